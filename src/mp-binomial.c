@@ -481,6 +481,62 @@ void i_stirling_second (mpz_t s, unsigned int n, unsigned int k)
 	i_triangle_cache_fetch (&cache, s, n, k);
 }
 
+/* ======================================================================= */
+/* i_eulerian - Eulerian numbers, the number of permutations of n
+ * elements with k ascents. Uses dynamically-sized cache.
+ */
+void i_eulerian (mpz_t a, unsigned int n, unsigned int k)
+{
+	DECLARE_I_CACHE (cache);
+
+	/* Trivial cases (not in the cache) */
+	if (0==k)
+	{
+		mpz_set_ui (a, 1);
+		return;
+	}
+
+	if (n<=k)
+	{
+		mpz_set_ui (a, 0);
+		return;
+	}
+
+	if (n==k+1)
+	{
+		mpz_set_ui (a, 1);
+		return;
+	}
+
+	/* Pull value from cache if it is there */
+	int hit = i_triangle_cache_check (&cache, n, k);
+	if (hit)
+	{
+		i_triangle_cache_fetch (&cache, a, n, k);
+		return;
+	}
+
+	/* Fill in the whole row, from the row above */
+	/* A(n, k) = (k+1) A(n-1, k) + (n-k) A(n-1, k-1) */
+	unsigned int i;
+	mpz_t akm, ak;
+	mpz_init (akm);
+	mpz_init (ak);
+	mpz_set_ui (akm, 1);
+	for (i=1; i<n-1; i++)
+	{
+		i_eulerian (ak, n-1, i);
+		mpz_mul_ui (a, ak, i+1);
+		mpz_addmul_ui (a, akm, n-i);
+		i_triangle_cache_store (&cache, a, n, i);
+		mpz_set (akm, ak);
+	}
+	mpz_clear (akm);
+	mpz_clear (ak);
+
+	i_triangle_cache_fetch (&cache, a, n, k);
+}
+
 /* ======================================================================= */
 /* binomial transform of power sum */
 
@@ -771,36 +827,57 @@ void cpx_binomial (cpx_t bin, const cpx_t ess, unsigned int k)
 	cpx_clear (bot);
 }
 
-void cpx_binomial_sum_cache (cpx_t bin, const cpx_t ess, unsigned int k)
+typedef struct
 {
-	DECLARE_CPX_CACHE (cache);
-	static int cache_bits = 0;
-	static cpx_t cache_s;
+	cpx_cache cache;
+	cpx_t cache_s;
+	int cache_bits;
+} binomial_sum_state;
 
-	if (!cache_bits)
-	{
-		cpx_init (cache_s);
-		cpx_set_ui (cache_s, 1, 0);
-	}
+static void * binomial_sum_state_new (void)
+{
+	binomial_sum_state *st = (binomial_sum_state *) malloc (sizeof (binomial_sum_state));
+	cpx_one_d_cache_init (&st->cache);
+	cpx_init (st->cache_s);
+	cpx_set_ui (st->cache_s, 1, 0);
+	st->cache_bits = 0;
+	return st;
+}
+
+static void binomial_sum_state_free (void *p)
+{
+	binomial_sum_state *st = (binomial_sum_state *) p;
+	cpx_one_d_cache_free (&st->cache);
+	cpx_clear (st->cache_s);
+	free (st);
+}
+
+/* Keyed on s, so one cache per thread. */
+DECLARE_THREAD_STATE (binomial_sum_state_key, binomial_sum_state_new,
+                      binomial_sum_state_free);
+
+void cpx_binomial_sum_cache (cpx_t bin, const cpx_t ess, unsigned int k)
+{
+	binomial_sum_state *st = thread_state_get (&binomial_sum_state_key);
 	int prec = mpf_get_default_prec();
-	if (cache_bits < prec)
+	if (st->cache_bits < prec)
 	{
-		cpx_set_prec (cache_s, prec);
-		cache_bits = prec;
+		cpx_set_prec (st->cache_s, prec);
+		st->cache_bits = prec;
 	}
 
 	/* First, check if this is the same s value as before */
-	if (!cpx_eq (cache_s, ess, prec))
+	if (!cpx_eq (st->cache_s, ess, prec))
 	{
-		cpx_one_d_cache_clear (&cache);
-		cpx_set (cache_s, ess);
+		cpx_one_d_cache_clear (&st->cache);
+		cpx_set (st->cache_s, ess);
 	}
 
 	/* Check the local cache */
-	int have_prec = cpx_one_d_cache_check (&cache, k);
+	int have_prec = cpx_one_d_cache_check (&st->cache, k);
 	if (have_prec >= prec)
 	{
-		cpx_one_d_cache_fetch (&cache, bin, k);
+		cpx_one_d_cache_fetch (&st->cache, bin, k);
 		return;
 	}
 
@@ -808,7 +885,7 @@ void cpx_binomial_sum_cache (cpx_t bin, const cpx_t ess, unsigned int k)
 	cpx_init (sn);
 	cpx_add_ui (sn, ess, k, 0);
 	cpx_binomial (bin, sn, k);
-	cpx_one_d_cache_store (&cache, bin, k, prec);
+	cpx_one_d_cache_store (&st->cache, bin, k, prec);
 	cpx_clear (sn);
 }
 
@@ -91,6 +91,13 @@ void i_stirbin_sum (mpz_t s, unsigned int n, unsigned int m);
  */
 void i_stirling_second (mpz_t s, unsigned int n, unsigned int k);
 
+/**
+ * i_eulerian - Eulerian numbers A(n,k), the number of permutations
+ * of n elements with k ascents; 0 <= k < n.
+ * Uses dynamically-sized cache.
+ */
+void i_eulerian (mpz_t a, unsigned int n, unsigned int k);
+
 /* binomial transform of power sum */
 void fp_bin_xform_pow (mpf_t bxp, unsigned int n, unsigned int s);
 
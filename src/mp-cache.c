@@ -22,6 +22,7 @@
  * 02110-1301  USA
  */
 
+#include <math.h>
 #include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -99,11 +100,12 @@ int i_triangle_cache_check (i_cache *c, unsigned int n, unsigned int k)
 
 	if (0 == n) n = 1;
 	unsigned int newsize = (n+1)*(n+2)/2;
+	unsigned int oldsize = (c->nmax+1)*(c->nmax+2)/2;
 	mpz_t* new_cache = (mpz_t *) malloc (newsize * sizeof (mpz_t));
-	if (c->nmax) memcpy(new_cache, c->cache, (c->nmax+1) * sizeof(mpz_t));
+	if (c->nmax) memcpy(new_cache, c->cache, oldsize * sizeof(mpz_t));
 
 	char* new_ticky = (char *) malloc (newsize * sizeof(char));
-	if (c->nmax) memcpy(new_ticky, c->ticky, (c->nmax+1) * sizeof(char));
+	if (c->nmax) memcpy(new_ticky, c->ticky, oldsize * sizeof(char));
 
 	unsigned int en;
 	unsigned int nstart = c->nmax + 1;
@@ -136,7 +138,8 @@ void i_one_d_cache_clear (i_cache *c)
 {
 	pthread_spin_lock(&c->lock);
 	unsigned int i;
-	for (i=0; i<c->nmax; i++)
+	/* nmax is the last valid index, not the size */
+	for (i=0; c->nmax && i<=c->nmax; i++)
 	{
 		c->ticky[i] = 0;
 	}
@@ -226,7 +229,8 @@ void fp_one_d_cache_clear (fp_cache *c)
 {
 	unsigned int i;
 	pthread_spin_lock(&c->lock);
-	for (i=0; i<c->nmax; i++)
+	/* nmax is the last valid index, not the size */
+	for (i=0; c->nmax && i<=c->nmax; i++)
 	{
 		c->precision[i] = 0;
 	}
@@ -321,12 +325,139 @@ void cpx_one_d_cache_clear (cpx_cache *c)
 {
 	unsigned int i;
 	pthread_spin_lock(&c->lock);
-	for (i=0; i<c->nmax; i++)
+	/* nmax is the last valid index, not the size */
+	for (i=0; c->nmax && i<=c->nmax; i++)
 	{
 		c->precision[i] = 0;
 	}
 	pthread_spin_unlock(&c->lock);
 }
 
+void cpx_one_d_cache_init (cpx_cache *c)
+{
+	c->nmax = 0;
+	c->cache = NULL;
+	c->precision = NULL;
+	pthread_spin_init(&c->lock, 0);
+}
+
+void cpx_one_d_cache_free (cpx_cache *c)
+{
+	unsigned int i;
+	for (i=0; c->nmax && i<=c->nmax; i++)
+	{
+		cpx_clear (c->cache[i]);
+	}
+	free (c->cache);
+	free (c->precision);
+	c->cache = NULL;
+	c->precision = NULL;
+	c->nmax = 0;
+	pthread_spin_destroy(&c->lock);
+}
+
+/* ======================================================================= */
+
+static unsigned int cpx_keyed_set (const cpx_t key)
+{
+	double re = fmod (floor (ldexp (cpx_get_re (key), 20) + 0.5), 4294967296.0);
+	double im = fmod (floor (ldexp (cpx_get_im (key), 20) + 0.5), 4294967296.0);
+	unsigned long h = (unsigned long) (long) re * 2654435761UL;
+	h ^= (unsigned long) (long) im * 40503UL;
+	h ^= h >> 15;
+	return h % CPX_KEYED_SETS;
+}
+
+/* The entry for key, if any, whatever its precision. Keys are
+ * compared to the lesser of the two precisions, so that there is
+ * never more than one entry per key. Call with the lock held. */
+static cpx_keyed_entry * cpx_keyed_find (cpx_keyed_cache *c, const cpx_t key, int prec)
+{
+	if (NULL == c->ent) return NULL;
+
+	cpx_keyed_entry *set = &c->ent[CPX_KEYED_WAYS * cpx_keyed_set (key)];
+	int i;
+	for (i=0; i<CPX_KEYED_WAYS; i++)
+	{
+		int p = set[i].precision;
+		if (0 == p) continue;
+		if (prec < p) p = prec;
+		if (cpx_eq (key, set[i].key, p*3.322)) return &set[i];
+	}
+	return NULL;
+}
+
+int cpx_keyed_cache_fetch (cpx_keyed_cache *c, const cpx_t key, int prec, cpx_t *vals)
+{
+	int i;
+	pthread_spin_lock(&c->lock);
+	cpx_keyed_entry *e = cpx_keyed_find (c, key, prec);
+	if (NULL == e || e->precision < prec)
+	{
+		pthread_spin_unlock(&c->lock);
+		return 0;
+	}
+	for (i=0; i<c->nvals; i++) cpx_set (vals[i], e->val[i]);
+	e->stamp = ++c->clock;
+	pthread_spin_unlock(&c->lock);
+	return 1;
+}
+
+void cpx_keyed_cache_store (cpx_keyed_cache *c, const cpx_t key, int prec, cpx_t *vals)
+{
+	int i, j;
+	pthread_spin_lock(&c->lock);
+	if (NULL == c->ent)
+	{
+		int nent = CPX_KEYED_SETS * CPX_KEYED_WAYS;
+		c->ent = (cpx_keyed_entry *) malloc (nent * sizeof (cpx_keyed_entry));
+		for (i=0; i<nent; i++)
+		{
+			cpx_keyed_entry *e = &c->ent[i];
+			cpx_init (e->key);
+			e->val = (cpx_t *) malloc (c->nvals * sizeof (cpx_t));
+			for (j=0; j<c->nvals; j++) cpx_init (e->val[j]);
+			e->precision = 0;
+			e->stamp = 0;
+		}
+	}
+
+	/* Overwrite this key, if present, else the oldest in the set */
+	cpx_keyed_entry *e = cpx_keyed_find (c, key, prec);
+	if (NULL == e)
+	{
+		cpx_keyed_entry *set = &c->ent[CPX_KEYED_WAYS * cpx_keyed_set (key)];
+		e = &set[0];
+		for (i=1; i<CPX_KEYED_WAYS; i++)
+		{
+			if (set[i].stamp < e->stamp) e = &set[i];
+		}
+	}
+
+	cpx_set_prec (e->key, 3.322*prec+50);
+	cpx_set (e->key, key);
+	for (j=0; j<c->nvals; j++)
+	{
+		cpx_set_prec (e->val[j], 3.322*prec+50);
+		cpx_set (e->val[j], vals[j]);
+	}
+	e->precision = prec;
+	e->stamp = ++c->clock;
+	pthread_spin_unlock(&c->lock);
+}
+
+/* ======================================================================= */
+
+void * thread_state_get (thread_state *ts)
+{
+	void *st = pthread_getspecific (ts->key);
+	if (NULL == st)
+	{
+		st = ts->ctor ();
+		pthread_setspecific (ts->key, st);
+	}
+	return st;
+}
+
 /* =============================== END OF FILE =========================== */
 
@@ -275,4 +275,87 @@ static inline void cpx_one_d_cache_store (cpx_cache *c, const cpx_t val, unsigne
 
 void cpx_one_d_cache_clear (cpx_cache *c);
 
+/**
+ * cpx_one_d_cache_init - initialize a cache that was not declared
+ * with DECLARE_CPX_CACHE, e.g. one that lives on the heap.
+ */
+void cpx_one_d_cache_init (cpx_cache *c);
+
+/**
+ * cpx_one_d_cache_free - release all storage held by the cache
+ */
+void cpx_one_d_cache_free (cpx_cache *c);
+
+/* ======================================================================= */
+/* Keyed cache */
+/* A small table of values that depend on a complex argument s and a
+ * precision, e.g. gamma(1-s) or (2pi)^{-s}, for a handful of distinct
+ * s at a time. Each entry holds nvals complex values. Entries are
+ * hashed on s into sets of CPX_KEYED_WAYS; within a set, the least
+ * recently used entry is replaced. Safe to share between threads.
+ */
+
+#define CPX_KEYED_SETS 16
+#define CPX_KEYED_WAYS 4
+
+typedef struct
+{
+	cpx_t key;
+	cpx_t *val;
+	int precision; /* base-10 precision; zero if unused */
+	unsigned long stamp;
+} cpx_keyed_entry;
+
+typedef struct
+{
+	int nvals;
+	unsigned long clock;
+	cpx_keyed_entry *ent;
+	pthread_spinlock_t lock;
+} cpx_keyed_cache;
+
+#define DECLARE_CPX_KEYED_CACHE(name, nv)         \
+	static cpx_keyed_cache name = {.nvals=nv, .clock=0, .ent=NULL, }; \
+	__attribute__((constructor)) \
+	void cpx_keyed_cache_ctor##name () { \
+		pthread_spin_init(&name.lock, 0); }
+
+/**
+ * cpx_keyed_cache_fetch - if there are values for key, good to at
+ * least prec digits, copy them to vals[0..nvals-1] and return true;
+ * else return false.
+ */
+int cpx_keyed_cache_fetch (cpx_keyed_cache *c, const cpx_t key, int prec, cpx_t *vals);
+
+/**
+ * cpx_keyed_cache_store - store vals[0..nvals-1] for key, at prec
+ */
+void cpx_keyed_cache_store (cpx_keyed_cache *c, const cpx_t key, int prec, cpx_t *vals);
+
+/* ======================================================================= */
+/* Per-thread state */
+/* Caches keyed on the most recent argument (e.g. "the last s") cannot
+ * be shared between threads, as each thread clobbers the key for the
+ * others. Such state is kept one copy per thread instead: created by
+ * ctor on first use in that thread, and handed to dtor when the thread
+ * exits.
+ */
+
+typedef struct
+{
+	pthread_key_t key;
+	void * (*ctor) (void);
+} thread_state;
+
+#define DECLARE_THREAD_STATE(name, ctorfn, dtorfn)         \
+	static thread_state name = {.ctor=ctorfn, }; \
+	__attribute__((constructor)) \
+	void thread_state_ctor##name () { \
+		pthread_key_create(&name.key, dtorfn); }
+
+/**
+ * thread_state_get - this thread's copy of the state
+ */
+void * thread_state_get (thread_state *ts);
+
 /* =============================== END OF FILE =========================== */
@@ -328,17 +328,24 @@ void fp_log_two_pi (mpf_t ltp, unsigned int prec)
 		pthread_spin_unlock(&mp_const_lock);
 		return;
 	}
+	pthread_spin_unlock(&mp_const_lock);
 
-	if (0 == precision)
-	{
-		mpf_init (cached_ltp);
-	}
-	mpf_set_prec (cached_ltp, 3.322*prec +50);
-
+	/* Compute outside of the lock: fp_two_pi() takes it too,
+	 * and so may fp_log(), by way of fp_log2(). */
 	fp_two_pi (ltp, prec);
 	fp_log (ltp, ltp, prec);
-	mpf_set (cached_ltp, ltp);
-	precision = prec;
+
+	pthread_spin_lock(&mp_const_lock);
+	if (precision < prec)
+	{
+		if (0 == precision)
+		{
+			mpf_init (cached_ltp);
+		}
+		mpf_set_prec (cached_ltp, 3.322*prec +50);
+		mpf_set (cached_ltp, ltp);
+		precision = prec;
+	}
 	pthread_spin_unlock(&mp_const_lock);
 }
 
@@ -0,0 +1,200 @@
+/*
+ * mp-dd.c
+ *
+ * Elementary functions in double-double precision.
+ *
+ * Copyright (C) 2026 Linas Vepstas
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301  USA
+ */
+
+#include <math.h>
+#include <stdio.h>
+
+#include "mp-dd.h"
+
+/* ============================================================= */
+
+const dd_t dd_pi = {3.141592653589793, 1.2246467991473532e-16};
+const dd_t dd_two_pi = {6.283185307179586, 2.4492935982947064e-16};
+const dd_t dd_pi_half = {1.5707963267948966, 6.123233995736766e-17};
+const dd_t dd_log2 = {0.6931471805599453, 2.3190468138462996e-17};
+const dd_t dd_log_two_pi = {1.8378770664093456, -7.756588316134483e-17};
+const dd_t dd_euler_mascheroni = {0.5772156649015329, -4.942915152430645e-18};
+const dd_t dd_half_sqrt_three = {0.8660254037844386, 5.0175421109034514e-17};
+
+/* Terms smaller than this are dropped from the series below. */
+#define DD_EPS 1.0e-34
+
+/* ============================================================= */
+/**
+ * dd_exp -- exponential.
+ *
+ * Reduce x = m log 2 + r, scale r down by 2^10, sum the Taylor
+ * series for exp(r)-1, and then square back up ten times.
+ */
+dd_t dd_exp (dd_t x)
+{
+	if (709.0 < x.hi) return dd_set_d (INFINITY);
+	if (-745.0 > x.hi) return dd_set_d (0.0);
+
+	double m = nearbyint (x.hi / dd_log2.hi);
+	dd_t r = dd_sub (x, dd_mul_d (dd_log2, m));
+	r = dd_ldexp (r, -10);
+
+	/* s = exp(r) - 1 */
+	dd_t s = r;
+	dd_t term = r;
+	int i;
+	for (i=2; i<20; i++)
+	{
+		term = dd_div_d (dd_mul (term, r), (double) i);
+		s = dd_add (s, term);
+		if (fabs (term.hi) < DD_EPS) break;
+	}
+
+	/* (1+s)^2 - 1 = 2s + s^2 */
+	for (i=0; i<10; i++)
+	{
+		s = dd_add (dd_ldexp (s, 1), dd_mul (s, s));
+	}
+
+	s = dd_add_d (s, 1.0);
+	return dd_ldexp (s, (int) m);
+}
+
+/* ============================================================= */
+/**
+ * dd_log -- natural logarithm.
+ *
+ * One Newton step y += x exp(-y) - 1, starting from the
+ * double-precision log, doubles the number of correct bits.
+ */
+dd_t dd_log (dd_t x)
+{
+	dd_t y = dd_set_d (log (x.hi));
+	dd_t t = dd_mul (x, dd_exp (dd_neg (y)));
+	y = dd_add (y, dd_add_d (t, -1.0));
+	return y;
+}
+
+/* ============================================================= */
+/**
+ * dd_sincos -- sine and cosine.
+ *
+ * Reduce modulo pi/2, then sum the Taylor series on |r| < pi/4.
+ */
+void dd_sincos (dd_t *sine, dd_t *cosine, dd_t x)
+{
+	double j = nearbyint (x.hi / dd_pi_half.hi);
+	dd_t r = dd_sub (x, dd_mul_d (dd_pi_half, j));
+	dd_t rsq = dd_neg (dd_mul (r, r));
+
+	dd_t s = r;
+	dd_t c = dd_set_d (1.0);
+	dd_t st = r;
+	dd_t ct = c;
+	int i;
+	for (i=1; i<30; i++)
+	{
+		st = dd_div_d (dd_mul (st, rsq), (double) (2*i*(2*i+1)));
+		ct = dd_div_d (dd_mul (ct, rsq), (double) (2*i*(2*i-1)));
+		s = dd_add (s, st);
+		c = dd_add (c, ct);
+		if (fabs (ct.hi) < DD_EPS) break;
+	}
+
+	/* Quadrant */
+	int q = ((int) fmod (j, 4.0) + 4) % 4;
+	switch (q)
+	{
+		case 0: *sine = s; *cosine = c; break;
+		case 1: *sine = c; *cosine = dd_neg (s); break;
+		case 2: *sine = dd_neg (s); *cosine = dd_neg (c); break;
+		case 3: *sine = dd_neg (c); *cosine = s; break;
+	}
+}
+
+/* ============================================================= */
+
+dd_t dd_pow_ui (dd_t x, unsigned int n)
+{
+	dd_t r = dd_set_d (1.0);
+	while (n)
+	{
+		if (n & 1) r = dd_mul (r, x);
+		n >>= 1;
+		if (n) x = dd_mul (x, x);
+	}
+	return r;
+}
+
+cdd_t cdd_exp (cdd_t z)
+{
+	dd_t mag = dd_exp (z.re);
+	cdd_t r;
+	dd_sincos (&r.im, &r.re, z.im);
+	r.re = dd_mul (r.re, mag);
+	r.im = dd_mul (r.im, mag);
+	return r;
+}
+
+cdd_t cdd_pow_log (dd_t logx, cdd_t s)
+{
+	return cdd_exp (cdd_times_dd (s, logx));
+}
+
+cdd_t cdd_ui_pow (unsigned int k, cdd_t s)
+{
+	if (1 == k) return cdd_set_d (1.0, 0.0);
+	return cdd_pow_log (dd_log (dd_set_d ((double) k)), s);
+}
+
+/* ============================================================= */
+
+void lowprec_cross_check (const char *name, const cpx_t fast,
+                          const cpx_t slow, const cpx_t ess,
+                          const cpx_t zee, int prec)
+{
+	cpx_t diff;
+	mpf_t mag, eps;
+	cpx_init (diff);
+	mpf_init (mag);
+	mpf_init (eps);
+
+	cpx_sub (diff, fast, slow);
+	cpx_mod_sq (eps, diff);
+	cpx_mod_sq (mag, slow);
+	if (0 != mpf_sgn (mag)) mpf_div (eps, eps, mag);
+
+	double rel = 0.5 * log10 (mpf_get_d (eps) + 1.0e-300);
+	if (rel > 2-prec)
+	{
+		printf ("Error: %s lowprec mismatch at prec=%d, rel err=1e%g\n"
+		        "\ts=%g+i%g z=%g+i%g\n"
+		        "\tfast=%g+i%g gmp=%g+i%g\n", name, prec, rel,
+		        cpx_get_re (ess), cpx_get_im (ess),
+		        cpx_get_re (zee), cpx_get_im (zee),
+		        cpx_get_re (fast), cpx_get_im (fast),
+		        cpx_get_re (slow), cpx_get_im (slow));
+	}
+
+	cpx_clear (diff);
+	mpf_clear (mag);
+	mpf_clear (eps);
+}
+
+/* =============================== END OF FILE =========================== */
@@ -0,0 +1,364 @@
+/*
+ * mp-dd.h
+ *
+ * Double-double arithmetic, for fast low-precision evaluation.
+ *
+ * A double-double is an unevaluated sum hi+lo of two IEEE doubles,
+ * with |lo| <= ulp(hi)/2; this gives about 106 bits, or 31 decimal
+ * digits, of precision. For requests of less than 30-odd digits,
+ * this is one to two orders of magnitude faster than GMP, whose
+ * per-operation overhead dominates at such low precision.
+ *
+ * The arithmetic follows the usual Dekker/Knuth error-free
+ * transformations, as in the QD library of Hida, Li and Bailey.
+ *
+ * Copyright (C) 2026 Linas Vepstas
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301  USA
+ */
+
+#include <math.h>
+#include <gmp.h>
+#include "mp-complex.h"
+
+#ifndef __MP_DD_H__
+#define __MP_DD_H__
+
+#ifdef  __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Precision thresholds, in decimal digits, for the low-precision
+ * fast paths. These are compared against the number of digits that
+ * an algorithm needs internally (i.e. including the digits lost to
+ * cancellation), not the number of digits requested by the caller.
+ * If the internal precision exceeds LOWPREC_DD_DIGITS, the GMP code
+ * is used.
+ */
+#define LOWPREC_DOUBLE_DIGITS 15
+#define LOWPREC_DD_DIGITS 30
+
+typedef struct {
+	double hi;
+	double lo;
+} dd_t;
+
+typedef struct {
+	dd_t re;
+	dd_t im;
+} cdd_t;
+
+/* ============================================================= */
+/* Error-free transformations */
+
+static inline dd_t __dd_quick_two_sum (double a, double b)
+{
+	dd_t r;
+	r.hi = a + b;
+	r.lo = b - (r.hi - a);
+	return r;
+}
+
+static inline dd_t __dd_two_sum (double a, double b)
+{
+	dd_t r;
+	r.hi = a + b;
+	double bb = r.hi - a;
+	r.lo = (a - (r.hi - bb)) + (b - bb);
+	return r;
+}
+
+static inline dd_t __dd_two_prod (double a, double b)
+{
+	dd_t r;
+	r.hi = a * b;
+#ifdef FP_FAST_FMA
+	r.lo = fma (a, b, -r.hi);
+#else
+	/* Dekker split into 26-bit halves */
+	const double split = 134217729.0;  /* 2^27 + 1 */
+	double t = split * a;
+	double ahi = t - (t - a);
+	double alo = a - ahi;
+	t = split * b;
+	double bhi = t - (t - b);
+	double blo = b - bhi;
+	r.lo = ((ahi * bhi - r.hi) + ahi * blo + alo * bhi) + alo * blo;
+#endif
+	return r;
+}
+
+/* ============================================================= */
+/* Real double-double arithmetic */
+
+static inline dd_t dd_set_d (double x)
+{
+	dd_t r;
+	r.hi = x;
+	r.lo = 0.0;
+	return r;
+}
+
+static inline dd_t dd_neg (dd_t a)
+{
+	a.hi = -a.hi;
+	a.lo = -a.lo;
+	return a;
+}
+
+static inline dd_t dd_add (dd_t a, dd_t b)
+{
+	dd_t s = __dd_two_sum (a.hi, b.hi);
+	dd_t t = __dd_two_sum (a.lo, b.lo);
+	s.lo += t.hi;
+	s = __dd_quick_two_sum (s.hi, s.lo);
+	s.lo += t.lo;
+	return __dd_quick_two_sum (s.hi, s.lo);
+}
+
+static inline dd_t dd_add_d (dd_t a, double b)
+{
+	dd_t s = __dd_two_sum (a.hi, b);
+	s.lo += a.lo;
+	return __dd_quick_two_sum (s.hi, s.lo);
+}
+
+static inline dd_t dd_sub (dd_t a, dd_t b)
+{
+	return dd_add (a, dd_neg (b));
+}
+
+static inline dd_t dd_mul (dd_t a, dd_t b)
+{
+	dd_t p = __dd_two_prod (a.hi, b.hi);
+	p.lo += a.hi * b.lo + a.lo * b.hi;
+	return __dd_quick_two_sum (p.hi, p.lo);
+}
+
+static inline dd_t dd_mul_d (dd_t a, double b)
+{
+	dd_t p = __dd_two_prod (a.hi, b);
+	p.lo += a.lo * b;
+	return __dd_quick_two_sum (p.hi, p.lo);
+}
+
+static inline dd_t dd_div (dd_t a, dd_t b)
+{
+	double q1 = a.hi / b.hi;
+	dd_t r = dd_sub (a, dd_mul_d (b, q1));
+	double q2 = r.hi / b.hi;
+	r = dd_sub (r, dd_mul_d (b, q2));
+	double q3 = r.hi / b.hi;
+	r = __dd_quick_two_sum (q1, q2);
+	return dd_add_d (r, q3);
+}
+
+static inline dd_t dd_div_d (dd_t a, double b)
+{
+	double q1 = a.hi / b;
+	dd_t p = __dd_two_prod (q1, b);
+	dd_t r = __dd_two_sum (a.hi, -p.hi);
+	r.lo -= p.lo;
+	r.lo += a.lo;
+	double q2 = (r.hi + r.lo) / b;
+	return __dd_quick_two_sum (q1, q2);
+}
+
+static inline dd_t dd_ldexp (dd_t a, int n)
+{
+	a.hi = ldexp (a.hi, n);
+	a.lo = ldexp (a.lo, n);
+	return a;
+}
+
+/* ============================================================= */
+/* Complex double-double arithmetic */
+
+static inline cdd_t cdd_set_d (double re, double im)
+{
+	cdd_t z;
+	z.re = dd_set_d (re);
+	z.im = dd_set_d (im);
+	return z;
+}
+
+static inline cdd_t cdd_neg (cdd_t a)
+{
+	a.re = dd_neg (a.re);
+	a.im = dd_neg (a.im);
+	return a;
+}
+
+static inline cdd_t cdd_add (cdd_t a, cdd_t b)
+{
+	a.re = dd_add (a.re, b.re);
+	a.im = dd_add (a.im, b.im);
+	return a;
+}
+
+static inline cdd_t cdd_sub (cdd_t a, cdd_t b)
+{
+	a.re = dd_sub (a.re, b.re);
+	a.im = dd_sub (a.im, b.im);
+	return a;
+}
+
+static inline cdd_t cdd_mul (cdd_t a, cdd_t b)
+{
+	cdd_t p;
+	p.re = dd_sub (dd_mul (a.re, b.re), dd_mul (a.im, b.im));
+	p.im = dd_add (dd_mul (a.re, b.im), dd_mul (a.im, b.re));
+	return p;
+}
+
+static inline cdd_t cdd_times_dd (cdd_t a, dd_t b)
+{
+	a.re = dd_mul (a.re, b);
+	a.im = dd_mul (a.im, b);
+	return a;
+}
+
+static inline cdd_t cdd_times_d (cdd_t a, double b)
+{
+	a.re = dd_mul_d (a.re, b);
+	a.im = dd_mul_d (a.im, b);
+	return a;
+}
+
+static inline cdd_t cdd_recip (cdd_t a)
+{
+	dd_t den = dd_add (dd_mul (a.re, a.re), dd_mul (a.im, a.im));
+	a.re = dd_div (a.re, den);
+	a.im = dd_neg (dd_div (a.im, den));
+	return a;
+}
+
+static inline cdd_t cdd_div (cdd_t a, cdd_t b)
+{
+	return cdd_mul (a, cdd_recip (b));
+}
+
+static inline double cdd_mod_sq_d (cdd_t a)
+{
+	return a.re.hi * a.re.hi + a.im.hi * a.im.hi;
+}
+
+/* ============================================================= */
+/* Conversion to and from GMP */
+
+static inline dd_t dd_get_mpf (const mpf_t x)
+{
+	mpf_t rem;
+	mpf_init2 (rem, mpf_get_prec (x));
+
+	dd_t r;
+	r.hi = mpf_get_d (x);
+	mpf_set_d (rem, r.hi);
+	mpf_sub (rem, x, rem);
+	r.lo = mpf_get_d (rem);
+	mpf_clear (rem);
+	return __dd_quick_two_sum (r.hi, r.lo);
+}
+
+static inline void dd_set_mpf (mpf_t r, dd_t x)
+{
+	mpf_t lo;
+	mpf_init2 (lo, 64);
+	mpf_set_d (lo, x.lo);
+	mpf_set_d (r, x.hi);
+	mpf_add (r, r, lo);
+	mpf_clear (lo);
+}
+
+static inline cdd_t cdd_get_cpx (const cpx_t z)
+{
+	cdd_t r;
+	r.re = dd_get_mpf (z[0].re);
+	r.im = dd_get_mpf (z[0].im);
+	return r;
+}
+
+static inline void cdd_set_cpx (cpx_t r, cdd_t z)
+{
+	dd_set_mpf (r[0].re, z.re);
+	dd_set_mpf (r[0].im, z.im);
+}
+
+/* ============================================================= */
+/* Constants */
+
+extern const dd_t dd_pi;
+extern const dd_t dd_two_pi;
+extern const dd_t dd_pi_half;
+extern const dd_t dd_log2;
+extern const dd_t dd_log_two_pi;
+extern const dd_t dd_euler_mascheroni;
+extern const dd_t dd_half_sqrt_three;
+
+/* ============================================================= */
+/* Elementary functions, implemented in mp-dd.c */
+
+/**
+ * dd_exp, dd_log -- exponential and natural log.
+ * dd_log requires a positive argument.
+ */
+dd_t dd_exp (dd_t x);
+dd_t dd_log (dd_t x);
+
+/**
+ * dd_sincos -- sine and cosine, computed together.
+ * Argument reduction is modulo pi/2, and so accuracy degrades
+ * in proportion to |x|.
+ */
+void dd_sincos (dd_t *sine, dd_t *cosine, dd_t x);
+
+/**
+ * dd_pow_ui -- return x^n, by repeated squaring.
+ */
+dd_t dd_pow_ui (dd_t x, unsigned int n);
+
+/**
+ * cdd_exp -- complex exponential.
+ */
+cdd_t cdd_exp (cdd_t z);
+
+/**
+ * cdd_pow_log -- return exp(s log x) for complex s, given the real
+ * value log x. Handy for k^s, where log k can be reused.
+ */
+cdd_t cdd_pow_log (dd_t logx, cdd_t s);
+
+/**
+ * cdd_ui_pow -- return k^s for complex s and positive integer k.
+ */
+cdd_t cdd_ui_pow (unsigned int k, cdd_t s);
+
+/**
+ * lowprec_cross_check -- compare a fast-path result against the
+ * GMP result, and print a complaint if they differ by more than
+ * the requested precision. Used when CROSS_VALIDATE_LOWPREC is
+ * defined.
+ */
+void lowprec_cross_check (const char *name, const cpx_t fast,
+                          const cpx_t slow, const cpx_t ess,
+                          const cpx_t zee, int prec);
+
+#ifdef  __cplusplus
+};
+#endif
+
+#endif /* __MP_DD_H__ */
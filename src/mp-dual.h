@@ -0,0 +1,262 @@
+/*
+ * mp-dual.h
+ *
+ * Forward-mode dual numbers over cpx_t, for computing a function
+ * value together with its first partial derivatives, in one pass.
+ *
+ * A dual number is a value, together with its derivatives with
+ * respect to CPX_DUAL_N independent variables. Arithmetic on
+ * dual numbers applies the chain rule as it goes; the variables are
+ * seeded with cpx_dual_var(), and everything else with
+ * cpx_dual_const(). Two variables are enough for f(s,z).
+ *
+ * Copyright (C) 2026 Linas Vepstas
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301  USA
+ */
+
+#include <gmp.h>
+#include "mp-complex.h"
+#include "mp-trig.h"
+
+#ifndef __MP_DUAL_H__
+#define __MP_DUAL_H__
+
+#ifdef  __cplusplus
+extern "C" {
+#endif
+
+#define CPX_DUAL_N 2
+
+/* a[0] is the value, a[1+i] the derivative by the i'th variable */
+typedef cpx_t cpx_dual_t[1+CPX_DUAL_N];
+
+static inline void cpx_dual_init (cpx_dual_t a)
+{
+	int i;
+	cpx_init (a[0]);
+	for (i=0; i<CPX_DUAL_N; i++) cpx_init (a[1+i]);
+}
+
+static inline void cpx_dual_clear (cpx_dual_t a)
+{
+	int i;
+	cpx_clear (a[0]);
+	for (i=0; i<CPX_DUAL_N; i++) cpx_clear (a[1+i]);
+}
+
+static inline void cpx_dual_set (cpx_dual_t a, const cpx_dual_t b)
+{
+	int i;
+	cpx_set (a[0], b[0]);
+	for (i=0; i<CPX_DUAL_N; i++) cpx_set (a[1+i], b[1+i]);
+}
+
+/** cpx_dual_const -- a = x, a constant */
+static inline void cpx_dual_const (cpx_dual_t a, const cpx_t x)
+{
+	int i;
+	cpx_set (a[0], x);
+	for (i=0; i<CPX_DUAL_N; i++) cpx_set_ui (a[1+i], 0, 0);
+}
+
+/** cpx_dual_set_ui -- a = x + iy, a constant */
+static inline void cpx_dual_set_ui (cpx_dual_t a, unsigned long x, unsigned long y)
+{
+	int i;
+	cpx_set_ui (a[0], x, y);
+	for (i=0; i<CPX_DUAL_N; i++) cpx_set_ui (a[1+i], 0, 0);
+}
+
+/** cpx_dual_var -- a = x, the n'th independent variable */
+static inline void cpx_dual_var (cpx_dual_t a, const cpx_t x, int n)
+{
+	cpx_dual_const (a, x);
+	cpx_set_ui (a[1+n], 1, 0);
+}
+
+static inline void cpx_dual_add (cpx_dual_t sum, const cpx_dual_t a, const cpx_dual_t b)
+{
+	int i;
+	cpx_add (sum[0], a[0], b[0]);
+	for (i=0; i<CPX_DUAL_N; i++) cpx_add (sum[1+i], a[1+i], b[1+i]);
+}
+
+static inline void cpx_dual_sub (cpx_dual_t dif, const cpx_dual_t a, const cpx_dual_t b)
+{
+	int i;
+	cpx_sub (dif[0], a[0], b[0]);
+	for (i=0; i<CPX_DUAL_N; i++) cpx_sub (dif[1+i], a[1+i], b[1+i]);
+}
+
+static inline void cpx_dual_neg (cpx_dual_t neg, const cpx_dual_t a)
+{
+	int i;
+	cpx_neg (neg[0], a[0]);
+	for (i=0; i<CPX_DUAL_N; i++) cpx_neg (neg[1+i], a[1+i]);
+}
+
+/** cpx_dual_add_ui -- sum = a + (rb + i ib); constants don't move d[] */
+static inline void cpx_dual_add_ui (cpx_dual_t sum, const cpx_dual_t a,
+                                    unsigned long rb, unsigned long ib)
+{
+	int i;
+	cpx_add_ui (sum[0], a[0], rb, ib);
+	for (i=0; i<CPX_DUAL_N; i++) cpx_set (sum[1+i], a[1+i]);
+}
+
+static inline void cpx_dual_times_mpf (cpx_dual_t prod, const cpx_dual_t a, const mpf_t b)
+{
+	int i;
+	cpx_times_mpf (prod[0], a[0], b);
+	for (i=0; i<CPX_DUAL_N; i++) cpx_times_mpf (prod[1+i], a[1+i], b);
+}
+
+/** cpx_dual_times_cpx -- prod = a * b, for a constant b */
+static inline void cpx_dual_times_cpx (cpx_dual_t prod, const cpx_dual_t a, const cpx_t b)
+{
+	int i;
+	cpx_mul (prod[0], a[0], b);
+	for (i=0; i<CPX_DUAL_N; i++) cpx_mul (prod[1+i], a[1+i], b);
+}
+
+/** cpx_dual_mul -- prod = a * b; (ab)' = a'b + ab' */
+static inline void cpx_dual_mul (cpx_dual_t prod, const cpx_dual_t a, const cpx_dual_t b)
+{
+	int i;
+	cpx_t tmp;
+	cpx_init2 (tmp, mpf_get_prec (prod[0][0].re));
+	for (i=0; i<CPX_DUAL_N; i++)
+	{
+		cpx_mul (tmp, a[1+i], b[0]);
+		cpx_addmul (tmp, a[0], b[1+i]);
+		cpx_set (prod[1+i], tmp);
+	}
+	cpx_mul (prod[0], a[0], b[0]);
+	cpx_clear (tmp);
+}
+
+/** cpx_dual_addmul -- acc += a * b */
+static inline void cpx_dual_addmul (cpx_dual_t acc, const cpx_dual_t a, const cpx_dual_t b)
+{
+	int i;
+	for (i=0; i<CPX_DUAL_N; i++)
+	{
+		cpx_addmul (acc[1+i], a[1+i], b[0]);
+		cpx_addmul (acc[1+i], a[0], b[1+i]);
+	}
+	cpx_addmul (acc[0], a[0], b[0]);
+}
+
+/**
+ * cpx_dual_chain -- the chain rule: given f = f(a) and fp = f'(a),
+ * computed by the caller, out = f(a) as a dual number.
+ */
+static inline void cpx_dual_chain (cpx_dual_t out, const cpx_dual_t a,
+                                   const cpx_t f, const cpx_t fp)
+{
+	int i;
+	for (i=0; i<CPX_DUAL_N; i++) cpx_mul (out[1+i], a[1+i], fp);
+	cpx_set (out[0], f);
+}
+
+/** cpx_dual_recip -- recip = 1/a; (1/a)' = -a'/a^2 */
+static inline void cpx_dual_recip (cpx_dual_t recip, const cpx_dual_t a)
+{
+	cpx_t f, fp;
+	cpx_init2 (f, mpf_get_prec (recip[0][0].re));
+	cpx_init2 (fp, mpf_get_prec (recip[0][0].re));
+	cpx_recip (f, a[0]);
+	cpx_mul (fp, f, f);
+	cpx_neg (fp, fp);
+	cpx_dual_chain (recip, a, f, fp);
+	cpx_clear (f);
+	cpx_clear (fp);
+}
+
+static inline void cpx_dual_div (cpx_dual_t ratio, const cpx_dual_t a, const cpx_dual_t b)
+{
+	cpx_dual_t recip;
+	cpx_dual_init (recip);
+	cpx_dual_recip (recip, b);
+	cpx_dual_mul (ratio, a, recip);
+	cpx_dual_clear (recip);
+}
+
+/** cpx_dual_pow_ui -- pow = a^n */
+static inline void cpx_dual_pow_ui (cpx_dual_t pow, const cpx_dual_t a, unsigned int n)
+{
+	cpx_t f, fp;
+	cpx_init2 (f, mpf_get_prec (pow[0][0].re));
+	cpx_init2 (fp, mpf_get_prec (pow[0][0].re));
+	if (0 == n)
+	{
+		cpx_set_ui (f, 1, 0);
+		cpx_set_ui (fp, 0, 0);
+	}
+	else
+	{
+		cpx_pow_ui (fp, a[0], n-1);
+		cpx_mul (f, fp, a[0]);
+		cpx_times_ui (fp, fp, n);
+	}
+	cpx_dual_chain (pow, a, f, fp);
+	cpx_clear (f);
+	cpx_clear (fp);
+}
+
+/**
+ * cpx_dual_pow -- pow = q^s, with both q and s dual; principal branch.
+ * (q^s)' = q^s (s' log q + s q'/q)
+ */
+static inline void cpx_dual_pow (cpx_dual_t pow, const cpx_dual_t q,
+                                 const cpx_dual_t s, int prec)
+{
+	int i;
+	cpx_t lq, f, fq, tmp;
+	cpx_init (lq);
+	cpx_init (f);
+	cpx_init (fq);
+	cpx_init (tmp);
+
+	cpx_log (lq, q[0], prec);
+	cpx_mul (f, lq, s[0]);
+	cpx_exp (f, f, prec);
+
+	/* fq = s q^s / q, and lq = q^s log q */
+	cpx_mul (fq, f, s[0]);
+	cpx_div (fq, fq, q[0]);
+	cpx_mul (lq, lq, f);
+
+	for (i=0; i<CPX_DUAL_N; i++)
+	{
+		cpx_mul (tmp, q[1+i], fq);
+		cpx_mul (pow[1+i], s[1+i], lq);
+		cpx_add (pow[1+i], pow[1+i], tmp);
+	}
+	cpx_set (pow[0], f);
+
+	cpx_clear (lq);
+	cpx_clear (f);
+	cpx_clear (fq);
+	cpx_clear (tmp);
+}
+
+#ifdef  __cplusplus
+};
+#endif
+
+#endif /* __MP_DUAL_H__ */
@@ -0,0 +1,125 @@
+/*
+ * mp-fft.c
+ *
+ * Fast Fourier transform of arrays of complex multi-precision numbers.
+ *
+ * Copyright (C) 2026 Linas Vepstas
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301  USA
+ */
+
+#include <math.h>
+#include <stdlib.h>
+
+#include <gmp.h>
+#include "mp-complex.h"
+#include "mp-consts.h"
+#include "mp-fft.h"
+#include "mp-trig.h"
+
+/* ======================================================================= */
+/**
+ * fft_twiddle -- w[k] = exp(sign 2pi i k/n) for 0 <= k < n/2.
+ *
+ * Only the roots at power-of-two k are computed with sine and cosine;
+ * the rest are products of these, one per entry, so that the roundoff
+ * grows with log n, not with n.
+ */
+static void fft_twiddle (cpx_t *w, unsigned int n, int sign, int prec)
+{
+	mp_bitcnt_t bits = 3.322 * prec + 50;
+	mpf_t ang;
+	mpf_init2 (ang, bits);
+
+	cpx_set_ui (w[0], 1, 0);
+	unsigned int b, k;
+	for (b=1; b<n/2; b<<=1)
+	{
+		fp_two_pi (ang, prec);
+		mpf_mul_ui (ang, ang, b);
+		mpf_div_ui (ang, ang, n);
+		fp_cosine (w[b][0].re, ang, prec);
+		fp_sine (w[b][0].im, ang, prec);
+		if (0 > sign) mpf_neg (w[b][0].im, w[b][0].im);
+
+		for (k=1; k<b; k++)
+		{
+			cpx_mul (w[b+k], w[b], w[k]);
+		}
+	}
+
+	mpf_clear (ang);
+}
+
+void cpx_fft (cpx_t *data, unsigned int n, int sign, int prec)
+{
+	unsigned int i, j, k, h;
+	if (n < 2) return;
+
+	/* Guard digits for the twiddles */
+	int wprec = prec + (int) log10 ((double) n) + 3;
+	mp_bitcnt_t bits = 3.322 * wprec + 50;
+
+	cpx_t *w = (cpx_t *) malloc ((n/2) * sizeof (cpx_t));
+	for (k=0; k<n/2; k++) cpx_init2 (w[k], bits);
+	fft_twiddle (w, n, sign, wprec);
+
+	/* Bit-reversal permutation */
+	j = 0;
+	for (i=0; i<n-1; i++)
+	{
+		if (i < j)
+		{
+			mpf_swap (data[i][0].re, data[j][0].re);
+			mpf_swap (data[i][0].im, data[j][0].im);
+		}
+		k = n >> 1;
+		while (k <= j) { j -= k; k >>= 1; }
+		j += k;
+	}
+
+	/* Butterflies, with the scratch space hoisted out of the loops */
+	mpf_t vre, vim, tmp;
+	mp_bitcnt_t dbits = mpf_get_prec (data[0][0].re) + 8;
+	mpf_init2 (vre, dbits);
+	mpf_init2 (vim, dbits);
+	mpf_init2 (tmp, dbits);
+	for (h=1; h<n; h<<=1)
+	{
+		unsigned int stride = n / (2*h);
+		for (i=0; i<n; i+= 2*h)
+		{
+			for (k=0; k<h; k++)
+			{
+				cpx_t *lo = &data[i+k];
+				cpx_t *hi = &data[i+k+h];
+				__cpx_mul_parts (vre, vim, tmp, *hi, w[k*stride]);
+				mpf_sub ((*hi)[0].re, (*lo)[0].re, vre);
+				mpf_sub ((*hi)[0].im, (*lo)[0].im, vim);
+				mpf_add ((*lo)[0].re, (*lo)[0].re, vre);
+				mpf_add ((*lo)[0].im, (*lo)[0].im, vim);
+			}
+		}
+	}
+
+	mpf_clear (vre);
+	mpf_clear (vim);
+	mpf_clear (tmp);
+	for (k=0; k<n/2; k++) cpx_clear (w[k]);
+	free (w);
+}
+
+/* =============================== END OF FILE =========================== */
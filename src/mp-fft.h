@@ -0,0 +1,49 @@
+/*
+ * mp-fft.h
+ *
+ * Fast Fourier transform of arrays of complex multi-precision numbers.
+ *
+ * Copyright (C) 2026 Linas Vepstas
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301  USA
+ */
+
+#ifndef __MP_FFT_H__
+#define __MP_FFT_H__
+
+#include <gmp.h>
+#include "mp-complex.h"
+
+#ifdef  __cplusplus
+extern "C" {
+#endif
+
+/**
+ * cpx_fft -- in-place discrete Fourier transform.
+ *
+ * Replaces data[j] by sum_{m=0}^{n-1} data[m] exp(sign 2pi i jm/n)
+ * for j=0..n-1; sign is +1 or -1. There is no 1/n normalization.
+ * The length n must be a power of two. The twiddle factors are
+ * computed to `prec` decimal digits, plus guard digits; the data
+ * are transformed at whatever precision they carry.
+ */
+void cpx_fft (cpx_t *data, unsigned int n, int sign, int prec);
+
+#ifdef  __cplusplus
+};
+#endif
+
+#endif /* __MP_FFT_H__ */
@@ -21,14 +21,19 @@
  * 02110-1301  USA
  */
 
+#include <complex.h>
 #include <math.h>
+#include <pthread.h>
 #include <stdio.h>
+#include <stdlib.h>
 
 #include <gmp.h>
 
 #include "mp-binomial.h"
+#include "mp-cache.h"
 #include "mp-complex.h"
 #include "mp-consts.h"
+#include "mp-dd.h"
 #include "mp-gamma.h"
 #include "mp-misc.h"
 #include "mp-trig.h"
@@ -36,7 +41,7 @@
 
 /* ================================================= */
 /*
- * fp_lngamma -- compute log of gamma for real argument
+ * reduced_lngamma -- compute log of gamma for real argument
  *
  * Uses simple, quickly converging algo-- A&S 6.1.33
  * Slightly modified:
@@ -103,7 +108,7 @@ static void reduced_lngamma (mpf_t gam, const mpf_t ex, int prec)
 
 /* ================================================= */
 /*
- * cpx_lngamma -- compute log of gamma for complex argument
+ * cpx_reduced_lngamma -- compute log of gamma for complex argument
  *
  * Same code as above, extended for complex arguments
  * Uses simple, quickly converging algo-- A&S 6.1.33
@@ -341,109 +346,587 @@ static void cpx_reduced_gamma (cpx_t gam, const cpx_t z, int prec)
 
 /* ================================================= */
 /*
- * gamma function for general complex argument
+ * Low-precision fast path for the gamma function.
  *
- * Use the multiplication theorem to compute result.
+ * The same algorithm as above: the pochhammer symbol to get into
+ * range, the reduced A&S 6.1.33 series, and the multiplication
+ * theorem; but carried out in IEEE double, or in double-double,
+ * when few enough digits are requested. At such low precision,
+ * the GMP per-operation overhead dominates everything else.
  */
-void cpx_gamma (cpx_t gam, const cpx_t z, int prec)
+
+#define LOWPREC_NZETA 160
+
+/* zeta(n)-1 for 2 <= n < LOWPREC_NZETA, filled in on first use. */
+static dd_t zeta_minus_one[LOWPREC_NZETA];
+static pthread_once_t zeta_minus_one_once = PTHREAD_ONCE_INIT;
+
+/* B_{2j} / (2j)! for the Euler-Maclaurin tail */
+static const dd_t bernoulli_by_fact[] = {
+	{0.08333333333333333, 4.625929269271485e-18},
+	{-0.001388888888888889, 5.300543954373577e-20},
+	{3.306878306878307e-05, -2.2300719288557665e-21},
+	{-8.267195767195768e-07, 3.457597454003665e-23},
+	{2.08767569878681e-08, -1.2073450591132599e-24},
+	{-5.284190138687493e-10, 3.517096671929869e-27},
+	{1.3382536530684679e-11, -2.828354019907999e-29},
+	{-3.3896802963225827e-13, -1.4986928409964295e-29},
+	{8.586062056277845e-15, -6.05252374381974e-31},
+	{-2.174868698558062e-16, 4.961617782549996e-33},
+	{5.5090028283602295e-18, -1.49827152194499e-35},
+	{-1.3954464685812522e-19, -1.0350590497256251e-35},
+	{3.534707039629467e-21, 1.894231142684204e-37},
+	{-8.953517427037546e-23, -5.728752743153026e-39},
+};
+
+/*
+ * zeta(n)-1 = sum_{k=2}^{N-1} k^{-n} + Euler-Maclaurin tail at N.
+ * This is computed directly, rather than as fp_zeta()-1, so that
+ * full relative precision is kept for large n, where zeta(n)-1 is
+ * of order 2^{-n}.
+ */
+static void zeta_minus_one_fill (void)
 {
-	/* Step one: find out how big the imaginary part is */
-	double img = fabs(mpf_get_d (z[0].im));
-	int m = (int) (img + 1.0);
+	const int N = 32;
+	const int nbern = sizeof (bernoulli_by_fact) / sizeof (dd_t);
+	int n, k, j;
 
-	if (1 == m)
+	dd_t ninv = dd_set_d (1.0 / N);
+	for (n=2; n<LOWPREC_NZETA; n++)
 	{
-		cpx_reduced_gamma (gam, z, prec);
-		return;
+		/* N^{-n} */
+		dd_t npow = dd_pow_ui (ninv, n);
+
+		/* Tail, starting with the smallest terms */
+		dd_t tail = dd_set_d (0.0);
+		dd_t fac = dd_mul_d (dd_mul (npow, ninv), n);
+		for (j=0; j<nbern; j++)
+		{
+			dd_t term = dd_mul (fac, bernoulli_by_fact[j]);
+			tail = dd_add (tail, term);
+			if (fabs (term.hi) < 1.0e-34 * fabs (tail.hi)) break;
+			fac = dd_mul_d (fac, (double) (n+2*j+1) * (n+2*j+2));
+			fac = dd_mul (fac, dd_mul (ninv, ninv));
+		}
+		tail = dd_add (tail, dd_ldexp (npow, -1));
+		tail = dd_add (tail, dd_div_d (dd_mul_d (npow, N), n-1));
+
+		/* Direct sum */
+		dd_t sum = tail;
+		for (k=N-1; k>=2; k--)
+		{
+			dd_t kinv = dd_div (dd_set_d (1.0), dd_set_d (k));
+			sum = dd_add (sum, dd_pow_ui (kinv, n));
+		}
+		zeta_minus_one[n] = sum;
 	}
+}
 
-	/* Step two: prepare to use the multiplicatin theorem */
-	cpx_t zee, mzee, term, acc;
-	cpx_init (zee);
-	cpx_init (mzee);
-	cpx_init (term);
-	cpx_init (acc);
+/* ------------------------------------------------- */
+/* IEEE double versions */
 
-	/* Copy the input arg NOW! */
-	cpx_set (mzee, z);
+static int d_reduced_lngamma (double complex *lng, double complex z)
+{
+	int n;
+	double complex zn, term, gam = 0.0;
+
+	z -= 2.0;
+	zn = z*z;
+	for (n=2; n<LOWPREC_NZETA; n++)
+	{
+		term = zn * (zeta_minus_one[n].hi / n);
+		if (n%2) gam -= term;
+		else gam += term;
+
+		if (creal(term)*creal(term) + cimag(term)*cimag(term) < 1.0e-36) break;
+		zn *= z;
+	}
+	if (LOWPREC_NZETA == n) return 1;
 
-	mpf_t frac;
-	mpf_init (frac);
+	gam -= (dd_euler_mascheroni.hi - 1.0) * z;
+	*lng = gam;
+	return 0;
+}
 
-	cpx_div_ui (zee, mzee, m);
+static int d_reduced_gamma (double complex *gam, double complex zee)
+{
+	double complex poch, rgamma;
+	double flo = creal (zee);
+	unsigned int i, intpart = 0;
 
-	/* frac = 1/m */
-	mpf_set_ui (frac, 1);
-	mpf_div_ui (frac, frac, m);
+	poch = 1.0;
+	if (flo > 2.5)
+	{
+		intpart = (unsigned int) floor (flo-1.0);
+		if (flo-intpart < 1.5) intpart --;
+		zee -= intpart;
+		for (i=0; i<intpart; i++) poch *= zee + i;
+	}
+	else if (flo < 1.5)
+	{
+		intpart = (unsigned int) floor (2.0-flo);
+		if (flo+intpart < 1.5) intpart ++;
+		for (i=0; i<intpart; i++) poch *= zee + i;
+		poch = 1.0 / poch;
+		zee += intpart;
+	}
 
-	cpx_set_ui (acc, 1, 0);
+	if (d_reduced_lngamma (&rgamma, zee)) return 1;
+	*gam = poch * cexp (rgamma);
+	return 0;
+}
 
-	/* Apply the multiplication theorem */
+static int d_gamma (double complex *gam, double complex z)
+{
 	int k;
+	int m = (int) (fabs (cimag (z)) + 1.0);
+	double complex acc = 1.0, term;
+
 	for (k=0; k<m; k++)
 	{
-		cpx_reduced_gamma (term, zee, prec);
-		cpx_mul (acc, acc, term);
-		mpf_add (zee[0].re, zee[0].re, frac);
+		if (d_reduced_gamma (&term, (z+k)/m)) return 1;
+		acc *= term;
 	}
 
-	/* Multiply by scaling factors */
-	fp_pi (frac, prec);
-	mpf_mul_ui (frac, frac, 2);
-	mpf_sqrt (frac, frac);   /* XXX could avoid sqrt if m is odd ... */
-	mpf_pow_ui (frac, frac, m-1);
-	cpx_div_mpf (acc, acc, frac);
+	if (1 < m)
+	{
+		acc *= exp (-0.5 * (m-1) * dd_log_two_pi.hi);
+		acc *= cexp ((z-0.5) * log ((double) m));
+	}
+	*gam = acc;
+	return 0;
+}
 
-	/* mz - 0.5 */
-	mpf_set_ui (frac, 1);
-	// mpf_div_ui (frac, frac, 2);
-	mpf_div_2exp (frac, frac, 1);  /* frac = frac/2, which is faster than mpf_div_ui(frac,frac,2); */
-	mpf_sub (mzee[0].re, mzee[0].re,frac);
+/* ------------------------------------------------- */
+/* Double-double versions */
 
-	/* m^(mz-0.5) */
-	mpf_set_ui (frac, m);
-	cpx_mpf_pow (term, frac, mzee, prec);
-	cpx_mul (acc, acc, term);
+static int dd_reduced_lngamma (cdd_t *lng, cdd_t z)
+{
+	int n;
+	cdd_t zn, term, gam;
 
-	cpx_set (gam, acc);
+	gam = cdd_set_d (0.0, 0.0);
+	z.re = dd_add_d (z.re, -2.0);
+	zn = cdd_mul (z, z);
+	for (n=2; n<LOWPREC_NZETA; n++)
+	{
+		term = cdd_times_dd (zn, dd_div_d (zeta_minus_one[n], n));
+		if (n%2) gam = cdd_sub (gam, term);
+		else gam = cdd_add (gam, term);
 
-	cpx_clear (zee);
-	cpx_clear (mzee);
-	cpx_clear (term);
-	cpx_clear (acc);
-	mpf_clear (frac);
+		if (cdd_mod_sq_d (term) < 1.0e-66) break;
+		zn = cdd_mul (zn, z);
+	}
+	if (LOWPREC_NZETA == n) return 1;
+
+	term = cdd_times_dd (z, dd_add_d (dd_euler_mascheroni, -1.0));
+	*lng = cdd_sub (gam, term);
+	return 0;
 }
 
-void cpx_gamma_cache (cpx_t gam, const cpx_t z, int prec)
+static int dd_reduced_gamma (cdd_t *gam, cdd_t zee)
 {
-	static cpx_t cache_z, cache_gam;
-	static int precision = 0;
-	int redo = 0;
+	cdd_t poch, rgamma;
+	double flo = zee.re.hi;
+	unsigned int i, intpart = 0;
 
-	if (precision < prec)
+	poch = cdd_set_d (1.0, 0.0);
+	if (flo > 2.5)
+	{
+		intpart = (unsigned int) floor (flo-1.0);
+		if (flo-intpart < 1.5) intpart --;
+		zee.re = dd_add_d (zee.re, -(double) intpart);
+		for (i=0; i<intpart; i++)
+		{
+			cdd_t zi = zee;
+			zi.re = dd_add_d (zi.re, i);
+			poch = cdd_mul (poch, zi);
+		}
+	}
+	else if (flo < 1.5)
 	{
-		if (!precision)
+		intpart = (unsigned int) floor (2.0-flo);
+		if (flo+intpart < 1.5) intpart ++;
+		for (i=0; i<intpart; i++)
 		{
-			cpx_init (cache_z);
-			cpx_init (cache_gam);
+			cdd_t zi = zee;
+			zi.re = dd_add_d (zi.re, i);
+			poch = cdd_mul (poch, zi);
 		}
+		poch = cdd_recip (poch);
+		zee.re = dd_add_d (zee.re, intpart);
+	}
 
-		cpx_set_prec (cache_z, 3.322*prec+50);
-		cpx_set_prec (cache_gam, 3.322*prec+50);
-		precision = prec;
-		redo = 1;
+	if (dd_reduced_lngamma (&rgamma, zee)) return 1;
+	*gam = cdd_mul (poch, cdd_exp (rgamma));
+	return 0;
+}
+
+static int dd_gamma (cdd_t *gam, cdd_t z)
+{
+	int k;
+	int m = (int) (fabs (z.im.hi) + 1.0);
+	cdd_t acc, term, zee;
+
+	acc = cdd_set_d (1.0, 0.0);
+	for (k=0; k<m; k++)
+	{
+		zee.re = dd_div_d (dd_add_d (z.re, k), m);
+		zee.im = dd_div_d (z.im, m);
+		if (dd_reduced_gamma (&term, zee)) return 1;
+		acc = cdd_mul (acc, term);
+	}
+
+	if (1 < m)
+	{
+		/* (2pi)^{-(m-1)/2} m^{z-1/2} */
+		dd_t lm = dd_log (dd_set_d (m));
+		term = z;
+		term.re = dd_add_d (term.re, -0.5);
+		term = cdd_times_dd (term, lm);
+		term.re = dd_sub (term.re, dd_mul_d (dd_log_two_pi, 0.5*(m-1)));
+		acc = cdd_mul (acc, cdd_exp (term));
+	}
+	*gam = acc;
+	return 0;
+}
+
+/*
+ * cpx_gamma_lowprec -- Gamma(z) using hardware floating point.
+ *
+ * Returns zero if the value was computed; returns non-zero if the
+ * requested precision is too high, or if the result is too large
+ * or too small for IEEE doubles. In that case, the GMP code must
+ * be used.
+ */
+static int cpx_gamma_lowprec (cpx_t gam, const cpx_t z, int prec)
+{
+	if (LOWPREC_DD_DIGITS < prec) return 1;
+
+	double zre = cpx_get_re (z);
+	double zim = cpx_get_im (z);
+
+	/* Stay well away from overflow and underflow */
+	if ((150.0 < fabs(zre)) || (150.0 < fabs(zim))) return 1;
+
+	/* Digits lost in the pochhammer product, the multiplication
+	 * theorem, and in the exponent of m^{z-1/2}. */
+	int m = (int) (fabs (zim) + 1.0);
+	double mag = sqrt (zre*zre + zim*zim);
+	int need = prec + 1 + (int) log10 ((2.0+fabs(zre)) * m * (1.0 + mag*log(m)));
+	if (LOWPREC_DD_DIGITS < need) return 1;
+
+	pthread_once (&zeta_minus_one_once, zeta_minus_one_fill);
+
+	if (LOWPREC_DOUBLE_DIGITS >= need)
+	{
+		double complex g;
+		if (d_gamma (&g, zre + I*zim)) return 1;
+		if (!isfinite (creal (g)) || !isfinite (cimag (g))) return 1;
+		mpf_set_d (gam[0].re, creal (g));
+		mpf_set_d (gam[0].im, cimag (g));
+		return 0;
+	}
+
+	cdd_t g;
+	if (dd_gamma (&g, cdd_get_cpx (z))) return 1;
+	if (!isfinite (g.re.hi) || !isfinite (g.im.hi)) return 1;
+	cdd_set_cpx (gam, g);
+	return 0;
+}
+
+/* ================================================= */
+/*
+ * Stirling's series, for large |z|:
+ *
+ *   ln Gamma(z) = (z-1/2) log z - z + (1/2) log 2pi
+ *               + sum_{k=1}^\infty B_2k / 2k(2k-1) z^{2k-1}
+ *
+ * The series is asymptotic; its smallest term is about exp(-2pi|z|),
+ * so |z| must be at least prec log(10)/2pi. Smaller z are first
+ * shifted up, with Gamma(z) = Gamma(z+N) / (z)_N. Unlike the A&S
+ * series above, the cost does not grow with |Im z|.
+ */
+
+/* B_2k / 2k(2k-1); these depend only on the precision */
+DECLARE_FP_CACHE (stirling_coef_cache);
+
+static void stirling_coef (mpf_t c, int k, int prec)
+{
+	if (prec <= fp_one_d_cache_check (&stirling_coef_cache, k))
+	{
+		fp_one_d_cache_fetch (&stirling_coef_cache, c, k);
+		return;
+	}
+
+	fp_bernoulli (c, 2*k, prec);
+	mpf_div_ui (c, c, 2*k);
+	mpf_div_ui (c, c, 2*k-1);
+
+	fp_one_d_cache_store (&stirling_coef_cache, c, k, prec);
+}
+
+/* The series is summed only for Re z >= 0 and |z| at least this */
+static inline double stirling_radius (int prec)
+{
+	return 0.6 * prec + 2.0;
+}
+
+/* How far z must be shifted up, to get into the zone above */
+static unsigned int stirling_shift (double zre, double zim, int prec)
+{
+	double r = stirling_radius (prec);
+	double x = 0.0;
+	if (zim*zim < r*r) x = sqrt (r*r - zim*zim);
+	if (zre >= x) return 0;
+	return (unsigned int) ceil (x - zre);
+}
+
+/* ln Gamma(z), for z already in the zone of convergence */
+static void cpx_stirling_lngamma (cpx_t lng, const cpx_t z, int prec)
+{
+	int k;
+	mpf_t c, eps, last;
+	mpf_init (c);
+	mpf_init (eps);
+	mpf_init (last);
+
+	cpx_t lz, zpow, zsq, term;
+	cpx_init (lz);
+	cpx_init (zpow);
+	cpx_init (zsq);
+	cpx_init (term);
+
+	/* The leading terms are of size |z log z|; keep prec digits
+	 * after the decimal point, not just prec significant digits. */
+	double zre = cpx_get_re (z);
+	double zim = cpx_get_im (z);
+	prec += (int) (0.5 * log10 (zre*zre + zim*zim + 1.0)) + 2;
+
+	/* (z-1/2) log z - z + (1/2) log 2pi */
+	cpx_log (lz, z, prec);
+	cpx_set (term, z);
+	mpf_set_ui (c, 1);
+	mpf_div_2exp (c, c, 1);
+	mpf_sub (term[0].re, term[0].re, c);
+	cpx_mul (term, term, lz);
+	cpx_sub (term, term, z);
+	fp_log_two_pi (c, prec);
+	mpf_div_2exp (c, c, 1);
+	mpf_add (term[0].re, term[0].re, c);
+
+	/* The sum, in powers of 1/z^2 */
+	cpx_set (lz, term);
+	cpx_recip (zpow, z);
+	cpx_mul (zsq, zpow, zpow);
+	fp_epsilon (eps, 2*prec);
+	for (k=1; ; k++)
+	{
+		stirling_coef (c, k, prec);
+		cpx_times_mpf (term, zpow, c);
+
+		/* Past the smallest term, the terms only grow */
+		cpx_mod_sq (c, term);
+		if (1 < k && 0 < mpf_cmp (c, last)) break;
+		mpf_set (last, c);
+		cpx_add (lz, lz, term);
+
+		if (mpf_cmp (c, eps) < 0) break;
+		cpx_mul (zpow, zpow, zsq);
+	}
+	cpx_set (lng, lz);
+
+	mpf_clear (c);
+	mpf_clear (eps);
+	mpf_clear (last);
+	cpx_clear (lz);
+	cpx_clear (zpow);
+	cpx_clear (zsq);
+	cpx_clear (term);
+}
+
+/* Gamma(z) by Stirling's series, shifting z up as needed */
+static void cpx_gamma_stirling (cpx_t gam, const cpx_t z, int prec)
+{
+	cpx_t zee, poch;
+	cpx_init (zee);
+	cpx_init (poch);
+
+	unsigned int n = stirling_shift (cpx_get_re (z), cpx_get_im (z), prec);
+	cpx_add_ui (zee, z, n, 0);
+	cpx_stirling_lngamma (zee, zee, prec);
+
+	/* The absolute error of the log is the relative error of gamma */
+	double lre = cpx_get_re (zee);
+	double lim = cpx_get_im (zee);
+	int eprec = prec + (int) (0.5 * log10 (lre*lre + lim*lim + 1.0)) + 1;
+	cpx_exp (zee, zee, eprec);
+
+	if (0 < n)
+	{
+		/* XXX as above, this divides by zero at the poles */
+		cpx_poch_rising (poch, z, n);
+		cpx_div (zee, zee, poch);
+	}
+	cpx_set (gam, zee);
+
+	cpx_clear (zee);
+	cpx_clear (poch);
+}
+
+/* ================================================= */
+/*
+ * gamma function for general complex argument
+ *
+ * The A&S series converges as |z-2|^n, after z is shifted by an
+ * integer; within 1/4 of the integers, and for small z, it is the
+ * fastest. Everywhere else, Stirling's series wins. Its cost does not
+ * grow with |Im z|, whereas the multiplication theorem needs |Im z|
+ * calls to cpx_reduced_gamma(). See tests/gamma-bench.c for timings.
+ */
+static void cpx_gamma_mp (cpx_t gam, const cpx_t z, int prec)
+{
+	double zre = cpx_get_re (z);
+	double zim = cpx_get_im (z);
+	double r = stirling_radius (prec);
+	double frac = zre - floor (zre + 0.5);
+
+	if ((frac*frac + zim*zim < 0.0625) && (zre*zre < r*r))
+	{
+		cpx_reduced_gamma (gam, z, prec);
+		return;
+	}
+	cpx_gamma_stirling (gam, z, prec);
+}
+
+void cpx_gamma (cpx_t gam, const cpx_t z, int prec)
+{
+	/* Low precision requests are done in double or double-double */
+	if (0 == cpx_gamma_lowprec (gam, z, prec))
+	{
+#ifdef CROSS_VALIDATE_LOWPREC
+		cpx_t mp;
+		cpx_init (mp);
+		cpx_gamma_mp (mp, z, prec);
+		lowprec_cross_check ("cpx_gamma", gam, mp, z, z, prec);
+		cpx_clear (mp);
+#endif
+		return;
+	}
+	cpx_gamma_mp (gam, z, prec);
+}
+
+/* Recently used z, shared by all threads */
+DECLARE_CPX_KEYED_CACHE (gamma_cache, 1);
+
+void cpx_gamma_cache (cpx_t gam, const cpx_t z, int prec)
+{
+	if (cpx_keyed_cache_fetch (&gamma_cache, z, prec, (cpx_t *) gam)) return;
+	cpx_gamma (gam, z, prec);
+	cpx_keyed_cache_store (&gamma_cache, z, prec, (cpx_t *) gam);
+}
+
+/* ================================================= */
+/*
+ * log gamma, on the principal branch
+ *
+ * The same split as for gamma itself: z is shifted by an integer, into
+ * the A&S or the Stirling zone, and the log of the pochhammer symbol
+ * is added or subtracted. The log of the product is taken just once;
+ * it differs from the sum of the principal logs of the factors by a
+ * multiple of 2pi i, which is found from the sum of their args, in
+ * double precision. That sum is the analytic continuation from the
+ * positive real axis, and so the result has its branch cut along the
+ * negative real axis only.
+ */
+static void cpx_log_poch (cpx_t lp, const cpx_t z, unsigned int n, int prec)
+{
+	unsigned int j;
+	double zre = cpx_get_re (z);
+	double zim = cpx_get_im (z);
+	double arg = 0.0;
+	for (j=0; j<n; j++) arg += atan2 (zim, zre + j);
+
+	/* XXX divides by zero at the poles, as above */
+	cpx_poch_rising (lp, z, n);
+	cpx_log (lp, lp, prec);
+
+	long k = lround ((arg - cpx_get_im (lp)) / (2.0 * M_PI));
+	if (0 != k)
+	{
+		mpf_t tpi;
+		mpf_init (tpi);
+		fp_two_pi (tpi, prec);
+		mpf_mul_ui (tpi, tpi, labs (k));
+		if (0 < k) mpf_add (lp[0].im, lp[0].im, tpi);
+		else mpf_sub (lp[0].im, lp[0].im, tpi);
+		mpf_clear (tpi);
 	}
+}
+
+void cpx_lngamma (cpx_t lng, const cpx_t z, int prec)
+{
+	cpx_t zee, lp;
+	cpx_init (zee);
+	cpx_init (lp);
+
+	double zre = cpx_get_re (z);
+	double zim = cpx_get_im (z);
+	double r = stirling_radius (prec);
+	double frac = zre - floor (zre + 0.5);
 
-	if (redo || !cpx_eq (z, cache_z, prec*3.322))
+	if ((frac*frac + zim*zim < 0.0625) && (zre*zre < r*r))
 	{
-		cpx_set (cache_z, z);
-		cpx_gamma (gam, z, prec);
-		cpx_set (cache_gam, gam);
+		/* Into 1.5 < Re z < 2.5, as in cpx_reduced_gamma() */
+		if (zre > 2.5)
+		{
+			unsigned int intpart = (unsigned int) floor (zre-1.0);
+			if (zre-intpart < 1.5) intpart --;
+			cpx_sub_ui (zee, z, intpart, 0);
+			cpx_log_poch (lp, zee, intpart, prec);
+		}
+		else if (zre < 1.5)
+		{
+			unsigned int intpart = (unsigned int) floor (2.0-zre);
+			if (zre+intpart < 1.5) intpart ++;
+			cpx_log_poch (lp, z, intpart, prec);
+			cpx_neg (lp, lp);
+			cpx_add_ui (zee, z, intpart, 0);
+		}
+		else
+		{
+			cpx_set (zee, z);
+			cpx_set_ui (lp, 0, 0);
+		}
+		cpx_reduced_lngamma (zee, zee, prec);
+		cpx_add (lng, zee, lp);
 	}
 	else
 	{
-		cpx_set (gam, cache_gam);
+		unsigned int n = stirling_shift (zre, zim, prec);
+		cpx_add_ui (zee, z, n, 0);
+		cpx_stirling_lngamma (zee, zee, prec);
+		if (0 < n)
+		{
+			cpx_log_poch (lp, z, n, prec);
+			cpx_sub (zee, zee, lp);
+		}
+		cpx_set (lng, zee);
 	}
+
+	cpx_clear (zee);
+	cpx_clear (lp);
+}
+
+void fp_lngamma (mpf_t lng, const mpf_t x, int prec)
+{
+	cpx_t zee;
+	cpx_init (zee);
+	mpf_set (zee[0].re, x);
+	mpf_set_ui (zee[0].im, 0);
+	cpx_lngamma (zee, zee, prec);
+	mpf_set (lng, zee[0].re);
+	cpx_clear (zee);
 }
 
 /* ==================  END OF FILE ===================== */
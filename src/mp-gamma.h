@@ -42,7 +42,9 @@ void fp_gamma_cache (mpf_t gam, const mpf_t ex, int prec);
 /**
  * cpx_gamma -- compute Gamma(x)=factorial(x-1) for complex argument
  *
- * Uses simple, quickly converging algo-- A&S 6.1.33
+ * Uses simple, quickly converging algo-- A&S 6.1.33 -- close to the
+ * integers, and Stirling's asymptotic series elsewhere. The cost of
+ * the latter does not grow with |Im x|.
  *
  * The caching version skips the calculation, if called again with
  * the same value of ex (up to the nprec precision bits).
@@ -55,6 +57,26 @@ void fp_gamma_cache (mpf_t gam, const mpf_t ex, int prec);
 void cpx_gamma (cpx_t gam, const cpx_t ex, int prec);
 void cpx_gamma_cache (cpx_t gam, const cpx_t ex, int prec);
 
+/**
+ * cpx_lngamma -- log Gamma(x), for complex argument
+ *
+ * This is the principal branch: the analytic continuation of the real
+ * log Gamma from the positive real axis, with the branch cut along the
+ * negative real axis. It is not, in general, the principal log of
+ * Gamma(x); the imaginary part grows without bound. Unlike Gamma(x),
+ * it stays of modest size for large |x|, so that products of gamma
+ * with other factors can be taken in log space.
+ *
+ * Uses the same series as cpx_gamma(), and shares its caches.
+ * As with cpx_gamma(), this traps at the poles.
+ */
+void cpx_lngamma (cpx_t lng, const cpx_t ex, int prec);
+
+/**
+ * fp_lngamma -- log |Gamma(x)|, for real argument
+ */
+void fp_lngamma (mpf_t lng, const mpf_t ex, int prec);
+
 #ifdef  __cplusplus
 };
 #endif
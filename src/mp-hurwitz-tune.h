@@ -0,0 +1,16 @@
+/*
+ * mp-hurwitz-tune.h
+ *
+ * Tuning table for cpx_hurwitz_auto(). Written by tests/hurwitz-tune;
+ * rerun that, and replace this file, to tune for another machine.
+ */
+#define HURWITZ_TUNE_ROWS 4
+
+/* prec, then microseconds per term for the setup and per-call cost
+ * of the periodic zeta, Taylor and Euler-Maclaurin methods. */
+static const double hurwitz_tune[HURWITZ_TUNE_ROWS][7] = {
+	{15, 14.22, 3.687, 10.94, 1.083, 0, 10.97},
+	{30, 57.77, 5.564, 23.54, 1.56, 0, 23.87},
+	{60, 94.55, 3.26, 48.89, 1.806, 0, 43.73},
+	{120, 199.6, 4.7, 107.7, 2.083, 0, 99.46},
+};
@@ -64,35 +64,12 @@ void ecpx_prt (const char * str, const cpx_t val)
  */
 void fp_epsilon (mpf_t eps, int prec)
 {
-	static int cache_prec = -1;
-	static mpf_t cache_eps;
-
-	if (-1 == cache_prec)
-	{
-		mpf_init (cache_eps);
-	}
-
-	if (prec == cache_prec)
-	{
-		mpf_set (eps, cache_eps);
-		return;
-	}
-	if (cache_prec < prec)
-	{
-		mpf_set_prec (cache_eps, 3.322*prec+50);
-	}
-
+	/* A shift is as cheap as a cache lookup, and needs no lock. */
 	/* double mex = ((double) prec) * log (10.0) / log(2.0); */
 	double mex = ((double) prec) * 3.321928095;
 	unsigned int imax = (unsigned int) (mex +1.0);
-	mpf_t one;
-	mpf_init (one);
-	mpf_set_ui (one, 1);
-	mpf_div_2exp (cache_eps, one, imax);
-
-	mpf_set (eps, cache_eps);
-	cache_prec = prec;
-	mpf_clear (one);
+	mpf_set_ui (eps, 1);
+	mpf_div_2exp (eps, eps, imax);
 }
 
 /* ===================================================== */
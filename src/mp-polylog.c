@@ -29,16 +29,24 @@
  * 02110-1301  USA
  */
 
+#include <complex.h>
 #include <math.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "mp-binomial.h"
 #include "mp-cache.h"
 #include "mp-complex.h"
 #include "mp-consts.h"
+#include "mp-dd.h"
+#include "mp-dual.h"
+#include "mp-fft.h"
 #include "mp-gamma.h"
+#include "mp-hurwitz-tune.h"
 #include "mp-misc.h"
 #include "mp-polylog.h"
+#include "mp-thread.h"
 #include "mp-trig.h"
 #include "mp-zeta.h"
 
@@ -57,12 +65,13 @@
  */
 static void polylog_borwein (cpx_t plog, const cpx_t ess, const cpx_t zee, int norder, int prec)
 {
-	DECLARE_CPX_CACHE (bin_sum);
 	mpz_t ibin;
+	mpf_t fbin;
 	cpx_t s, z, ska, pz, acc, term, ck, bins;
 	int k;
 
 	mpz_init (ibin);
+	mpf_init (fbin);
 	cpx_init (s);
 	cpx_init (z);
 	cpx_init (ska);
@@ -72,14 +81,19 @@ static void polylog_borwein (cpx_t plog, const cpx_t ess, const cpx_t zee, int n
 	cpx_init (ck);
 	cpx_init (bins);
 
+	/* The binomial sums are needed again, in reverse order. They live
+	 * on the heap, one array per call, so that concurrent callers
+	 * don't trample one another. */
+	cpx_t *bin_sum = (cpx_t *) malloc ((norder+1) * sizeof (cpx_t));
+	for (k=0; k<=norder; k++) cpx_init (bin_sum[k]);
+
 	/* s = -ess */
 	cpx_neg (s, ess);
 	cpx_set (z, zee);
 
 	/* First binomial summation term is 1 */
 	cpx_set_ui (bins, 1, 0);
-	cpx_one_d_cache_check (&bin_sum, 0);
-	cpx_one_d_cache_store (&bin_sum, bins, 0, prec);
+	cpx_set (bin_sum[0], bins);
 
 	/* ska = [1/(z-1)]^n */
 	cpx_set (ska, z);
@@ -90,6 +104,7 @@ static void polylog_borwein (cpx_t plog, const cpx_t ess, const cpx_t zee, int n
 	cpx_set_ui (pz, 1, 0);
 	cpx_set_ui (acc, 0, 0);
 	cpx_set_ui (plog, 0, 0);
+	mpz_set_ui (ibin, 1);
 
 	for (k=1; k<=norder; k++)
 	{
@@ -99,14 +114,14 @@ static void polylog_borwein (cpx_t plog, const cpx_t ess, const cpx_t zee, int n
 		cpx_ui_pow_cache (term, k, s, prec);
 
 		/* Put it together */
-		cpx_mul (term, term, pz);
-		cpx_add (acc, acc, term);
+		cpx_addmul (acc, term, pz);
 
-		/* Compute the binomial sum */
-		i_binomial (ibin, norder, k);
-		mpf_set_z (term[0].re, ibin);
-		mpf_set_ui (term[0].im, 0);
-		cpx_mul (term, term, pz);
+		/* Compute the binomial sum; the binomials come
+		 * one after another, each from the last. */
+		mpz_mul_ui (ibin, ibin, norder-k+1);
+		mpz_divexact_ui (ibin, ibin, k);
+		mpf_set_z (fbin, ibin);
+		cpx_times_mpf (term, pz, fbin);
 
 		if (k%2)
 		{
@@ -120,8 +135,7 @@ static void polylog_borwein (cpx_t plog, const cpx_t ess, const cpx_t zee, int n
 		/* Stow the binomial sum away in an array;
 		 * we'll need to reference this in reverse order later.
 		 */
-		cpx_one_d_cache_check (&bin_sum, k);
-		cpx_one_d_cache_store (&bin_sum, bins, k, prec);
+		cpx_set (bin_sum[k], bins);
 	}
 
 	for (k=norder+1; k<=2*norder; k++)
@@ -132,12 +146,8 @@ static void polylog_borwein (cpx_t plog, const cpx_t ess, const cpx_t zee, int n
 		cpx_ui_pow_cache (term, k, s, prec);
 		cpx_mul (term, term, pz);
 
-		/* Fetch binomial sum from the array */
-		cpx_one_d_cache_fetch (&bin_sum, bins, 2*norder-k);
-		cpx_mul (term, term, bins);
-
-		/* Put it together */
-		cpx_add (plog, plog, term);
+		/* Fetch binomial sum from the array, put it together */
+		cpx_addmul (plog, term, bin_sum[2*norder-k]);
 	}
 
 	cpx_mul (plog, plog, ska);
@@ -158,9 +168,11 @@ static void polylog_borwein (cpx_t plog, const cpx_t ess, const cpx_t zee, int n
 	cpx_clear (term);
 	cpx_clear (ck);
 	cpx_clear (bins);
+	mpf_clear (fbin);
 	mpz_clear (ibin);
 
-	cpx_one_d_cache_clear(&bin_sum);
+	for (k=0; k<=norder; k++) cpx_clear (bin_sum[k]);
+	free (bin_sum);
 }
 
 /* ============================================================= */
@@ -196,17 +208,20 @@ inline static double polylog_modsq (const cpx_t zee)
  * polylog_terms_est() -- estimate number of terms needed
  * in the polylog summation in order to keep the error
  * to be less than 10^-prec.
+ *
+ * The estimate runs about one digit short, so one guard digit is
+ * added. The duplication formula for the periodic zeta loses more
+ * than that; see periodic_zeta_guard().
  */
-static int polylog_terms_est (const cpx_t ess, const cpx_t zee, int prec)
+static int polylog_terms_est_d (double sre, double sim,
+                                double zre, double zim, int prec)
 {
-	double fterms = 2.302585 * prec;  /* log(10) */
+	double fterms = 2.302585 * (prec+1);  /* log(10) */
 
 	/* Estimate for the gamma. A slightly better estimate
 	 * can be obtained for sre negative but still small.
 	 */
 	double gamterms;
-	double sre = mpf_get_d (ess[0].re);
-	double sim = mpf_get_d (ess[0].im);
 	if (0.0 > sim) sim = -sim;
 	if (0.0 < sre) {
 		gamterms = 0.5*M_PI*sim;
@@ -233,8 +248,6 @@ static int polylog_terms_est (const cpx_t ess, const cpx_t zee, int prec)
 
 	fterms += gamterms;
 
-	double zre = mpf_get_d (zee[0].re);
-	double zim = mpf_get_d (zee[0].im);
 	double cterms = 0.0;
 	if (0.0 < zre)
 	{
@@ -272,9 +285,260 @@ zre, zim, sqrt(den), prec,  -0.5*log(den) + 1.386294361, nterms, gamterms, cterm
 	return nterms;
 }
 
+static int polylog_terms_est (const cpx_t ess, const cpx_t zee, int prec)
+{
+	return polylog_terms_est_d (cpx_get_re (ess), cpx_get_im (ess),
+	                            cpx_get_re (zee), cpx_get_im (zee), prec);
+}
+
+/*
+ * periodic_zeta_guard() -- extra digits to sum the polylog to, at
+ * the leaves of the duplication recursion for F(s,q).
+ *
+ * A leaf at depth d is scaled by 2^{(1-s)d}, and so is its
+ * truncation error. On one side of q=0 (q>0, if Im s > 0) the
+ * q^{s-1} singularity grows just as fast, and nothing is lost; on
+ * the other, it is damped by exp(-pi |Im s|), and F(s,q) stays
+ * near zeta(s): the error of the deepest leaf then grows by
+ * |2^{1-s}| per level. For Re s < 1 this costs up to a digit for
+ * every 3/(1-Re s) levels, e.g. three digits at q=1-10^-4 for
+ * Re s = -0.7. The bound is taken for both sides of the circle.
+ */
+static int periodic_zeta_guard (double sre, double q)
+{
+	q -= floor (q);
+	if (0.5 < q) q = 1.0 - q;
+	if ((0.25 <= q) || (1.0e-15 > q) || (1.0 <= sre)) return 0;
+
+	int depth = (int) ceil (log2 (0.25 / q));
+	return (int) ceil (depth * (1.0 - sre) * 0.30103);  /* log10(2) */
+}
+
+/* ============================================================= */
+/*
+ * Memo table for the duplication recursion.
+ *
+ * The duplication formulas split a point into two (or three) others;
+ * over a sweep of many points, e.g. around the unit circle, the same
+ * ones come up again and again. When turned on, the value at each
+ * point reached by the recursion is remembered, and reused when the
+ * same point comes up again with the same s and prec. Points are
+ * hashed on their double-precision value, but are compared to the
+ * full working precision.
+ *
+ * The table is per thread, and flushed whenever s, prec or the
+ * default precision changes, or when it fills up.
+ */
+#define MEMO_BUCKETS 4096
+#define MEMO_MAX 65536
+
+enum { MEMO_POLYLOG, MEMO_PERIODIC };
+
+typedef struct
+{
+	cpx_t ess;
+	int prec;
+	int nbits;
+	int bucket[MEMO_BUCKETS];
+	int n, alloc;
+	int *kind;
+	int *next;
+	cpx_t *key;
+	cpx_t *val;
+} polylog_memo;
+
+/* The counts are bumped on every lookup, from every thread; they are
+ * atomics, rather than under a lock, to keep the lookups from being
+ * serialized. */
+static int memo_on = 0;
+static unsigned long memo_lookups = 0;
+static unsigned long memo_hits = 0;
+
+static void polylog_memo_flush (polylog_memo *m)
+{
+	int i;
+	for (i=0; i<MEMO_BUCKETS; i++) m->bucket[i] = -1;
+	m->n = 0;
+}
+
+static void polylog_memo_release (polylog_memo *m)
+{
+	int i;
+	for (i=0; i<m->alloc; i++)
+	{
+		cpx_clear (m->key[i]);
+		cpx_clear (m->val[i]);
+	}
+	free (m->kind);
+	free (m->next);
+	free (m->key);
+	free (m->val);
+	m->kind = NULL;
+	m->next = NULL;
+	m->key = NULL;
+	m->val = NULL;
+	m->alloc = 0;
+	polylog_memo_flush (m);
+}
+
+static void * polylog_memo_new (void)
+{
+	polylog_memo *m = (polylog_memo *) malloc (sizeof (polylog_memo));
+	cpx_init (m->ess);
+	m->prec = -1;
+	m->nbits = -1;
+	m->alloc = 0;
+	m->kind = NULL;
+	m->next = NULL;
+	m->key = NULL;
+	m->val = NULL;
+	polylog_memo_flush (m);
+	return m;
+}
+
+static void polylog_memo_free (void *p)
+{
+	polylog_memo *m = (polylog_memo *) p;
+	polylog_memo_release (m);
+	cpx_clear (m->ess);
+	free (m);
+}
+
+DECLARE_THREAD_STATE (polylog_memo_key, polylog_memo_new, polylog_memo_free);
+
+void cpx_polylog_memo (int on)
+{
+	memo_on = on;
+}
+
+void cpx_polylog_memo_stats (unsigned long *lookups, unsigned long *hits, int reset)
+{
+	if (reset)
+	{
+		unsigned long n = __atomic_exchange_n (&memo_lookups, 0, __ATOMIC_RELAXED);
+		unsigned long h = __atomic_exchange_n (&memo_hits, 0, __ATOMIC_RELAXED);
+		if (lookups) *lookups = n;
+		if (hits) *hits = h;
+		return;
+	}
+	if (lookups) *lookups = __atomic_load_n (&memo_lookups, __ATOMIC_RELAXED);
+	if (hits) *hits = __atomic_load_n (&memo_hits, __ATOMIC_RELAXED);
+}
+
+/* Return this thread's table, made ready for s and prec; or NULL
+ * if memoization is turned off. */
+static polylog_memo * polylog_memo_get (const cpx_t ess, int prec)
+{
+	if (!memo_on) return NULL;
+
+	polylog_memo *m = thread_state_get (&polylog_memo_key);
+	int nbits = mpf_get_default_prec ();
+	if (m->nbits != nbits)
+	{
+		/* The stored values are too short, or too long */
+		polylog_memo_release (m);
+		cpx_set_prec (m->ess, nbits);
+		m->nbits = nbits;
+		m->prec = -1;
+	}
+	if (m->prec != prec ||
+	    mpf_cmp (m->ess[0].re, ess[0].re) || mpf_cmp (m->ess[0].im, ess[0].im))
+	{
+		polylog_memo_flush (m);
+		cpx_set (m->ess, ess);
+		m->prec = prec;
+	}
+	return m;
+}
+
+static int polylog_memo_hash (int kind, const cpx_t zee)
+{
+	/* Keep the values in range of a long, as in cpx_keyed_set() */
+	double re = fmod (floor (ldexp (cpx_get_re (zee), 24) + 0.5), 4294967296.0);
+	double im = fmod (floor (ldexp (cpx_get_im (zee), 24) + 0.5), 4294967296.0);
+	unsigned long h = (unsigned long) (long) re * 2654435761UL;
+	h ^= (unsigned long) (long) im * 40503UL + kind;
+	h ^= h >> 17;
+	return h % MEMO_BUCKETS;
+}
+
+/* Look for zee in the memo table for ess, prec. Return 1 if found,
+ * with the value in val. */
+static int polylog_memo_fetch (int kind, cpx_t val, const cpx_t ess,
+                               const cpx_t zee, int prec)
+{
+	polylog_memo *m = polylog_memo_get (ess, prec);
+	if (NULL == m) return 0;
+
+	int nbits = 3.322 * m->prec + 10;
+	int found = 0;
+	int i;
+	for (i = m->bucket[polylog_memo_hash (kind, zee)]; 0 <= i; i = m->next[i])
+	{
+		if (m->kind[i] == kind && cpx_eq (m->key[i], zee, nbits))
+		{
+			cpx_set (val, m->val[i]);
+			found = 1;
+			break;
+		}
+	}
+
+	__atomic_add_fetch (&memo_lookups, 1, __ATOMIC_RELAXED);
+	if (found) __atomic_add_fetch (&memo_hits, 1, __ATOMIC_RELAXED);
+	return found;
+}
+
+/* The computation of val may itself have used the table for some
+ * other s, so the table is looked up afresh. */
+static void polylog_memo_store (int kind, const cpx_t val, const cpx_t ess,
+                                const cpx_t zee, int prec)
+{
+	polylog_memo *m = polylog_memo_get (ess, prec);
+	if (NULL == m) return;
+
+	if (MEMO_MAX <= m->n) polylog_memo_flush (m);
+	if (m->alloc <= m->n)
+	{
+		int i;
+		int na = 2 * m->alloc + 64;
+		m->kind = (int *) realloc (m->kind, na * sizeof (int));
+		m->next = (int *) realloc (m->next, na * sizeof (int));
+		m->key = (cpx_t *) realloc (m->key, na * sizeof (cpx_t));
+		m->val = (cpx_t *) realloc (m->val, na * sizeof (cpx_t));
+		for (i=m->alloc; i<na; i++)
+		{
+			cpx_init (m->key[i]);
+			cpx_init (m->val[i]);
+		}
+		m->alloc = na;
+	}
+
+	int i = m->n++;
+	int h = polylog_memo_hash (kind, zee);
+	m->kind[i] = kind;
+	cpx_set (m->key[i], zee);
+	cpx_set (m->val[i], val);
+	m->next[i] = m->bucket[h];
+	m->bucket[h] = i;
+}
+
+/* Call one of the recursive polylog routines, fn, through the
+ * memo table. */
+static int polylog_memo_call (int (*fn) (cpx_t, const cpx_t, const cpx_t, int, int),
+                              cpx_t plog, const cpx_t ess, const cpx_t zee,
+                              int prec, int depth)
+{
+	if (polylog_memo_fetch (MEMO_POLYLOG, plog, ess, zee, prec)) return 0;
+
+	int rc = fn (plog, ess, zee, prec, depth);
+	if (0 == rc) polylog_memo_store (MEMO_POLYLOG, plog, ess, zee, prec);
+	return rc;
+}
+
 /* ============================================================= */
 
 static int recurse_away_polylog (cpx_t plog, const cpx_t ess, const cpx_t zee, int prec, int depth);
+static int polylog_logser (cpx_t plog, const cpx_t ess, const cpx_t zee, int prec, int cold);
 
 static inline int polylog_recurse_duple (cpx_t plog, const cpx_t ess, const cpx_t zee, int prec, int depth)
 {
@@ -294,11 +558,11 @@ printf ("\n");
 cpx_prt ("zsq= ", zsq);
 printf ("\n");
 #endif
-	rc = recurse_away_polylog (pp, s, zsq, prec, depth);
+	rc = polylog_memo_call (recurse_away_polylog, pp, s, zsq, prec, depth);
 	if (rc) goto bailout;
 
 	cpx_neg (zsq, zee);
-	rc = recurse_away_polylog (pn, s, zsq, prec, depth);
+	rc = polylog_memo_call (recurse_away_polylog, pn, s, zsq, prec, depth);
 	if (rc) goto bailout;
 
 	/* now, compute 2^{1-s} in place */
@@ -332,7 +596,7 @@ static inline int polylog_recurse_triple (cpx_t plog, const cpx_t ess, const cpx
 
 	cpx_mul (zcu, zee, zee);
 	cpx_mul (zcu, zcu, zee);
-	rc = recurse_away_polylog (pp, s, zcu, prec, depth);
+	rc = polylog_memo_call (recurse_away_polylog, pp, s, zcu, prec, depth);
 	if (rc) goto bailout;
 
 	/* tr = exp (i 2pi/3) = -1/2  + i sqrt(3)/2 */
@@ -342,11 +606,11 @@ static inline int polylog_recurse_triple (cpx_t plog, const cpx_t ess, const cpx
 	fp_half_sqrt_three (tr[0].im, prec);
 
 	cpx_mul (zcu, tr, zee);
-	rc = recurse_away_polylog (pu, s, zcu, prec, depth);
+	rc = polylog_memo_call (recurse_away_polylog, pu, s, zcu, prec, depth);
 	if (rc) goto bailout;
 
 	cpx_mul (zcu, tr, zcu);
-	rc = recurse_away_polylog (pd, s, zcu, prec, depth);
+	rc = polylog_memo_call (recurse_away_polylog, pd, s, zcu, prec, depth);
 	if (rc) goto bailout;
 
 	/* now, compute 3^{1-s} in place */
@@ -398,6 +662,10 @@ static int recurse_away_polylog (cpx_t plog, const cpx_t ess, const cpx_t zee, i
 		fprintf (stderr, "excessive recursion (away) at z=%g+ i%g\n", zre, zim);
 		return 1;
 	}
+
+	/* Close to z=1, sum the series in log z instead. Only a call
+	 * from outside may pay for setting it up. */
+	if (0 == polylog_logser (plog, ess, zee, prec, 0 == depth)) return 0;
 	depth ++;
 
 	/*
@@ -489,7 +757,7 @@ static int recurse_away_polylog (cpx_t plog, const cpx_t ess, const cpx_t zee, i
 
 int cpx_polylog_away (cpx_t plog, const cpx_t ess, const cpx_t zee, int prec)
 {
-	int rc = recurse_away_polylog (plog, ess, zee, prec, 0);
+	int rc = polylog_memo_call (recurse_away_polylog, plog, ess, zee, prec, 0);
 	if (rc)
 	{
 		cpx_set_ui (plog, 0,0);
@@ -497,6 +765,71 @@ int cpx_polylog_away (cpx_t plog, const cpx_t ess, const cpx_t zee, int prec)
 	return rc;
 }
 
+/* ============================================================= */
+/* Commonly re-used values for polylog_invert(), one set per thread. */
+typedef struct
+{
+	cpx_t phase, scale, cache_ess, s;
+	mpf_t twopi, otp, log_twopi;
+	int cache_prec;
+} invert_state;
+
+/* Values that depend only on the precision */
+static void invert_state_prec (invert_state *st, int prec)
+{
+	st->cache_prec = prec;
+	mpf_set_prec (st->twopi, 3.322*prec +50);
+	mpf_set_prec (st->otp, 3.322*prec +50);
+	mpf_set_prec (st->log_twopi, 3.322*prec +50);
+
+	cpx_set_prec (st->phase, 3.322*prec +50);
+	cpx_set_prec (st->scale, 3.322*prec +50);
+	cpx_set_prec (st->s, 3.322*prec +50);
+	cpx_set_prec (st->cache_ess, 3.322*prec +50);
+
+	fp_two_pi (st->twopi, prec);
+
+	/* otp = -1/2pi */
+	mpf_set_ui (st->otp, 1);
+	mpf_neg (st->otp, st->otp);
+	mpf_div (st->otp, st->otp, st->twopi);
+
+	fp_log (st->log_twopi, st->twopi, prec);
+}
+
+static void * invert_state_new (void)
+{
+	invert_state *st = (invert_state *) malloc (sizeof (invert_state));
+	st->cache_prec = -1;
+	mpf_init (st->twopi);
+	mpf_init (st->otp);
+	mpf_init (st->log_twopi);
+
+	cpx_init (st->phase);
+	cpx_init (st->scale);
+	cpx_init (st->s);
+	cpx_init (st->cache_ess);
+	cpx_set_ui (st->cache_ess, 123123123, 321321321);
+	invert_state_prec (st, 15);
+	return st;
+}
+
+static void invert_state_free (void *p)
+{
+	invert_state *st = (invert_state *) p;
+	mpf_clear (st->twopi);
+	mpf_clear (st->otp);
+	mpf_clear (st->log_twopi);
+
+	cpx_clear (st->phase);
+	cpx_clear (st->scale);
+	cpx_clear (st->s);
+	cpx_clear (st->cache_ess);
+	free (st);
+}
+
+DECLARE_THREAD_STATE (invert_state_key, invert_state_new, invert_state_free);
+
 /* ============================================================= */
 
 static int recurse_towards_polylog (cpx_t plog, const cpx_t ess, const cpx_t zee, int prec, int depth);
@@ -520,11 +853,11 @@ printf ("\n");
 cpx_prt ("zroot= ", zroot);
 printf ("\n");
 #endif
-	rc = recurse_towards_polylog (pp, s, zroot, prec, depth);
+	rc = polylog_memo_call (recurse_towards_polylog, pp, s, zroot, prec, depth);
 	if (rc) goto bailout;
 
 	cpx_neg (zroot, zroot);
-	rc = recurse_towards_polylog (pn, s, zroot, prec, depth);
+	rc = polylog_memo_call (recurse_towards_polylog, pn, s, zroot, prec, depth);
 	if (rc) goto bailout;
 
 	cpx_add (plog, pp, pn);
@@ -687,45 +1020,12 @@ static int
 polylog_invert(cpx_t plog, const cpx_t ess, const cpx_t zee, int prec, int depth)
 {
 	int redo = 0;
+	invert_state *st = thread_state_get (&invert_state_key);
 
-	/* Create a cache of commonly re-used values. */
-	static int cache_prec = -1;
-	static mpf_t twopi, otp, log_twopi;
-	static cpx_t phase, scale, cache_ess, s;
-	if (-1 == cache_prec)
-	{
-		mpf_init (twopi);
-		mpf_init (otp);
-		mpf_init (log_twopi);
-
-		cpx_init (phase);
-		cpx_init (scale);
-		cpx_init (s);
-		cpx_init (cache_ess);
-		cpx_set_ui(cache_ess, 123123123, 321321321);
-	}
-
-	if (cache_prec != prec)
+	if (st->cache_prec != prec)
 	{
 		redo = 1;
-		cache_prec = prec;
-		mpf_set_prec (twopi, 3.322*prec +50);
-		mpf_set_prec (otp, 3.322*prec +50);
-		mpf_set_prec (log_twopi, 3.322*prec +50);
-
-		cpx_set_prec (phase, 3.322*prec +50);
-		cpx_set_prec (scale, 3.322*prec +50);
-		cpx_set_prec (s, 3.322*prec +50);
-		cpx_set_prec (cache_ess, 3.322*prec +50);
-
-		fp_two_pi (twopi, prec);
-
-		/* otp = -1/2pi */
-		mpf_set_ui (otp, 1);
-		mpf_neg (otp, otp);
-		mpf_div (otp, otp, twopi);
-
-		fp_log (log_twopi, twopi, prec);
+		invert_state_prec (st, prec);
 	}
 
 	cpx_t oz, tmp, logz;
@@ -734,34 +1034,34 @@ polylog_invert(cpx_t plog, const cpx_t ess, const cpx_t zee, int prec, int depth
 	cpx_init (logz);
 
 	/* Recompute these values only if s differs from last time. */
-	if (redo || !cpx_eq (ess, cache_ess, prec*3.322))
+	if (redo || !cpx_eq (ess, st->cache_ess, prec*3.322))
 	{
-		cpx_set (cache_ess, ess);
+		cpx_set (st->cache_ess, ess);
 
 		/* s = 1-ess */
-		cpx_ui_sub (s, 1, 0, ess);
+		cpx_ui_sub (st->s, 1, 0, ess);
 
 		/* compute ph = e^{-i pi s / 2} = (-i)^s */
-		cpx_times_mpf (tmp, s, twopi);
+		cpx_times_mpf (tmp, st->s, st->twopi);
 		cpx_div_ui (tmp, tmp, 4);
 		cpx_times_i (tmp, tmp);
 		cpx_neg (tmp, tmp);
 		cpx_exp (oz, tmp, prec);
-		cpx_mul (phase, oz, oz);
+		cpx_mul (st->phase, oz, oz);
 
 		/* gamma(s) (i)^s / (2pi)^s */
-		cpx_gamma_cache (scale, s, prec);
-		cpx_times_mpf (tmp, s, log_twopi);
+		cpx_gamma_cache (st->scale, st->s, prec);
+		cpx_times_mpf (tmp, st->s, st->log_twopi);
 		cpx_neg (tmp, tmp);
 		cpx_exp (tmp, tmp, prec);
-		cpx_mul (scale, scale, tmp);
-		cpx_div (scale, scale, oz);
+		cpx_mul (st->scale, st->scale, tmp);
+		cpx_div (st->scale, st->scale, oz);
 	}
 
 	/* compute ln z/(2pi i) */
 	cpx_set (oz, zee);
 	cpx_log (logz, oz, prec);
-	cpx_times_mpf (logz, logz, otp);
+	cpx_times_mpf (logz, logz, st->otp);
 	cpx_times_i (logz, logz);
 
 	/* Place branch cut so that it extends to the right from z=1 */
@@ -772,16 +1072,16 @@ polylog_invert(cpx_t plog, const cpx_t ess, const cpx_t zee, int prec, int depth
 
 	/* zeta (s, ln z/(2pi i)) */
 	// cpx_hurwitz_taylor (plog, s, logz, prec);
-	cpx_hurwitz_euler (plog, s, logz, prec);
+	cpx_hurwitz_euler (plog, st->s, logz, prec);
 
 	/* plus e^{-ipi s} zeta (s, 1-ln z/(2pi i)) */
 	cpx_ui_sub (logz, 1, 0, logz);
 	// cpx_hurwitz_taylor (tmp, s, logz, prec);
-	cpx_hurwitz_euler (tmp, s, logz, prec);
-	cpx_mul (tmp, tmp, phase);
+	cpx_hurwitz_euler (tmp, st->s, logz, prec);
+	cpx_mul (tmp, tmp, st->phase);
 	cpx_add (plog, plog, tmp);
 
-	cpx_mul (plog, plog, scale);
+	cpx_mul (plog, plog, st->scale);
 
 	cpx_clear (oz);
 	cpx_clear (logz);
@@ -1253,6 +1553,9 @@ static int recurse_towards_polylog (cpx_t plog, const cpx_t ess, const cpx_t zee
 		fprintf (stderr, "excessive recursion (to) at z=%g+ i%g\n", zre, zim);
 		return 1;
 	}
+
+	/* Close to z=1, sum the series in log z instead */
+	if (0 == polylog_logser (plog, ess, zee, prec, 0 == depth)) return 0;
 	depth ++;
 
 	/*
@@ -1375,960 +1678,3639 @@ static int recurse_towards_polylog (cpx_t plog, const cpx_t ess, const cpx_t zee
 	return rc;
 }
 
-int cpx_polylog (cpx_t plog, const cpx_t ess, const cpx_t zee, int prec)
-{
-	int rc = recurse_towards_polylog (plog, ess, zee, prec, 0);
-	if (rc)
-	{
-		cpx_set_ui (plog, 0,0);
-		return rc;
-	}
-	return 0;
-}
-
 /* ============================================================= */
-/**
- * cpx_polylog_sum -- compute the polylogarithm by direct summation
+/*
+ * Low-precision fast paths.
  *
- * Caches intermediate results, so that overall performance is
- * considerably better if z is varied while s is held fixed.
+ * For requests of fewer than about 30 digits, the GMP overhead
+ * completely dominates. The routines below implement the same
+ * algorithms -- Borwein, and the duplication recursion -- in IEEE
+ * double, or in double-double. Since there are no spare bits to
+ * hide in, each routine also returns a running bound on its
+ * absolute rounding error; the result is used only if that bound
+ * is below the requested precision. Otherwise, non-zero is
+ * returned, and the GMP code is used instead.
  *
- * The magnitude of z must be less than one.
+ * The inversion formula (Hurwitz zeta near z=1) is not handled
+ * here; points that need it go to the GMP code.
  */
 
-void cpx_polylog_sum (cpx_t plog, const cpx_t ess, const cpx_t zee, int prec)
+/* Largest polynomial order; bounds the stack arrays below. */
+#define LOWPREC_MAX_TERMS 127
+
+/* Unit roundoff, for double and for double-double. */
+#define LOWPREC_D_EPS 1.12e-16
+#define LOWPREC_DD_EPS 4.93e-32
+
+/* Return true if an absolute error of err is good to prec digits */
+static inline int lowprec_good_enough (double err, double mag, int prec)
 {
-	int n;
+	return err <= mag * pow (10.0, -prec);
+}
 
-	cpx_t s, z, zp, term;
-	cpx_init (s);
-	cpx_init (z);
-	cpx_init (zp);
-	cpx_init (term);
+/* ------------------------------------------------------------- */
+/* IEEE double versions */
 
-	cpx_set (s, ess);
-	cpx_set (z, zee);
-	cpx_set (zp, zee);
-	cpx_set_ui (plog, 0, 0);
+/*
+ * polylog_borwein_d -- same as polylog_borwein(). The error
+ * estimate is the sum of the magnitudes of all summands, times
+ * the roundoff of each, which grows with |s log k|.
+ */
+static double complex
+polylog_borwein_d (double *err, double complex ess, double complex z, int norder)
+{
+	double complex bins[LOWPREC_MAX_TERMS+1];
+	double abins[LOWPREC_MAX_TERMS+1];
+	double complex s, pz, acc, plog, bsum, term, ska;
+	double bin = 1.0;
+	double zmod = cabs (z);
+	double apz = 1.0;
+	double absum = 1.0;
+	double asum = 0.0;
+	double psum = 0.0;
+	int k;
 
-	/* Estimate the number of terms needed to sum over */
-	double mag = polylog_modsq (zee);
+	s = -ess;
+	pz = 1.0;
+	acc = 0.0;
+	plog = 0.0;
+	bsum = 1.0;
+	bins[0] = bsum;
+	abins[0] = absum;
 
-	/* Domain error, should be less than one */
-	if (1.0 <= mag)
+	for (k=1; k<=norder; k++)
 	{
-		fprintf (stderr, "cpx_polylog_sum(): Domain error, |z|=%g\n", sqrt(mag));
-		return;
+		pz *= z;
+		apz *= zmod;
+		term = cexp (s * log ((double) k));
+		acc += term * pz;
+		asum += cabs (term) * apz;
+
+		bin = bin * (norder-k+1) / k;
+		if (k%2) bsum -= bin * pz;
+		else bsum += bin * pz;
+		bins[k] = bsum;
+		absum += bin * apz;
+		abins[k] = absum;
 	}
 
-	int nterms = -2.0 * prec *2.302585093 / log(mag);
-	for (n=1; n<nterms; n++)
+	for (k=norder+1; k<=2*norder; k++)
 	{
-		cpx_ui_pow_cache (term, n, s, prec);
-		cpx_div (term, zp, term);
-
-		cpx_add (plog, plog, term);
-		cpx_mul (zp, zp, z);
+		pz *= z;
+		apz *= zmod;
+		term = cexp (s * log ((double) k));
+		plog += term * pz * bins[2*norder-k];
+		psum += cabs (term) * apz * abins[2*norder-k];
 	}
 
-	cpx_clear (s);
-	cpx_clear (z);
-	cpx_clear (zp);
-	cpx_clear (term);
+	ska = cpow (1.0 / (z - 1.0), norder);
+	plog *= ska;
+	psum *= cabs (ska);
+
+	*err = LOWPREC_D_EPS * (4.0 + cabs(s) * log (2.0*norder)) * (asum + psum);
+
+	if (norder%2) return acc - plog;
+	return acc + plog;
 }
 
-/* ============================================================= */
-/**
- * cpx_polylog_nint -- compute the polylogarithm at negetive integers
- *
- * At the negative integers, the polylog is a rational function,
- * meromorphic everywhere except for multiple poles at z=1.
+/*
+ * Apply the duplication formula, given Li_s(z^2) and Li_s(-z),
+ * or F(s,2q) and F(s,q+1/2), and their error estimates.
  */
+static inline double complex
+duple_d (double *err, double complex s,
+         double complex pp, double epp, double complex pn, double epn)
+{
+	double complex ts = cexp ((1.0 - s) * M_LN2);
+	pp *= ts;
+	*err = cabs (ts) * epp + epn + LOWPREC_D_EPS * (cabs (pp) + cabs (pn));
+	return pp - pn;
+}
 
-void cpx_polylog_nint (cpx_t plog, unsigned int negn, const cpx_t zee)
+static int recurse_away_polylog_d (double complex *plog, double *err,
+                                   double complex s, double complex z,
+                                   int prec, int depth)
 {
-	int k;
+	int rc;
+	double zre = creal (z);
+	double zim = cimag (z);
 
-	mpz_t stir, fac;
-	mpz_init (stir);
-	mpz_init (fac);
+	if (25 < zre*zre + zim*zim) return 1;
+	if (9 < depth) return 1;
+	depth ++;
 
-	cpx_t z, zp, term;
-	cpx_init (z);
-	cpx_init (zp);
-	cpx_init (term);
+	if (1.5 < polylog_get_zone (zre, zim))
+	{
+		double complex pp, pn;
+		double epp, epn;
+		rc = recurse_away_polylog_d (&pp, &epp, s, z*z, prec, depth);
+		if (rc) return rc;
+		rc = recurse_away_polylog_d (&pn, &epn, s, -z, prec, depth);
+		if (rc) return rc;
+		*plog = duple_d (err, s, pp, epp, pn, epn);
+		return 0;
+	}
 
-	cpx_set (z, zee);
-	cpx_sub_ui (zp, zee, 1, 0);
-	cpx_recip (zp, zp);
+	int nterms = polylog_terms_est_d (creal(s), cimag(s), zre, zim, prec);
+	if (1 > nterms || LOWPREC_MAX_TERMS < nterms) return 1;
 
-	if (0 == negn)
+	*plog = polylog_borwein_d (err, s, z, nterms);
+	return 0;
+}
+
+static int periodic_zeta_d (double complex *pz, double *err,
+                            double complex s, double q, int prec)
+{
+	int rc;
+	double complex pp, pn;
+	double epp, epn;
+
+	q -= floor (q);
+	if ((1.0e-15 > q) || (1.0e-15 > 1.0-q))
 	{
-		cpx_mul (plog, z, zp);
-		cpx_neg (plog, plog);
+		/* Same as the GMP code */
+		*pz = 0.0;
+		*err = 0.0;
+		return 0;
 	}
-	else
+	if (0.25 > q)
 	{
-		cpx_set_ui (plog, 0, 0);
-		mpz_set_ui (fac, 1);
-		cpx_set (z, zp);
-		for (k=1; k<= negn+1; k++)
-		{
-			i_stirling_second (stir, negn+1, k);
-			mpz_mul (stir, stir, fac);
-			mpf_set_z (term[0].re, stir);
-			mpf_set_ui (term[0].im, 0);
+		rc = periodic_zeta_d (&pp, &epp, s, 2.0*q, prec);
+		if (rc) return rc;
+		rc = periodic_zeta_d (&pn, &epn, s, q+0.5, prec);
+		if (rc) return rc;
+		*pz = duple_d (err, s, pp, epp, pn, epn);
+		return 0;
+	}
+	if (0.75 < q)
+	{
+		rc = periodic_zeta_d (&pp, &epp, s, 2.0*q-1.0, prec);
+		if (rc) return rc;
+		rc = periodic_zeta_d (&pn, &epn, s, q-0.5, prec);
+		if (rc) return rc;
+		*pz = duple_d (err, s, pp, epp, pn, epn);
+		return 0;
+	}
 
-			cpx_mul (term, term, zp);
+	double complex z = cexp (2.0*M_PI*I*q);
+	int nterms = polylog_terms_est_d (creal(s), cimag(s), creal(z), cimag(z), prec);
+	if (4 >= nterms || LOWPREC_MAX_TERMS < nterms) return 1;
 
-			cpx_add (plog, plog, term);
-			cpx_mul (zp, zp, z);
-			mpz_mul_ui (fac, fac, k);
-		}
+	*pz = polylog_borwein_d (err, s, z, nterms);
+	return 0;
+}
 
-		if (0==negn%2)
-		{
-			cpx_neg (plog, plog);
-		}
-	}
+/* ------------------------------------------------------------- */
+/* Double-double versions */
 
-	cpx_clear (z);
-	cpx_clear (zp);
-	cpx_clear (term);
-	mpz_clear (stir);
-	mpz_clear (fac);
+static inline double cdd_abs_d (cdd_t z)
+{
+	return hypot (z.re.hi, z.im.hi);
 }
 
-/* ============================================================= */
-/**
- * cpx_polylog_euler -- compute the polylogarithm from Hurwitz Euler.
- *
- * Combine two Hurwitz Euler-Maclaurin evaluations to obtain the polylogarithm.
- */
-
-void cpx_polylog_euler (cpx_t zeta, const cpx_t ess, const cpx_t zee, int prec)
+static cdd_t polylog_borwein_dd (double *err, cdd_t ess, cdd_t z, int norder)
 {
-	int redo = 0;
-	cpx_t q, tmp;
-	cpx_init (q);
-	cpx_init (tmp);
-
-	/* Create a cache of commonly re-used values */
-	static int cache_prec = -1;
+	cdd_t bins[LOWPREC_MAX_TERMS+1];
+	double abins[LOWPREC_MAX_TERMS+1];
+	cdd_t s, pz, acc, plog, bsum, term, ska;
+	dd_t bin = dd_set_d (1.0);
+	double zmod = cdd_abs_d (z);
+	double apz = 1.0;
+	double absum = 1.0;
+	double asum = 0.0;
+	double psum = 0.0;
+	int k;
 
-	static mpf_t twopi, otp, log_twopi;
-	static cpx_t phase, scale, cache_ess, s;
+	s = cdd_neg (ess);
+	pz = cdd_set_d (1.0, 0.0);
+	acc = cdd_set_d (0.0, 0.0);
+	plog = cdd_set_d (0.0, 0.0);
+	bsum = cdd_set_d (1.0, 0.0);
+	bins[0] = bsum;
+	abins[0] = absum;
 
-	if (-1 == cache_prec)
+	for (k=1; k<=norder; k++)
 	{
-		mpf_init (twopi);
-		mpf_init (otp);
-		mpf_init (log_twopi);
-
-		cpx_init (phase);
-		cpx_init (scale);
-		cpx_init (s);
-		cpx_init (cache_ess);
-		cpx_set_ui(cache_ess, 123123123, 321321321);
+		pz = cdd_mul (pz, z);
+		apz *= zmod;
+		term = cdd_ui_pow (k, s);
+		asum += cdd_abs_d (term) * apz;
+		acc = cdd_add (acc, cdd_mul (term, pz));
+
+		bin = dd_div_d (dd_mul_d (bin, norder-k+1), k);
+		term = cdd_times_dd (pz, bin);
+		if (k%2) bsum = cdd_sub (bsum, term);
+		else bsum = cdd_add (bsum, term);
+		bins[k] = bsum;
+		absum += bin.hi * apz;
+		abins[k] = absum;
 	}
 
-	if (cache_prec != prec)
+	for (k=norder+1; k<=2*norder; k++)
 	{
-		redo = 1;
-		cache_prec = prec;
-		mpf_set_prec (twopi, 3.322*prec +50);
-		mpf_set_prec (otp, 3.322*prec +50);
-		mpf_set_prec (log_twopi, 3.322*prec +50);
+		pz = cdd_mul (pz, z);
+		apz *= zmod;
+		term = cdd_ui_pow (k, s);
+		psum += cdd_abs_d (term) * apz * abins[2*norder-k];
+		term = cdd_mul (term, pz);
+		plog = cdd_add (plog, cdd_mul (term, bins[2*norder-k]));
+	}
 
-		cpx_set_prec (phase, 3.322*prec +50);
-		cpx_set_prec (scale, 3.322*prec +50);
-		cpx_set_prec (s, 3.322*prec +50);
-		cpx_set_prec (cache_ess, 3.322*prec +50);
+	/* ska = [1/(z-1)]^n */
+	ska = z;
+	ska.re = dd_add_d (ska.re, -1.0);
+	ska = cdd_recip (ska);
+	term = cdd_set_d (1.0, 0.0);
+	for (k=norder; k; k >>= 1)
+	{
+		if (k & 1) term = cdd_mul (term, ska);
+		ska = cdd_mul (ska, ska);
+	}
+	plog = cdd_mul (plog, term);
+	psum *= cdd_abs_d (term);
 
-		fp_two_pi (twopi, prec);
+	*err = LOWPREC_DD_EPS * (4.0 + cdd_abs_d (s) * log (2.0*norder)) * (asum + psum);
 
-		/* otp = -1/2pi */
-		mpf_set_ui (otp, 1);
-		mpf_neg (otp, otp);
-		mpf_div (otp, otp, twopi);
+	if (norder%2) return cdd_sub (acc, plog);
+	return cdd_add (acc, plog);
+}
 
-		fp_log (log_twopi, twopi, prec);
-	}
+static inline cdd_t duple_dd (double *err, cdd_t s,
+                              cdd_t pp, double epp, cdd_t pn, double epn)
+{
+	/* ts = 2^{1-s} */
+	cdd_t ts = cdd_neg (s);
+	ts.re = dd_add_d (ts.re, 1.0);
+	ts = cdd_pow_log (dd_log2, ts);
+
+	pp = cdd_mul (pp, ts);
+	*err = cdd_abs_d (ts) * epp + epn +
+	       LOWPREC_DD_EPS * (cdd_abs_d (pp) + cdd_abs_d (pn));
+	return cdd_sub (pp, pn);
+}
 
-	/* Recompute these values only if s differs from last time. */
-	if(redo || !cpx_eq (ess, cache_ess, prec*3.322))
-	{
-		cpx_set (cache_ess, ess);
-		cpx_ui_sub (s, 1, 0, ess);
+static int recurse_away_polylog_dd (cdd_t *plog, double *err,
+                                    cdd_t s, cdd_t z, int prec, int depth)
+{
+	int rc;
+	double zre = z.re.hi;
+	double zim = z.im.hi;
 
-		/* compute phase = e^{i pi s / 2} = (i)^s */
-		cpx_times_mpf (tmp, s, twopi);
-		cpx_div_ui (tmp, tmp, 4);
-		cpx_times_i (tmp, tmp);
-		cpx_exp (phase, tmp, prec);
+	if (25 < zre*zre + zim*zim) return 1;
+	if (9 < depth) return 1;
+	depth ++;
 
-		/* scale = gamma(s) / (2pi)^s */
-		cpx_gamma_cache (scale, s, prec);
-		cpx_times_mpf (tmp, s, log_twopi);
-		cpx_neg (tmp, tmp);
-		cpx_exp (tmp, tmp, prec);
-		cpx_mul (scale, scale, tmp);
+	if (1.5 < polylog_get_zone (zre, zim))
+	{
+		cdd_t pp, pn;
+		double epp, epn;
+		rc = recurse_away_polylog_dd (&pp, &epp, s, cdd_mul (z, z), prec, depth);
+		if (rc) return rc;
+		rc = recurse_away_polylog_dd (&pn, &epn, s, cdd_neg (z), prec, depth);
+		if (rc) return rc;
+		*plog = duple_dd (err, s, pp, epp, pn, epn);
+		return 0;
 	}
 
-	/* Compute q = ln z/(2pi i) */
-	cpx_log (q, zee, prec);
-	cpx_times_mpf (q, q, otp);
-	cpx_times_i (q, q);
+	int nterms = polylog_terms_est_d (s.re.hi, s.im.hi, zre, zim, prec);
+	if (1 > nterms || LOWPREC_MAX_TERMS < nterms) return 1;
 
-	/* exp (i pi s/2) * zeta (s,q) */
-	cpx_hurwitz_euler (zeta, s, q, prec);
-	cpx_mul (tmp, zeta, phase);
+	*plog = polylog_borwein_dd (err, s, z, nterms);
+	return 0;
+}
 
-	/* exp (-i pi s/2) * zeta (s,1-q) */
-	cpx_ui_sub (q, 1, 0, q);
-	cpx_hurwitz_euler (zeta, s, q, prec);
-	cpx_div (zeta, zeta, phase);
-	cpx_add (zeta, zeta, tmp);
+static int periodic_zeta_dd (cdd_t *pz, double *err, cdd_t s, dd_t q, int prec)
+{
+	int rc;
+	cdd_t pp, pn;
+	double epp, epn;
 
-	cpx_mul (zeta, zeta, scale);
+	if ((1.0e-15 > q.hi) || (1.0e-15 > 1.0-q.hi))
+	{
+		/* Same as the GMP code */
+		*pz = cdd_set_d (0.0, 0.0);
+		*err = 0.0;
+		return 0;
+	}
+	if (0.25 > q.hi)
+	{
+		rc = periodic_zeta_dd (&pp, &epp, s, dd_ldexp (q, 1), prec);
+		if (rc) return rc;
+		rc = periodic_zeta_dd (&pn, &epn, s, dd_add_d (q, 0.5), prec);
+		if (rc) return rc;
+		*pz = duple_dd (err, s, pp, epp, pn, epn);
+		return 0;
+	}
+	if (0.75 < q.hi)
+	{
+		rc = periodic_zeta_dd (&pp, &epp, s, dd_add_d (dd_ldexp (q, 1), -1.0), prec);
+		if (rc) return rc;
+		rc = periodic_zeta_dd (&pn, &epn, s, dd_add_d (q, -0.5), prec);
+		if (rc) return rc;
+		*pz = duple_dd (err, s, pp, epp, pn, epn);
+		return 0;
+	}
 
-	cpx_clear (q);
-	cpx_clear (tmp);
+	cdd_t z;
+	dd_sincos (&z.im, &z.re, dd_mul (dd_two_pi, q));
+	int nterms = polylog_terms_est_d (s.re.hi, s.im.hi, z.re.hi, z.im.hi, prec);
+	if (4 >= nterms || LOWPREC_MAX_TERMS < nterms) return 1;
+
+	*pz = polylog_borwein_dd (err, s, z, nterms);
+	return 0;
 }
 
-/* ============================================================= */
-/**
- * cpx_periodic_zeta -- Periodic zeta function
- *
- * F(s,q) = sum_{n=1}^infty exp(2pi iqn)/ n^s
- *        = Li_s (exp(2pi iq))
- * where
- * Li_s(z) is the polylogarithm
- *
- * Periodic zeta function is defined as F(s,q) by Tom Apostol, chapter 12
- *
- * For 0<q<1/4 or for 3/4<q<1, this algo applies the duplication
- * formula, and calls itself recusrively, until 1/4<q<3/4, which
- * can then be evaluated at a single shot using teh Borwein algorithm.
+/* ------------------------------------------------------------- */
+
+/*
+ * polylog_lowprec -- the recurse_towards_polylog() algorithm, less
+ * the inversion formula, in double or double-double precision.
  */
-void cpx_periodic_zeta (cpx_t z, const cpx_t ess, const mpf_t que, int prec)
+static int polylog_lowprec (cpx_t plog, const cpx_t ess, const cpx_t zee, int prec)
 {
-	mpf_t q, qf;
-	mpf_init (q);
-	mpf_init (qf);
+	int rc;
+	double err;
 
-	cpx_t s, sm;
-	cpx_init (s);
-	cpx_init (sm);
+	if (LOWPREC_DD_DIGITS < prec) return 1;
 
-	mpf_set (q, que);
-	mpf_floor (qf, q);
-	mpf_sub (q, q, qf);
+	double zre = cpx_get_re (zee);
+	double zim = cpx_get_im (zee);
+	double sre = cpx_get_re (ess);
+	double sim = cpx_get_im (ess);
+	double den = polylog_get_zone (zre, zim);
+	int nterms = polylog_terms_est_d (sre, sim, zre, zim, prec);
+	int direct = ((den < 1.5) && (0 < nterms) && (LOWPREC_MAX_TERMS >= nterms));
 
-	cpx_set (s, ess);
+	/* Points that need the inversion formula go to GMP */
+	if (!direct && (1.0 < zre*zre + zim*zim)) return 1;
 
-	double fq = mpf_get_d (q);
-	if ((1.0e-15 > fq) || (1.0e-15 > 1.0-fq))
+	if (LOWPREC_DOUBLE_DIGITS >= prec)
 	{
-		// XXX should be more precise with the next order
-		// q correction ...
-		// riemann_zeta (s.re, s.im, &z.re, &z.im);
-		cpx_set_ui (z, 0, 0);
+		double complex p;
+		double complex s = sre + I*sim;
+		double complex z = zre + I*zim;
+		rc = 0;
+		if (direct) p = polylog_borwein_d (&err, s, z, nterms);
+		else rc = recurse_away_polylog_d (&p, &err, s, z, prec, 0);
+
+		if ((0 == rc) && lowprec_good_enough (err, cabs (p), prec))
+		{
+			mpf_set_d (plog[0].re, creal (p));
+			mpf_set_d (plog[0].im, cimag (p));
+			return 0;
+		}
 	}
-	else if (mpf_cmp_d (q, 0.25) < 0)
-	{
-		/* Use the duplication formula to get into convergent region */
-		cpx_t ts, bt;
-		cpx_init (ts);
-		cpx_init (bt);
-
-		/* sm = 1-s */
-		cpx_neg (sm, s);
-		cpx_add_ui (sm, sm, 1, 0);
-
-		/* ts = 2^{1-s} */
-		fp_log2 (qf, prec);
-		cpx_times_mpf (sm, sm, qf);
-		cpx_exp (ts, sm, prec);
-
-		/* bt = pzeta (2q) * 2^{1-s} */
-		mpf_mul_ui (qf, q, 2);
-		cpx_periodic_zeta (bt, s, qf, prec);
-		cpx_mul (bt, bt, ts);
 
-		/* pzeta (q+0.5) */
-		mpf_set_ui (qf, 1);
-		mpf_div_ui (qf, qf, 2);
-		mpf_add (qf, q, qf);
-		cpx_periodic_zeta (z, s, qf, prec);
-		cpx_sub (z, bt, z);
+	cdd_t p;
+	cdd_t s = cdd_get_cpx (ess);
+	cdd_t z = cdd_get_cpx (zee);
+	rc = 0;
+	if (direct) p = polylog_borwein_dd (&err, s, z, nterms);
+	else rc = recurse_away_polylog_dd (&p, &err, s, z, prec, 0);
 
-		cpx_clear (ts);
-		cpx_clear (bt);
-	}
-	else if (mpf_cmp_d (q, 0.75) > 0)
-	{
-		/* Use the duplication formula to get into convergent region */
-		cpx_t ts, bt;
-		cpx_init (ts);
-		cpx_init (bt);
+	if (rc || !lowprec_good_enough (err, cdd_abs_d (p), prec)) return 1;
+	cdd_set_cpx (plog, p);
+	return 0;
+}
 
-		/* sm = 1-s */
-		cpx_neg (sm, s);
-		cpx_add_ui (sm, sm, 1, 0);
+/*
+ * periodic_zeta_lowprec -- cpx_periodic_zeta() in double or
+ * double-double precision. The fractional part of q is taken
+ * in GMP, so that no bits of q are lost.
+ */
+static int periodic_zeta_lowprec (cpx_t pz, const cpx_t ess, const mpf_t que, int prec)
+{
+	double err;
 
-		/* ts = 2^{1-s} */
-		fp_log2 (qf, prec);
-		cpx_times_mpf (sm, sm, qf);
-		cpx_exp (ts, sm, prec);
+	if (LOWPREC_DD_DIGITS < prec) return 1;
 
-		/* bt = pzeta (2q-1) * 2^{1-s} */
-		mpf_mul_ui (qf, q, 2);
-		mpf_sub_ui (qf, qf, 1);
-		cpx_periodic_zeta (bt, s, qf, prec);
-		cpx_mul (bt, bt, ts);
+	mpf_t q;
+	mpf_init2 (q, mpf_get_prec (que));
+	mpf_floor (q, que);
+	mpf_sub (q, que, q);
+	dd_t qd = dd_get_mpf (q);
+	mpf_clear (q);
 
-		/* pzeta (q-0.5) */
-		mpf_set_ui (qf, 1);
-		mpf_div_ui (qf, qf, 2);
-		mpf_sub (qf, q, qf);
-		cpx_periodic_zeta (z, s, qf, prec);
-		cpx_sub (z, bt, z);
+	/* The leaves are summed to more digits; the roundoff is in err */
+	int lprec = prec + periodic_zeta_guard (cpx_get_re (ess), qd.hi);
 
-		cpx_clear (ts);
-		cpx_clear (bt);
-	}
-	else
+	if (LOWPREC_DOUBLE_DIGITS >= prec)
 	{
-		/* Normal case; within the convergence region */
-		fp_two_pi (qf, prec);
-		mpf_mul (qf, qf, q);
-
-		fp_cosine (z[0].re, qf, prec);
-		fp_sine (z[0].im, qf, prec);
-
-		// cpx_polylog (z, s, z, prec);
-		int nterms = polylog_terms_est (s, z, prec);
-		if (4 < nterms)
-		{
-			polylog_borwein (z, s, z, nterms, prec);
-		}
-		else
+		double complex p;
+		double complex s = cpx_get_re (ess) + I*cpx_get_im (ess);
+		if ((0 == periodic_zeta_d (&p, &err, s, qd.hi, lprec)) &&
+		    lowprec_good_enough (err, cabs (p), prec))
 		{
-			fprintf (stderr, "Error: cpx_periodic_zeta() has bad terms estimate\n");
+			mpf_set_d (pz[0].re, creal (p));
+			mpf_set_d (pz[0].im, cimag (p));
+			return 0;
 		}
 	}
 
-	mpf_clear (q);
-	mpf_clear (qf);
+	cdd_t p;
+	if (periodic_zeta_dd (&p, &err, cdd_get_cpx (ess), qd, lprec)) return 1;
+	if (!lowprec_good_enough (err, cdd_abs_d (p), prec)) return 1;
+	cdd_set_cpx (pz, p);
+	return 0;
+}
 
-	cpx_clear (s);
-	cpx_clear (sm);
+int cpx_polylog (cpx_t plog, const cpx_t ess, const cpx_t zee, int prec)
+{
+	if (0 == polylog_lowprec (plog, ess, zee, prec))
+	{
+#ifdef CROSS_VALIDATE_LOWPREC
+		cpx_t mp;
+		cpx_init (mp);
+		if (0 == recurse_towards_polylog (mp, ess, zee, prec, 0))
+			lowprec_cross_check ("cpx_polylog", plog, mp, ess, zee, prec);
+		cpx_clear (mp);
+#endif /* CROSS_VALIDATE_LOWPREC */
+		return 0;
+	}
+
+	int rc = polylog_memo_call (recurse_towards_polylog, plog, ess, zee, prec, 0);
+	if (rc)
+	{
+		cpx_set_ui (plog, 0,0);
+		return rc;
+	}
+	return 0;
 }
 
 /* ============================================================= */
 /**
- * cpx_periodic_beta -- Periodic beta function
- *
- * Similar to periodic zeta, but with different normalization
- *
- * beta = 2 Gamma(s+1) (2\pi)^{-s} F(s,q)
- *
- * The implemented algorithm is to compute periodic zeta, and
- * then renormalize and return the ressult.
+ * cpx_polylog_grid -- polylog on a rectangular grid of z, fixed s.
  *
- * As of 22 December 2006, seems to be passing the tests --
- * that is, it gives the Bernoulli polynomials for integer s,
- * with all the right scale factors and signs, etc. Yay!
+ * The rows are spread over the thread pool. Within each thread, the
+ * state keyed on s (the powers k^-s, gamma(1-s) and the like) is
+ * computed once and then shared by all of the points that the thread
+ * handles, in this call and in later ones with the same s. Within a
+ * row, the points are taken in groups, by the path that the
+ * recursion will take, and the costliest first; as the cached powers
+ * are only ever bumped up in precision, this avoids recomputing them.
  */
-void cpx_periodic_beta (cpx_t zee, const cpx_t ess, const mpf_t que, int prec)
+typedef struct
 {
-	static cpx_t cache_s, scale;
-	static int precision = 0;
-	int redo = 0;
+	cpx_t *out;
+	cpx_t ess;
+	double sre, sim;
+	mpf_t x0, y0, dx, dy;
+	int nx;
+	int prec;
+	int *nfail;
+} polylog_grid_ctx;
+
+typedef struct
+{
+	int i;
+	int path;
+	int nterms;
+} polylog_grid_pt;
+
+static int polylog_grid_cmp (const void *a, const void *b)
+{
+	const polylog_grid_pt *pa = (const polylog_grid_pt *) a;
+	const polylog_grid_pt *pb = (const polylog_grid_pt *) b;
+	if (pa->path != pb->path) return pa->path - pb->path;
+	if (pa->nterms != pb->nterms) return pb->nterms - pa->nterms;
+	return pa->i - pb->i;
+}
+
+static void polylog_grid_row (void *arg, int row)
+{
+	polylog_grid_ctx *g = (polylog_grid_ctx *) arg;
+	int nx = g->nx;
+	int n;
+
+	cpx_t z;
+	cpx_init (z);
+	mpf_mul_ui (z[0].im, g->dy, row);
+	mpf_add (z[0].im, z[0].im, g->y0);
 
-	if (!precision)
+	/* Same tests as in recurse_towards_polylog() */
+	polylog_grid_pt *pts = (polylog_grid_pt *) malloc (nx * sizeof (polylog_grid_pt));
+	for (n=0; n<nx; n++)
 	{
-		precision = prec;
-		cpx_init (cache_s);
-		cpx_init (scale);
+		mpf_mul_ui (z[0].re, g->dx, n);
+		mpf_add (z[0].re, z[0].re, g->x0);
+
+		double zre = cpx_get_re (z);
+		double zim = cpx_get_im (z);
+		double mod = zre*zre + zim*zim;
+		pts[n].i = n;
+		pts[n].nterms = polylog_terms_est_d (g->sre, g->sim, zre, zim, g->prec);
+		pts[n].path = 2;
+		if (mod <= 1.0) pts[n].path = 1;
+		if (polylog_get_zone (zre, zim) < 1.5) pts[n].path = 0;
 	}
+	qsort (pts, nx, sizeof (polylog_grid_pt), polylog_grid_cmp);
 
-	if (precision < prec)
+	for (n=0; n<nx; n++)
 	{
-		precision = prec;
-		redo = 1;
-		cpx_set_prec (cache_s, 3.322*prec+50);
-		cpx_set_prec (scale, 3.322*prec+50);
+		int i = pts[n].i;
+		mpf_mul_ui (z[0].re, g->dx, i);
+		mpf_add (z[0].re, z[0].re, g->x0);
+		if (cpx_polylog (g->out[row*nx + i], g->ess, z, g->prec))
+			g->nfail[row] ++;
 	}
 
-	if (redo || !cpx_eq (ess, cache_s, prec*3.322))
-	{
-		cpx_set (cache_s, ess);
+	free (pts);
+	cpx_clear (z);
+}
 
-		mpf_t two_pi;
-		mpf_init (two_pi);
+int cpx_polylog_grid (cpx_t *out, const cpx_t ess,
+                      const cpx_t z_ll, const cpx_t z_ur,
+                      int nx, int ny, int prec, int nthreads)
+{
+	int j;
+	if (nx <= 0 || ny <= 0) return 0;
+
+	polylog_grid_ctx g;
+	g.out = out;
+	g.nx = nx;
+	g.prec = prec;
+	g.nfail = (int *) calloc (ny, sizeof (int));
+	cpx_init (g.ess);
+	cpx_set (g.ess, ess);
+	g.sre = cpx_get_re (ess);
+	g.sim = cpx_get_im (ess);
+	mpf_init (g.x0);
+	mpf_init (g.y0);
+	mpf_init (g.dx);
+	mpf_init (g.dy);
+	mpf_set (g.x0, z_ll[0].re);
+	mpf_set (g.y0, z_ll[0].im);
+	mpf_sub (g.dx, z_ur[0].re, z_ll[0].re);
+	mpf_sub (g.dy, z_ur[0].im, z_ll[0].im);
+	if (1 < nx) mpf_div_ui (g.dx, g.dx, nx-1);
+	if (1 < ny) mpf_div_ui (g.dy, g.dy, ny-1);
+
+	mp_parallel_for_n (nthreads, ny, polylog_grid_row, &g);
+
+	int nfail = 0;
+	for (j=0; j<ny; j++) nfail += g.nfail[j];
+
+	free (g.nfail);
+	cpx_clear (g.ess);
+	mpf_clear (g.x0);
+	mpf_clear (g.y0);
+	mpf_clear (g.dx);
+	mpf_clear (g.dy);
+	return nfail;
+}
 
-		cpx_t s, tps;
-		cpx_init (s);
-		cpx_init (tps);
+/* ============================================================= */
+/**
+ * cpx_polylog_sum -- compute the polylogarithm by direct summation
+ *
+ * Caches intermediate results, so that overall performance is
+ * considerably better if z is varied while s is held fixed.
+ *
+ * The magnitude of z must be less than one.
+ */
 
-		/* 2 gamma(s+1)/ (2pi)^s */
-		cpx_add_ui (s, ess, 1,0);
-		cpx_gamma_cache (scale, s, prec);
+void cpx_polylog_sum (cpx_t plog, const cpx_t ess, const cpx_t zee, int prec)
+{
+	int n;
 
-		/* times (2pi)^{-s} */
-		fp_two_pi (two_pi, prec);
-		cpx_neg (s, ess);
-		cpx_mpf_pow (tps, two_pi, s, prec);
-		cpx_mul (scale, scale, tps);
+	cpx_t s, z, zp, term;
+	cpx_init (s);
+	cpx_init (z);
+	cpx_init (zp);
+	cpx_init (term);
 
-		/* times two */
-		cpx_times_ui (scale, scale, 2);
-		cpx_clear (tps);
-		cpx_clear (s);
-		mpf_clear (two_pi);
+	cpx_set (s, ess);
+	cpx_set (z, zee);
+	cpx_set (zp, zee);
+	cpx_set_ui (plog, 0, 0);
+
+	/* Estimate the number of terms needed to sum over */
+	double mag = polylog_modsq (zee);
+
+	/* Domain error, should be less than one */
+	if (1.0 <= mag)
+	{
+		fprintf (stderr, "cpx_polylog_sum(): Domain error, |z|=%g\n", sqrt(mag));
+		return;
 	}
 
-	cpx_periodic_zeta (zee, ess, que, prec);
-	cpx_mul (zee, zee, scale);
+	int nterms = -2.0 * prec *2.302585093 / log(mag);
+	for (n=1; n<nterms; n++)
+	{
+		cpx_ui_pow_cache (term, n, s, prec);
+		cpx_div (term, zp, term);
+
+		cpx_add (plog, plog, term);
+		cpx_mul (zp, zp, z);
+	}
+
+	cpx_clear (s);
+	cpx_clear (z);
+	cpx_clear (zp);
+	cpx_clear (term);
 }
 
 /* ============================================================= */
 /**
- * hurwitz_zeta -- Hurwitz zeta function
+ * cpx_polylog_nint -- compute the polylogarithm at negetive integers
  *
- * Built up from the periodic zeta. Caches intermediate terms, and so
- * performance is much better if s is held const, while q is varied.
- * Expects the input value of q to be between 0 and 1.
+ * At the negative integers, the polylog is a rational function,
+ * meromorphic everywhere except for multiple poles at z=1:
  *
- * "built up" means periodic zeta is computed (twice) and then summed
- * with appropriate factors, to compute hurwitz zeta.
+ *    Li_{-n}(z) = z A_n(z) / (1-z)^{n+1}
+ *
+ * where A_n(z) is the Eulerian polynomial, whose coefficients,
+ * the Eulerian numbers, are cached.
  */
 
-static void hurwitz_zeta (cpx_t zee, const cpx_t ess, const mpf_t que, int prec)
+void cpx_polylog_nint (cpx_t plog, unsigned int negn, const cpx_t zee)
 {
-	static cpx_t cache_s, piss, niss, scale;
-	static int precision = 0;
-	int redo = 0;
+	int k;
 
-	if (!precision)
+	mpz_t eul;
+	mpz_init (eul);
+	mpf_t feul;
+	mpf_init (feul);
+
+	cpx_t w, acc;
+	cpx_init (w);
+	cpx_init (acc);
+
+	/* w = 1/(1-z) */
+	cpx_set_ui (w, 1, 0);
+	cpx_sub (w, w, zee);
+	cpx_recip (w, w);
+
+	if (0 == negn)
 	{
-		precision = prec;
-		cpx_init (cache_s);
-		cpx_init (piss);
-		cpx_init (niss);
-		cpx_init (scale);
+		cpx_mul (plog, zee, w);
 	}
-	if (precision < prec)
+	else
 	{
-		precision = prec;
-		redo = 1;
-		cpx_set_prec (cache_s, 3.322*prec+50);
-		cpx_set_prec (piss, 3.322*prec+50);
-		cpx_set_prec (niss, 3.322*prec+50);
-		cpx_set_prec (scale, 3.322*prec+50);
-	}
-
-	mpf_t t;
-	mpf_init (t);
+		/* Horner's rule for the Eulerian polynomial */
+		cpx_set_ui (acc, 1, 0);
+		for (k=negn-2; 0<=k; k--)
+		{
+			cpx_mul (acc, acc, zee);
+			i_eulerian (eul, negn, k);
+			mpf_set_z (feul, eul);
+			mpf_add (acc[0].re, acc[0].re, feul);
+		}
 
-	cpx_t s, zm;
-	cpx_init (s);
-	cpx_init (zm);
+		cpx_pow_ui (w, w, negn+1);
+		cpx_mul (acc, acc, w);
+		cpx_mul (plog, acc, zee);
+	}
 
-	/* s = 1-ess */
-	cpx_neg (s, ess);
-	cpx_add_ui (s, s, 1, 0);
+	cpx_clear (w);
+	cpx_clear (acc);
+	mpf_clear (feul);
+	mpz_clear (eul);
+}
 
-	if (redo || !cpx_eq (s, cache_s, prec*3.322))
-	{
-		cpx_set (cache_s, s);
+/**
+ * cpx_polylog_nint_batch -- Li_{-n}(z) for all n = 0..maxn, at one z
+ *
+ * Summing (k+1)^n z^{k+1} in two ways gives the recurrence
+ *
+ *    Li_{-n}(z) = z/(1-z) [1 + sum_{j=0}^{n-1} (n choose j) Li_{-j}(z)]
+ *
+ * so that each n costs n real-times-complex multiplies, and there
+ * is only the one division.
+ */
+void cpx_polylog_nint_batch (cpx_t *plog, unsigned int maxn, const cpx_t zee)
+{
+	unsigned int n, j;
 
-		cpx_t tps;
-		cpx_init (tps);
+	mpz_t bin;
+	mpz_init (bin);
+	mpf_t fbin;
+	mpf_init (fbin);
 
-		/* exp (i pi s/2) */
-		fp_pi_half (t, prec);
-		cpx_times_mpf (piss, s, t);
-		cpx_times_i (piss, piss);
-		cpx_exp (piss, piss, prec);
-		cpx_recip (niss, piss);
+	cpx_t r, acc, term;
+	cpx_init (r);
+	cpx_init (acc);
+	cpx_init (term);
 
-		/* gamma(s)/ (2pi)^s */
-		cpx_gamma_cache (scale, s, prec);
+	/* r = z/(1-z) = Li_0(z) */
+	cpx_set_ui (r, 1, 0);
+	cpx_sub (r, r, zee);
+	cpx_div (r, zee, r);
+	cpx_set (plog[0], r);
 
-		/* times (2pi)^{-s} */
-		fp_two_pi (t, prec);
-		cpx_neg (s, s);
-		cpx_mpf_pow (tps, t, s, prec);
-		cpx_neg (s, s);
-		cpx_mul (scale, scale, tps);
+	for (n=1; n<=maxn; n++)
+	{
+		cpx_set_ui (acc, 1, 0);
+		mpz_set_ui (bin, 1);
+		for (j=0; j<n; j++)
+		{
+			mpf_set_z (fbin, bin);
+			cpx_times_mpf (term, plog[j], fbin);
+			cpx_add (acc, acc, term);
 
-		/* times two */
-		cpx_clear (tps);
+			/* (n choose j+1) from (n choose j) */
+			mpz_mul_ui (bin, bin, n-j);
+			mpz_divexact_ui (bin, bin, j+1);
+		}
+		cpx_mul (plog[n], acc, r);
 	}
 
-	/* F(s,q) and F(s, 1-q) */
-	cpx_periodic_zeta (zee, s, que, prec);
-	mpf_ui_sub (t, 1, que);
-	cpx_periodic_zeta (zm, s, t, prec);
-
-	/* assemble the thing */
-	cpx_mul (zm, zm, piss);
-	cpx_mul (zee, zee, niss);
-	cpx_add (zee, zee, zm);
-	cpx_mul (zee, zee, scale);
-
-	cpx_clear (s);
-	cpx_clear (zm);
-	mpf_clear (t);
+	cpx_clear (r);
+	cpx_clear (acc);
+	cpx_clear (term);
+	mpf_clear (fbin);
+	mpz_clear (bin);
 }
 
-/* ============================================================= */
 /**
- * cpx_hurwitz_zeta -- Hurwitz zeta function
+ * q_polylog_nint -- Li_{-n}(z), exactly, for rational z
  *
- * Built up from the periodic zeta. Caches intermediate terms, and so
- * performance is much better if s is held const, while q is varied.
- * The value for q must be positive; the algo gets slow if q is large.
+ * With z = p/q, this is p q H / (q-p)^{n+1}, where
+ * H = sum_k A(n,k) p^k q^{n-1-k} is the Eulerian polynomial,
+ * homogenized. Returns non-zero, and sets plog to zero, at the
+ * pole z=1.
  */
-
-void cpx_hurwitz_zeta (cpx_t zee, const cpx_t ess, const mpf_t que, int prec)
+int q_polylog_nint (mpq_t plog, unsigned int negn, const mpq_t zee)
 {
-	cpx_t s, term;
-	mpf_t q;
-	cpx_init (s);
-	cpx_init (term);
-	mpf_init (q);
-	cpx_set (s, ess);
-	mpf_set (q, que);
+	int k;
 
-	/* Make sure q is between 0 and 1, by subtracting the integer part */
-	long nq = mpf_get_si (q);
-	mpf_sub_ui (q, q, nq);
+	if (0 == mpq_cmp_ui (zee, 1, 1))
+	{
+		mpq_set_ui (plog, 0, 1);
+		return 1;
+	}
 
-	hurwitz_zeta (zee, s, q, prec);
+	mpz_t p, q, h, qpow, eul;
+	mpz_init (p);
+	mpz_init (q);
+	mpz_init (h);
+	mpz_init (qpow);
+	mpz_init (eul);
 
-	cpx_neg (s, s);
-	int k;
-	for (k=0; k<nq; k++)
+	mpz_set (p, mpq_numref (zee));
+	mpz_set (q, mpq_denref (zee));
+
+	if (0 == negn)
 	{
-		/* subtract off the leading terms -- the 1/(q+k)^s */
-		cpx_mpf_pow (term, q, s, prec);
-		cpx_sub (zee, zee, term);
-		mpf_add_ui (q, q, 1);
+		mpz_set (h, p);
+	}
+	else
+	{
+		/* Horner's rule, homogenized */
+		mpz_set_ui (h, 1);
+		mpz_set_ui (qpow, 1);
+		for (k=negn-2; 0<=k; k--)
+		{
+			mpz_mul (h, h, p);
+			mpz_mul (qpow, qpow, q);
+			i_eulerian (eul, negn, k);
+			mpz_addmul (h, eul, qpow);
+		}
+		mpz_mul (h, h, p);
+		mpz_mul (h, h, q);
 	}
 
-	cpx_clear (s);
-	cpx_clear (term);
-	mpf_clear (q);
+	/* (q-p)^{n+1} */
+	mpz_sub (q, q, p);
+	mpz_pow_ui (q, q, negn+1);
+
+	mpz_set (mpq_numref (plog), h);
+	mpz_set (mpq_denref (plog), q);
+	mpq_canonicalize (plog);
+
+	mpz_clear (p);
+	mpz_clear (q);
+	mpz_clear (h);
+	mpz_clear (qpow);
+	mpz_clear (eul);
+	return 0;
 }
 
 /* ============================================================= */
 /**
- * cpx_hurwitz_taylor -- Hurwitz zeta function Taylor series
- *
- * Implement the Hurwitz zeta as a Taylor expansion about q=0.
- * Recall, hurwitz(s,q) = sum_{k=0}^\infty (k+q)^{-s}
- *
- * If the real part of q fails to satisfy -0.5 < Re q < 0.5 then
- * the sum over k is shifted, to absorb the integer part. Thus,
- * the domain of convergence is a bubbly strip surrounding the real
- * axis, approximately -0.866 < Im q < 0.866. This corresponds to
- * an infinitely repeated bubble of |q| < 1.0 in which the Taylor
- * series can converge.
- *
- * The algo prints a warning when the shifted |q| < 0.9 isn't true.
- * It returns a non-zero value in this case, else zero if success.
- * TODO: This should be converted to an exception.
- *
- * Overview of the algorithm:
- * First, pull out the leading 1/q^s term, and handle it distinctly.
- *    hurwitz(s,q) = 1/q^s + sum_{k=1}^\infty (k+q)^{-s}
- *
- * If the real part of q fails to satisfy -0.5 < Re q < 0.5 then
- * additional terms are peeled off the sum, until it is brought into
- * this domain. This works, because, hey, it just means moving over
- * where the sum in k starts. Execution time is linear in |Re q|
- * because each term is peeled off, one by one.
- *
- * Taylor series is f(q) = sum_{n=0}^\infty q^n f^{(n)}(0) / n!
- *
- * Taylor series for hurwitz in q requires the n'th derivative
- * d^n/dq^n (k+q)^{-s} = (-1)^n s(s+1)(s+2)...(s+n-1) / (k+q)^{s+n}
- *
- * Exchanging the order of the Hurwitz and Taylor summations, we get
- *    f^{(n)}(0) = (-1)^n s(s+1)(s+2)...(s+n-1)
- *                       sum_{k=1}^\infty 1/k^{s+n}
- *
- * The product is the rising Pochammer. The sum is just the Riemann
- * zeta, that is zeta(s+n) = sum_{k=1}^\infty 1/k^{s+n} and so we write
- *    f^{(n)}(0) = (-1)^n s(s+1)(s+2)...(s+n-1) zeta(s+n)
- *
- * The factorial divides the rising Pochammer to yeild the binomial
- * coefficient:
- *    binom(s+n-1, n) = s(s+1)(s+2)...(s+n-1) / n!
+ * cpx_polylog_euler -- compute the polylogarithm from Hurwitz Euler.
  *
- * Thus, we conclude
- *    hurwitz(s,q) = 1/q^s + sum_{n=0}^\infty q^n binom(s+n-1, n) zeta(s+n)
+ * Combine two Hurwitz Euler-Maclaurin evaluations to obtain the polylogarithm.
  */
 
-int cpx_hurwitz_taylor (cpx_t hurw, const cpx_t ess, const cpx_t que, int prec)
+void cpx_polylog_euler (cpx_t zeta, const cpx_t ess, const cpx_t zee, int prec)
 {
-	cpx_t s, sn, q, qn, bin, term;
-	cpx_init (s);
-	cpx_init (sn);
+	int redo = 0;
+	cpx_t q, tmp;
 	cpx_init (q);
-	cpx_init (qn);
-	cpx_init (bin);
-	cpx_init (term);
+	cpx_init (tmp);
 
-	/* Define epsilon = 10^{-prec} as bound for smallest term in sum. */
-	mpf_t epsilon, aterm;
-	mpf_init (epsilon);
-	mpf_init (aterm);
-	fp_epsilon (epsilon, 2*prec);
+	/* Create a cache of commonly re-used values */
+	static int cache_prec = -1;
 
-	cpx_set (s, ess);
-	cpx_set (q, que);
+	static mpf_t twopi, otp, log_twopi;
+	static cpx_t phase, scale, cache_ess, s;
 
-	/* Compute 1/q^s if the real part of q is near 0.
-	 *
-	 * Else navigate the waters of the Hurwitz branch cut.
-	 * "Near zero" is -0.5 < Re q < 0.5. However, 0.5 is
-	 * the Riemann critical line, so move off of that,
-	 * to -0.55 < Re q < 0.45 to avoid weird rounding effects.
-	 *
-	 * Define tay(s,q) = sum_{k=1}^\infty (k+q)^{-s}
-	 * and note that hurwitz(s,q) = 1/q^s + tay(s,q)
-	 * Perform repeated shifts as follows:
-	 *
-	 * Let L = floor(Re q + 0.55)
-	 * Define q' = q - L
-	 * This allows tay(s,q') to be evaluated within the
-	 * domain of convergence |q'| < 1. This correspnds to
-	 * a band of unit-radius disks centered on the integers.
-	 *
-	 * For L > 0 define shif(s,q) = - sum_{k=1}^{L-1} 1/(q-k)^s
-	 * For L <=0 define shif(s,q) = sum_{k=0}^{-L} 1/(q+k)^s
-	 * This allows hurwitz(s,q) = shif(s,q) + tay(s,q')
-	 *
-	 * On exit from this pair of loops, hurw will contain shif(s,q)
-	 * and Re q will satisfy -0.55 < Re q < 0.45
-	 *
-	 * Examples:
-	 * -1.55 < Re q < -0.55  means L=-1 and hurw = 1/q^s + 1/(q+1)^s
-	 * -0.55 < Re q < +0.45  means L=0 and hurw = 1/q^s
-	 * +0.45 < Re q < +1.45  means L=1 and hurw = 0
-	 * +1.45 < Re q < +2.45  means L=2 and hurw = - 1/(q-1)^s
-	 * +2.45 < Re q < +3.45  means L=3 and hurw = - [1/(q-1)^s + 1/(q-2)^s]
-	 *
-	 * TODO: right now, the above uses the floating compare, which
-	 * might result in bizarro rounding errors at high accuracy. Maybe.
-	 * I dunno. Right now, none of the code actually requires this func,
-	 * so for now, leave as-is.
-	 */
-#define STRIP 0.45
-	cpx_neg (s, s);
-	cpx_set_ui (hurw, 0, 0);
-	while (mpf_cmp_d (q[0].re, STRIP) < 0)
-	{
-		cpx_pow (qn, q, s, prec);
-		cpx_add (hurw, hurw, qn);
-		mpf_add_ui (q[0].re, q[0].re, 1);
-	}
-	mpf_sub_ui (q[0].re, q[0].re, 1);
-	while (mpf_cmp_d (q[0].re, 1.0+STRIP) > 0)
+	if (-1 == cache_prec)
+	{
+		mpf_init (twopi);
+		mpf_init (otp);
+		mpf_init (log_twopi);
+
+		cpx_init (phase);
+		cpx_init (scale);
+		cpx_init (s);
+		cpx_init (cache_ess);
+		cpx_set_ui(cache_ess, 123123123, 321321321);
+	}
+
+	if (cache_prec != prec)
+	{
+		redo = 1;
+		cache_prec = prec;
+		mpf_set_prec (twopi, 3.322*prec +50);
+		mpf_set_prec (otp, 3.322*prec +50);
+		mpf_set_prec (log_twopi, 3.322*prec +50);
+
+		cpx_set_prec (phase, 3.322*prec +50);
+		cpx_set_prec (scale, 3.322*prec +50);
+		cpx_set_prec (s, 3.322*prec +50);
+		cpx_set_prec (cache_ess, 3.322*prec +50);
+
+		fp_two_pi (twopi, prec);
+
+		/* otp = -1/2pi */
+		mpf_set_ui (otp, 1);
+		mpf_neg (otp, otp);
+		mpf_div (otp, otp, twopi);
+
+		fp_log (log_twopi, twopi, prec);
+	}
+
+	/* Recompute these values only if s differs from last time. */
+	if(redo || !cpx_eq (ess, cache_ess, prec*3.322))
+	{
+		cpx_set (cache_ess, ess);
+		cpx_ui_sub (s, 1, 0, ess);
+
+		/* compute phase = e^{i pi s / 2} = (i)^s */
+		cpx_times_mpf (tmp, s, twopi);
+		cpx_div_ui (tmp, tmp, 4);
+		cpx_times_i (tmp, tmp);
+		cpx_exp (phase, tmp, prec);
+
+		/* scale = gamma(s) / (2pi)^s */
+		cpx_gamma_cache (scale, s, prec);
+		cpx_times_mpf (tmp, s, log_twopi);
+		cpx_neg (tmp, tmp);
+		cpx_exp (tmp, tmp, prec);
+		cpx_mul (scale, scale, tmp);
+	}
+
+	/* Compute q = ln z/(2pi i) */
+	cpx_log (q, zee, prec);
+	cpx_times_mpf (q, q, otp);
+	cpx_times_i (q, q);
+
+	/* exp (i pi s/2) * zeta (s,q) */
+	cpx_hurwitz_euler (zeta, s, q, prec);
+	cpx_mul (tmp, zeta, phase);
+
+	/* exp (-i pi s/2) * zeta (s,1-q) */
+	cpx_ui_sub (q, 1, 0, q);
+	cpx_hurwitz_euler (zeta, s, q, prec);
+	cpx_div (zeta, zeta, phase);
+	cpx_add (zeta, zeta, tmp);
+
+	cpx_mul (zeta, zeta, scale);
+
+	cpx_clear (q);
+	cpx_clear (tmp);
+}
+
+/* ============================================================= */
+/**
+ * cpx_periodic_zeta -- Periodic zeta function
+ *
+ * F(s,q) = sum_{n=1}^infty exp(2pi iqn)/ n^s
+ *        = Li_s (exp(2pi iq))
+ * where
+ * Li_s(z) is the polylogarithm
+ *
+ * Periodic zeta function is defined as F(s,q) by Tom Apostol, chapter 12
+ *
+ * For 0<q<1/4 or for 3/4<q<1, this algo applies the duplication
+ * formula, and calls itself recusrively, until 1/4<q<3/4, which
+ * can then be evaluated at a single shot using teh Borwein algorithm.
+ */
+static void periodic_zeta_mp (cpx_t z, const cpx_t ess, const mpf_t que, int prec)
+{
+	mpf_t q, qf;
+	mpf_init (q);
+	mpf_init (qf);
+
+	cpx_t s, sm, qkey;
+	cpx_init (s);
+	cpx_init (sm);
+	cpx_init (qkey);
+
+	mpf_set (q, que);
+	mpf_floor (qf, q);
+	mpf_sub (q, q, qf);
+
+	cpx_set (s, ess);
+
+	/* The duplication formula below revisits the same q's */
+	mpf_set (qkey[0].re, q);
+	if (polylog_memo_fetch (MEMO_PERIODIC, z, s, qkey, prec)) goto bailout;
+
+	double fq = mpf_get_d (q);
+	if ((1.0e-15 > fq) || (1.0e-15 > 1.0-fq))
+	{
+		// XXX should be more precise with the next order
+		// q correction ...
+		// riemann_zeta (s.re, s.im, &z.re, &z.im);
+		cpx_set_ui (z, 0, 0);
+	}
+	else if (mpf_cmp_d (q, 0.25) < 0)
+	{
+		/* Use the duplication formula to get into convergent region */
+		cpx_t ts, bt;
+		cpx_init (ts);
+		cpx_init (bt);
+
+		/* sm = 1-s */
+		cpx_neg (sm, s);
+		cpx_add_ui (sm, sm, 1, 0);
+
+		/* ts = 2^{1-s} */
+		fp_log2 (qf, prec);
+		cpx_times_mpf (sm, sm, qf);
+		cpx_exp (ts, sm, prec);
+
+		/* bt = pzeta (2q) * 2^{1-s} */
+		mpf_mul_ui (qf, q, 2);
+		periodic_zeta_mp (bt, s, qf, prec);
+		cpx_mul (bt, bt, ts);
+
+		/* pzeta (q+0.5) */
+		mpf_set_ui (qf, 1);
+		mpf_div_ui (qf, qf, 2);
+		mpf_add (qf, q, qf);
+		periodic_zeta_mp (z, s, qf, prec);
+		cpx_sub (z, bt, z);
+
+		cpx_clear (ts);
+		cpx_clear (bt);
+	}
+	else if (mpf_cmp_d (q, 0.75) > 0)
+	{
+		/* Use the duplication formula to get into convergent region */
+		cpx_t ts, bt;
+		cpx_init (ts);
+		cpx_init (bt);
+
+		/* sm = 1-s */
+		cpx_neg (sm, s);
+		cpx_add_ui (sm, sm, 1, 0);
+
+		/* ts = 2^{1-s} */
+		fp_log2 (qf, prec);
+		cpx_times_mpf (sm, sm, qf);
+		cpx_exp (ts, sm, prec);
+
+		/* bt = pzeta (2q-1) * 2^{1-s} */
+		mpf_mul_ui (qf, q, 2);
+		mpf_sub_ui (qf, qf, 1);
+		periodic_zeta_mp (bt, s, qf, prec);
+		cpx_mul (bt, bt, ts);
+
+		/* pzeta (q-0.5) */
+		mpf_set_ui (qf, 1);
+		mpf_div_ui (qf, qf, 2);
+		mpf_sub (qf, q, qf);
+		periodic_zeta_mp (z, s, qf, prec);
+		cpx_sub (z, bt, z);
+
+		cpx_clear (ts);
+		cpx_clear (bt);
+	}
+	else
+	{
+		/* Normal case; within the convergence region */
+		fp_two_pi (qf, prec);
+		mpf_mul (qf, qf, q);
+
+		fp_cosine (z[0].re, qf, prec);
+		fp_sine (z[0].im, qf, prec);
+
+		// cpx_polylog (z, s, z, prec);
+		int nterms = polylog_terms_est (s, z, prec);
+		if (4 < nterms)
+		{
+			polylog_borwein (z, s, z, nterms, prec);
+		}
+		else
+		{
+			fprintf (stderr, "Error: cpx_periodic_zeta() has bad terms estimate\n");
+		}
+	}
+
+	polylog_memo_store (MEMO_PERIODIC, z, s, qkey, prec);
+
+bailout:
+	mpf_clear (q);
+	mpf_clear (qf);
+
+	cpx_clear (s);
+	cpx_clear (sm);
+	cpx_clear (qkey);
+}
+
+void cpx_periodic_zeta (cpx_t z, const cpx_t ess, const mpf_t que, int prec)
+{
+	int mprec = prec + periodic_zeta_guard (cpx_get_re (ess), mpf_get_d (que));
+
+	if (0 == periodic_zeta_lowprec (z, ess, que, prec))
+	{
+#ifdef CROSS_VALIDATE_LOWPREC
+		cpx_t mp, q;
+		cpx_init (mp);
+		cpx_init (q);
+		mpf_set (q[0].re, que);
+		periodic_zeta_mp (mp, ess, que, mprec);
+		lowprec_cross_check ("cpx_periodic_zeta", z, mp, ess, q, prec);
+		cpx_clear (mp);
+		cpx_clear (q);
+#endif /* CROSS_VALIDATE_LOWPREC */
+		return;
+	}
+	periodic_zeta_mp (z, ess, que, mprec);
+}
+
+/* ============================================================= */
+/**
+ * cpx_periodic_zeta_batch -- F(s,p/N) for all p = 0..N-1 at once.
+ *
+ * Split the sum over n by the residue r = n mod N:
+ *
+ *     F(s,p/N) = sum_{r=1}^N exp(2pi i rp/N) c_r
+ *     c_r = sum_{k>=0} (kN+r)^{-s} = N^{-s} zeta(s, r/N)
+ *
+ * so that all N values are one discrete Fourier transform of the
+ * Hurwitz zeta at q=r/N. Each c_r is summed directly for k < M; the
+ * rest, starting at n = MN+r, is the Euler-Maclaurin tail, which,
+ * with a = n/N, is
+ *
+ *     n^{-s} [a/(s-1) + 1/2 + sum_{j=1}^J B_{2j}/(2j)! (s)_{2j-1} a^{1-2j}]
+ *
+ * with (s)_k the rising factorial. Only the integer powers n^{-s},
+ * for n <= (M+1)N, are needed; as these are completely
+ * multiplicative, only those at the primes need an exp and a log,
+ * the rest are one multiply each. The coefficients of the tail are
+ * shared by all r.
+ */
+
+/* Cost of n^{-s} at a prime, and of one tail term, relative to a
+ * complex multiply. */
+#define PZETA_POW_COST 40.0
+#define PZETA_TAIL_COST 2.0
+
+/**
+ * periodic_zeta_batch_plan() -- pick the number of direct terms M
+ * per residue, and of tail terms J, for the cheapest sum to prec
+ * digits. Returns the estimated cost, in multiplies.
+ */
+static double periodic_zeta_batch_plan (double sre, double sim,
+                                        unsigned int N, int prec,
+                                        unsigned int *mterms, int *ntail)
+{
+	double best = HUGE_VAL;
+	double lneps = -(prec+3) * M_LN10;
+	double ltwopi = log (2.0*M_PI);
+
+	*mterms = 0;
+	*ntail = 0;
+	unsigned int m;
+	for (m=1; (m+1.0)*N < 4.0e9; m++)
+	{
+		/* Bigger m can only cost more */
+		if (best < m * (double) N) break;
+
+		double nmin = m * (double) N + 1.0;
+		double lnn = log (nmin);
+		double la = log (nmin / N);
+
+		/* Log of the first omitted tail term, j+1, which is about
+		 * 2 |(s)_{2j+1}| (2pi)^{-2j-2} a^{-2j-1} n^{-sigma}. */
+		double err = M_LN2 + 0.5 * log (sre*sre + sim*sim)
+		           - 2.0*ltwopi - la - sre*lnn;
+		int j = 0;
+		while (lneps < err)
+		{
+			double r1 = sre + 2*j + 1.0;
+			double r2 = sre + 2*j + 2.0;
+			double step = 0.5 * log ((r1*r1 + sim*sim) * (r2*r2 + sim*sim))
+			            - 2.0*ltwopi - 2.0*la;
+			if (0.0 <= step) break;
+			err += step;
+			j++;
+		}
+		if (lneps < err) continue;
+
+		double cost = (m+1.0) * N * (1.0 + PZETA_POW_COST / lnn)
+		            + N * j * PZETA_TAIL_COST;
+		if (cost < best)
+		{
+			best = cost;
+			*mterms = m;
+			*ntail = j;
+		}
+	}
+	return best;
+}
+
+typedef struct
+{
+	cpx_t *out;
+	cpx_t *d;
+	cpx_t *w;
+	unsigned int N;
+	mp_bitcnt_t bits;
+} pzeta_dft_ctx;
+
+/* One output of the plain DFT, for N not a power of two */
+static void pzeta_dft_row (void *arg, int p)
+{
+	pzeta_dft_ctx *ctx = (pzeta_dft_ctx *) arg;
+	unsigned int N = ctx->N;
+	unsigned int m;
+
+	cpx_t acc, term;
+	cpx_init2 (acc, ctx->bits);
+	cpx_init2 (term, ctx->bits);
+
+	cpx_set (acc, ctx->d[0]);
+	for (m=1; m<N; m++)
+	{
+		cpx_mul (term, ctx->d[m], ctx->w[((unsigned long) m * p) % N]);
+		cpx_add (acc, acc, term);
+	}
+	cpx_set (ctx->out[p], acc);
+
+	cpx_clear (acc);
+	cpx_clear (term);
+}
+
+void cpx_periodic_zeta_batch (cpx_t *out, const cpx_t ess, unsigned int N, int prec)
+{
+	unsigned int n, r, k;
+	int j;
+	if (0 == N) return;
+
+	if (0 == mpf_cmp_ui (ess[0].re, 1) && 0 == mpf_sgn (ess[0].im))
+	{
+		fprintf (stderr, "Error: cpx_periodic_zeta_batch(): pole at s=1\n");
+		for (r=0; r<N; r++) cpx_set_ui (out[r], 0, 0);
+		return;
+	}
+
+	double sre = cpx_get_re (ess);
+	double sim = cpx_get_im (ess);
+	unsigned int mterms;
+	int ntail;
+	periodic_zeta_batch_plan (sre, sim, N, prec, &mterms, &ntail);
+	unsigned int nmax = (mterms+1) * N;
+
+	/* For Re s < 0, the terms grow, and cancel in the sums */
+	mp_bitcnt_t bits = mpf_get_default_prec ();
+	if (0.0 > sre) bits += (mp_bitcnt_t) (-sre * log2 (nmax));
+	int wprec = bits / 3.322;
+
+	cpx_t mess, term, acc, tail;
+	cpx_init2 (mess, bits);
+	cpx_init2 (term, bits);
+	cpx_init2 (acc, bits);
+	cpx_init2 (tail, bits);
+	cpx_neg (mess, ess);
+
+	/* pw[n] = n^{-s}, out of the smallest prime factor of n */
+	unsigned int *spf = (unsigned int *) calloc (nmax+1, sizeof (unsigned int));
+	cpx_t *pw = (cpx_t *) malloc ((nmax+1) * sizeof (cpx_t));
+	for (n=1; n<=nmax; n++) cpx_init2 (pw[n], bits);
+	cpx_set_ui (pw[1], 1, 0);
+	for (n=2; n<=nmax; n++)
+	{
+		if (0 == spf[n])
+		{
+			for (k=n; k<=nmax; k+=n)
+				if (0 == spf[k]) spf[k] = n;
+			cpx_ui_pow (pw[n], n, mess, wprec);
+		}
+		else
+		{
+			cpx_mul (pw[n], pw[spf[n]], pw[n/spf[n]]);
+		}
+	}
+	free (spf);
+
+	/* tc[j] = B_{2j}/(2j)! (s)_{2j-1}, and sm = 1/(s-1) */
+	cpx_t *tc = (cpx_t *) malloc ((ntail+1) * sizeof (cpx_t));
+	cpx_t poch, sm;
+	mpf_t fact, bf, a, x, xsq, xp;
+	cpx_init2 (poch, bits);
+	cpx_init2 (sm, bits);
+	mpf_init2 (fact, bits);
+	mpf_init2 (bf, bits);
+	mpf_init2 (a, bits);
+	mpf_init2 (x, bits);
+	mpf_init2 (xsq, bits);
+	mpf_init2 (xp, bits);
+
+	cpx_set (poch, ess);
+	mpf_set_ui (fact, 2);
+	for (j=1; j<=ntail; j++)
+	{
+		cpx_init2 (tc[j], bits);
+		fp_bernoulli (bf, 2*j, wprec);
+		mpf_div (bf, bf, fact);
+		cpx_times_mpf (tc[j], poch, bf);
+
+		cpx_add_ui (term, ess, 2*j-1, 0);
+		cpx_mul (poch, poch, term);
+		cpx_add_ui (term, ess, 2*j, 0);
+		cpx_mul (poch, poch, term);
+		mpf_mul_ui (fact, fact, (2*j+1)*(2*j+2));
+	}
+	cpx_sub_ui (sm, ess, 1, 0);
+	cpx_recip (sm, sm);
+
+	/* d[r mod N] = c_r */
+	cpx_t *d = (cpx_t *) malloc (N * sizeof (cpx_t));
+	for (r=1; r<=N; r++)
+	{
+		cpx_set_ui (acc, 0, 0);
+		for (n=r; n<=mterms*N; n+=N) cpx_add (acc, acc, pw[n]);
+
+		/* The tail at n, a = n/N */
+		n = mterms*N + r;
+		mpf_set_ui (a, n);
+		mpf_div_ui (a, a, N);
+		mpf_ui_div (x, 1, a);
+		mpf_mul (xsq, x, x);
+		mpf_set (xp, x);
+
+		cpx_times_mpf (tail, sm, a);
+		mpf_set_d (bf, 0.5);
+		mpf_add (tail[0].re, tail[0].re, bf);
+		for (j=1; j<=ntail; j++)
+		{
+			cpx_times_mpf (term, tc[j], xp);
+			cpx_add (tail, tail, term);
+			mpf_mul (xp, xp, xsq);
+		}
+		cpx_mul (tail, tail, pw[n]);
+		cpx_add (acc, acc, tail);
+
+		cpx_init2 (d[r%N], bits);
+		cpx_set (d[r%N], acc);
+	}
+
+	for (n=1; n<=nmax; n++) cpx_clear (pw[n]);
+	free (pw);
+	for (j=1; j<=ntail; j++) cpx_clear (tc[j]);
+	free (tc);
+
+	/* F(s,p/N) = sum_m exp(2pi i mp/N) d[m] */
+	if (0 == (N & (N-1)))
+	{
+		cpx_fft (d, N, 1, wprec);
+		for (r=0; r<N; r++) cpx_set (out[r], d[r]);
+	}
+	else
+	{
+		/* w[k] = exp(2pi i k/N); as in the FFT, only the roots at
+		 * powers of two are from sine and cosine, so that the
+		 * roundoff grows only as log N. */
+		cpx_t *w = (cpx_t *) malloc (N * sizeof (cpx_t));
+		for (k=0; k<N; k++) cpx_init2 (w[k], bits);
+		cpx_set_ui (w[0], 1, 0);
+		unsigned int b;
+		for (b=1; b<N; b<<=1)
+		{
+			fp_two_pi (a, wprec);
+			mpf_mul_ui (a, a, b);
+			mpf_div_ui (a, a, N);
+			fp_cosine (w[b][0].re, a, wprec);
+			fp_sine (w[b][0].im, a, wprec);
+			for (k=1; k<b && b+k<N; k++)
+				cpx_mul (w[b+k], w[b], w[k]);
+		}
+
+		pzeta_dft_ctx ctx;
+		ctx.out = out;
+		ctx.d = d;
+		ctx.w = w;
+		ctx.N = N;
+		ctx.bits = bits;
+		mp_parallel_for (N, pzeta_dft_row, &ctx);
+
+		for (k=0; k<N; k++) cpx_clear (w[k]);
+		free (w);
+	}
+
+	for (r=0; r<N; r++) cpx_clear (d[r]);
+	free (d);
+
+	cpx_clear (mess);
+	cpx_clear (term);
+	cpx_clear (acc);
+	cpx_clear (tail);
+	cpx_clear (poch);
+	cpx_clear (sm);
+	mpf_clear (fact);
+	mpf_clear (bf);
+	mpf_clear (a);
+	mpf_clear (x);
+	mpf_clear (xsq);
+	mpf_clear (xp);
+}
+
+/* ============================================================= */
+/*
+ * Double-precision grid kernels.
+ *
+ * For previews, Li_s(z) or F(s,q) is wanted at double precision on
+ * large grids, for one fixed s. The duplication formula is linear,
+ * and so every point is a weighted sum
+ *
+ *     Li_s(z) = sum_j  c_j Li_s(z_j)
+ *
+ * over leaves z_j that lie inside the Borwein zone of convergence,
+ * with c_j = +/- [2^{1-s}]^m. The leaves for a block of points are
+ * gathered, sorted by polynomial order, and then evaluated GRID_LANES
+ * at a time by a Borwein kernel written over fixed-width arrays, which
+ * shares the table of k^{-s} and the binomials between lanes. The
+ * compiler vectorizes the lane loops; on x86_64, AVX2 and AVX-512
+ * versions are built as well, and the best is picked at run time.
+ *
+ * Points that need the inversion formula go to cpx_polylog().
+ */
+
+#define GRID_LANES 8
+#define GRID_BLOCK 512
+#define GRID_MAX_DEPTH 60
+
+#if defined(__x86_64__) && defined(__GNUC__) && !defined(__clang__)
+#define GRID_TARGET_CLONES __attribute__((target_clones("avx512f","avx2","default")))
+#else
+#define GRID_TARGET_CLONES
+#endif
+
+typedef struct {
+	double zre;
+	double zim;
+	int point;   /* index of the grid point */
+	int depth;   /* power of 2^{1-s} in the coefficient */
+	int sign;
+	int nterms;
+} grid_leaf_t;
+
+typedef struct {
+	double sre;
+	double sim;
+	int prec;
+	int guard;   /* see periodic_zeta_guard() */
+	double pwre[2*LOWPREC_MAX_TERMS+1];   /* k^{-s} */
+	double pwim[2*LOWPREC_MAX_TERMS+1];
+	double pwabs[2*LOWPREC_MAX_TERMS+1];
+	double roundoff;   /* per-term rounding, see polylog_borwein_d() */
+	double complex tpow[GRID_MAX_DEPTH+1];   /* 2^{(1-s) m} */
+	grid_leaf_t *leaf;
+	int nleaves;
+	int alloc;
+} grid_ctx_t;
+
+static void grid_init (grid_ctx_t *g, double sre, double sim, int prec)
+{
+	int k;
+	double complex s = sre + I*sim;
+
+	g->sre = sre;
+	g->sim = sim;
+	g->prec = (LOWPREC_DOUBLE_DIGITS < prec) ? LOWPREC_DOUBLE_DIGITS : prec;
+	g->guard = 0;
+
+	for (k=1; k<=2*LOWPREC_MAX_TERMS; k++)
+	{
+		double complex pw = cexp (-s * log ((double) k));
+		g->pwre[k] = creal (pw);
+		g->pwim[k] = cimag (pw);
+		g->pwabs[k] = cabs (pw);
+	}
+	g->roundoff = LOWPREC_D_EPS * (4.0 + cabs (s) * log (4.0*LOWPREC_MAX_TERMS));
+
+	double complex ts = cexp ((1.0 - s) * M_LN2);
+	g->tpow[0] = 1.0;
+	for (k=1; k<=GRID_MAX_DEPTH; k++) g->tpow[k] = g->tpow[k-1] * ts;
+
+	g->alloc = 4*GRID_BLOCK;
+	g->leaf = (grid_leaf_t *) malloc (g->alloc * sizeof (grid_leaf_t));
+	g->nleaves = 0;
+}
+
+static void grid_push_leaf (grid_ctx_t *g, double zre, double zim,
+                            int point, int depth, int sign, int nterms)
+{
+	if (g->nleaves == g->alloc)
+	{
+		g->alloc *= 2;
+		g->leaf = (grid_leaf_t *) realloc (g->leaf, g->alloc * sizeof (grid_leaf_t));
+	}
+	grid_leaf_t *lf = &g->leaf[g->nleaves];
+	lf->zre = zre;
+	lf->zim = zim;
+	lf->point = point;
+	lf->depth = depth;
+	lf->sign = sign;
+	lf->nterms = nterms;
+	g->nleaves ++;
+}
+
+static int grid_leaf_cmp (const void *a, const void *b)
+{
+	return ((const grid_leaf_t *) a)->nterms - ((const grid_leaf_t *) b)->nterms;
+}
+
+/*
+ * polylog_borwein_lanes -- polylog_borwein() for GRID_LANES values
+ * of z at once, all to the same order. As in polylog_borwein_d(),
+ * the sum of the magnitudes of the summands is returned in omag,
+ * for the error estimate.
+ */
+GRID_TARGET_CLONES
+static void polylog_borwein_lanes (double *ore, double *oim, double *omag,
+                                   const double *zre, const double *zim,
+                                   int norder, const double *pwre,
+                                   const double *pwim, const double *pwabs)
+{
+	double bre[LOWPREC_MAX_TERMS+1][GRID_LANES];
+	double bim[LOWPREC_MAX_TERMS+1][GRID_LANES];
+	double babs[LOWPREC_MAX_TERMS+1][GRID_LANES];
+	double zmod[GRID_LANES], apz[GRID_LANES];
+	double asum[GRID_LANES], absum[GRID_LANES], psum[GRID_LANES];
+	double pre[GRID_LANES], pim[GRID_LANES];
+	double are[GRID_LANES], aim[GRID_LANES];
+	double bsre[GRID_LANES], bsim[GRID_LANES];
+	double plre[GRID_LANES], plim[GRID_LANES];
+	double bin = 1.0;
+	int j, k;
+
+	for (j=0; j<GRID_LANES; j++)
+	{
+		pre[j] = 1.0; pim[j] = 0.0;
+		are[j] = 0.0; aim[j] = 0.0;
+		bsre[j] = 1.0; bsim[j] = 0.0;
+		plre[j] = 0.0; plim[j] = 0.0;
+		bre[0][j] = 1.0; bim[0][j] = 0.0;
+
+		zmod[j] = sqrt (zre[j]*zre[j] + zim[j]*zim[j]);
+		apz[j] = 1.0;
+		asum[j] = 0.0;
+		absum[j] = 1.0;
+		psum[j] = 0.0;
+		babs[0][j] = 1.0;
+	}
+
+	for (k=1; k<=norder; k++)
+	{
+		bin = bin * (norder-k+1) / k;
+		double sb = (k%2) ? -bin : bin;
+		double wre = pwre[k];
+		double wim = pwim[k];
+		for (j=0; j<GRID_LANES; j++)
+		{
+			double t = pre[j]*zre[j] - pim[j]*zim[j];
+			pim[j] = pre[j]*zim[j] + pim[j]*zre[j];
+			pre[j] = t;
+
+			are[j] += wre*pre[j] - wim*pim[j];
+			aim[j] += wre*pim[j] + wim*pre[j];
+
+			bsre[j] += sb*pre[j];
+			bsim[j] += sb*pim[j];
+			bre[k][j] = bsre[j];
+			bim[k][j] = bsim[j];
+
+			apz[j] *= zmod[j];
+			asum[j] += pwabs[k] * apz[j];
+			absum[j] += bin * apz[j];
+			babs[k][j] = absum[j];
+		}
+	}
+
+	for (k=norder+1; k<=2*norder; k++)
+	{
+		double wre = pwre[k];
+		double wim = pwim[k];
+		int b = 2*norder-k;
+		for (j=0; j<GRID_LANES; j++)
+		{
+			double t = pre[j]*zre[j] - pim[j]*zim[j];
+			pim[j] = pre[j]*zim[j] + pim[j]*zre[j];
+			pre[j] = t;
+
+			double tre = wre*pre[j] - wim*pim[j];
+			double tim = wre*pim[j] + wim*pre[j];
+			plre[j] += tre*bre[b][j] - tim*bim[b][j];
+			plim[j] += tre*bim[b][j] + tim*bre[b][j];
+
+			apz[j] *= zmod[j];
+			psum[j] += pwabs[k] * apz[j] * babs[b][j];
+		}
+	}
+
+	/* ska = [1/(z-1)]^n, by repeated squaring */
+	double skre[GRID_LANES], skim[GRID_LANES];
+	double rre[GRID_LANES], rim[GRID_LANES];
+	for (j=0; j<GRID_LANES; j++)
+	{
+		double wre = zre[j] - 1.0;
+		double den = 1.0 / (wre*wre + zim[j]*zim[j]);
+		skre[j] = wre * den;
+		skim[j] = -zim[j] * den;
+		rre[j] = 1.0;
+		rim[j] = 0.0;
+	}
+	for (k=norder; k; k >>= 1)
+	{
+		for (j=0; j<GRID_LANES; j++)
+		{
+			double t;
+			if (k & 1)
+			{
+				t = rre[j]*skre[j] - rim[j]*skim[j];
+				rim[j] = rre[j]*skim[j] + rim[j]*skre[j];
+				rre[j] = t;
+			}
+			t = skre[j]*skre[j] - skim[j]*skim[j];
+			skim[j] = 2.0*skre[j]*skim[j];
+			skre[j] = t;
+		}
+	}
+
+	double sgn = (norder%2) ? -1.0 : 1.0;
+	for (j=0; j<GRID_LANES; j++)
+	{
+		double t = plre[j]*rre[j] - plim[j]*rim[j];
+		double u = plre[j]*rim[j] + plim[j]*rre[j];
+		ore[j] = are[j] + sgn*t;
+		oim[j] = aim[j] + sgn*u;
+		omag[j] = asum[j] + psum[j] * sqrt (rre[j]*rre[j] + rim[j]*rim[j]);
+	}
+}
+
+/*
+ * Evaluate all of the gathered leaves, and accumulate them into
+ * the output points.
+ */
+static void grid_eval_leaves (grid_ctx_t *g, double *out, double *err, int first)
+{
+	double zre[GRID_LANES], zim[GRID_LANES];
+	double ore[GRID_LANES], oim[GRID_LANES], omag[GRID_LANES];
+	int i, j;
+
+	qsort (g->leaf, g->nleaves, sizeof (grid_leaf_t), grid_leaf_cmp);
+
+	for (i=0; i<g->nleaves; i+=GRID_LANES)
+	{
+		int nl = g->nleaves - i;
+		if (GRID_LANES < nl) nl = GRID_LANES;
+
+		/* Pad unused lanes with z=0 */
+		for (j=0; j<GRID_LANES; j++)
+		{
+			zre[j] = (j<nl) ? g->leaf[i+j].zre : 0.0;
+			zim[j] = (j<nl) ? g->leaf[i+j].zim : 0.0;
+		}
+		int norder = g->leaf[i+nl-1].nterms;
+
+		polylog_borwein_lanes (ore, oim, omag, zre, zim, norder,
+		                       g->pwre, g->pwim, g->pwabs);
+
+		for (j=0; j<nl; j++)
+		{
+			grid_leaf_t *lf = &g->leaf[i+j];
+			double complex c = lf->sign * g->tpow[lf->depth];
+			double complex v = c * (ore[j] + I*oim[j]);
+			int p = lf->point - first;
+			out[2*p] += creal (v);
+			out[2*p+1] += cimag (v);
+			err[p] += cabs (c) * g->roundoff * omag[j] +
+			          LOWPREC_D_EPS * cabs (v);
+		}
+	}
+	g->nleaves = 0;
+}
+
+/* Same as recurse_away_polylog(), but gathering leaves. */
+static int grid_polylog_away (grid_ctx_t *g, double zre, double zim,
+                              int point, int depth, int sign)
+{
+	if (25 < zre*zre + zim*zim) return 1;
+	if (GRID_MAX_DEPTH <= depth) return 1;
+
+	if (1.5 < polylog_get_zone (zre, zim))
+	{
+		if (grid_polylog_away (g, zre*zre-zim*zim, 2.0*zre*zim,
+		                       point, depth+1, sign)) return 1;
+		return grid_polylog_away (g, -zre, -zim, point, depth, -sign);
+	}
+
+	int nterms = polylog_terms_est_d (g->sre, g->sim, zre, zim, g->prec);
+	if (1 > nterms || LOWPREC_MAX_TERMS < nterms) return 1;
+	grid_push_leaf (g, zre, zim, point, depth, sign, nterms);
+	return 0;
+}
+
+static int grid_polylog (grid_ctx_t *g, double zre, double zim, int point)
+{
+	int nterms = polylog_terms_est_d (g->sre, g->sim, zre, zim, g->prec);
+	if ((polylog_get_zone (zre, zim) < 1.5) &&
+	    (0 < nterms) && (LOWPREC_MAX_TERMS >= nterms))
+	{
+		grid_push_leaf (g, zre, zim, point, 0, 1, nterms);
+		return 0;
+	}
+	if (1.0 < zre*zre + zim*zim) return 1;
+	return grid_polylog_away (g, zre, zim, point, 0, 1);
+}
+
+/* Same as periodic_zeta_mp(), but gathering leaves. */
+static int grid_periodic_zeta (grid_ctx_t *g, double q,
+                               int point, int depth, int sign)
+{
+	q -= floor (q);
+	if ((1.0e-15 > q) || (1.0e-15 > 1.0-q)) return 0;
+	if (GRID_MAX_DEPTH <= depth) return 1;
+
+	if (0.25 > q)
+	{
+		if (grid_periodic_zeta (g, 2.0*q, point, depth+1, sign)) return 1;
+		return grid_periodic_zeta (g, q+0.5, point, depth, -sign);
+	}
+	if (0.75 < q)
+	{
+		if (grid_periodic_zeta (g, 2.0*q-1.0, point, depth+1, sign)) return 1;
+		return grid_periodic_zeta (g, q-0.5, point, depth, -sign);
+	}
+
+	double zre = cos (2.0*M_PI*q);
+	double zim = sin (2.0*M_PI*q);
+	int nterms = polylog_terms_est_d (g->sre, g->sim, zre, zim,
+	                                  g->prec + g->guard);
+	if (4 >= nterms || LOWPREC_MAX_TERMS < nterms) return 1;
+	grid_push_leaf (g, zre, zim, point, depth, sign, nterms);
+	return 0;
+}
+
+/*
+ * Shared driver: gather leaves for a block of points, evaluate,
+ * and hand any points that could not be expanded to the general
+ * purpose code.
+ */
+static void grid_driver (double *out, double sre, double sim,
+                         const double *arg, int npts, int prec, int is_pzeta)
+{
+	grid_ctx_t g;
+	int i, first;
+	char failed[GRID_BLOCK];
+	double err[GRID_BLOCK];
+
+	grid_init (&g, sre, sim, prec);
+	double eps = pow (10.0, -g.prec);
+
+	cpx_t s, v, z;
+	cpx_init (s);
+	cpx_init (v);
+	cpx_init (z);
+	cpx_set_d (s, sre, sim);
+
+	for (first=0; first<npts; first+=GRID_BLOCK)
+	{
+		int last = first + GRID_BLOCK;
+		if (npts < last) last = npts;
+
+		for (i=first; i<last; i++)
+		{
+			int mark = g.nleaves;
+			int rc;
+			if (is_pzeta)
+			{
+				g.guard = periodic_zeta_guard (sre, arg[i]);
+				rc = grid_periodic_zeta (&g, arg[i], i, 0, 1);
+			}
+			else
+				rc = grid_polylog (&g, arg[2*i], arg[2*i+1], i);
+
+			/* Discard partial expansions */
+			if (rc) g.nleaves = mark;
+			failed[i-first] = rc;
+			out[2*i] = 0.0;
+			out[2*i+1] = 0.0;
+			err[i-first] = 0.0;
+		}
+
+		grid_eval_leaves (&g, &out[2*first], err, first);
+
+		/* Redo the points that were not expanded, and those
+		 * that lost too much to cancellation. */
+		for (i=first; i<last; i++)
+		{
+			if ((0 == failed[i-first]) &&
+			    (err[i-first] <= eps * hypot (out[2*i], out[2*i+1])))
+				continue;
+			if (is_pzeta)
+			{
+				mpf_set_d (z[0].re, arg[i]);
+				cpx_periodic_zeta (v, s, z[0].re, prec);
+			}
+			else
+			{
+				cpx_set_d (z, arg[2*i], arg[2*i+1]);
+				cpx_polylog (v, s, z, prec);
+			}
+			out[2*i] = cpx_get_re (v);
+			out[2*i+1] = cpx_get_im (v);
+		}
+	}
+
+	cpx_clear (s);
+	cpx_clear (v);
+	cpx_clear (z);
+	free (g.leaf);
+}
+
+void polylog_grid_d (double *out, double sre, double sim,
+                     const double *zee, int npts, int prec)
+{
+	grid_driver (out, sre, sim, zee, npts, prec, 0);
+}
+
+void periodic_zeta_grid_d (double *out, double sre, double sim,
+                           const double *que, int npts, int prec)
+{
+	grid_driver (out, sre, sim, que, npts, prec, 1);
+}
+
+/* ============================================================= */
+/**
+ * cpx_periodic_beta -- Periodic beta function
+ *
+ * Similar to periodic zeta, but with different normalization
+ *
+ * beta = 2 Gamma(s+1) (2\pi)^{-s} F(s,q)
+ *
+ * The implemented algorithm is to compute periodic zeta, and
+ * then renormalize and return the ressult.
+ *
+ * As of 22 December 2006, seems to be passing the tests --
+ * that is, it gives the Bernoulli polynomials for integer s,
+ * with all the right scale factors and signs, etc. Yay!
+ */
+/* The scale factor, for recently used s, shared by all threads */
+DECLARE_CPX_KEYED_CACHE (periodic_beta_cache, 1);
+
+void cpx_periodic_beta (cpx_t zee, const cpx_t ess, const mpf_t que, int prec)
+{
+	cpx_t scale;
+	cpx_init (scale);
+
+	if (!cpx_keyed_cache_fetch (&periodic_beta_cache, ess, prec, &scale))
+	{
+		mpf_t ltp;
+		mpf_init (ltp);
+
+		cpx_t s, tps;
+		cpx_init (s);
+		cpx_init (tps);
+
+		/* 2 gamma(s+1)/ (2pi)^s, taken as the exp of its log */
+		cpx_add_ui (s, ess, 1,0);
+		cpx_lngamma (scale, s, prec);
+
+		/* minus s log 2pi */
+		fp_log_two_pi (ltp, prec);
+		cpx_times_mpf (tps, ess, ltp);
+		cpx_sub (scale, scale, tps);
+		cpx_exp (scale, scale, prec);
+
+		/* times two */
+		cpx_times_ui (scale, scale, 2);
+		cpx_clear (tps);
+		cpx_clear (s);
+		mpf_clear (ltp);
+
+		cpx_keyed_cache_store (&periodic_beta_cache, ess, prec, &scale);
+	}
+
+	cpx_periodic_zeta (zee, ess, que, prec);
+	cpx_mul (zee, zee, scale);
+	cpx_clear (scale);
+}
+
+/* ============================================================= */
+/**
+ * hurwitz_zeta -- Hurwitz zeta function
+ *
+ * Built up from the periodic zeta. Caches intermediate terms, and so
+ * performance is much better if s is held const, while q is varied.
+ * Expects the input value of q to be between 0 and 1.
+ *
+ * "built up" means periodic zeta is computed (twice) and then summed
+ * with appropriate factors, to compute hurwitz zeta.
+ */
+
+/* For recently used s: gamma(s)/(2pi)^s times exp(i pi s/2) and
+ * times its inverse. Shared by all threads. */
+DECLARE_CPX_KEYED_CACHE (hurwitz_cache, 2);
+
+static void hurwitz_zeta (cpx_t zee, const cpx_t ess, const mpf_t que, int prec)
+{
+	mpf_t t;
+	mpf_init (t);
+
+	cpx_t s, zm;
+	cpx_init (s);
+	cpx_init (zm);
+
+	cpx_t fac[2];
+	cpx_init (fac[0]);
+	cpx_init (fac[1]);
+
+	/* s = 1-ess */
+	cpx_neg (s, ess);
+	cpx_add_ui (s, s, 1, 0);
+
+	if (!cpx_keyed_cache_fetch (&hurwitz_cache, s, prec, fac))
+	{
+		cpx_t lsc, ips;
+		cpx_init (lsc);
+		cpx_init (ips);
+
+		/* log gamma(s)/ (2pi)^s; for large Im s, gamma is tiny
+		 * and one of the exp(i pi s/2) huge, but not their product */
+		cpx_lngamma (lsc, s, prec);
+		fp_log_two_pi (t, prec);
+		cpx_times_mpf (ips, s, t);
+		cpx_sub (lsc, lsc, ips);
+
+		/* i pi s/2 */
+		fp_pi_half (t, prec);
+		cpx_times_mpf (ips, s, t);
+		cpx_times_i (ips, ips);
+
+		cpx_add (fac[0], lsc, ips);
+		cpx_exp (fac[0], fac[0], prec);
+		cpx_sub (fac[1], lsc, ips);
+		cpx_exp (fac[1], fac[1], prec);
+
+		cpx_clear (lsc);
+		cpx_clear (ips);
+		cpx_keyed_cache_store (&hurwitz_cache, s, prec, fac);
+	}
+
+	/* F(s,q) and F(s, 1-q) */
+	cpx_periodic_zeta (zee, s, que, prec);
+	mpf_ui_sub (t, 1, que);
+	cpx_periodic_zeta (zm, s, t, prec);
+
+	/* assemble the thing */
+	cpx_mul (zm, zm, fac[0]);
+	cpx_mul (zee, zee, fac[1]);
+	cpx_add (zee, zee, zm);
+
+	cpx_clear (s);
+	cpx_clear (zm);
+	cpx_clear (fac[0]);
+	cpx_clear (fac[1]);
+	mpf_clear (t);
+}
+
+/* ============================================================= */
+/**
+ * cpx_hurwitz_zeta -- Hurwitz zeta function
+ *
+ * Built up from the periodic zeta. Caches intermediate terms, and so
+ * performance is much better if s is held const, while q is varied.
+ * The value for q must be positive; the algo gets slow if q is large.
+ */
+
+void cpx_hurwitz_zeta (cpx_t zee, const cpx_t ess, const mpf_t que, int prec)
+{
+	cpx_t s, term;
+	mpf_t q;
+	cpx_init (s);
+	cpx_init (term);
+	mpf_init (q);
+	cpx_set (s, ess);
+	mpf_set (q, que);
+
+	/* Make sure q is between 0 and 1, by subtracting the integer part */
+	long nq = mpf_get_si (q);
+	mpf_sub_ui (q, q, nq);
+
+	hurwitz_zeta (zee, s, q, prec);
+
+	cpx_neg (s, s);
+	int k;
+	for (k=0; k<nq; k++)
+	{
+		/* subtract off the leading terms -- the 1/(q+k)^s */
+		cpx_mpf_pow (term, q, s, prec);
+		cpx_sub (zee, zee, term);
+		mpf_add_ui (q, q, 1);
+	}
+
+	cpx_clear (s);
+	cpx_clear (term);
+	mpf_clear (q);
+}
+
+/* ============================================================= */
+/*
+ * hurwitz_taylor_shift -- compute 1/q^s if the real part of q is
+ * near 0.
+ *
+ * Else navigate the waters of the Hurwitz branch cut.
+ * "Near zero" is -0.5 < Re q < 0.5. However, 0.5 is
+ * the Riemann critical line, so move off of that,
+ * to -0.55 < Re q < 0.45 to avoid weird rounding effects.
+ *
+ * Define tay(s,q) = sum_{k=1}^\infty (k+q)^{-s}
+ * and note that hurwitz(s,q) = 1/q^s + tay(s,q)
+ * Perform repeated shifts as follows:
+ *
+ * Let L = floor(Re q + 0.55)
+ * Define q' = q - L
+ * This allows tay(s,q') to be evaluated within the
+ * domain of convergence |q'| < 1. This correspnds to
+ * a band of unit-radius disks centered on the integers.
+ *
+ * For L > 0 define shif(s,q) = - sum_{k=1}^{L-1} 1/(q-k)^s
+ * For L <=0 define shif(s,q) = sum_{k=0}^{-L} 1/(q+k)^s
+ * This allows hurwitz(s,q) = shif(s,q) + tay(s,q')
+ *
+ * On exit, hurw will contain shif(s,q) and q will have been
+ * replaced by q', with -0.55 <= Re q' <= 0.45 (the ends are only
+ * reached when Re q is exactly STRIP plus an integer), and Im q'
+ * the same as Im q.
+ *
+ * Examples:
+ * -1.55 < Re q < -0.55  means L=-1 and hurw = 1/q^s + 1/(q+1)^s
+ * -0.55 < Re q < +0.45  means L=0 and hurw = 1/q^s
+ * +0.45 < Re q < +1.45  means L=1 and hurw = 0
+ * +1.45 < Re q < +2.45  means L=2 and hurw = - 1/(q-1)^s
+ * +2.45 < Re q < +3.45  means L=3 and hurw = - [1/(q-1)^s + 1/(q-2)^s]
+ *
+ * Both cpx_hurwitz_taylor() and cpx_hurwitz_taylor_batch() rely on
+ * this: they sum the Taylor series in q' about q'=0, and so need
+ * |q'| < 1; they check for |q'| <= 0.9, which, given the strip,
+ * holds whenever |Im q| < 0.71. The shift is taken one
+ * integer at a time, so it costs |Re q| complex powers.
+ */
+#define STRIP 0.45
+static void hurwitz_taylor_shift (cpx_t hurw, cpx_t q, const cpx_t ess, int prec)
+{
+	cpx_t s, qn;
+	cpx_init (s);
+	cpx_init (qn);
+
+	cpx_neg (s, ess);
+	cpx_set_ui (hurw, 0, 0);
+	while (mpf_cmp_d (q[0].re, STRIP) < 0)
+	{
+		cpx_pow (qn, q, s, prec);
+		cpx_add (hurw, hurw, qn);
+		mpf_add_ui (q[0].re, q[0].re, 1);
+	}
+	mpf_sub_ui (q[0].re, q[0].re, 1);
+	while (mpf_cmp_d (q[0].re, STRIP) > 0)
 	{
-		mpf_sub_ui (q[0].re, q[0].re, 1);
 		cpx_pow (qn, q, s, prec);
 		cpx_sub (hurw, hurw, qn);
+		mpf_sub_ui (q[0].re, q[0].re, 1);
+	}
+
+	cpx_clear (s);
+	cpx_clear (qn);
+}
+
+/* ============================================================= */
+/**
+ * cpx_hurwitz_taylor -- Hurwitz zeta function Taylor series
+ *
+ * Implement the Hurwitz zeta as a Taylor expansion about q=0.
+ * Recall, hurwitz(s,q) = sum_{k=0}^\infty (k+q)^{-s}
+ *
+ * If the real part of q fails to satisfy -0.5 < Re q < 0.5 then
+ * the sum over k is shifted, to absorb the integer part. Thus,
+ * the domain of convergence is a bubbly strip surrounding the real
+ * axis, approximately -0.866 < Im q < 0.866. This corresponds to
+ * an infinitely repeated bubble of |q| < 1.0 in which the Taylor
+ * series can converge.
+ *
+ * The algo prints a warning when the shifted |q| < 0.9 isn't true.
+ * It returns a non-zero value in this case, else zero if success.
+ * TODO: This should be converted to an exception.
+ *
+ * Overview of the algorithm:
+ * First, pull out the leading 1/q^s term, and handle it distinctly.
+ *    hurwitz(s,q) = 1/q^s + sum_{k=1}^\infty (k+q)^{-s}
+ *
+ * If the real part of q fails to satisfy -0.5 < Re q < 0.5 then
+ * additional terms are peeled off the sum, until it is brought into
+ * this domain. This works, because, hey, it just means moving over
+ * where the sum in k starts. Execution time is linear in |Re q|
+ * because each term is peeled off, one by one.
+ *
+ * Taylor series is f(q) = sum_{n=0}^\infty q^n f^{(n)}(0) / n!
+ *
+ * Taylor series for hurwitz in q requires the n'th derivative
+ * d^n/dq^n (k+q)^{-s} = (-1)^n s(s+1)(s+2)...(s+n-1) / (k+q)^{s+n}
+ *
+ * Exchanging the order of the Hurwitz and Taylor summations, we get
+ *    f^{(n)}(0) = (-1)^n s(s+1)(s+2)...(s+n-1)
+ *                       sum_{k=1}^\infty 1/k^{s+n}
+ *
+ * The product is the rising Pochammer. The sum is just the Riemann
+ * zeta, that is zeta(s+n) = sum_{k=1}^\infty 1/k^{s+n} and so we write
+ *    f^{(n)}(0) = (-1)^n s(s+1)(s+2)...(s+n-1) zeta(s+n)
+ *
+ * The factorial divides the rising Pochammer to yeild the binomial
+ * coefficient:
+ *    binom(s+n-1, n) = s(s+1)(s+2)...(s+n-1) / n!
+ *
+ * Thus, we conclude
+ *    hurwitz(s,q) = 1/q^s + sum_{n=0}^\infty q^n binom(s+n-1, n) zeta(s+n)
+ */
+
+int cpx_hurwitz_taylor (cpx_t hurw, const cpx_t ess, const cpx_t que, int prec)
+{
+	cpx_t s, sn, q, qn, bin, term;
+	cpx_init (s);
+	cpx_init (sn);
+	cpx_init (q);
+	cpx_init (qn);
+	cpx_init (bin);
+	cpx_init (term);
+
+	/* Define epsilon = 10^{-prec} as bound for smallest term in sum. */
+	mpf_t epsilon, aterm;
+	mpf_init (epsilon);
+	mpf_init (aterm);
+	fp_epsilon (epsilon, 2*prec);
+
+	cpx_set (s, ess);
+	cpx_set (q, que);
+
+	/* Bring q into the strip -0.55 < Re q < 0.45 */
+	hurwitz_taylor_shift (hurw, q, s, prec);
+
+	/* Sanity check. This is never hit, but still, nice to have. */
+	/* TODO: convert this to an exception. */
+	int rc = 0;
+	double qre = cpx_get_re (q);
+	double qim = cpx_get_im (q);
+	double mod = sqrt(qre*qre+qim*qim);
+	if (0.9 < mod) {
+		rc = 1;
+		printf ("oh no mr bill! q=%g +i%g modulus=%g\n", qre, qim, mod);
+		goto punt;
+	}
+
+	/* Now do a power series in -q. We use a minus here, to cleverly
+	 * absorb a minus sign coming from the Taylor's differentiation. */
+	cpx_neg (q, q);
+	cpx_set_ui (qn, 1, 0);
+	cpx_sub_ui (sn, s, 1, 0);
+	int n = 0;
+	while (1)
+	{
+		/* Compute binomial(s+n-1, n) as per above. */
+		/* The caching version uses precomputed values, making
+		 * the algo faster. The caching version also means that
+		 * sn does not need to be incremented. */
+		// cpx_binomial (bin, sn, n);
+		// cpx_add_ui (sn, sn, 1, 0);
+		cpx_binomial_sum_cache (bin, sn, n);
+
+		/* zeta_cache returns zeta(s+n) */
+		cpx_borwein_zeta_cache (term, s, n, prec);
+		// cpx_borwein_zeta (term, sn, prec);
+		cpx_mul (term, term, bin);
+		cpx_mul (term, term, qn);
+		cpx_add (hurw, hurw, term);
+
+		/* Don't go no farther than this */
+		cpx_mod_sq (aterm, term);
+		if (mpf_cmp (aterm, epsilon) < 0) break;
+
+		n++;
+
+		/* qn = q^n */
+		cpx_mul (qn, qn, q);
+	}
+
+punt:
+	cpx_clear (s);
+	cpx_clear (sn);
+	cpx_clear (q);
+	cpx_clear (qn);
+	cpx_clear (bin);
+	cpx_clear (term);
+	mpf_clear (aterm);
+	mpf_clear (epsilon);
+
+	return rc;
+}
+
+/* ============================================================= */
+/*
+ * State shared by the jobs of cpx_hurwitz_taylor_batch. The first
+ * pass shifts each q into the strip; the second evaluates the
+ * (common) Taylor series at each shifted q by Horner's rule.
+ */
+typedef struct
+{
+	cpx_t *out;
+	const cpx_t *que;
+	cpx_t *qs;          /* shifted q, negated on the second pass */
+	const cpx_t *ess;
+	cpx_t *coef;        /* binom(s+n-1, n) zeta(s+n) */
+	double *logc;       /* log |coef[n]| */
+	int *order;         /* per-q truncation, or -1 if out of domain */
+	int ncoef;
+	double logeps;
+	int prec;
+} hurwitz_batch;
+
+static void hurwitz_batch_shift (void *arg, int j)
+{
+	hurwitz_batch *hb = arg;
+	cpx_set (hb->qs[j], hb->que[j]);
+	hurwitz_taylor_shift (hb->out[j], hb->qs[j], *hb->ess, hb->prec);
+}
+
+static void hurwitz_batch_horner (void *arg, int j)
+{
+	hurwitz_batch *hb = arg;
+	int n = hb->order[j];
+	if (n < 0) return;
+
+	cpx_t acc;
+	cpx_init (acc);
+
+	cpx_set (acc, hb->coef[n]);
+	for (n--; 0 <= n; n--)
+	{
+		cpx_mul (acc, acc, hb->qs[j]);
+		cpx_add (acc, acc, hb->coef[n]);
+	}
+	cpx_add (hb->out[j], hb->out[j], acc);
+
+	cpx_clear (acc);
+}
+
+/**
+ * cpx_hurwitz_taylor_batch -- Hurwitz zeta at many q, for one s.
+ *
+ * The Taylor coefficients binom(s+n-1, n) zeta(s+n) depend only on
+ * s; they are computed once, out to the order needed by the q of
+ * largest shifted modulus. Each q then costs only its shift and a
+ * Horner evaluation, truncated at the order that q needs.
+ */
+int cpx_hurwitz_taylor_batch (cpx_t *out, const cpx_t ess,
+                              const cpx_t *que, int m, int prec)
+{
+	int j, n;
+	if (m <= 0) return 0;
+
+	hurwitz_batch hb;
+	hb.out = out;
+	hb.que = que;
+	hb.ess = (const cpx_t *) ess;
+	hb.prec = prec;
+	hb.qs = (cpx_t *) malloc (m * sizeof (cpx_t));
+	hb.order = (int *) malloc (m * sizeof (int));
+	for (j=0; j<m; j++) cpx_init (hb.qs[j]);
+
+	mp_parallel_for (m, hurwitz_batch_shift, &hb);
+
+	/* Same domain check as cpx_hurwitz_taylor */
+	int nbad = 0;
+	double qmax = 0.0;
+	for (j=0; j<m; j++)
+	{
+		double qre = cpx_get_re (hb.qs[j]);
+		double qim = cpx_get_im (hb.qs[j]);
+		double mod = sqrt (qre*qre+qim*qim);
+		if (0.9 < mod)
+		{
+			hb.order[j] = -1;
+			cpx_set_ui (out[j], 0, 0);
+			nbad ++;
+			continue;
+		}
+		hb.order[j] = 0;
+		if (qmax < mod) qmax = mod;
+		cpx_neg (hb.qs[j], hb.qs[j]);
+	}
+
+	/* Coefficients, until |coef[n]| qmax^n < 10^{-prec} */
+	cpx_t s, sn, bin;
+	cpx_init (s);
+	cpx_init (sn);
+	cpx_init (bin);
+	cpx_set (s, ess);
+	cpx_sub_ui (sn, s, 1, 0);
+
+	hb.logeps = -prec * M_LN10;
+	double logq = (0.0 < qmax) ? log (qmax) : -1.0e30;
+	int alloc = 0;
+	hb.coef = NULL;
+	hb.logc = NULL;
+	for (n=0; nbad < m; n++)
+	{
+		if (alloc <= n)
+		{
+			int na = alloc ? 2*alloc : 64;
+			hb.coef = (cpx_t *) realloc (hb.coef, na * sizeof (cpx_t));
+			hb.logc = (double *) realloc (hb.logc, na * sizeof (double));
+			for (j=alloc; j<na; j++) cpx_init (hb.coef[j]);
+			alloc = na;
+		}
+		cpx_binomial_sum_cache (bin, sn, n);
+		cpx_borwein_zeta_cache (hb.coef[n], s, n, prec);
+		cpx_mul (hb.coef[n], hb.coef[n], bin);
+
+		mpf_t aterm;
+		mpf_init (aterm);
+		cpx_mod_sq (aterm, hb.coef[n]);
+		long ex;
+		double d = mpf_get_d_2exp (&ex, aterm);
+		hb.logc[n] = (0.0 < d) ? 0.5 * (log (d) + ex * M_LN2) : -1.0e30;
+		mpf_clear (aterm);
+
+		if (hb.logc[n] + n * logq < hb.logeps) break;
+	}
+	hb.ncoef = n;
+
+	/* Per-q truncation: the last term that is still above epsilon */
+	for (j=0; j<m; j++)
+	{
+		if (hb.order[j] < 0) continue;
+		double qre = cpx_get_re (hb.qs[j]);
+		double qim = cpx_get_im (hb.qs[j]);
+		double mod = sqrt (qre*qre+qim*qim);
+		double lq = (0.0 < mod) ? log (mod) : -1.0e30;
+		for (n=0; n<hb.ncoef; n++)
+			if (hb.logc[n] + n * lq < hb.logeps) break;
+		hb.order[j] = n;
+	}
+
+	mp_parallel_for (m, hurwitz_batch_horner, &hb);
+
+	for (j=0; j<alloc; j++) cpx_clear (hb.coef[j]);
+	for (j=0; j<m; j++) cpx_clear (hb.qs[j]);
+	free (hb.coef);
+	free (hb.logc);
+	free (hb.qs);
+	free (hb.order);
+	cpx_clear (s);
+	cpx_clear (sn);
+	cpx_clear (bin);
+
+	return nbad;
+}
+
+/* =========================================================== */
+/**
+ * cpx_hurwitz_euler -- Hurwitz zeta function via Euler-Maclaurin algo
+ *
+ * This function computes the value of the Hurwitz zeta function
+ * using an Euler-Maclaurin summation to obtain an estimate.
+ *
+ * The algorithm appears to work.
+ */
+
+/* Number of Bernoulli terms that zeta_euler will take, or -1 if
+ * the asymptotic series turns around before reaching 10^-prec.
+ * The k'th term is B_2k/(2k)! (s)_{2k-1} / (M+q)^{s+2k-1}, and
+ * B_2k/(2k)! is about 2/(2pi)^2k. */
+static int euler_bern_terms (double sre, double sim,
+                             double qre, double qim, int em, int prec)
+{
+	double logeps = -prec * M_LN10;
+	double lmq = 0.5 * log ((em+qre)*(em+qre) + qim*qim);
+	double l2pi = 2.0 * log (2.0*M_PI);
+	double lterm = M_LN2 - l2pi + 0.5 * log (sre*sre + sim*sim) - (sre+1.0) * lmq;
+	int k;
+	for (k=1; k<100000; k++)
+	{
+		if (lterm < logeps) return k;
+		double a = sre + 2*k - 1;
+		double b = sre + 2*k;
+		double step = 0.5 * log ((a*a + sim*sim) * (b*b + sim*sim)) - l2pi - 2.0*lmq;
+		if (0.0 < step) return -1;
+		lterm += step;
+	}
+	return -1;
+}
+
+/*
+ * euler_plan -- pick the cutoff M for the direct sum, and with it the
+ * number of Bernoulli terms, to minimize the cost. A term of the direct
+ * sum is a complex power, costing about prec/2 Bernoulli terms, once
+ * the latter come out of the caches below. Returns -1 if no M works.
+ */
+static int euler_plan (double sre, double sim, double qre, double qim,
+                       int prec, int *nbern)
+{
+	double cpow = 5.0 + 0.5 * prec;
+	double smod = sqrt (sre*sre + sim*sim);
+
+	/* M+q must stay clear of zero; 2pi(M+q) > |s| + prec log 10
+	 * is enough for the tail to converge. */
+	int lo = (int) ceil (1.0 - qre);
+	if (lo < 1) lo = 1;
+	int hi = (int) ((smod + prec * M_LN10) / M_PI - qre) + 12;
+	if (hi < lo) hi = lo;
+	int step = (hi - lo) / 32 + 1;
+
+	int em, best = -1;
+	double bestcost = 0.0;
+	for (em=lo; em<=hi; em+=step)
+	{
+		int k = euler_bern_terms (sre, sim, qre, qim, em, prec);
+		if (k < 0) continue;
+		double cost = em * cpow + k;
+		if (best < 0 || cost < bestcost)
+		{
+			best = em;
+			bestcost = cost;
+			*nbern = k;
+		}
+	}
+	return best;
+}
+
+/* B_2k / (2k)! */
+DECLARE_FP_CACHE (euler_bern_cache);
+
+static void euler_bern (mpf_t bf, int k, int prec)
+{
+	if (prec <= fp_one_d_cache_check (&euler_bern_cache, k))
+	{
+		fp_one_d_cache_fetch (&euler_bern_cache, bf, k);
+		return;
+	}
+
+	mpf_t fact;
+	mpf_init (fact);
+	fp_bernoulli (bf, 2*k, prec);
+	fp_inv_factorial (fact, 2*k, prec);
+	mpf_mul (bf, bf, fact);
+	mpf_clear (fact);
+
+	fp_one_d_cache_store (&euler_bern_cache, bf, k, prec);
+}
+
+/* The rising factorials (s)_{2k-1}, for the most recent s. Each is
+ * built from the one before, so the cache fills from the bottom. */
+typedef struct
+{
+	cpx_cache cache;
+	cpx_t cache_s;
+	int precision;
+	int top;
+} euler_poch_state;
+
+static void * euler_poch_state_new (void)
+{
+	euler_poch_state *st = (euler_poch_state *) malloc (sizeof (euler_poch_state));
+	cpx_one_d_cache_init (&st->cache);
+	cpx_init (st->cache_s);
+	st->precision = 0;
+	st->top = 0;
+	return st;
+}
+
+static void euler_poch_state_free (void *p)
+{
+	euler_poch_state *st = (euler_poch_state *) p;
+	cpx_one_d_cache_free (&st->cache);
+	cpx_clear (st->cache_s);
+	free (st);
+}
+
+DECLARE_THREAD_STATE (euler_poch_key, euler_poch_state_new, euler_poch_state_free);
+
+static void euler_poch (cpx_t poch, const cpx_t ess, int k, int prec)
+{
+	euler_poch_state *st = thread_state_get (&euler_poch_key);
+	if (st->precision < prec || !cpx_eq (st->cache_s, ess, prec*3.322))
+	{
+		cpx_one_d_cache_clear (&st->cache);
+		cpx_set_prec (st->cache_s, 3.322*prec+50);
+		cpx_set (st->cache_s, ess);
+		st->precision = prec;
+		st->top = 0;
 	}
-	if (mpf_cmp_d (q[0].re, STRIP) > 0)
+
+	if (k <= st->top)
 	{
-		mpf_sub_ui (q[0].re, q[0].re, 1);
+		cpx_one_d_cache_fetch (&st->cache, poch, k);
+		return;
 	}
-	cpx_neg (s, s); /* Restore original s */
 
-	/* Sanity check. This is never hit, but still, nice to have. */
-	/* TODO: convert this to an exception. */
-	int rc = 0;
-	double qre = cpx_get_re (q);
-	double qim = cpx_get_im (q);
-	double mod = sqrt(qre*qre+qim*qim);
-	if (0.9 < mod) {
-		rc = 1;
-		printf ("oh no mr bill! q=%g +i%g modulus=%g\n", qre, qim, mod);
-		goto punt;
+	cpx_t sj;
+	cpx_init (sj);
+	if (0 == st->top)
+	{
+		cpx_set (poch, ess);
+		cpx_one_d_cache_check (&st->cache, 1);
+		cpx_one_d_cache_store (&st->cache, poch, 1, st->precision);
+		st->top = 1;
+	}
+	else
+	{
+		cpx_one_d_cache_fetch (&st->cache, poch, st->top);
+	}
+	while (st->top < k)
+	{
+		/* (s)_{2j+1} = (s)_{2j-1} (s+2j-1) (s+2j) */
+		int j = st->top;
+		cpx_add_ui (sj, ess, 2*j-1, 0);
+		cpx_mul (poch, poch, sj);
+		cpx_add_ui (sj, ess, 2*j, 0);
+		cpx_mul (poch, poch, sj);
+		st->top ++;
+		cpx_one_d_cache_check (&st->cache, st->top);
+		cpx_one_d_cache_store (&st->cache, poch, st->top, st->precision);
+	}
+	cpx_clear (sj);
+}
+
+/*
+ * The Euler-Maclaurin tail: given deriv = 1/(M+q)^s and emq = M+q,
+ * add (1/2)/(M+q)^s + (M+q)^{1-s}/(s-1) and the Bernoulli terms
+ * B_2k/(2k)! (s)_{2k-1} / (M+q)^{s+2k-1} to zeta.
+ */
+static void zeta_euler_tail (cpx_t zeta, const cpx_t ess, cpx_t deriv,
+                             cpx_t emq, int kmax, int prec)
+{
+	cpx_t term, spoch;
+	cpx_init (term);
+	cpx_init (spoch);
+
+	mpf_t eps, ft, last;
+	mpf_init (eps);
+	mpf_init (ft);
+	mpf_init (last);
+
+	/* Add another (1/2) of 1 /(M+q)^s */
+	cpx_div_ui (term, deriv, 2);
+	cpx_add (zeta, zeta, term);
+
+	/* term = 1/(s-1)*(q+M)^{1-s} */
+	cpx_mul (term, deriv, emq);
+	cpx_sub_ui (spoch, ess, 1, 0);
+	cpx_div (term, term, spoch);
+	cpx_add (zeta, zeta, term);
+
+	/* deriv = 1/(M+q)^{s+1}, emq = 1/(M+q)^2 */
+	cpx_recip (emq, emq);
+	cpx_mul (deriv, deriv, emq);
+	cpx_mul (emq, emq, emq);
+
+	fp_epsilon (eps, 2*prec);
+	mpf_set_ui (last, 0);
+
+	int k;
+	for (k=1; ; k++)
+	{
+		/* term = B_2k/(2k)! (s)_{2k-1} / (M+q)^{s+2k-1} */
+		euler_bern (ft, k, prec);
+		euler_poch (spoch, ess, k, prec);
+		cpx_times_mpf (term, deriv, ft);
+		cpx_mul (term, term, spoch);
+
+		/* Past the smallest term, the terms only grow */
+		cpx_mod_sq (ft, term);
+		if (1 < k && 0 < mpf_cmp (ft, last)) break;
+		mpf_set (last, ft);
+		cpx_add (zeta, zeta, term);
+
+		if (mpf_cmp (ft, eps) < 0) break;
+
+		/* The series is asymptotic; don't walk past the plan */
+		if (2*kmax+10 < k) break;
+
+		cpx_mul (deriv, deriv, emq);
+	}
+
+	mpf_clear (eps);
+	mpf_clear (ft);
+	mpf_clear (last);
+	cpx_clear (term);
+	cpx_clear (spoch);
+}
+
+static void zeta_euler_fp(cpx_t zeta, cpx_t ess, mpf_t q, int em, int kmax, int prec)
+{
+	int k;
+	cpx_t s, emq, term, deriv;
+	cpx_init (s);
+	cpx_init (emq);
+	cpx_init (term);
+	cpx_init (deriv);
+
+	cpx_neg (s, ess);
+
+	cpx_set_ui (zeta, 0, 0);
+	/* sum over 1/(k+q)^s  from k=0 to k=M-1 */
+	for (k=0; k<em; k++)
+	{
+		fp_pow_rc (term, k, q, s, prec);
+		cpx_add (zeta, zeta, term);
+	}
+
+	/* deriv = 1/(M+q)^s */
+	fp_pow_rc (deriv, em, q, s, prec);
+
+	/* emq = M+q */
+	mpf_add_ui (emq[0].re, q, em);
+	mpf_set_ui (emq[0].im, 0);
+
+	zeta_euler_tail (zeta, ess, deriv, emq, kmax, prec);
+
+	cpx_clear (s);
+	cpx_clear (emq);
+	cpx_clear (term);
+	cpx_clear (deriv);
+}
+
+static void zeta_euler(cpx_t zeta, cpx_t ess, cpx_t q, int em, int kmax, int prec)
+{
+	int k;
+	cpx_t s, emq, term, deriv;
+	cpx_init (s);
+	cpx_init (emq);
+	cpx_init (term);
+	cpx_init (deriv);
+
+	cpx_neg (s, ess);
+
+	cpx_set_ui (zeta, 0, 0);
+	/* sum over 1/(k+q)^s  from k=0 to k=M-1 */
+	for (k=0; k<em; k++)
+	{
+		cpx_pow_rc (term, k, q, s, prec);
+		cpx_add (zeta, zeta, term);
+	}
+
+	/* deriv = 1/(M+q)^s */
+	cpx_pow_rc (deriv, em, q, s, prec);
+
+	/* emq = M+q */
+	cpx_set (emq, q);
+	mpf_add_ui (emq[0].re, emq[0].re, em);
+
+	zeta_euler_tail (zeta, ess, deriv, emq, kmax, prec);
+
+	cpx_clear (s);
+	cpx_clear (emq);
+	cpx_clear (term);
+	cpx_clear (deriv);
+}
+
+void cpx_hurwitz_euler_fp(cpx_t zeta, cpx_t ess, mpf_t q, int prec)
+{
+	int kmax = 0;
+	int em = euler_plan (cpx_get_re (ess), cpx_get_im (ess),
+	                     mpf_get_d (q), 0.0, prec, &kmax);
+	if (em < 0) em = prec + 12;
+
+	zeta_euler_fp (zeta, ess, q, em, kmax, prec);
+}
+
+void cpx_hurwitz_euler(cpx_t zeta, cpx_t ess, cpx_t q, int prec)
+{
+	int kmax = 0;
+	int em = euler_plan (cpx_get_re (ess), cpx_get_im (ess),
+	                     cpx_get_re (q), cpx_get_im (q), prec, &kmax);
+	if (em < 0) em = prec + 12;
+
+	zeta_euler (zeta, ess, q, em, kmax, prec);
+}
+
+/* ============================================================= */
+/*
+ * The polylog near z=1, as a series in powers of L = log z:
+ *
+ *    Li_s(z) = Gamma(1-s) (-L)^{s-1} + sum_{k=0}^inf zeta(s-k) L^k / k!
+ *
+ * which converges for |L| < 2pi, when s is not a positive integer.
+ * The coefficients depend only on s, and so are computed once, and
+ * kept; after that, each z costs a Horner sum and one complex power.
+ * The duplication recursion, by contrast, needs about log_2 (1/|L|)
+ * Borwein sums, and fails outright when z is very close to 1.
+ *
+ * The zeta(s-k) come from the functional equation,
+ *
+ *    zeta(s-k) = 2 (2pi)^{s-k-1} sin (pi(s-k)/2) Gamma(1-s+k) zeta(1-s+k)
+ *
+ * and all of the zeta(w+k), with w=1-s, from a single Euler-Maclaurin
+ * sum: the powers n^{-w-k} of the direct sum are each one division
+ * away from the last, and the tail dies off as M^{-k}.
+ */
+
+/* Largest |log z| for which the series is used. The terms go down
+ * as (|L|/2pi)^k, so about prec/0.62 of them are needed at the edge. */
+#define LOGSER_RADIUS 1.5
+
+/* Distance from s = 0, 1, 2, ... at which the series is given up;
+ * there, Gamma(1-s) and one of the zeta(s-k) blow up. */
+#define LOGSER_SGAP 0.1
+
+/* Recursion depth at which the duplication formula is abandoned,
+ * no matter what the series costs to set up. */
+#define LOGSER_DEEP 4
+
+/* The coefficients a_k = zeta(s-k)/k!, for the most recent s */
+typedef struct
+{
+	cpx_t cache_s;
+	int prec;
+	int nterms;
+	int alloc;
+	cpx_t *coef;
+	double *lmag;
+	cpx_t gam;
+	double setup;
+	double spent;
+} logser_state;
+
+static void * logser_state_new (void)
+{
+	logser_state *st = (logser_state *) malloc (sizeof (logser_state));
+	cpx_init (st->cache_s);
+	cpx_set_ui (st->cache_s, 123123123, 321321321);
+	cpx_init (st->gam);
+	st->prec = 0;
+	st->nterms = 0;
+	st->alloc = 0;
+	st->coef = NULL;
+	st->lmag = NULL;
+	st->setup = -1.0;
+	st->spent = 0.0;
+	return st;
+}
+
+static void logser_state_free (void *p)
+{
+	logser_state *st = (logser_state *) p;
+	int k;
+	for (k=0; k<st->alloc; k++) cpx_clear (st->coef[k]);
+	free (st->coef);
+	free (st->lmag);
+	cpx_clear (st->cache_s);
+	cpx_clear (st->gam);
+	free (st);
+}
+
+DECLARE_THREAD_STATE (logser_key, logser_state_new, logser_state_free);
+
+/* log |z|, without overflow or underflow in the exponent */
+static double cpx_log_abs_d (const cpx_t z)
+{
+	signed long int ere, eim;
+	double re = mpf_get_d_2exp (&ere, z[0].re);
+	double im = mpf_get_d_2exp (&eim, z[0].im);
+	if (0.0 == re && 0.0 == im) return -1.0e300;
+	if (0.0 == re) return log (fabs (im)) + eim * M_LN2;
+	if (0.0 == im) return log (fabs (re)) + ere * M_LN2;
+	if (ere < eim)
+	{
+		re = ldexp (re, ere - eim);
+		return 0.5 * log (re*re + im*im) + eim * M_LN2;
+	}
+	im = ldexp (im, eim - ere);
+	return 0.5 * log (re*re + im*im) + ere * M_LN2;
+}
+
+/* Upper bound on the number of coefficients, for |L| up to the radius */
+static int logser_nmax (double wre, double wim, int prec)
+{
+	return (int) (prec * M_LN10 / log (2.0 * M_PI / LOGSER_RADIUS)
+	              + sqrt (wre*wre + wim*wim)) + 10;
+}
+
+/* The Euler-Maclaurin cutoff, good for all of zeta(w+k), k < nmax */
+static int logser_em (double wre, double wim, int nmax, int prec, int *nbern)
+{
+	int em = euler_plan (wre, wim, 0.0, 0.0, prec, nbern);
+	if (em < 0) return -1;
+
+	int k;
+	for (k=1; k<nmax; k++)
+	{
+		if (0 <= euler_bern_terms (wre+k, wim, 0.0, 0.0, em, prec)) continue;
+		em += em/2 + 1;
+		if (20*prec + 200 < em) return -1;
+		k = 0;
+	}
+	return em;
+}
+
+/*
+ * Cost of setting up the coefficients, in complex multiplies: M powers
+ * for the direct sum, and, for each coefficient, a division of each of
+ * the powers and a run of Bernoulli terms.
+ */
+static double logser_setup_cost (double wre, double wim, int prec)
+{
+	int nbern = 0;
+	int nmax = logser_nmax (wre, wim, prec);
+	int em = logser_em (wre, wim, nmax, prec, &nbern);
+	if (em < 0) return -1.0;
+	return 1.3 * prec * em + nmax * (0.5 * em + 4.0 * nbern + 10.0);
+}
+
+/*
+ * Cost of the usual route to z, in complex multiplies: a chain of
+ * duplications, each with a warm Borwein sum of about 4 multiplies a
+ * term, inside the unit circle; the inversion formula, with its two
+ * Euler-Maclaurin sums, outside. Also returns the chain length.
+ */
+static double logser_path_cost (double sre, double sim, double zre, double zim,
+                                double lmod, int prec, int *chain)
+{
+	int depth = 0;
+	if (lmod < 1.0) depth = (int) ceil (-log (lmod) / M_LN2);
+	*chain = depth;
+
+	if (zre*zre + zim*zim <= 1.0)
+	{
+		int nterms = polylog_terms_est_d (sre, sim, -1.0, 0.0, prec);
+		return 8.0 * nterms * (depth + 1);
+	}
+
+	int nbern = 0;
+	int em = euler_plan (1.0-sre, -sim, 0.5, 0.0, prec, &nbern);
+	if (em < 0) return 1.0e30;
+	return 2.0 * (1.3 * prec * em + 4.0 * nbern);
+}
+
+/* Fill in the coefficients a_k = zeta(s-k)/k! for this s */
+static int logser_build (logser_state *st, const cpx_t ess, int prec)
+{
+	int k, n, rc = 0;
+	double wre = 1.0 - cpx_get_re (ess);
+	double wim = - cpx_get_im (ess);
+	double logeps = -prec * M_LN10;
+	double logr = log (LOGSER_RADIUS);
+
+	int nbern = 0;
+	int nmax = logser_nmax (wre, wim, prec);
+	int em = logser_em (wre, wim, nmax, prec, &nbern);
+	if (em < 0) return 1;
+	double logm = log (em);
+
+	if (st->alloc < nmax)
+	{
+		st->coef = (cpx_t *) realloc (st->coef, nmax * sizeof (cpx_t));
+		st->lmag = (double *) realloc (st->lmag, nmax * sizeof (double));
+		for (k=st->alloc; k<nmax; k++) cpx_init (st->coef[k]);
+		st->alloc = nmax;
+	}
+	for (k=0; k<nmax; k++) cpx_set_prec (st->coef[k], 3.322*prec+50);
+	cpx_set_prec (st->gam, 3.322*prec+50);
+
+	cpx_t w, mw, wk, gee, bee, sn, cs, trig, zk, deriv, emq, term;
+	cpx_init (w);
+	cpx_init (mw);
+	cpx_init (wk);
+	cpx_init (gee);
+	cpx_init (bee);
+	cpx_init (sn);
+	cpx_init (cs);
+	cpx_init (trig);
+	cpx_init (zk);
+	cpx_init (deriv);
+	cpx_init (emq);
+	cpx_init (term);
+
+	mpf_t twopi, eps, ft;
+	mpf_init (twopi);
+	mpf_init (eps);
+	mpf_init (ft);
+	fp_two_pi (twopi, prec);
+	fp_epsilon (eps, 2*prec);
+
+	/* The direct sum, pn[n] = n^{-w-k} */
+	cpx_set_ui (w, 1, 0);
+	cpx_sub (w, w, ess);
+	cpx_neg (mw, w);
+	cpx_t *pn = (cpx_t *) malloc (em * sizeof (cpx_t));
+	for (n=2; n<em; n++)
+	{
+		cpx_init (pn[n]);
+		cpx_ui_pow (pn[n], n, mw, prec);
+	}
+	int ntop = em-1;
+
+	/* deriv = M^{-w-k} */
+	cpx_ui_pow (deriv, em, mw, prec);
+
+	/* G = 2 (2pi)^{-w} Gamma(w), and Gamma(1-s) = Gamma(w) */
+	cpx_gamma_cache (st->gam, w, prec);
+	cpx_mpf_pow (gee, twopi, mw, prec);
+	cpx_mul (gee, gee, st->gam);
+	cpx_times_ui (gee, gee, 2);
+
+	/* sin and cos of pi s/2 */
+	fp_pi (ft, prec);
+	cpx_times_mpf (term, ess, ft);
+	cpx_div_ui (term, term, 2);
+	cpx_sine (sn, term, prec);
+	cpx_cosine (cs, term, prec);
+
+	/* bee = (w)_k / k! (2pi)^k */
+	cpx_set_ui (bee, 1, 0);
+
+	double lmax = -1.0e300;
+	int nsmall = 0;
+	for (k=0; ; k++)
+	{
+		if (nmax <= k) { rc = 1; break; }
+
+		/* zk = zeta(w+k) */
+		cpx_set_ui (zk, 1, 0);
+		for (n=2; n<=ntop; n++) cpx_add (zk, zk, pn[n]);
+
+		/* The tail is about M^{1-w-k} / (w+k-1) */
+		if ((wre + k - 1.0) * logm < -logeps + 5.0)
+		{
+			cpx_add_ui (wk, w, k, 0);
+			cpx_set (term, deriv);
+			cpx_set_ui (emq, em, 0);
+			int kmax = euler_bern_terms (wre+k, wim, 0.0, 0.0, em, prec);
+			zeta_euler_tail (zk, wk, term, emq, kmax, prec);
+		}
+
+		/* sin (pi(s-k)/2) */
+		switch (k%4)
+		{
+			case 0: cpx_set (trig, sn); break;
+			case 1: cpx_neg (trig, cs); break;
+			case 2: cpx_neg (trig, sn); break;
+			case 3: cpx_set (trig, cs); break;
+		}
+
+		cpx_mul (term, gee, bee);
+		cpx_mul (term, term, trig);
+		cpx_mul (st->coef[k], term, zk);
+
+		double lmag = cpx_log_abs_d (st->coef[k]);
+		st->lmag[k] = lmag;
+
+		/* Done once two terms in a row are negligible at the
+		 * largest |L|, and are falling. */
+		lmag += k * logr;
+		if (lmax < lmag) lmax = lmag;
+		if (lmag < logeps + (0.0 < lmax ? lmax : 0.0) &&
+		    sqrt (wre*wre + wim*wim) < k) nsmall ++;
+		else nsmall = 0;
+		if (2 <= nsmall) break;
+
+		/* bee *= (w+k) / (k+1) 2pi */
+		cpx_add_ui (wk, w, k, 0);
+		cpx_mul (bee, bee, wk);
+		cpx_div_ui (bee, bee, k+1);
+		cpx_div_mpf (bee, bee, twopi);
+
+		/* Next powers; drop those that no longer matter */
+		for (n=2; n<=ntop; n++) cpx_div_ui (pn[n], pn[n], n);
+		while (1 < ntop)
+		{
+			cpx_mod_sq (ft, pn[ntop]);
+			if (0 <= mpf_cmp (ft, eps)) break;
+			ntop --;
+		}
+		cpx_div_ui (deriv, deriv, em);
+	}
+
+	if (0 == rc)
+	{
+		st->nterms = k+1;
+		st->prec = prec;
+	}
+
+	for (n=2; n<em; n++) cpx_clear (pn[n]);
+	free (pn);
+
+	cpx_clear (w);
+	cpx_clear (mw);
+	cpx_clear (wk);
+	cpx_clear (gee);
+	cpx_clear (bee);
+	cpx_clear (sn);
+	cpx_clear (cs);
+	cpx_clear (trig);
+	cpx_clear (zk);
+	cpx_clear (deriv);
+	cpx_clear (emq);
+	cpx_clear (term);
+	mpf_clear (twopi);
+	mpf_clear (eps);
+	mpf_clear (ft);
+	return rc;
+}
+
+/*
+ * polylog_logser -- the polylog near z=1, by the series in log z.
+ *
+ * Return a non-zero value if no value was computed: z is too far
+ * from 1, s is too close to a non-negative integer, or there are not
+ * enough spare bits to absorb the cancellation in the sum. When the
+ * coefficients for this s are not yet at hand, they are computed only
+ * if "cold" is set, and then only once the cost of the usual route,
+ * summed over the calls at this s, has come to the cost of setting
+ * them up (the ski-rental rule, as in cpx_hurwitz_auto), or that
+ * route would recurse too deeply.
+ */
+static int polylog_logser (cpx_t plog, const cpx_t ess, const cpx_t zee,
+                           int prec, int cold)
+{
+	double sre = cpx_get_re (ess);
+	double sim = cpx_get_im (ess);
+	double nint = floor (sre + 0.5);
+	if (0.0 <= nint && fabs (sre - nint) < LOGSER_SGAP && fabs (sim) < LOGSER_SGAP)
+		return 1;
+
+	double zre = cpx_get_re (zee);
+	double zim = cpx_get_im (zee);
+	double lre = 0.5 * log (zre*zre + zim*zim);
+	double lim = atan2 (zim, zre);
+	double lmod = sqrt (lre*lre + lim*lim);
+	if (LOGSER_RADIUS <= lmod) return 1;
+
+	/* The coefficients are made with the spare bits as guard digits */
+	int nbits = mpf_get_default_prec();
+	int guard = (int) ((nbits - 3.321928095 * prec) / 3.321928095) - 1;
+	if (guard < 2) return 1;
+	if (20 < guard) guard = 20;
+	int iprec = prec + guard;
+
+	logser_state *st = thread_state_get (&logser_key);
+	if (!cpx_eq (st->cache_s, ess, 3.322*prec))
+	{
+		cpx_set_prec (st->cache_s, 3.322*prec+50);
+		cpx_set (st->cache_s, ess);
+		st->prec = 0;
+		st->nterms = 0;
+		st->setup = -1.0;
+		st->spent = 0.0;
+	}
+
+	if (st->prec < iprec)
+	{
+		if (!cold) return 1;
+
+		if (st->setup < 0.0)
+			st->setup = logser_setup_cost (1.0-sre, -sim, iprec);
+		if (st->setup < 0.0) return 1;
+
+		int chain;
+		st->spent += logser_path_cost (sre, sim, zre, zim, lmod, prec, &chain);
+		if (st->spent < st->setup && chain < LOGSER_DEEP) return 1;
+
+		if (logser_build (st, ess, iprec))
+		{
+			st->setup = 1.0e30;
+			return 1;
+		}
 	}
 
-	/* Now do a power series in -q. We use a minus here, to cleverly
-	 * absorb a minus sign coming from the Taylor's differentiation. */
-	cpx_neg (q, q);
-	cpx_set_ui (qn, 1, 0);
-	cpx_sub_ui (sn, s, 1, 0);
-	int n = 0;
-	while (1)
+	/* Only as many terms as this |L| needs */
+	double logl = log (lmod);
+	double lmax = -1.0e300;
+	int k, nz = 0;
+	for (k=0; k<st->nterms; k++)
 	{
-		/* Compute binomial(s+n-1, n) as per above. */
-		/* The caching version uses precomputed values, making
-		 * the algo faster. The caching version also means that
-		 * sn does not need to be incremented. */
-		// cpx_binomial (bin, sn, n);
-		// cpx_add_ui (sn, sn, 1, 0);
-		cpx_binomial_sum_cache (bin, sn, n);
-
-		/* zeta_cache returns zeta(s+n) */
-		cpx_borwein_zeta_cache (term, s, n, prec);
-		// cpx_borwein_zeta (term, sn, prec);
-		cpx_mul (term, term, bin);
-		cpx_mul (term, term, qn);
-		cpx_add (hurw, hurw, term);
+		double lt = st->lmag[k] + k * logl;
+		if (lmax < lt) lmax = lt;
+		if (lt > lmax - iprec * M_LN10) nz = k+1;
+	}
 
-		/* Don't go no farther than this */
-		cpx_mod_sq (aterm, term);
-		if (mpf_cmp (aterm, epsilon) < 0) break;
+	cpx_t ell, acc, sing;
+	cpx_init (ell);
+	cpx_init (acc);
+	cpx_init (sing);
 
-		n++;
+	cpx_log (ell, zee, iprec);
 
-		/* qn = q^n */
-		cpx_mul (qn, qn, q);
+	/* Horner */
+	cpx_set (acc, st->coef[nz-1]);
+	for (k=nz-2; 0<=k; k--)
+	{
+		cpx_mul (acc, acc, ell);
+		cpx_add (acc, acc, st->coef[k]);
 	}
 
-punt:
-	cpx_clear (s);
-	cpx_clear (sn);
-	cpx_clear (q);
-	cpx_clear (qn);
-	cpx_clear (bin);
-	cpx_clear (term);
-	mpf_clear (aterm);
-	mpf_clear (epsilon);
+	/* Gamma(1-s) (-L)^{s-1} */
+	cpx_neg (ell, ell);
+	cpx_sub_ui (sing, ess, 1, 0);
+	cpx_pow (sing, ell, sing, iprec);
+	cpx_mul (sing, sing, st->gam);
+	double lsing = cpx_log_abs_d (sing);
+	if (lmax < lsing) lmax = lsing;
+
+	cpx_add (acc, acc, sing);
 
+	/* Digits lost to cancellation must fit in the guard digits */
+	int rc = 1;
+	if (lmax - cpx_log_abs_d (acc) < guard * M_LN10)
+	{
+		cpx_set (plog, acc);
+		rc = 0;
+	}
+
+	cpx_clear (ell);
+	cpx_clear (acc);
+	cpx_clear (sing);
 	return rc;
 }
-
-/* =========================================================== */
-/**
- * cpx_hurwitz_euler -- Hurwitz zeta function via Euler-Maclaurin algo
- *
- * This function computes the value of the Hurwitz zeta function
- * using an Euler-Maclaurin summation to obtain an estimate.
- *
- * The algorithm appears to work.
+/* ============================================================= */
+/*
+ * Derivatives, computed along with the value, with the dual numbers
+ * of mp-dual.h. The dual versions below follow the plain ones step
+ * by step. Variable 0 is s, variable 1 is z (or q).
  */
 
-static void zeta_euler_fp(cpx_t zeta, cpx_t ess, mpf_t q, int em, int prec)
+/* polylog_borwein(), on dual numbers */
+static void polylog_borwein_dual (cpx_dual_t plog, const cpx_dual_t ess,
+                                  const cpx_dual_t zee, int norder, int prec)
 {
+	mpz_t ibin;
+	mpf_t fbin, logk;
+	cpx_dual_t s, ska, pz, acc, term, bins;
+	cpx_t pk, dpk;
 	int k;
-	cpx_t s, spoch, term, deriv;
-	cpx_init (s);
-	cpx_init (spoch);
-	cpx_init (term);
-	cpx_init (deriv);
 
-	cpx_neg (s, ess);
+	mpz_init (ibin);
+	mpf_init (fbin);
+	mpf_init (logk);
+	cpx_dual_init (s);
+	cpx_dual_init (ska);
+	cpx_dual_init (pz);
+	cpx_dual_init (acc);
+	cpx_dual_init (term);
+	cpx_dual_init (bins);
+	cpx_init (pk);
+	cpx_init (dpk);
+
+	cpx_dual_t *bin_sum = (cpx_dual_t *) malloc ((norder+1) * sizeof (cpx_dual_t));
+	for (k=0; k<=norder; k++) cpx_dual_init (bin_sum[k]);
 
-	cpx_set_ui (zeta, 0, 0);
-	/* sum over 1/(k+q)^s  from k=0 to k=M-1 */
-	for (k=0; k<em; k++)
-	{
-		fp_pow_rc (term, k, q, s, prec);
-		cpx_add (zeta, zeta, term);
-	}
+	/* s = -ess */
+	cpx_dual_neg (s, ess);
 
-	/* deriv = 1/(M+q)^s */
-	fp_pow_rc (deriv, em, q, s, prec);
+	/* First binomial summation term is 1 */
+	cpx_dual_set_ui (bins, 1, 0);
+	cpx_dual_set (bin_sum[0], bins);
+	cpx_dual_set_ui (pz, 1, 0);
 
-	/* Add another (1/2) of 1 /(M+q)^s */
-	cpx_div_ui (term, deriv, 2);
-	cpx_add (zeta, zeta, term);
+	/* ska = [1/(z-1)]^n */
+	cpx_dual_set (ska, zee);
+	cpx_sub_ui (ska[0], ska[0], 1, 0);
+	cpx_dual_recip (ska, ska);
+	cpx_dual_pow_ui (ska, ska, norder);
 
-	mpf_t eps, fact, emq, ft;
-	mpf_init (eps);
-	mpf_init (fact);
-	mpf_init (emq);
-	mpf_init (ft);
+	cpx_dual_set_ui (acc, 0, 0);
+	cpx_dual_set_ui (plog, 0, 0);
+	mpz_set_ui (ibin, 1);
 
-	mpq_t bern;
-	mpq_init (bern);
+	for (k=1; k<=2*norder; k++)
+	{
+		cpx_dual_mul (pz, pz, zee);
 
-	/* emq = M+q */
-	mpf_add_ui (emq, q, em);
+		/* k^s, and its derivative, log k k^s */
+		cpx_ui_pow_cache (pk, k, s[0], prec);
+		fp_log_ui (logk, k, prec);
+		cpx_times_mpf (dpk, pk, logk);
+		cpx_dual_chain (term, s, pk, dpk);
 
-	/* term = 1/(s-1)*(q+M)^{s-1} */
-	cpx_times_mpf (term, deriv, emq);
-	cpx_add_ui (s, s, 1, 0);
-	cpx_div (term, term, s);
-	cpx_sub (zeta, zeta, term);
+		if (k <= norder)
+		{
+			cpx_dual_addmul (acc, term, pz);
 
-	/* emq = 1/(M+q) */
-	mpf_ui_div (emq, 1, emq);
-	cpx_times_mpf (deriv, deriv, emq);
+			mpz_mul_ui (ibin, ibin, norder-k+1);
+			mpz_divexact_ui (ibin, ibin, k);
+			mpf_set_z (fbin, ibin);
+			cpx_dual_times_mpf (term, pz, fbin);
 
-	/* emq = 1/(M+q)^2 */
-	mpf_mul (emq, emq, emq);
+			if (k%2)
+				cpx_dual_sub (bins, bins, term);
+			else
+				cpx_dual_add (bins, bins, term);
 
-	mpf_set_ui (fact, 1);
-	mpf_div_ui (fact, fact, 2);
+			cpx_dual_set (bin_sum[k], bins);
+		}
+		else
+		{
+			cpx_dual_mul (term, term, pz);
+			cpx_dual_addmul (plog, term, bin_sum[2*norder-k]);
+		}
+	}
 
-	cpx_sub_ui (s, s, 1, 0);
-	cpx_neg (s, s);
-	cpx_set (spoch, s);
+	cpx_dual_mul (plog, plog, ska);
+	if (norder%2)
+		cpx_dual_sub (plog, acc, plog);
+	else
+		cpx_dual_add (plog, acc, plog);
+
+	for (k=0; k<=norder; k++) cpx_dual_clear (bin_sum[k]);
+	free (bin_sum);
+
+	cpx_dual_clear (s);
+	cpx_dual_clear (ska);
+	cpx_dual_clear (pz);
+	cpx_dual_clear (acc);
+	cpx_dual_clear (term);
+	cpx_dual_clear (bins);
+	cpx_clear (pk);
+	cpx_clear (dpk);
+	mpf_clear (fbin);
+	mpf_clear (logk);
+	mpz_clear (ibin);
+}
 
-	fp_epsilon (eps, 2*prec);
+/* recurse_away_polylog(), on dual numbers */
+static int recurse_away_polylog_dual (cpx_dual_t plog, const cpx_dual_t ess,
+                                      const cpx_dual_t zee, int prec, int depth)
+{
+	int rc;
+	double zre = cpx_get_re (zee[0]);
+	double zim = cpx_get_im (zee[0]);
+	double mod = zre*zre + zim*zim;
 
-	k = 1;
-	while (1)
+	if (25 < mod) return 1;
+	if (9 < depth) return 1;
+	depth ++;
+
+	double den = polylog_get_zone (zre, zim);
+	int nterms = polylog_terms_est (ess[0], zee[0], prec);
+	int nbits = mpf_get_default_prec();
+	int maxterms = nbits - (int) (3.321928095 *prec);
+
+	if ((den <= 1.5) && (maxterms >= nterms))
 	{
-		/* ft = B_2k / (2k)! */
-		q_bernoulli (bern, 2*k);
-		mpf_set_q (ft, bern);
-		mpf_mul (ft, ft, fact);
+		prec += (int) (0.301029996 * nterms) +1;
+		polylog_borwein_dual (plog, ess, zee, nterms, prec);
+		return 0;
+	}
 
-		cpx_times_mpf (term, deriv, ft);
-		cpx_mul (term, term, spoch);
-		cpx_add (zeta, zeta, term);
+	/* Li_s(z) = 2^{1-s} Li_s(z^2) - Li_s(-z) */
+	cpx_dual_t zsq, pp, pn;
+	cpx_dual_init (zsq);
+	cpx_dual_init (pp);
+	cpx_dual_init (pn);
 
-		cpx_mod_sq (ft, term);
-		if (mpf_cmp (ft, eps) < 0) break;
+	cpx_dual_mul (zsq, zee, zee);
+	rc = recurse_away_polylog_dual (pp, ess, zsq, prec, depth);
+	if (rc) goto bailout;
 
-		// printf ("M=%d Q=%d bern=%g ", em, k, mpf_get_d(ft));
-		k++;
+	cpx_dual_neg (zsq, zee);
+	rc = recurse_away_polylog_dual (pn, ess, zsq, prec, depth);
+	if (rc) goto bailout;
 
-		mpf_div_ui (fact, fact, (2*k-1)*2*k);
-		cpx_times_mpf (deriv, deriv, emq);
-		mpf_add_ui (s[0].re, s[0].re, 1);
-		cpx_mul (spoch, spoch, s);
-		mpf_add_ui (s[0].re, s[0].re, 1);
-		cpx_mul (spoch, spoch, s);
-	}
+	/* 2^{1-s}, and its derivative, -log 2 2^{1-s} */
+	cpx_t tv, dtv;
+	mpf_t log2;
+	cpx_init (tv);
+	cpx_init (dtv);
+	mpf_init (log2);
+	cpx_set_ui (tv, 1, 0);
+	cpx_sub (tv, tv, ess[0]);
+	cpx_ui_pow (tv, 2, tv, prec);
+	fp_log2 (log2, prec);
+	cpx_times_mpf (dtv, tv, log2);
+	cpx_neg (dtv, dtv);
+	cpx_dual_chain (zsq, ess, tv, dtv);
+	cpx_clear (tv);
+	cpx_clear (dtv);
+	mpf_clear (log2);
+
+	cpx_dual_mul (plog, pp, zsq);
+	cpx_dual_sub (plog, plog, pn);
 
-	mpq_clear (bern);
-	mpf_clear (fact);
-	mpf_clear (emq);
-	mpf_clear (ft);
-	cpx_clear (s);
-	cpx_clear (spoch);
-	cpx_clear (term);
-	cpx_clear (deriv);
+bailout:
+	cpx_dual_clear (zsq);
+	cpx_dual_clear (pp);
+	cpx_dual_clear (pn);
+	return rc;
+}
+
+/**
+ * cpx_polylog_d -- the polylog, and its partial derivatives in s and z,
+ * in one pass over the Borwein sums and the duplication formula.
+ */
+int cpx_polylog_d (cpx_t plog, cpx_t ds, cpx_t dz,
+                   const cpx_t ess, const cpx_t zee, int prec)
+{
+	cpx_dual_t s, z, val;
+	cpx_dual_init (s);
+	cpx_dual_init (z);
+	cpx_dual_init (val);
+
+	cpx_dual_var (s, ess, 0);
+	cpx_dual_var (z, zee, 1);
+
+	int rc = recurse_away_polylog_dual (val, s, z, prec, 0);
+	if (rc) cpx_dual_set_ui (val, 0, 0);
+	cpx_set (plog, val[0]);
+	if (ds) cpx_set (ds, val[1+0]);
+	if (dz) cpx_set (dz, val[1+1]);
+
+	cpx_dual_clear (s);
+	cpx_dual_clear (z);
+	cpx_dual_clear (val);
+	return rc;
 }
 
-static void zeta_euler(cpx_t zeta, cpx_t ess, cpx_t q, int em, int prec)
+/**
+ * cpx_hurwitz_zeta_d -- the Hurwitz zeta, and its partial derivatives
+ * in s and q, from one Euler-Maclaurin sum.
+ */
+void cpx_hurwitz_zeta_d (cpx_t hz, cpx_t ds, cpx_t dq,
+                         const cpx_t ess, const cpx_t que, int prec)
 {
 	int k;
-	cpx_t s, emq, spoch, term, deriv;
-	cpx_init (s);
-	cpx_init (emq);
-	cpx_init (spoch);
-	cpx_init (term);
-	cpx_init (deriv);
+	int kmax = 0;
+	/* A few extra digits, as the derivatives of the Bernoulli terms
+	 * are larger than the terms themselves. */
+	int em = euler_plan (cpx_get_re (ess), cpx_get_im (ess),
+	                     cpx_get_re (que), cpx_get_im (que), prec+4, &kmax);
+	if (em < 0) em = prec + 12;
+
+	cpx_dual_t s, ms, q, base, term, zeta, deriv, ibsq, spoch;
+	cpx_dual_init (s);
+	cpx_dual_init (ms);
+	cpx_dual_init (q);
+	cpx_dual_init (base);
+	cpx_dual_init (term);
+	cpx_dual_init (zeta);
+	cpx_dual_init (deriv);
+	cpx_dual_init (ibsq);
+	cpx_dual_init (spoch);
+
+	mpf_t eps, ft, last;
+	mpf_init (eps);
+	mpf_init (ft);
+	mpf_init (last);
+	fp_epsilon (eps, 2*prec+8);
 
-	cpx_neg (s, ess);
-	cpx_set (emq, q);
+	cpx_dual_var (s, ess, 0);
+	cpx_dual_var (q, que, 1);
+	cpx_dual_neg (ms, s);
 
-	cpx_set_ui (zeta, 0, 0);
-	/* sum over 1/(k+q)^s  from k=0 to k=M-1 */
+	/* sum over 1/(k+q)^s from k=0 to k=M-1 */
+	cpx_dual_set_ui (zeta, 0, 0);
 	for (k=0; k<em; k++)
 	{
-		cpx_pow_rc (term, k, emq, s, prec);
-		cpx_add (zeta, zeta, term);
+		cpx_dual_add_ui (base, q, k, 0);
+		cpx_dual_pow (term, base, ms, prec);
+		cpx_dual_add (zeta, zeta, term);
 	}
 
-	/* deriv = 1/(M+q)^s */
-	cpx_pow_rc (deriv, em, emq, s, prec);
+	/* deriv = 1/(M+q)^s, plus half of it */
+	cpx_dual_add_ui (base, q, em, 0);
+	cpx_dual_pow (deriv, base, ms, prec);
+	mpf_set_d (ft, 0.5);
+	cpx_dual_times_mpf (term, deriv, ft);
+	cpx_dual_add (zeta, zeta, term);
+
+	/* (M+q)^{1-s} / (s-1) */
+	cpx_dual_mul (term, deriv, base);
+	cpx_dual_set (spoch, s);
+	cpx_sub_ui (spoch[0], spoch[0], 1, 0);
+	cpx_dual_div (term, term, spoch);
+	cpx_dual_add (zeta, zeta, term);
+
+	/* deriv = 1/(M+q)^{s+1}, ibsq = 1/(M+q)^2 */
+	cpx_dual_recip (ibsq, base);
+	cpx_dual_mul (deriv, deriv, ibsq);
+	cpx_dual_mul (ibsq, ibsq, ibsq);
+
+	/* B_2k/(2k)! (s)_{2k-1} / (M+q)^{s+2k-1}. The series is
+	 * asymptotic: stop at the smallest term, should the plan
+	 * have been too optimistic. */
+	mpf_set_ui (last, 0);
+	cpx_dual_set (spoch, s);
+	for (k=1; ; k++)
+	{
+		euler_bern (ft, k, prec);
+		cpx_dual_mul (term, deriv, spoch);
+		cpx_dual_times_mpf (term, term, ft);
 
-	/* Add another (1/2) of 1 /(M+q)^s */
-	cpx_div_ui (term, deriv, 2);
-	cpx_add (zeta, zeta, term);
+		cpx_mod_sq (ft, term[0]);
+		if (1 < k && 0 < mpf_cmp (ft, last)) break;
+		mpf_set (last, ft);
+		cpx_dual_add (zeta, zeta, term);
 
-	mpf_t eps, fact, ft;
-	mpf_init (eps);
-	mpf_init (fact);
-	mpf_init (ft);
+		if (mpf_cmp (ft, eps) < 0) break;
+		if (2*kmax+10 < k) break;
 
-	mpq_t bern;
-	mpq_init (bern);
+		cpx_dual_add_ui (base, s, 2*k-1, 0);
+		cpx_dual_mul (spoch, spoch, base);
+		cpx_dual_add_ui (base, s, 2*k, 0);
+		cpx_dual_mul (spoch, spoch, base);
+		cpx_dual_mul (deriv, deriv, ibsq);
+	}
 
-	/* emq = M+q */
-	mpf_add_ui (emq[0].re, emq[0].re, em);
+	cpx_set (hz, zeta[0]);
+	if (ds) cpx_set (ds, zeta[1+0]);
+	if (dq) cpx_set (dq, zeta[1+1]);
+
+	cpx_dual_clear (s);
+	cpx_dual_clear (ms);
+	cpx_dual_clear (q);
+	cpx_dual_clear (base);
+	cpx_dual_clear (term);
+	cpx_dual_clear (zeta);
+	cpx_dual_clear (deriv);
+	cpx_dual_clear (ibsq);
+	cpx_dual_clear (spoch);
+	mpf_clear (eps);
+	mpf_clear (ft);
+	mpf_clear (last);
+}
 
-	/* term = 1/(s-1)*(q+M)^{s-1} */
-	cpx_mul (term, deriv, emq);
-	cpx_add_ui (s, s, 1, 0);
-	cpx_div (term, term, s);
-	cpx_sub (zeta, zeta, term);
+/* ============================================================= */
+/*
+ * Choosing between the Hurwitz zeta algorithms.
+ *
+ * Each method is costed in "terms", which are, roughly, one complex
+ * power at the working precision. A method may have a one-time setup
+ * cost for a given s: the k^{-s} cache of the polylog for the periodic
+ * zeta route, the zeta(s+n) cache for the Taylor series. Euler-Maclaurin
+ * has none. The microseconds per term are in mp-hurwitz-tune.h, which
+ * is written by tests/hurwitz-tune.
+ */
 
-	/* emq = 1/(M+q) */
-	cpx_recip (emq, emq);
-	cpx_mul (deriv, deriv, emq);
+/* Number of terms in the Taylor series, for shifted |q| = qmod */
+static int hurwitz_taylor_terms (double sre, double sim, double qmod, int prec)
+{
+	double logeps = -prec * M_LN10;
+	if (qmod < 1.0e-30) return 1;
+	double lq = log (qmod);
 
-	/* emq = 1/(M+q)^2 */
-	cpx_mul (emq, emq, emq);
+	/* log |binom(s+n-1, n)| grows as long as |s+n| > n+1 */
+	double lbin = 0.0;
+	int n;
+	for (n=1; n<100000; n++)
+	{
+		lbin += 0.5 * log (((sre+n-1)*(sre+n-1) + sim*sim) / ((double) n*n));
+		if (lbin + n*lq < logeps) return n;
+	}
+	return -1;
+}
 
-	mpf_set_ui (fact, 1);
-	mpf_div_ui (fact, fact, 2);
+/**
+ * cpx_hurwitz_terms -- estimated setup and per-call costs, in terms,
+ * of one Hurwitz zeta method. Returns zero if the method does not
+ * apply at these arguments.
+ */
+int cpx_hurwitz_terms (int method, const cpx_t ess, const cpx_t que, int prec,
+                       double *setup, double *percall)
+{
+	double sre = cpx_get_re (ess);
+	double sim = cpx_get_im (ess);
+	double qre = cpx_get_re (que);
+	double qim = cpx_get_im (que);
 
-	cpx_sub_ui (s, s, 1, 0);
-	cpx_neg (s, s);
-	cpx_set (spoch, s);
+	*setup = 0.0;
+	*percall = 0.0;
 
-	fp_epsilon (eps, 2*prec);
+	/* The pole at s=1, and the poles at q = 0, -1, -2, ... */
+	if (1.0 == sre && 0.0 == sim) return 0;
+	if (0.0 == qim && qre <= 0.0 && qre == floor (qre)) return 0;
 
-	k = 1;
-	while (1)
+	if (HURWITZ_PERIODIC == method)
 	{
-		/* ft = B_2k / (2k)! */
-		q_bernoulli (bern, 2*k);
-		mpf_set_q (ft, bern);
-		mpf_mul (ft, ft, fact);
+		if (0.0 != qim || qre <= 0.0) return 0;
 
-		cpx_times_mpf (term, deriv, ft);
-		cpx_mul (term, term, spoch);
-		cpx_add (zeta, zeta, term);
+		double frac = qre - floor (qre);
+		if (1.0e-15 > frac || 1.0e-15 > 1.0-frac) return 0;
 
-		cpx_mod_sq (ft, term);
-		if (mpf_cmp (ft, eps) < 0) break;
-#if 0
-		double t = mpf_get_d (ft);
-		printf ("M=%d Q=%d bern=%g ", em, k, t);
-#endif
+		/* The polylog is taken at 1-s, at z on the unit circle;
+		 * the duplication formula keeps 1/4 < q < 3/4. */
+		int nhalf = polylog_terms_est_d (1.0-sre, -sim, -1.0, 0.0, prec);
+		int nquart = polylog_terms_est_d (1.0-sre, -sim, 0.0, 1.0, prec);
+		if (4 >= nhalf || 4 >= nquart) return 0;
+		int nmax = (nhalf > nquart) ? nhalf : nquart;
 
-		k++;
+		int depth = 0;
+		if (0.5 < frac) frac = 1.0 - frac;
+		while (frac < 0.25) { frac *= 2.0; depth++; }
 
-		mpf_div_ui (fact, fact, (2*k-1)*2*k);
-		cpx_mul (deriv, deriv, emq);
-		mpf_add_ui (s[0].re, s[0].re, 1);
-		cpx_mul (spoch, spoch, s);
-		mpf_add_ui (s[0].re, s[0].re, 1);
-		cpx_mul (spoch, spoch, s);
+		*setup = nmax;
+		*percall = 2.0 * (depth+1) * nmax + floor (qre);
+		return 1;
 	}
 
-	mpq_clear (bern);
-	mpf_clear (fact);
-	mpf_clear (ft);
-	cpx_clear (s);
-	cpx_clear (spoch);
-	cpx_clear (term);
-	cpx_clear (deriv);
+	if (HURWITZ_TAYLOR == method)
+	{
+		if (0.0 == sim && sre <= 1.0 && sre == floor (sre)) return 0;
+
+		double ell = floor (qre + 0.55);
+		double qs = qre - ell;
+		int n = hurwitz_taylor_terms (sre, sim, sqrt (qs*qs + qim*qim), prec);
+		if (0.9*0.9 < qs*qs + qim*qim || n < 0) return 0;
+
+		/* Each zeta(s+n) is a Borwein sum */
+		int nzeta = polylog_terms_est_d (sre, sim, -1.0, 0.0, prec);
+		if (nzeta < 1) nzeta = 1;
+
+		*setup = (double) n * nzeta;
+		*percall = n + fabs (ell - 1.0);
+		return 1;
+	}
+
+	if (HURWITZ_EULER == method)
+	{
+		int k;
+		int em = euler_plan (sre, sim, qre, qim, prec, &k);
+		if (em < 0) return 0;
+
+		/* A Bernoulli term costs about 2/prec of a power */
+		*percall = em + k * 2.0 / (prec + 10.0);
+		return 1;
+	}
+
+	return 0;
 }
 
-void cpx_hurwitz_euler_fp(cpx_t zeta, cpx_t ess, mpf_t q, int prec)
+/* Microseconds per term, interpolated between the rows of the table */
+static double hurwitz_unit_cost (int col, int prec)
 {
-	/* really really really bad estimates to the bounds */
-	// int em = prec + 12;
-	int em = prec/2 + 5;
+	int i;
+	if (prec <= hurwitz_tune[0][0]) return hurwitz_tune[0][col];
+	for (i=1; i<HURWITZ_TUNE_ROWS; i++)
+	{
+		if (prec <= hurwitz_tune[i][0])
+		{
+			double p0 = hurwitz_tune[i-1][0];
+			double p1 = hurwitz_tune[i][0];
+			double f = (prec - p0) / (p1 - p0);
+			return (1.0-f) * hurwitz_tune[i-1][col] + f * hurwitz_tune[i][col];
+		}
+	}
+	return hurwitz_tune[HURWITZ_TUNE_ROWS-1][col];
+}
 
-	zeta_euler_fp (zeta, ess, q, em, prec);
+/* What each thread has seen lately. The setup that is counted, the
+ * k^{-s} of the polylog and the zeta(s+n) of the Taylor series, is
+ * cached per thread, and so this is too. The gamma and scale factors
+ * are in shared keyed caches, but are a few terms, and not counted.
+ * The setup already paid is kept in terms, since the Taylor series
+ * needs more coefficients as the shifted |q| grows; "since" is the
+ * call at which it was paid. */
+typedef struct
+{
+	double sre;
+	double sim;
+	int prec;
+	unsigned long ncalls;
+	double paid[HURWITZ_NMETHODS];
+	unsigned long since[HURWITZ_NMETHODS];
+} hurwitz_auto_state;
+
+static void * hurwitz_auto_state_new (void)
+{
+	hurwitz_auto_state *st = (hurwitz_auto_state *) malloc (sizeof (hurwitz_auto_state));
+	st->sre = 1.0;
+	st->sim = 0.0;
+	st->prec = 0;
+	st->ncalls = 0;
+	memset (st->paid, 0, sizeof (st->paid));
+	memset (st->since, 0, sizeof (st->since));
+	return st;
 }
 
-void cpx_hurwitz_euler(cpx_t zeta, cpx_t ess, cpx_t q, int prec)
+DECLARE_THREAD_STATE (hurwitz_auto_key, hurwitz_auto_state_new, free);
+
+/*
+ * The setup cost is amortized over the number of calls made so far
+ * at this s, in the manner of the ski-rental problem: a method with
+ * an expensive setup is picked only once enough calls have been made
+ * that it would have paid for itself. Further setup (more Taylor
+ * coefficients) is amortized over the calls since the last payment,
+ * so that it is not bought in many small pieces.
+ */
+static int hurwitz_choose (const cpx_t ess, const cpx_t que, int prec,
+                           hurwitz_auto_state *st, unsigned long ncalls,
+                           double *setup_needed)
+{
+	int best = -1;
+	double bestcost = 0.0;
+	int m;
+	for (m=0; m<HURWITZ_NMETHODS; m++)
+	{
+		double setup, percall;
+		if (!cpx_hurwitz_terms (m, ess, que, prec, &setup, &percall)) continue;
+
+		double cost = hurwitz_unit_cost (2*m+2, prec) * percall;
+		if (st->paid[m] < setup)
+			cost += hurwitz_unit_cost (2*m+1, prec) * (setup - st->paid[m])
+			        / (ncalls - st->since[m]);
+
+		if (best < 0 || cost < bestcost)
+		{
+			best = m;
+			bestcost = cost;
+			*setup_needed = setup;
+		}
+	}
+	return best;
+}
+
+static int hurwitz_same_s (hurwitz_auto_state *st, const cpx_t ess, int prec)
+{
+	return st->sre == cpx_get_re (ess) && st->sim == cpx_get_im (ess) &&
+	       prec <= st->prec;
+}
+
+int cpx_hurwitz_method (const cpx_t ess, const cpx_t que, int prec)
 {
-	/* really really really bad estimates to the bounds */
-	int em = prec + 12;
+	hurwitz_auto_state *st = thread_state_get (&hurwitz_auto_key);
+	double setup;
+	if (hurwitz_same_s (st, ess, prec))
+		return hurwitz_choose (ess, que, prec, st, st->ncalls+1, &setup);
+
+	hurwitz_auto_state cold;
+	memset (&cold, 0, sizeof (cold));
+	return hurwitz_choose (ess, que, prec, &cold, 1, &setup);
+}
+
+/**
+ * cpx_hurwitz_auto -- Hurwitz zeta, by whichever method is cheapest.
+ */
+int cpx_hurwitz_auto (cpx_t hzeta, const cpx_t ess, const cpx_t que, int prec)
+{
+	hurwitz_auto_state *st = thread_state_get (&hurwitz_auto_key);
+	if (!hurwitz_same_s (st, ess, prec))
+	{
+		st->sre = cpx_get_re (ess);
+		st->sim = cpx_get_im (ess);
+		st->prec = prec;
+		st->ncalls = 0;
+		memset (st->paid, 0, sizeof (st->paid));
+		memset (st->since, 0, sizeof (st->since));
+	}
+	st->ncalls ++;
+
+	double setup;
+	int m = hurwitz_choose (ess, que, prec, st, st->ncalls, &setup);
+	if (m < 0)
+	{
+		fprintf (stderr, "Error: cpx_hurwitz_auto() no method applies at "
+		         "s=%g+i%g q=%g+i%g\n", cpx_get_re (ess), cpx_get_im (ess),
+		         cpx_get_re (que), cpx_get_im (que));
+		cpx_set_ui (hzeta, 0, 0);
+		return 1;
+	}
+	if (st->paid[m] < setup)
+	{
+		st->paid[m] = setup;
+		st->since[m] = st->ncalls;
+	}
+
+	if (HURWITZ_PERIODIC == m)
+	{
+		cpx_hurwitz_zeta (hzeta, ess, que[0].re, prec);
+		return 0;
+	}
+	if (HURWITZ_TAYLOR == m)
+		return cpx_hurwitz_taylor (hzeta, ess, que, prec);
 
-	zeta_euler (zeta, ess, q, em, prec);
+	cpx_t s, q;
+	cpx_init (s);
+	cpx_init (q);
+	cpx_set (s, ess);
+	cpx_set (q, que);
+	cpx_hurwitz_euler (hzeta, s, q, prec);
+	cpx_clear (s);
+	cpx_clear (q);
+	return 0;
 }
 
 /* ============================================================= */
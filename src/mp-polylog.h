@@ -37,6 +37,18 @@ extern "C" {
  */
 void cpx_polylog_nint (cpx_t plog, unsigned int negn, const cpx_t zee);
 
+/**
+ * cpx_polylog_nint_batch -- Li_{-n}(z) for all 0 <= n <= maxn, at
+ * one z. The array plog must hold maxn+1 initialized values.
+ */
+void cpx_polylog_nint_batch (cpx_t *plog, unsigned int maxn, const cpx_t zee);
+
+/**
+ * q_polylog_nint -- Li_{-n}(z), exactly, for rational z.
+ * Returns non-zero at the pole z=1.
+ */
+int q_polylog_nint (mpq_t plog, unsigned int negn, const mpq_t zee);
+
 /**
  * cpx_polylog_sum -- compute the polylogarithm by direct summation
  *
@@ -78,6 +90,57 @@ void cpx_polylog_sum (cpx_t plog, const cpx_t ess, const cpx_t zee, int prec);
  */
 int cpx_polylog (cpx_t plog, const cpx_t ess, const cpx_t zee, int prec);
 
+/**
+ * cpx_polylog_d -- polylogarithm, together with its partial derivatives
+ * ds = d Li_s(z)/ds and dz = d Li_s(z)/dz, computed in a single pass
+ * with dual numbers. Either of ds, dz may be NULL.
+ *
+ * Only the Borwein sums and the duplication formula are used; so z
+ * must lie in, or just outside of, the unit disk, and not too close
+ * to z=1. Returns non-zero, with everything set to zero, if no value
+ * was computed.
+ */
+int cpx_polylog_d (cpx_t plog, cpx_t ds, cpx_t dz,
+                   const cpx_t ess, const cpx_t zee, int prec);
+
+/**
+ * cpx_polylog_grid -- polylogarithm on a rectangular grid of z
+ *
+ * Evaluates Li_s(z) for fixed s, at nx by ny points of z spaced
+ * evenly from z_ll (the lower-left corner) to z_ur (upper-right),
+ * corners included. The results are written to out[j*nx+i], for the
+ * point z = z_ll + i*dx + I*j*dy; the out array must hold nx*ny
+ * initialized values. The rows are spread over up to nthreads
+ * threads; zero or less means mp_get_nthreads().
+ *
+ * Somewhat faster than calling cpx_polylog() one point at a time
+ * even on a single thread, as the work that depends only on s is
+ * shared between the points.
+ * Returns the number of points that could not be evaluated; those
+ * are set to zero, as with cpx_polylog().
+ */
+int cpx_polylog_grid (cpx_t *out, const cpx_t ess,
+                      const cpx_t z_ll, const cpx_t z_ur,
+                      int nx, int ny, int prec, int nthreads);
+
+/**
+ * cpx_polylog_memo -- remember the subproblems of the recursion
+ *
+ * cpx_polylog() and cpx_periodic_zeta() use duplication formulas
+ * that split a point into others: z into z^2 and -z, or q into 2q
+ * and q+1/2. Over a sweep of many points, e.g. around |z|=1, the
+ * same ones come up again and again. If on is non-zero, the value
+ * at each such point is kept, and reused when that point comes up
+ * again with the same s and prec. The table is per thread, and is
+ * flushed whenever s or prec changes. Off by default.
+ *
+ * cpx_polylog_memo_stats -- the number of lookups in the memo
+ * table, and how many of those were hits, summed over all threads.
+ * If reset is non-zero, the counts are then set back to zero.
+ */
+void cpx_polylog_memo (int on);
+void cpx_polylog_memo_stats (unsigned long *lookups, unsigned long *hits, int reset);
+
 /**
  * cpx_polylog_euler -- compute the polylogarithm from Hurwitz Euler.
  *
@@ -132,6 +195,38 @@ void cpx_polylog_g1_action(cpx_t delta, const cpx_t ess, const cpx_t zee, int di
  */
 void cpx_periodic_zeta (cpx_t z, const cpx_t ess, const mpf_t que, int prec);
 
+/**
+ * cpx_periodic_zeta_batch -- periodic zeta at all of q = p/N.
+ *
+ * Sets out[p] = F(s,p/N) for p = 0..N-1; the out array must hold N
+ * initialized values. Note that out[0] = F(s,0) = zeta(s). All N
+ * values come from one discrete Fourier transform of the Hurwitz
+ * zeta values zeta(s, r/N), r = 1..N, and these from one shared
+ * table of n^{-s}. The transform is an FFT when N is a power of two.
+ * There is a pole at s=1.
+ *
+ * The table holds (M+1)N powers, for a cutoff M, so the cost still
+ * grows linearly with N; it is not that of a few single evaluations.
+ * At s=1/2+14i and 50 digits, a batch of 64 takes about the time of
+ * 32 single cpx_periodic_zeta() calls, or of 13 once the Bernoulli
+ * numbers are cached; but it is the more accurate.
+ */
+void cpx_periodic_zeta_batch (cpx_t *out, const cpx_t ess, unsigned int N, int prec);
+
+/**
+ * polylog_grid_d, periodic_zeta_grid_d -- double-precision grids.
+ * Evaluate Li_s(z) at the npts points zee[], or F(s,q) at the npts
+ * points que[], all for the same s = sre + i sim, and write the
+ * results into out[]. Complex values, both zee[] and out[], are
+ * stored as interleaved (re, im) pairs of doubles. Intended for
+ * preview renders: prec is clamped to 15 digits, and the Borwein
+ * cancellation typically costs a few digits more than that.
+ */
+void polylog_grid_d (double *out, double sre, double sim,
+                     const double *zee, int npts, int prec);
+void periodic_zeta_grid_d (double *out, double sre, double sim,
+                           const double *que, int npts, int prec);
+
 /**
  * cpx_periodic_beta -- Periodic beta function 
  *
@@ -167,20 +262,67 @@ void cpx_hurwitz_zeta (cpx_t hzeta, const cpx_t ess, const mpf_t que, int prec);
  */
 int cpx_hurwitz_taylor (cpx_t hzeta, const cpx_t ess, const cpx_t que, int prec);
 
+/**
+ * cpx_hurwitz_taylor_batch -- as above, for the m values que[0..m-1]
+ * at once. The Taylor coefficients are computed only once; each q
+ * is then summed by Horner's rule, in parallel. Returns the number
+ * of q that fell outside the domain of convergence; out[] is set to
+ * zero for those.
+ */
+int cpx_hurwitz_taylor_batch (cpx_t *out, const cpx_t ess,
+                              const cpx_t *que, int m, int prec);
+
 /**
  * cpx_hurwitz_euler -- Hurwitz zeta function via Euler-Maclaurin algo
  *
  * This function computes the value of the Hurwitz zeta function
  * using an Euler-Maclaurin summation to obtain an estimate.
  *
- * The algorithm appears to work in principle (well, it gets 4 or 5
- * digits right), but we are doing a really really bad error estimate.
- * So it doesn't work at higher precision, at least not on the critical
- * strip.
+ * The cutoff M of the direct sum is chosen, together with the number
+ * of Bernoulli terms, to reach 10^-prec at the least cost; it grows
+ * with |s|. The Bernoulli terms, and the rising factorials of s that
+ * they need, are cached, so repeated calls at the same s are cheaper.
  */
 void cpx_hurwitz_euler_fp(cpx_t hzeta, cpx_t ess, mpf_t que, int prec);
 void cpx_hurwitz_euler(cpx_t hzeta, cpx_t ess, cpx_t que, int prec);
 
+/**
+ * cpx_hurwitz_zeta_d -- Hurwitz zeta function, together with its
+ * partial derivatives ds and dq, from a single Euler-Maclaurin sum
+ * over dual numbers. Either of ds, dq may be NULL.
+ */
+void cpx_hurwitz_zeta_d (cpx_t hzeta, cpx_t ds, cpx_t dq,
+                         const cpx_t ess, const cpx_t que, int prec);
+
+/**
+ * cpx_hurwitz_auto -- Hurwitz zeta function, choosing whichever of
+ * the above methods is estimated to be fastest for the given s, q
+ * and precision. The estimate uses the tuning table written by
+ * tests/hurwitz-tune. Repeated calls with the same s favor the
+ * methods whose per-s caches are already filled. Returns non-zero
+ * (and sets hzeta to zero) if no method applies.
+ */
+int cpx_hurwitz_auto (cpx_t hzeta, const cpx_t ess, const cpx_t que, int prec);
+
+#define HURWITZ_PERIODIC 0
+#define HURWITZ_TAYLOR 1
+#define HURWITZ_EULER 2
+#define HURWITZ_NMETHODS 3
+
+/**
+ * cpx_hurwitz_method -- the method that the next call to
+ * cpx_hurwitz_auto, from this thread, would use; -1 if none.
+ */
+int cpx_hurwitz_method (const cpx_t ess, const cpx_t que, int prec);
+
+/**
+ * cpx_hurwitz_terms -- estimated cost of one method, in units of
+ * terms, split into the one-time setup for a given s and the cost
+ * of each call. Returns zero if the method does not apply.
+ */
+int cpx_hurwitz_terms (int method, const cpx_t ess, const cpx_t que, int prec,
+                       double *setup, double *percall);
+
 #ifdef  __cplusplus
 };
 #endif
@@ -0,0 +1,192 @@
+/*
+ * mp-thread.c
+ *
+ * Minimal support for spreading independent work over several threads.
+ *
+ * Copyright (C) 2026 Linas Vepstas
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301  USA
+ */
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "mp-thread.h"
+
+/* ======================================================================= */
+
+static int mp_nthreads = 0;
+
+/* Set in threads that are running jobs; parallel loops nested
+ * inside of a job just run serially. */
+static __thread int mp_in_parallel = 0;
+
+void mp_set_nthreads (int nthreads)
+{
+	mp_nthreads = nthreads;
+}
+
+int mp_get_nthreads (void)
+{
+	if (0 < mp_nthreads) return mp_nthreads;
+
+	long ncpu = sysconf (_SC_NPROCESSORS_ONLN);
+	if (ncpu < 1) ncpu = 1;
+	return ncpu;
+}
+
+/* ======================================================================= */
+
+typedef struct
+{
+	void (*fn) (void *, int);
+	void *arg;
+	int njobs;
+	int next;
+	pthread_spinlock_t lock;
+} job_queue;
+
+static void run_jobs (job_queue *q)
+{
+	while (1)
+	{
+		pthread_spin_lock (&q->lock);
+		int job = q->next++;
+		pthread_spin_unlock (&q->lock);
+
+		if (q->njobs <= job) break;
+		q->fn (q->arg, job);
+	}
+}
+
+/* ======================================================================= */
+/*
+ * The worker threads are kept around between parallel loops. Besides
+ * saving the thread start-up, this keeps the per-thread caches (see
+ * DECLARE_THREAD_STATE) warm: a sweep over many points with the same
+ * s only pays for the powers k^-s once per thread, not once per loop.
+ */
+
+static struct
+{
+	pthread_mutex_t lock;
+	pthread_cond_t work;
+	pthread_cond_t done;
+	int nworkers;     /* threads started so far */
+	int want;         /* workers 0..want-1 take part in this round */
+	int active;       /* workers still busy with this round */
+	int busy;         /* a round is in progress */
+	unsigned long round;
+	job_queue *q;
+} pool = {
+	.lock = PTHREAD_MUTEX_INITIALIZER,
+	.work = PTHREAD_COND_INITIALIZER,
+	.done = PTHREAD_COND_INITIALIZER,
+};
+
+static void * pool_worker (void *data)
+{
+	int id = (int) (long) data;
+	unsigned long seen = 0;
+	mp_in_parallel = 1;
+
+	pthread_mutex_lock (&pool.lock);
+	while (1)
+	{
+		while (seen == pool.round)
+			pthread_cond_wait (&pool.work, &pool.lock);
+		seen = pool.round;
+		if (pool.want <= id) continue;
+
+		job_queue *q = pool.q;
+		pthread_mutex_unlock (&pool.lock);
+		run_jobs (q);
+		pthread_mutex_lock (&pool.lock);
+
+		pool.active --;
+		if (0 == pool.active) pthread_cond_signal (&pool.done);
+	}
+	return NULL;
+}
+
+void mp_parallel_for_n (int nthr, int njobs,
+                        void (*fn) (void *arg, int job), void *arg)
+{
+	int i;
+	if (nthr <= 0) nthr = mp_get_nthreads ();
+	if (njobs < nthr) nthr = njobs;
+	if (mp_in_parallel) nthr = 1;
+
+	/* The pool serves one loop at a time; a second, concurrent
+	 * caller just runs its loop by itself. */
+	if (1 < nthr)
+	{
+		pthread_mutex_lock (&pool.lock);
+		if (pool.busy) nthr = 1;
+		else pool.busy = 1;
+		pthread_mutex_unlock (&pool.lock);
+	}
+
+	if (nthr <= 1)
+	{
+		for (i=0; i<njobs; i++) fn (arg, i);
+		return;
+	}
+
+	job_queue q;
+	q.fn = fn;
+	q.arg = arg;
+	q.njobs = njobs;
+	q.next = 0;
+	pthread_spin_init (&q.lock, PTHREAD_PROCESS_PRIVATE);
+
+	/* The calling thread works too */
+	pthread_mutex_lock (&pool.lock);
+	while (pool.nworkers < nthr-1)
+	{
+		pthread_t thr;
+		if (pthread_create (&thr, NULL, pool_worker, (void *) (long) pool.nworkers))
+			break;
+		pthread_detach (thr);
+		pool.nworkers ++;
+	}
+	pool.want = nthr-1;
+	if (pool.nworkers < pool.want) pool.want = pool.nworkers;
+	pool.active = pool.want;
+	pool.q = &q;
+	pool.round ++;
+	pthread_cond_broadcast (&pool.work);
+	pthread_mutex_unlock (&pool.lock);
+
+	mp_in_parallel = 1;
+	run_jobs (&q);
+	mp_in_parallel = 0;
+
+	pthread_mutex_lock (&pool.lock);
+	while (0 < pool.active)
+		pthread_cond_wait (&pool.done, &pool.lock);
+	pool.busy = 0;
+	pthread_mutex_unlock (&pool.lock);
+	pthread_spin_destroy (&q.lock);
+}
+
+void mp_parallel_for (int njobs, void (*fn) (void *arg, int job), void *arg)
+{
+	mp_parallel_for_n (mp_get_nthreads (), njobs, fn, arg);
+}
+
+/* =============================== END OF FILE =========================== */
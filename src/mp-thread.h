@@ -0,0 +1,66 @@
+/*
+ * mp-thread.h
+ *
+ * Minimal support for spreading independent work over several threads.
+ *
+ * Copyright (C) 2026 Linas Vepstas
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301  USA
+ */
+
+#ifndef __MP_THREAD_H__
+#define __MP_THREAD_H__
+
+#ifdef  __cplusplus
+extern "C" {
+#endif
+
+/**
+ * mp_set_nthreads -- number of threads to use for parallel loops.
+ * Zero or less restores the default, which is the number of
+ * online CPUs. One disables threading entirely.
+ */
+void mp_set_nthreads (int nthreads);
+int mp_get_nthreads (void);
+
+/**
+ * mp_parallel_for -- call fn (arg, job) for job = 0 .. njobs-1.
+ *
+ * The jobs are handed out, in order, to up to mp_get_nthreads()
+ * threads (including the calling thread), and this returns when all
+ * are done. The jobs must be independent of one another. Callers
+ * that want reproducible results should have each job write to its
+ * own slot, and then combine the slots in job order; the outcome
+ * is then independent of the number of threads. Calls made from
+ * within a job run serially, in the calling thread.
+ */
+void mp_parallel_for (int njobs, void (*fn) (void *arg, int job), void *arg);
+
+/**
+ * mp_parallel_for_n -- as above, but with at most nthreads threads.
+ * Zero or less means mp_get_nthreads().
+ *
+ * The threads are pooled, and live on between calls; their
+ * per-thread caches stay warm from one loop to the next.
+ */
+void mp_parallel_for_n (int nthreads, int njobs,
+                        void (*fn) (void *arg, int job), void *arg);
+
+#ifdef  __cplusplus
+};
+#endif
+
+#endif /* __MP_THREAD_H__ */
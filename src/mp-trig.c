@@ -777,21 +777,25 @@ void cpx_log_m1 (cpx_t lg, const cpx_t z, unsigned int prec)
 void cpx_log (cpx_t lg, const cpx_t z, unsigned int prec)
 {
 	mp_bitcnt_t bits = ((double) prec) * 3.322 + 50;
-	mpf_t r;
+	mpf_t r, theta;
 	mpf_init2 (r, bits);
+	mpf_init2 (theta, bits);
 
 	/* log (re^{itheta}) = log(r) +  itheta)
 	 * theta = arctan (y/x)
+	 * fp_arctan2() can't take atn == y, so lg == z needs a temp.
 	 */
 	cpx_mod_sq (r, z);
-	fp_arctan2 (lg[0].im, z[0].im, z[0].re, prec);
+	fp_arctan2 (theta, z[0].im, z[0].re, prec);
 	fp_log (lg[0].re, r, prec);
+	mpf_set (lg[0].im, theta);
 
 	/* divide by two; using mpf_div_2exp() is faster than mpf_div_ui() */
 	// mpf_div_ui (lg[0].re, lg[0].re, 2);
 	mpf_div_2exp (lg[0].re, lg[0].re, 1);
 
 	mpf_clear (r);
+	mpf_clear (theta);
 }
 
 /* ======================================================================= */
@@ -913,6 +917,34 @@ static void atan2_reduce (mpf_t atn, const mpf_t y, const mpf_t x, unsigned int
 
 void fp_arctan2 (mpf_t atn, const mpf_t y, const mpf_t x, unsigned int prec)
 {
+	/* atan2_reduce() compares x and y as doubles; scale them into
+	 * range, else huge or tiny values overflow to inf or zero. */
+	long ey, ex;
+	mpf_get_d_2exp (&ey, y);
+	mpf_get_d_2exp (&ex, x);
+	if (ex < ey) ex = ey;
+	if (512 < labs (ex))
+	{
+		mp_bitcnt_t bits = ((double) prec) * 3.322 + 50;
+		mpf_t sy, sx;
+		mpf_init2 (sy, bits);
+		mpf_init2 (sx, bits);
+		if (0 < ex)
+		{
+			mpf_div_2exp (sy, y, ex);
+			mpf_div_2exp (sx, x, ex);
+		}
+		else
+		{
+			mpf_mul_2exp (sy, y, -ex);
+			mpf_mul_2exp (sx, x, -ex);
+		}
+		fp_arctan2 (atn, sy, sx, prec);
+		mpf_clear (sy);
+		mpf_clear (sx);
+		return;
+	}
+
 	int sgn_x = mpf_sgn(x);
 	int sgn_y = mpf_sgn(y);
 
@@ -1181,52 +1213,92 @@ void cpx_ui_pow (cpx_t powc, unsigned int k, const cpx_t ess, int prec)
 	mpf_clear(pha);
 }
 
-// Caching  versions need a thread lock
-static pthread_spinlock_t cache_lock;
-__attribute__((constructor))
-	void cache_lock_init(void) { pthread_spin_init(&cache_lock, 0); }
+/* The caches below are keyed on the value of s (and q), and so are
+ * kept one per thread: threads working on different s would otherwise
+ * keep clearing each other's cache. */
+typedef struct
+{
+	cpx_cache powcache[2];
+	cpx_t cache_q[2];
+	cpx_t cache_s[2];
+	int precision;
+	int next;
+} pow_state;
+
+static void * pow_state_new (void)
+{
+	pow_state *st = (pow_state *) malloc (sizeof (pow_state));
+	int i;
+	for (i=0; i<2; i++)
+	{
+		cpx_one_d_cache_init (&st->powcache[i]);
+		cpx_init (st->cache_q[i]);
+		cpx_init (st->cache_s[i]);
+	}
+	st->precision = 0;
+	st->next = 0;
+	return st;
+}
+
+static void pow_state_free (void *p)
+{
+	pow_state *st = (pow_state *) p;
+	int i;
+	for (i=0; i<2; i++)
+	{
+		cpx_one_d_cache_free (&st->powcache[i]);
+		cpx_clear (st->cache_q[i]);
+		cpx_clear (st->cache_s[i]);
+	}
+	free (st);
+}
+
+/* Bump up the precision of the keys; clears the caches. */
+static void pow_state_prec (pow_state *st, int prec)
+{
+	int i;
+	if (prec <= st->precision) return;
+	st->precision = prec;
+	for (i=0; i<2; i++)
+	{
+		cpx_set_prec (st->cache_q[i], 3.322*prec+50);
+		cpx_set_prec (st->cache_s[i], 3.322*prec+50);
+		cpx_one_d_cache_clear (&st->powcache[i]);
+	}
+}
+
+DECLARE_THREAD_STATE (ui_pow_state, pow_state_new, pow_state_free);
 
 /**
  * cpx_ui_pow_cache -- return k^s for complex s, integer k.
  *
  * If s is held fixed, and k varied, then the values are cached,
- * allowing improved algorithm speeds.
+ * allowing improved algorithm speeds. Thread-safe; each thread
+ * has its own cache.
  */
 void cpx_ui_pow_cache (cpx_t powc, unsigned int k, const cpx_t ess, int prec)
 {
-	DECLARE_CPX_CACHE (powcache);
-	static cpx_t cache_s;
-	static int precision = 0;
+	pow_state *st = thread_state_get (&ui_pow_state);
+	cpx_cache *powcache = &st->powcache[0];
 
-	if (precision < prec)
-	{
-		pthread_spin_lock(&cache_lock);
-		if (!precision)
-		{
-			cpx_init (cache_s);
-		}
-
-		precision = prec;
-		cpx_set_prec (cache_s, 3.322*prec+50);
-		pthread_spin_unlock(&cache_lock);
-	}
+	pow_state_prec (st, prec);
 
 	// If value of s has changed, then clear the cache.
-	if (!cpx_eq (ess, cache_s, prec*3.322))
+	if (!cpx_eq (ess, st->cache_s[0], prec*3.322))
 	{
-		cpx_one_d_cache_clear (&powcache);
-		cpx_set (cache_s, ess);
+		cpx_one_d_cache_clear (powcache);
+		cpx_set (st->cache_s[0], ess);
 	}
 
-	if (prec <= cpx_one_d_cache_check (&powcache, k))
+	if (prec <= cpx_one_d_cache_check (powcache, k))
 	{
-		cpx_one_d_cache_fetch (&powcache, powc, k);
+		cpx_one_d_cache_fetch (powcache, powc, k);
 		return;
 	}
 
 	cpx_ui_pow (powc, k, ess, prec);
 
-	cpx_one_d_cache_store (&powcache, powc, k, prec);
+	cpx_one_d_cache_store (powcache, powc, k, prec);
 }
 
 /* ======================================================================= */
@@ -1259,13 +1331,47 @@ void cpx_harmonic(cpx_t hns, unsigned int n, const cpx_t ess, int prec)
 	cpx_clear(powc);
 }
 
+/* ======================================================================= */
+
+DECLARE_THREAD_STATE (fp_pow_state, pow_state_new, pow_state_free);
+DECLARE_THREAD_STATE (cpx_pow_state, pow_state_new, pow_state_free);
+
+/* Return the cache for (q,s), if there is one; else recycle the
+ * least-recently-used of the two. Only the real part of q is looked
+ * at when isreal is set. */
+static cpx_cache * pow_state_lookup (pow_state *st, int isreal,
+                                     const mpf_t qre, const mpf_t qim,
+                                     const cpx_t ess, int prec)
+{
+	int i;
+	for (i=0; i<2; i++)
+	{
+		if (mpf_eq(qre, st->cache_q[i]->re, prec*3.322) &&
+		    (isreal || mpf_eq(qim, st->cache_q[i]->im, prec*3.322)) &&
+		    cpx_eq(ess, st->cache_s[i], prec*3.322))
+		{
+			st->next = 1-i;
+			return &st->powcache[i];
+		}
+	}
+
+	i = st->next;
+	st->next = 1-i;
+	cpx_one_d_cache_clear (&st->powcache[i]);
+	cpx_one_d_cache_check (&st->powcache[i], 4);
+	mpf_set (st->cache_q[i]->re, qre);
+	if (!isreal) mpf_set (st->cache_q[i]->im, qim);
+	cpx_set (st->cache_s[i], ess);
+	return &st->powcache[i];
+}
+
 /* ======================================================================= */
 /**
  * fp_pow_rc-- return (k+q)^s for complex s, integer k, real q.
  *
  * If q and s is held fixed, and k varied, then the values are cached,
  * allowing improved algorithm speeds. Up to two distinct values
- * of q are cached.
+ * of q are cached, per thread.
  *
  * Overall, though, this thing is pretty slow, as it requires
  * a logarithm, an exp, sin and cos to be computed, each of which
@@ -1273,78 +1379,14 @@ void cpx_harmonic(cpx_t hns, unsigned int n, const cpx_t ess, int prec)
  */
 void fp_pow_rc (cpx_t powc, int k, const mpf_t q, const cpx_t ess, int prec)
 {
-	DECLARE_CPX_CACHE (powcache_one);
-	DECLARE_CPX_CACHE (powcache_two);
-	static mpf_t cache_q_one, cache_q_two;
-	static cpx_t cache_s_one, cache_s_two;
-	static int precision = 0;
-	static cpx_cache *next_cache;
-	static mpf_t *next_q;
-	static cpx_t *next_s;
-
-	if (precision < prec)
-	{
-		pthread_spin_lock(&cache_lock);
-		if (precision < prec)
-		{
-			if (!precision)
-			{
-				mpf_init (cache_q_one);
-				mpf_init (cache_q_two);
-				cpx_init (cache_s_one);
-				cpx_init (cache_s_two);
-				next_cache = &powcache_one;
-				next_q = &cache_q_one;
-				next_s = &cache_s_one;
-			}
-
-			precision = prec;
-			mpf_set_prec (cache_q_one, 3.322*prec+50);
-			mpf_set_prec (cache_q_two, 3.322*prec+50);
-			cpx_set_prec (cache_s_one, 3.322*prec+50);
-			cpx_set_prec (cache_s_two, 3.322*prec+50);
-			cpx_one_d_cache_clear (&powcache_one);
-			cpx_one_d_cache_clear (&powcache_two);
-		}
-		pthread_spin_unlock(&cache_lock);
-	}
-
-	cpx_cache *powcache = NULL;
-	if (mpf_eq(q, cache_q_one, prec*3.322) &&
-	    cpx_eq(ess, cache_s_one, prec*3.322))
-	{
-		powcache = &powcache_one;
-		if (prec <= cpx_one_d_cache_check (powcache, k))
-		{
-			cpx_one_d_cache_fetch (powcache, powc, k);
-			return;
-		}
-		next_cache = &powcache_two;
-		next_q = &cache_q_two;
-		next_s = &cache_s_two;
-	}
-
-	if (mpf_eq(q, cache_q_two, prec*3.322) &&
-	    cpx_eq(ess, cache_s_two, prec*3.322))
-	{
-		powcache = &powcache_two;
-		if (prec <= cpx_one_d_cache_check (powcache, k))
-		{
-			cpx_one_d_cache_fetch (powcache, powc, k);
-			return;
-		}
-		next_cache = &powcache_one;
-		next_q = &cache_q_one;
-		next_s = &cache_s_one;
-	}
+	pow_state *st = thread_state_get (&fp_pow_state);
+	pow_state_prec (st, prec);
 
-	if (NULL == powcache)
+	cpx_cache *powcache = pow_state_lookup (st, 1, q, q, ess, prec);
+	if (prec <= cpx_one_d_cache_check (powcache, k))
 	{
-		powcache = next_cache;
-		cpx_one_d_cache_clear (powcache);
-		cpx_one_d_cache_check (powcache, 4);
-		mpf_set(*next_q, q);
-		cpx_set(*next_s, ess);
+		cpx_one_d_cache_fetch (powcache, powc, k);
+		return;
 	}
 
 	mp_bitcnt_t bits = ((double) prec) * 3.322 + 50;
@@ -1359,80 +1401,16 @@ void fp_pow_rc (cpx_t powc, int k, const mpf_t q, const cpx_t ess, int prec)
 
 void cpx_pow_rc (cpx_t powc, int k, const cpx_t q, const cpx_t ess, int prec)
 {
-	DECLARE_CPX_CACHE (powcache_one);
-	DECLARE_CPX_CACHE (powcache_two);
-	static cpx_t cache_q_one, cache_q_two;
-	static cpx_t cache_s_one, cache_s_two;
-	static int precision = 0;
-	static cpx_cache *next_cache;
-	static cpx_t *next_q, *next_s;
-
-	if (precision < prec)
-	{
-		pthread_spin_lock(&cache_lock);
-		if (precision < prec)
-		{
-			if (!precision)
-			{
-				cpx_init (cache_q_one);
-				cpx_init (cache_q_two);
-				cpx_init (cache_s_one);
-				cpx_init (cache_s_two);
-				next_cache = &powcache_one;
-				next_q = &cache_q_one;
-				next_s = &cache_s_one;
-			}
-
-			precision = prec;
-			cpx_set_prec (cache_q_one, 3.322*prec+50);
-			cpx_set_prec (cache_q_two, 3.322*prec+50);
-			cpx_set_prec (cache_s_one, 3.322*prec+50);
-			cpx_set_prec (cache_s_two, 3.322*prec+50);
-			cpx_one_d_cache_clear (&powcache_one);
-			cpx_one_d_cache_clear (&powcache_two);
-		}
-		pthread_spin_unlock(&cache_lock);
-	}
-
-	cpx_cache *powcache = NULL;
-	if (cpx_eq(q, cache_q_one, prec*3.322) &&
-	    cpx_eq(ess, cache_s_one, prec*3.322))
-	{
-		powcache = &powcache_one;
-		if (prec <= cpx_one_d_cache_check (powcache, k))
-		{
-			cpx_one_d_cache_fetch (powcache, powc, k);
-			return;
-		}
-		next_cache = &powcache_two;
-		next_q = &cache_q_two;
-		next_s = &cache_s_two;
-	}
-
-	if (cpx_eq(q, cache_q_two, prec*3.322) &&
-	    cpx_eq(ess, cache_s_two, prec*3.322))
-	{
-		powcache = &powcache_two;
-		if (prec <= cpx_one_d_cache_check (powcache, k))
-		{
-			cpx_one_d_cache_fetch (powcache, powc, k);
-			return;
-		}
-		next_cache = &powcache_one;
-		next_q = &cache_q_one;
-		next_s = &cache_s_one;
-	}
+	pow_state *st = thread_state_get (&cpx_pow_state);
+	pow_state_prec (st, prec);
 
-	if (NULL == powcache)
+	cpx_cache *powcache = pow_state_lookup (st, 0, q[0].re, q[0].im, ess, prec);
+	if (prec <= cpx_one_d_cache_check (powcache, k))
 	{
-		powcache = next_cache;
-		cpx_one_d_cache_clear (powcache);
-		cpx_one_d_cache_check (powcache, 4);
-		cpx_set(*next_q, q);
-		cpx_set(*next_s, ess);
+		cpx_one_d_cache_fetch (powcache, powc, k);
+		return;
 	}
 
-
 	mp_bitcnt_t bits = ((double) prec) * 3.322 + 50;
 	cpx_t kq;
 	cpx_init2 (kq, bits);
@@ -690,6 +690,112 @@ int cpx_find_zero(cpx_t result,
 		ndigits, nprec, func);
 }
 
+/* =============================================== */
+/**
+ * cpx_find_zero_newton_r.
+ * Newton's method, for functions that can supply their own derivative,
+ * e.g. cpx_polylog_d() or cpx_hurwitz_zeta_d(). See mp-zerofind.h
+ *
+ * Each step is damped, halving it until |f| actually decreases, so
+ * that a poor initial guess wanders, rather than shooting off to
+ * infinity.
+ */
+int cpx_find_zero_newton_r(cpx_t result,
+              void (*func)(cpx_t f, cpx_t fp, cpx_t z, int nprec, void*),
+              cpx_t initial_z,
+              int ndigits, int nprec, void* args)
+{
+	mp_bitcnt_t bits = ((double) nprec) * 3.322 + 50;
+
+	int rc = 1;
+	mpf_t zero, epsi, f0, f1;
+	mpf_init2 (zero, bits);
+	mpf_init2 (f0, bits);
+	mpf_init2 (f1, bits);
+
+	/* Compute the tolerance */
+	mpf_init (epsi);
+	mpf_set_ui(epsi, 1);
+	mpf_div_2exp(epsi, epsi, (int)(3.322*ndigits));
+
+	cpx_t s0, s1, y0, y1, dy, step;
+	cpx_init2 (s0, bits);
+	cpx_init2 (s1, bits);
+	cpx_init2 (y0, bits);
+	cpx_init2 (y1, bits);
+	cpx_init2 (dy, bits);
+	cpx_init2 (step, bits);
+
+	cpx_set (s0, initial_z);
+	func (y0, dy, s0, nprec, args);
+	cpx_abs (f0, y0);
+
+	/* Iterate */
+	int i, j;
+	for (i=0; i<100; i++)
+	{
+		cpx_abs (zero, dy);
+		if (0 == mpf_sgn (zero)) break;
+
+		cpx_div (step, y0, dy);
+		cpx_abs (zero, step);
+		if (0 > mpf_cmp(zero, epsi))
+		{
+			/* Converged */
+			cpx_sub (s0, s0, step);
+			rc = 0;
+			break;
+		}
+
+		/* Damped step: halve it until it's an improvement. */
+		for (j=0; j<20; j++)
+		{
+			cpx_sub (s1, s0, step);
+			func (y1, dy, s1, nprec, args);
+			cpx_abs (f1, y1);
+			if (0 > mpf_cmp(f1, f0)) break;
+			cpx_times_d (step, step, 0.5);
+		}
+		if (20 == j) break;
+
+		cpx_set (s0, s1);
+		cpx_set (y0, y1);
+		mpf_set (f0, f1);
+	}
+
+	/* The returned value */
+	cpx_set (result, s0);
+
+	cpx_clear (s0);
+	cpx_clear (s1);
+	cpx_clear (y0);
+	cpx_clear (y1);
+	cpx_clear (dy);
+	cpx_clear (step);
+
+	mpf_clear (zero);
+	mpf_clear (epsi);
+	mpf_clear (f0);
+	mpf_clear (f1);
+
+	return rc;
+}
+
+static void wrap_newton(cpx_t f, cpx_t fp, cpx_t z, int nprec, void* func)
+{
+	void (*fun)(cpx_t, cpx_t, cpx_t, int) = func;
+	fun(f, fp, z, nprec);
+}
+
+int cpx_find_zero_newton(cpx_t result,
+              void (*func)(cpx_t f, cpx_t fp, cpx_t z, int nprec),
+              cpx_t initial_z,
+              int ndigits, int nprec)
+{
+	return cpx_find_zero_newton_r(result, wrap_newton, initial_z,
+		ndigits, nprec, func);
+}
+
 /* =============================================== */
 
 // #define TEST
@@ -71,6 +71,39 @@ int cpx_find_zero_r(cpx_t result,
               cpx_t e1, cpx_t e2,
               int ndigits, int nprec, void* args);
 
+/* =============================================== */
+/**
+ * cpx_find_zero_newton.
+ * Numerically locate the zero of a complex-valued function, by
+ * Newton's method.
+ *
+ * @func function whose zeros are to be found.
+ *       func takes z as input, returns f and its derivative fp = df/dz
+ *       as output. 'nprec' is as for cpx_find_zero() above.
+ * @initial_z initial suggestion for the location of the zero.
+ * @ndigits number of decimal digits of accuracy to which the zero
+ *       should be searched for.
+ * @nprec number of digits of decimal precision to which intermediate
+ *       terms will be maintained.
+ *
+ * @returns 0 if result is valid, else an error code.
+ *
+ * Converges quadratically to a simple zero, and so needs far fewer
+ * calls to 'func' than cpx_find_zero(), when the derivative comes
+ * cheaply, as from cpx_polylog_d() or cpx_hurwitz_zeta_d(). Steps
+ * that fail to reduce |f| are halved.
+ */
+int cpx_find_zero_newton(cpx_t result,
+              void (*func)(cpx_t f, cpx_t fp, cpx_t z, int nprec),
+              cpx_t initial_z,
+              int ndigits, int nprec);
+
+/** Reentrant version of above. Passes user-defined args to function. */
+int cpx_find_zero_newton_r(cpx_t result,
+              void (*func)(cpx_t f, cpx_t fp, cpx_t z, int nprec, void*),
+              cpx_t initial_z,
+              int ndigits, int nprec, void* args);
+
 #ifdef  __cplusplus
 };
 #endif
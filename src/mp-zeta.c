@@ -22,6 +22,7 @@
  * 02110-1301  USA
  */
 
+#include <pthread.h>
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -32,7 +33,10 @@
 #include "mp-cache.h"
 #include "mp-complex.h"
 #include "mp-consts.h"
+#include "mp-fft.h"
+#include "mp-gamma.h"
 #include "mp-misc.h"
+#include "mp-thread.h"
 #include "mp-trig.h"
 #include "mp-zeta.h"
 
@@ -97,11 +101,67 @@ void fp_hasse_zeta (mpf_t zeta, unsigned int s, int prec)
 }
 
 /* ======================================================================= */
-/* Bernoulli number as a rational */
+/**
+ * q_bernoulli_fill() -- place B_2, B_4, ... B_{2hn} into the cache.
+ *
+ * Uses the tangent numbers T_k, with B_{2k} = (-1)^{k-1} 2k T_k /
+ * 4^k (4^k-1). The T_k are integers, and are obtained all at once
+ * from the Brent-Harvey recurrence, which needs only multiplies of
+ * bignums by small integers. This replaces the classic recurrence,
+ * which is O(n^2) rational operations, with exploding denominators.
+ */
+static void q_bernoulli_fill (q_cache *cache, int hn)
+{
+	int j, k;
+	mpz_t *tang = (mpz_t *) malloc ((hn+1) * sizeof (mpz_t));
+	for (k=0; k<=hn; k++) mpz_init (tang[k]);
+
+	mpz_set_ui (tang[1], 1);
+	for (k=2; k<=hn; k++) mpz_mul_ui (tang[k], tang[k-1], k-1);
+	for (k=2; k<=hn; k++)
+	{
+		for (j=k; j<=hn; j++)
+		{
+			mpz_mul_ui (tang[j], tang[j], j-k+2);
+			mpz_addmul_ui (tang[j], tang[j-1], j-k);
+		}
+	}
+
+	mpz_t den;
+	mpz_init (den);
+	mpq_t bern;
+	mpq_init (bern);
+
+	q_one_d_cache_check (cache, hn);
+	for (k=1; k<=hn; k++)
+	{
+		/* den = 4^k (4^k-1) / 2k */
+		mpz_set_ui (den, 1);
+		mpz_mul_2exp (den, den, 2*k);
+		mpz_sub_ui (den, den, 1);
+		mpz_mul_2exp (den, den, 2*k-1);
+
+		mpz_mul_ui (mpq_numref (bern), tang[k], k);
+		if (0 == k%2) mpz_neg (mpq_numref (bern), mpq_numref (bern));
+		mpz_set (mpq_denref (bern), den);
+		mpq_canonicalize (bern);
+		q_one_d_cache_store (cache, bern, k);
+	}
+
+	for (k=0; k<=hn; k++) mpz_clear (tang[k]);
+	free (tang);
+	mpz_clear (den);
+	mpq_clear (bern);
+}
 
+/* Bernoulli number as a rational */
 void q_bernoulli (mpq_t bern, int n)
 {
 	DECLARE_Q_CACHE (cache);
+	static int nfilled = 0;
+	/* The q cache has no lock of its own, and the fill can take a
+	 * while; so a mutex, rather than a spinlock. */
+	static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
 
 	if (0>n) return;
 	if (0==n) {	mpq_set_ui (bern, 1,1); return; }
@@ -111,44 +171,19 @@ void q_bernoulli (mpq_t bern, int n)
 	if (n%2) { mpq_set_ui (bern, 0, 1);  return; }
 
 	int hn = n/2;
-
-	int hit = q_one_d_cache_check (&cache, hn);
-	if (hit)
-	{
-		q_one_d_cache_fetch (&cache, bern, hn);
-		return;
-	}
-
-	/* Not found in cache, will have to compute */
-	mpz_t binom;
-	mpz_init (binom);
-
-	mpq_t term, tmp;
-	mpq_init (term);
-	mpq_init (tmp);
-
-	mpq_set_si (bern, 1-n, 2);
-
-	int i;
-	for (i=1; i<hn; i++)
+	pthread_mutex_lock (&lock);
+	if (nfilled < hn)
 	{
-		int k = 2*i;
-		i_binomial (binom, n+1, k);
-
-		mpq_set_z (tmp, binom);
-		q_bernoulli (term, k);
-		mpq_mul (term, term, tmp);
-		mpq_add (bern, bern, term);
+		/* Callers usually walk up through n, one at a time;
+		 * so fill generously, to avoid doing this over and over. */
+		int nfill = 2*nfilled;
+		if (nfill < hn) nfill = hn;
+		if (nfill < 16) nfill = 16;
+		q_bernoulli_fill (&cache, nfill);
+		nfilled = nfill;
 	}
-
-	mpq_set_si (tmp, -1, n+1);
-	mpq_mul (bern, bern, tmp);
-
-	mpz_clear (binom);
-	mpq_clear (term);
-	mpq_clear (tmp);
-
-	q_one_d_cache_store (&cache, bern, hn);
+	q_one_d_cache_fetch (&cache, bern, hn);
+	pthread_mutex_unlock (&lock);
 }
 
 /* ======================================================================= */
@@ -597,178 +632,332 @@ int fp_zeta_odd_plouffe (mpf_t zeta, unsigned int n, unsigned int prec)
 
 /* ======================================================================= */
 /* Brute force summation of zeta values */
+/*
+ * The direct sum over k < N is followed by the Euler-Maclaurin tail
+ *    sum_{k>=N} k^{-s} = N^{1-s}/(s-1) + N^{-s}/2
+ *        + sum_{j=1}^J B_{2j}/(2j)! s(s+1)...(s+2j-2) N^{-s-2j+1}
+ * The tail terms shrink roughly as ((s+2j)/2pi N)^2, and so a handful
+ * of them replace a great many direct terms.
+ */
 
-void fp_zeta_brute (mpf_t zeta, unsigned int s, int prec)
+/* Cost of one tail term, relative to a multiply; a direct term
+ * k^{-s} costs about log2(s)+2 multiplies. */
+#define ZETA_TAIL_COST 6.0
+
+/* Direct terms per thread job */
+#define ZETA_BRUTE_CHUNK 256
+
+/**
+ * zeta_brute_plan() -- pick the number of direct terms N, and of
+ * tail terms J, for the cheapest brute-force sum to prec digits.
+ * Returns the estimated cost, in multiplies.
+ */
+static double zeta_brute_plan (unsigned int s, int prec,
+                               unsigned int *nterms, int *ntail)
 {
-	unsigned long int us = s;
+	double best = HUGE_VAL;
 
-	/* Set up cache of what we've computed so far */
-	static int cache_size = 0;
-	static mpf_t *zeta_cache = NULL;
-	static int *zprec= NULL;
-	static unsigned int *last_term= NULL;
+	/* A few guard digits, so as to be as good as Borwein */
+	double lneps = -(prec+3) * M_LN10;
+	double cdir = log2 (s) + 2.0;
+	double ltwopi = log (2.0*M_PI);
 
-	if (s >= cache_size)
+	*nterms = 0;
+	*ntail = 0;
+	unsigned int n;
+	for (n=2; n<1000000000; n += (n<16) ? 1 : n/8)
 	{
-		int newsize = (3*s)/2+20;
-		zeta_cache = (mpf_t *) realloc (zeta_cache, newsize*sizeof (mpf_t));
-		zprec = (int *) realloc (zprec, newsize*sizeof (int));
-		last_term = (unsigned int *) realloc (last_term, newsize*sizeof (unsigned int));
+		/* Bigger n can only cost more */
+		if (best < n*cdir) break;
+
+		/* Log of the first omitted tail term, j+1, which is about
+		 * 2 (s)_{2j+1} / (2pi)^{2j+2} N^{-s-2j-1}. */
+		double lnn = log (n);
+		double err = M_LN2 + log (s) - 2.0*ltwopi - (s+1)*lnn;
+
+		/* The steps only get smaller; skip hopeless n quickly. */
+		double step0 = log ((s+1.0) * (s+2.0)) - 2.0*ltwopi - 2.0*lnn;
+		if (0.0 <= step0 && lneps < err) continue;
+		if (lneps < err &&
+		    best <= n*cdir + ZETA_TAIL_COST * (err - lneps) / -step0)
+			continue;
+
+		int j = 0;
+		while (lneps < err)
+		{
+			double step = log ((s+2*j+1.0) * (s+2*j+2.0)) - 2.0*ltwopi - 2.0*lnn;
+			if (0.0 <= step) break;
+			err += step;
+			j++;
+		}
+		if (lneps < err) continue;
 
-		int i;
-		for (i=cache_size; i<newsize; i++)
+		double cost = n*cdir + j*ZETA_TAIL_COST;
+		if (cost < best)
 		{
-			zprec[i] = 0;
+			best = cost;
+			*nterms = n;
+			*ntail = j;
 		}
-		cache_size = newsize;
 	}
+	return best;
+}
 
-	if (s<2) return;
+/**
+ * zeta_brute_tail() -- the Euler-Maclaurin tail, sum_{k>=n} k^{-s},
+ * using ntail correction terms.
+ */
+static void zeta_brute_tail (mpf_t tail, unsigned int s,
+                             unsigned int n, int ntail, mp_bitcnt_t bits)
+{
+	mpf_t pw, term, poch, fact;
+	mpf_init2 (pw, bits);
+	mpf_init2 (term, bits);
+	mpf_init2 (poch, bits);
+	mpf_init2 (fact, bits);
+	mpq_t bern;
+	mpq_init (bern);
 
-	/* Lets see if we can get lucky with the cache. */
-	if (prec < zprec[s])
+	/* pw = n^{-s} */
+	mpf_set_ui (pw, 1);
+	mpf_div_ui (pw, pw, n);
+	mpf_pow_ui (pw, pw, s);
+
+	/* n^{1-s}/(s-1) + n^{-s}/2 */
+	mpf_mul_ui (tail, pw, n);
+	mpf_div_ui (tail, tail, s-1);
+	mpf_div_2exp (term, pw, 1);
+	mpf_add (tail, tail, term);
+
+	mpf_set_ui (poch, s);
+	mpf_set_ui (fact, 2);
+	mpf_div_ui (pw, pw, n);
+
+	int j;
+	for (j=1; j<=ntail; j++)
 	{
-		mpf_set (zeta, zeta_cache[s]);
-		return;
+		q_bernoulli (bern, 2*j);
+		mpf_set_q (term, bern);
+		mpf_mul (term, term, poch);
+		mpf_mul (term, term, pw);
+		mpf_div (term, term, fact);
+		mpf_add (tail, tail, term);
+
+		mpf_mul_ui (poch, poch, s+2*j-1);
+		mpf_mul_ui (poch, poch, s+2*j);
+		mpf_mul_ui (fact, fact, (2*j+1)*(2*j+2));
+		mpf_div_ui (pw, pw, n);
+		mpf_div_ui (pw, pw, n);
 	}
 
-	/* Initialize the cache line, if needed */
-	if (0 == zprec[s])
+	mpf_clear (pw);
+	mpf_clear (term);
+	mpf_clear (poch);
+	mpf_clear (fact);
+	mpq_clear (bern);
+}
+
+typedef struct
+{
+	unsigned int s;
+	unsigned int nterms;
+	mpf_t *part;
+} zeta_brute_job;
+
+/* Partial sum of k^{-s} over one chunk of k */
+static void zeta_brute_chunk (void *arg, int job)
+{
+	zeta_brute_job *zb = (zeta_brute_job *) arg;
+	mp_bitcnt_t bits = mpf_get_prec (zb->part[job]);
+	unsigned int k = 2 + job * ZETA_BRUTE_CHUNK;
+	unsigned int kend = k + ZETA_BRUTE_CHUNK;
+	if (zb->nterms < kend) kend = zb->nterms;
+
+	mpf_t term;
+	mpf_init2 (term, bits);
+	mpf_set_ui (zb->part[job], 0);
+	for (; k<kend; k++)
 	{
-		mpf_init (zeta_cache[s]);
-		mpf_set_ui (zeta_cache[s], 1);
-		last_term[s] = 2;
-		zprec[s] = prec;
+		mpf_set_ui (term, 1);
+		mpf_div_ui (term, term, k);
+		mpf_pow_ui (term, term, zb->s);
+		mpf_add (zb->part[job], zb->part[job], term);
 	}
+	mpf_clear (term);
+}
 
-	/* If we are here, well have to compute values using brute force */
-	mpf_t acc;
-	mpf_t term;
-	mpf_t en;
-	mpf_t inv;
+/**
+ * fp_zeta_brute() -- zeta(s) from the direct sum, plus the
+ * Euler-Maclaurin tail. Long direct sums are split into chunks that
+ * are done in parallel; the partial sums are added up in chunk
+ * order, and so the result does not depend on the thread count.
+ */
+void fp_zeta_brute (mpf_t zeta, unsigned int s, int prec)
+{
+	if (s<2) return;
 
-	mpf_init (acc);
-	mpf_init (term);
-	mpf_init (en);
-	mpf_init (inv);
+	unsigned int nterms;
+	int ntail;
+	zeta_brute_plan (s, prec, &nterms, &ntail);
 
-	mpf_set_ui (zeta, 1);
+	mp_bitcnt_t bits = mpf_get_prec (zeta);
+	int njobs = (nterms - 2 + ZETA_BRUTE_CHUNK - 1) / ZETA_BRUTE_CHUNK;
 
-	/* Compute number of terms to be carried out.
-	 * If we want error t be less than epsilon,
-	 * then must sum to epsilon=N^{1-s} or
-	 * N = exp (ln(espilon) / (1-s))
-	 * But epsilon = 10^{-prec} so
-	 * Nmax = 10^{prec/(s-1)}
-	 *
-	 * Note that this provides a precise upper bound
-	 * on the error term, for an s>7.
-	 */
-	double fprec = prec;
-	fprec /= (double) (s-1);
-	double fnmax = pow (10.0, fprec);
-	if (1.0e9 < fnmax)
-	{
-		fprintf (stderr, "Sorry bucko, can't do it, you asked for zeta(%d) in %g digits\n", s, fnmax);
-		return;
-	}
-	int nmax = (int) (fnmax+3.0); // Add 3 just to be safe
-	// printf ("zeta(%d) to precision %d will require %d terms\n", s, prec, nmax);
+	zeta_brute_job zb;
+	zb.s = s;
+	zb.nterms = nterms;
+	zb.part = (mpf_t *) malloc (njobs * sizeof (mpf_t));
 
-	/* Start computations where we last left off. */
-	mpf_set (zeta, zeta_cache[s]);
-	int nstart = last_term[s];
+	int j;
+	for (j=0; j<njobs; j++) mpf_init2 (zb.part[j], bits);
+	mp_parallel_for (njobs, zeta_brute_chunk, &zb);
 
-	int n;
-	for (n=nstart; n< nmax; n++)
+	mpf_t tail;
+	mpf_init2 (tail, bits);
+	zeta_brute_tail (tail, s, nterms, ntail, bits);
+
+	mpf_set_ui (zeta, 1);
+	for (j=0; j<njobs; j++)
 	{
-		mpf_set_ui (en, n);
-		mpf_ui_div (inv, 1, en);  /* inv = 1/n */
-		mpf_pow_ui (term, inv, us); /* term = 1/n^s */
-		mpf_add (acc, zeta, term);
-		mpf_set (zeta, acc);
+		mpf_add (zeta, zeta, zb.part[j]);
+		mpf_clear (zb.part[j]);
 	}
+	mpf_add (zeta, zeta, tail);
 
-	/* cache the results */
-	mpf_set (zeta_cache[s], zeta);
-	last_term[s] = nmax;
-
-	mpf_clear (acc);
-	mpf_clear (term);
-	mpf_clear (en);
-	mpf_clear (inv);
+	free (zb.part);
+	mpf_clear (tail);
 }
 
 /* ======================================================================= */
 /**
- * fp_borwein_tchebysheff() -- return the d_k from the Borwein 1995 paper
+ * borwein_horner_step() -- rescale one step of the Borwein sum.
+ *
+ * The Borwein 1995 paper, "An Efficient Algorithm for Computing
+ * the Riemann Zeta Function", writes
+ *    eta(s) = -1/d_n sum_{k=0}^{n-1} (-1)^k (d_k - d_n) (k+1)^{-s}
+ * with d_k = sum_{i=0}^k t_i and t_i = n (n+i-1)! 4^i / ((n-i)! (2i)!)
+ * the (integer) Tchebysheff coefficients.  Summing by parts,
+ *    sum_k (-1)^k (d_k - d_n) p_k = - sum_{i=1}^n t_i S_{i-1}
+ * where S_j = sum_{k=0}^j (-1)^k p_k are the partial sums.  The
+ * ratio t_i/t_{i-1} = 2(n+i-1)(n-i+1) / (i(2i-1)) is a ratio of
+ * small integers, and so the sum is evaluated Horner-style:
+ *    H_i = S_{i-1} + H_{i-1} t_{i-1}/t_i
+ * so that eta(s) = t_n H_n / d_n, with t_n = 2^{2n-1} and
+ * d_n = T_n(3), the Tchebysheff polynomial, an exact integer.
  *
- * "An Efficient Algorithm for Computing ... etc.
+ * Both H and S are held as mpz, in fixed point with a common
+ * power-of-two scale; this routine multiplies h by t_{i-1}/t_i.
+ * Thus, the inner loop is free of both full-width multiplies and
+ * of floating-point normalization, and the result is converted to
+ * mpf only once, at the very end.
  */
+static inline void borwein_horner_step (mpz_t h, int n, int i)
+{
+	mpz_mul_ui (h, h, ((unsigned long) i) * (2*i-1));
+	mpz_tdiv_q_ui (h, h, ((unsigned long) 2*(n+i-1)) * (n-i+1));
+}
 
-static void fp_borwein_tchebysheff (mpf_t d_k, int n, int k, unsigned int prec)
+/**
+ * i_tchebysheff_three() -- return T_n(3), exactly.
+ *
+ * Uses the doubling formulas T_{2m} = 2T_m^2 - 1 and
+ * T_{2m+1} = 2T_m T_{m+1} - 3 on the pair (T_m, T_{m+1}).
+ */
+static void i_tchebysheff_three (mpz_t d_n, int n)
 {
-	DECLARE_FP_CACHE (cache);
+	mpz_t a, b, ab;
+	mpz_init_set_ui (a, 1);
+	mpz_init_set_ui (b, 3);
+	mpz_init (ab);
 
-	/* cache the likeliest case: same value of n every time. */
-	static int ncache = 0;
-	if (n != ncache)
-	{
-		fp_one_d_cache_clear(&cache);
-		ncache = n;
-	}
-	if ((0 == k) || (0 == n))
+	int bit;
+	for (bit = 8*sizeof(int)-2; 0 <= bit; bit--)
 	{
-		mpf_set_ui (d_k, 1);
-		return;
-	}
-	int cision = fp_one_d_cache_check (&cache, k);
-	if (prec <= cision)
-	{
-		fp_one_d_cache_fetch (&cache, d_k, k);
-		return;
+		mpz_mul (ab, a, b);
+		mpz_mul_2exp (ab, ab, 1);
+		mpz_sub_ui (ab, ab, 3);
+		if ((n >> bit) & 1)
+		{
+			mpz_mul (b, b, b);
+			mpz_mul_2exp (b, b, 1);
+			mpz_sub_ui (b, b, 1);
+			mpz_swap (a, ab);
+		}
+		else
+		{
+			mpz_mul (a, a, a);
+			mpz_mul_2exp (a, a, 1);
+			mpz_sub_ui (a, a, 1);
+			mpz_swap (b, ab);
+		}
 	}
+	mpz_set (d_n, a);
 
-	mpz_t ifact;
-	mpz_init (ifact);
+	mpz_clear (a);
+	mpz_clear (b);
+	mpz_clear (ab);
+}
 
-	mpf_t term, fact, four;
-	mpf_init (term);
-	mpf_init (fact);
-	mpf_init (four);
+/**
+ * i_borwein_d_n() -- return d_n = T_n(3), exactly.
+ *
+ * The number of terms n depends on both the precision and on the
+ * imaginary part of s, so that interleaved calls flip between several
+ * values of n. The last few d_n are kept, shared between threads.
+ */
+#define BORWEIN_D_N_SLOTS 8
+static struct {
+	int n;
+	mpz_t d_n;
+} borwein_d_n_cache[BORWEIN_D_N_SLOTS];
+static int borwein_d_n_next = 0;
+static pthread_spinlock_t borwein_d_n_lock;
 
-	mpf_set_ui (d_k, 0);
-	mpf_set_ui (four, 1);
-	int i;
+__attribute__((constructor)) static void borwein_d_n_ctor (void)
+{
+	pthread_spin_init (&borwein_d_n_lock, PTHREAD_PROCESS_PRIVATE);
+}
 
-	/* prime the cache */
-	fp_one_d_cache_check (&cache, n);
-	for (i=0; i<=n; i++)
+static void i_borwein_d_n (mpz_t d_n, int n)
+{
+	int j;
+	pthread_spin_lock (&borwein_d_n_lock);
+	for (j=0; j<BORWEIN_D_N_SLOTS; j++)
 	{
-		i_factorial (ifact, n+i-1);
-		mpf_set_z (term, ifact);
-		i_factorial (ifact, n-i);
-		mpf_set_z (fact, ifact);
-		mpf_div (term, term, fact);
-		i_factorial (ifact, 2*i);
-		mpf_set_z (fact, ifact);
-		mpf_div (term, term, fact);
-		mpf_mul (term, term, four);
-		mpf_mul_ui(term, term, n);
-
-		mpf_add (d_k, d_k, term);
-
-		fp_one_d_cache_store (&cache, d_k, i, prec);
-
-		mpf_mul_ui (four, four, 4);
+		if (n != borwein_d_n_cache[j].n) continue;
+		mpz_set (d_n, borwein_d_n_cache[j].d_n);
+		pthread_spin_unlock (&borwein_d_n_lock);
+		return;
 	}
+	pthread_spin_unlock (&borwein_d_n_lock);
+
+	/* Compute outside of the lock; another thread racing on the same
+	 * n just stores a duplicate, which is harmless. */
+	i_tchebysheff_three (d_n, n);
+
+	pthread_spin_lock (&borwein_d_n_lock);
+	j = borwein_d_n_next;
+	borwein_d_n_next = (j+1) % BORWEIN_D_N_SLOTS;
+	if (0 == borwein_d_n_cache[j].n) mpz_init (borwein_d_n_cache[j].d_n);
+	mpz_set (borwein_d_n_cache[j].d_n, d_n);
+	borwein_d_n_cache[j].n = n;
+	pthread_spin_unlock (&borwein_d_n_lock);
+}
 
-	mpf_clear (fact);
-	mpf_clear (term);
-	mpf_clear (four);
-	mpz_clear (ifact);
-
-	fp_one_d_cache_fetch (&cache, d_k, k);
+/**
+ * borwein_eta_fixed() -- eta = t_n h / d_n, h in fixed point.
+ */
+static void borwein_eta_fixed (mpf_t eta, const mpz_t h, const mpz_t d_n,
+                               int n, unsigned long fbits)
+{
+	mpf_t d;
+	mpf_init (d);
+	mpf_set_z (d, d_n);
+	mpf_set_z (eta, h);
+	mpf_div (eta, eta, d);
+	mpf_mul_2exp (eta, eta, 2*n-1);
+	mpf_div_2exp (eta, eta, fbits);
+	mpf_clear (d);
 }
 
 void fp_borwein_zeta (mpf_t zeta, unsigned int s, int prec)
@@ -779,40 +968,47 @@ void fp_borwein_zeta (mpf_t zeta, unsigned int s, int prec)
 	nterms *= 0.567296329;
 	int n = (int) (nterms+1.0);
 
-	mpz_t ip;
+	/* Fixed-point scale, in bits */
+	unsigned long fbits = mpf_get_prec (zeta) + 64;
+
+	mpz_t ip, one, po, sum, h, d;
 	mpz_init (ip);
+	mpz_init (one);
+	mpz_init (po);
+	mpz_init (sum);
+	mpz_init (h);
+	mpz_init (d);
 
-	mpf_t d_n, po, term, twon;
-	mpf_init (d_n);
-	mpf_init (po);
+	mpf_t term, twon;
 	mpf_init (term);
 	mpf_init (twon);
 
-	fp_borwein_tchebysheff (d_n, n, n, prec);
+	mpz_set_ui (one, 1);
+	mpz_mul_2exp (one, one, fbits);
 
-	mpf_set_ui (zeta, 0);
-	int k;
-	for (k=0; k<n; k++)
+	mpz_set_ui (sum, 0);
+	mpz_set_ui (h, 0);
+	int i;
+	for (i=1; i<=n; i++)
 	{
-		fp_borwein_tchebysheff (term, n, k, prec);
-		mpf_sub (term, term, d_n);
+		/* po = 1/i^s in fixed point */
+		mpz_ui_pow_ui (ip, i, s);
+		mpz_tdiv_q (po, one, ip);
 
-		// i_pow (ip, k+1, s);
-		mpz_ui_pow_ui (ip, k+1, s);
-		mpf_set_z (po, ip);
-		mpf_div (term, term, po);
-
-		if (k%2)
+		if (i%2)
 		{
-			mpf_sub(zeta, zeta, term);
+			mpz_add (sum, sum, po);
 		}
 		else
 		{
-			mpf_add(zeta, zeta, term);
+			mpz_sub (sum, sum, po);
 		}
+
+		borwein_horner_step (h, n, i);
+		mpz_add (h, h, sum);
 	}
-	mpf_div (zeta, zeta, d_n);
-	mpf_neg (zeta, zeta);
+	i_borwein_d_n (d, n);
+	borwein_eta_fixed (zeta, h, d, n, fbits);
 
 	mpf_set_ui (twon, 1);
 	mpf_div_2exp (twon, twon, s-1);
@@ -823,135 +1019,1006 @@ void fp_borwein_zeta (mpf_t zeta, unsigned int s, int prec)
 	mpf_div (zeta, zeta, term);
 
 	mpz_clear (ip);
+	mpz_clear (one);
+	mpz_clear (po);
+	mpz_clear (sum);
+	mpz_clear (h);
+	mpz_clear (d);
 	mpf_clear (twon);
 	mpf_clear (term);
-	mpf_clear (po);
-	mpf_clear (d_n);
 }
 
-static inline int bor_zeta_terms_est (const cpx_t s, int prec)
-{
-	double nterms = 0.69 + 2.302585093 * prec;
+/* ======================================================================= */
+/*
+ * Riemann-Siegel formula.
+ *
+ * On the critical line s = 1/2+it, one has zeta(s) = exp(-i theta(t)) Z(t)
+ * with Z(t) real, and theta(t) the Riemann-Siegel theta function.
+ * The Riemann-Siegel formula gives
+ *
+ *    Z(t) = 2 sum_{n=1}^N n^{-1/2} cos(theta(t) - t log n)
+ *           + (-1)^{N-1} tau^{-1/4} sum_{k=0}^4 C_k(p) tau^{-k/2}
+ *
+ * where tau = t/2pi, N = floor(sqrt(tau)) and p = sqrt(tau) - N. The
+ * C_k are Gabcke's correction terms, linear combinations of the
+ * derivatives of Psi(p) = cos(2pi(p^2-p-1/16)) / cos(2pi p).
+ *
+ * The sum has only O(sqrt(t)) terms, whereas the Borwein algorithm
+ * needs O(t) terms, and O(t) digits of working precision to overcome
+ * the cancellation. However, the formula is asymptotic: Gabcke shows
+ * that, for t > 200, the error after the C_4 term is less than
+ * 0.017 tau^{-11/4}. This bounds the number of digits that can be
+ * obtained: about 7 at t=1000, 10 at t=10^4, 13 at t=10^5 and 16 at
+ * t=10^6.
+ */
 
-	// This is a real sleazy way of estimating the number
-	// of terms needed for complex values far from the real axis.
-	// Works OK for s = 1/2 + i tau, should be cleaned up to be better.
-	// What we want is an estimate for size of gamma
-	// nterms -=  s * log(s) -s;  -- Stirling approx for gamma ...
-	double sim = mpf_get_d (s[0].im);
-	sim = fabs(sim);
-	nterms += 0.5*M_PI*sim;
+#define RS_MIN_T 200.0
+#define RS_REMAINDER 0.017
 
-	nterms *= 0.567296329;
-	return (int) (nterms+1.0);
+/* Number of correct decimal digits that Gabcke's bound guarantees */
+static inline double rs_digits (double t)
+{
+	return -log10 (RS_REMAINDER) + 2.75 * log10 (t / (2.0*M_PI));
 }
 
-void cpx_borwein_zeta (cpx_t zeta, const cpx_t s, int prec)
+/* Number of terms q_m needed in the Taylor expansion of Psi, so that
+ * the twelfth derivative is good to 10^{-prec}.  The q_m fall off
+ * faster than (2pi)^m/m!, while |p-1/2| < 1/2 and each derivative
+ * brings down at most a factor of 2m. */
+static int rs_psi_terms (int prec)
 {
-	int n = bor_zeta_terms_est (s, prec);
-
-	mpf_t d_n, one;
-	mpf_init (d_n);
-	mpf_init (one);
-	mpf_set_ui (one, 1);
-
-	cpx_t po, term, ess;
-	cpx_init (po);
-	cpx_init (term);
-	cpx_init (ess);
+	int m;
+	for (m=10; m<500; m++)
+	{
+		double lg = m * log (0.5*M_PI) - lgamma (m+1.0) + 12.0 * log (4.0*m);
+		if (lg < -2.302585093 * (prec+3)) break;
+	}
+	return m;
+}
 
-	/* make copy of input now ! */
-	cpx_set (ess, s);
-	cpx_set_ui (zeta, 0, 0);
+/**
+ * rs_psi_coeffs -- Taylor coefficients of Psi about p = 1/2.
+ *
+ * With p = 1/2+h and u = h^2, one has
+ *    Psi(p) = -cos(2pi u - 5pi/8) / cos(2pi sqrt(u)) = sum_m q_m u^m
+ * The numerator and denominator are both entire in u, and the q_m are
+ * obtained by series division. The division loses about log10(16)
+ * digits per term, and so is done with extra precision. The q_m are
+ * cached.
+ */
+static void rs_psi_coeffs (mpf_t *q, int nterms, int prec)
+{
+	DECLARE_FP_CACHE (psi_q);
+	int m, j;
 
-	fp_borwein_tchebysheff (d_n, n, n, prec);
-	int k;
-	for (k=0; k<n; k++)
+	int wprec = prec + 1.21 * nterms + 10;
+	/* Check the top entry first; this grows the cache. */
+	int hit = 1;
+	for (m=nterms-1; m>=0; m--)
 	{
-		mpf_set_ui (term[0].im, 0);
-		fp_borwein_tchebysheff (term[0].re, n, k, prec);
-		mpf_sub (term[0].re, term[0].re, d_n);
+		if (fp_one_d_cache_check (&psi_q, m) < wprec) { hit = 0; break; }
+	}
+	if (hit)
+	{
+		for (m=0; m<nterms; m++) fp_one_d_cache_fetch (&psi_q, q[m], m);
+		return;
+	}
 
-		// po = pow (k+1, s);
-		fp_pow_rc (po, k, one, ess, prec);
-		cpx_div (term, term, po);
+	mp_bitcnt_t bits = 3.322 * wprec + 50;
+	mpf_t twopi, phi, co, si, fact, term;
+	mpf_init2 (twopi, bits);
+	mpf_init2 (phi, bits);
+	mpf_init2 (co, bits);
+	mpf_init2 (si, bits);
+	mpf_init2 (fact, bits);
+	mpf_init2 (term, bits);
+
+	mpf_t *a = (mpf_t *) malloc (nterms * sizeof (mpf_t));
+	mpf_t *b = (mpf_t *) malloc (nterms * sizeof (mpf_t));
+	mpf_t *r = (mpf_t *) malloc (nterms * sizeof (mpf_t));
+	for (m=0; m<nterms; m++)
+	{
+		mpf_init2 (a[m], bits);
+		mpf_init2 (b[m], bits);
+		mpf_init2 (r[m], bits);
+	}
 
-		if (k%2)
+	/* phi = 5pi/8 */
+	fp_two_pi (twopi, wprec);
+	mpf_mul_ui (phi, twopi, 5);
+	mpf_div_ui (phi, phi, 16);
+	fp_cosine (co, phi, wprec);
+	fp_sine (si, phi, wprec);
+
+	/* a_m = (2pi)^m/m! cos(m pi/2 - 5pi/8), the numerator.
+	 * b_m = (-1)^m (2pi)^{2m}/(2m)!, the denominator. */
+	mpf_set_ui (fact, 1);
+	for (m=0; m<nterms; m++)
+	{
+		switch (m%4)
 		{
-			cpx_sub(zeta, zeta, term);
+			case 0: mpf_mul (a[m], fact, co); break;
+			case 1: mpf_mul (a[m], fact, si); break;
+			case 2: mpf_mul (a[m], fact, co); mpf_neg (a[m], a[m]); break;
+			case 3: mpf_mul (a[m], fact, si); mpf_neg (a[m], a[m]); break;
 		}
-		else
+		mpf_mul (fact, fact, twopi);
+		mpf_div_ui (fact, fact, m+1);
+	}
+	mpf_set_ui (fact, 1);
+	for (m=0; m<nterms; m++)
+	{
+		mpf_set (b[m], fact);
+		if (m%2) mpf_neg (b[m], b[m]);
+		mpf_mul (fact, fact, twopi);
+		mpf_mul (fact, fact, twopi);
+		mpf_div_ui (fact, fact, (2*m+1)*(2*m+2));
+	}
+
+	/* q = -a/b, using b_0 = 1 */
+	for (m=0; m<nterms; m++)
+	{
+		mpf_neg (r[m], a[m]);
+		for (j=0; j<m; j++)
 		{
-			cpx_add(zeta, zeta, term);
+			mpf_mul (term, r[j], b[m-j]);
+			mpf_sub (r[m], r[m], term);
 		}
+		mpf_set (q[m], r[m]);
+		fp_one_d_cache_store (&psi_q, r[m], m, wprec);
 	}
-	mpf_div (zeta[0].re, zeta[0].re, d_n);
-	mpf_div (zeta[0].im, zeta[0].im, d_n);
-
-	cpx_neg (zeta, zeta);
-
-	/* po = 1 - 2^{1-s} */
-	mpf_sub_ui (ess[0].re, ess[0].re, 1);
-	fp_pow_rc (po, 1, one, ess, prec);
-	cpx_recip (po, po);
-	cpx_neg (po, po);
-	mpf_add_ui (po[0].re, po[0].re, 1);
-
-	cpx_div (zeta, zeta, po);
 
-	mpf_clear (d_n);
-	mpf_clear (one);
-
-	cpx_clear (po);
-	cpx_clear (term);
-	cpx_clear (ess);
+	for (m=0; m<nterms; m++)
+	{
+		mpf_clear (a[m]);
+		mpf_clear (b[m]);
+		mpf_clear (r[m]);
+	}
+	free (a);
+	free (b);
+	free (r);
+
+	mpf_clear (twopi);
+	mpf_clear (phi);
+	mpf_clear (co);
+	mpf_clear (si);
+	mpf_clear (fact);
+	mpf_clear (term);
 }
 
-void cpx_borwein_zeta_cache (cpx_t zeta, const cpx_t s, unsigned int n, int prec)
+/**
+ * rs_psi_derivs -- the derivatives Psi^{(k)}(p) for 0 <= k < nderiv.
+ *
+ * Writing delta = p-1/2, Psi(p) = sum_m q_m delta^{2m} is a polynomial
+ * in delta; it is differentiated term by term and evaluated by Horner's
+ * rule.
+ */
+static void rs_psi_derivs (mpf_t *psi, int nderiv, const mpf_t p, int prec)
 {
-	DECLARE_CPX_CACHE (cache);
-	static int precision = 0;
-	static cpx_t cache_s;
-	if (!precision)
+	int nterms = rs_psi_terms (prec);
+	int deg = 2*nterms - 2;
+	int j, k;
+
+	/* The q_m are needed at high precision, but once they are known,
+	 * the polynomial is tame: the largest terms, in the twelfth
+	 * derivative, are of order 10^13. */
+	mp_bitcnt_t bits = 3.322 * (prec + 15) + 50;
+
+	mpf_t *q = (mpf_t *) malloc (nterms * sizeof (mpf_t));
+	mpf_t *c = (mpf_t *) malloc ((deg+1) * sizeof (mpf_t));
+	for (j=0; j<nterms; j++) mpf_init2 (q[j], bits);
+	for (j=0; j<=deg; j++) mpf_init2 (c[j], bits);
+
+	rs_psi_coeffs (q, nterms, prec);
+	for (j=0; j<=deg; j++)
 	{
-		cpx_init (cache_s);
-		cpx_set_ui (cache_s, 1, 0);
+		if (j%2) mpf_set_ui (c[j], 0);
+		else mpf_set (c[j], q[j/2]);
 	}
 
-	if (precision < prec)
+	mpf_t delta;
+	mpf_init2 (delta, bits);
+	mpf_set_d (delta, 0.5);
+	mpf_sub (delta, p, delta);
+
+	for (k=0; k<nderiv; k++)
 	{
-		cpx_set_prec (cache_s, 3.22*prec+50);
-		precision = prec;
+		/* Horner */
+		mpf_set (psi[k], c[deg-k]);
+		for (j=deg-k-1; j>=0; j--)
+		{
+			mpf_mul (psi[k], psi[k], delta);
+			mpf_add (psi[k], psi[k], c[j]);
+		}
+
+		/* Differentiate */
+		for (j=0; j<deg-k; j++)
+		{
+			mpf_mul_ui (c[j], c[j+1], j+1);
+		}
 	}
 
-	/* First, check if this is the same s value as before */
-	if (!cpx_eq (cache_s, s, prec*3.322))
+	for (j=0; j<nterms; j++) mpf_clear (q[j]);
+	for (j=0; j<=deg; j++) mpf_clear (c[j]);
+	free (q);
+	free (c);
+	mpf_clear (delta);
+}
+
+/**
+ * fp_riemann_siegel_theta -- the Riemann-Siegel theta function.
+ *
+ * Uses the asymptotic expansion
+ *    theta(t) = t/2 log(t/2pi) - t/2 - pi/8
+ *             + sum_k (1-2^{1-2k}) |B_{2k}| / (4k(2k-1) t^{2k-1})
+ * which is summed until the terms are less than 10^{-prec}, or start
+ * to grow. The expansion is good only to about exp(-pi t); for
+ * smaller t, theta is taken from its definition,
+ *    theta(t) = Im log Gamma(1/4+it/2) - t/2 log pi
+ */
+static void theta_lngamma (mpf_t theta, const mpf_t t, int prec)
+{
+	mpf_t lpi;
+	mpf_init (lpi);
+	fp_pi (lpi, prec);
+	fp_log (lpi, lpi, prec);
+	mpf_mul (lpi, lpi, t);
+	mpf_div_2exp (lpi, lpi, 1);
+
+	cpx_t z;
+	cpx_init (z);
+	mpf_set_ui (z[0].re, 1);
+	mpf_div_2exp (z[0].re, z[0].re, 2);
+	mpf_div_2exp (z[0].im, t, 1);
+	cpx_lngamma (z, z, prec);
+	mpf_sub (theta, z[0].im, lpi);
+
+	cpx_clear (z);
+	mpf_clear (lpi);
+}
+
+void fp_riemann_siegel_theta (mpf_t theta, const mpf_t t, int prec)
+{
+	if (M_PI * mpf_get_d (t) < (prec + 1) * M_LN10)
 	{
-		cpx_one_d_cache_clear (&cache);
-		cpx_set (cache_s, s);
+		theta_lngamma (theta, t, prec);
+		return;
 	}
 
-	/* Check the local cache */
-	int have_prec = cpx_one_d_cache_check (&cache, n);
-	if (have_prec >= prec)
+	mp_bitcnt_t bits = 3.322 * prec + 50;
+	mpf_t tee, acc, term, last, tpow, tsq, eps;
+	mpf_init2 (tee, bits);
+	mpf_init2 (acc, bits);
+	mpf_init2 (term, bits);
+	mpf_init2 (last, bits);
+	mpf_init2 (tpow, bits);
+	mpf_init2 (tsq, bits);
+	mpf_init2 (eps, bits);
+
+	/* Make copy of argument now! */
+	mpf_set (tee, t);
+
+	fp_two_pi (term, prec);
+	mpf_div (term, tee, term);
+	fp_log (acc, term, prec);
+	mpf_sub_ui (acc, acc, 1);
+	mpf_mul (acc, acc, tee);
+	mpf_div_ui (acc, acc, 2);
+	fp_pi (term, prec);
+	mpf_div_ui (term, term, 8);
+	mpf_sub (acc, acc, term);
+
+	fp_epsilon (eps, prec);
+	mpf_ui_div (tpow, 1, tee);
+	mpf_mul (tsq, tpow, tpow);
+	mpf_set_ui (last, 0);
+
+	int k;
+	for (k=1; ; k++)
 	{
-		cpx_one_d_cache_fetch (&cache, zeta, n);
-		return;
+		fp_bernoulli (term, 2*k, prec);
+		mpf_abs (term, term);
+		mpf_mul (term, term, tpow);
+		mpf_div_ui (term, term, 4*k*(2*k-1));
+
+		/* Asymptotic series; stop before it diverges. */
+		if (1 < k && 0 < mpf_cmp (term, last)) break;
+
+		mpf_add (acc, acc, term);
+		mpf_set (last, term);
+		mpf_div_2exp (term, term, 2*k-1);
+		mpf_sub (acc, acc, term);
+
+		if (mpf_cmp (last, eps) < 0) break;
+		mpf_mul (tpow, tpow, tsq);
 	}
+	mpf_set (theta, acc);
 
-	cpx_t ess;
-	cpx_init (ess);
-	cpx_add_ui (ess, s, n, 0);
-	cpx_borwein_zeta (zeta, ess, prec);
-	cpx_one_d_cache_store (&cache, zeta, n, prec);
-	cpx_clear (ess);
+	mpf_clear (tee);
+	mpf_clear (acc);
+	mpf_clear (term);
+	mpf_clear (last);
+	mpf_clear (tpow);
+	mpf_clear (tsq);
+	mpf_clear (eps);
+}
+
+/* Gabcke's correction terms, as sums of
+ * num/den pi^{-2 pipow} Psi^{(deriv)}(p) tau^{-k/2} */
+static const struct
+{
+	int k;
+	int deriv;
+	int pipow;
+	long num;
+	unsigned long den;
+} rs_gabcke[] =
+{
+	{0,  0, 0,  1, 1},
+	{1,  3, 1, -1, 96},
+	{2,  2, 1,  1, 64},
+	{2,  6, 2,  1, 18432},
+	{3,  1, 1, -1, 64},
+	{3,  5, 2, -1, 3840},
+	{3,  9, 3, -1, 5308416},
+	{4,  0, 1,  1, 128},
+	{4,  4, 2, 19, 24576},
+	{4,  8, 3, 11, 5898240},
+	{4, 12, 4,  1, 2038431744},
+};
+
+#define RS_NDERIV 13
+
+/* Working precision, in decimal digits: the phases t log n need
+ * log10(t) extra digits, and the roundoff of the N terms adds up. */
+static inline int rs_working_prec (double t, int prec)
+{
+	double tau = t / (2.0*M_PI);
+	return prec + (int) (log10 (t) + 0.5 * log10 (tau)) + 5;
+}
+
+/* Reduce x modulo 2pi, into [0, 2pi) */
+static inline void rs_mod_two_pi (mpf_t x, const mpf_t twopi)
+{
+	mpf_t k;
+	mpf_init2 (k, mpf_get_prec (x));
+	mpf_div (k, x, twopi);
+	mpf_floor (k, k);
+	mpf_mul (k, k, twopi);
+	mpf_sub (x, x, k);
+	mpf_clear (k);
+}
+
+/* a = sqrt(t/2pi), p = a - N; returns N = floor(a) */
+static unsigned int rs_split (mpf_t a, mpf_t p, const mpf_t t, const mpf_t twopi)
+{
+	mpf_div (a, t, twopi);
+	mpf_sqrt (a, a);
+	mpf_floor (p, a);
+	unsigned int nmax = mpf_get_ui (p);
+	mpf_sub (p, a, p);
+	return nmax;
 }
 
-/* ======================================================================= */
 /**
- * fp_zeta
- * Floating-point-valued Riemann zeta for positive integer arguments
- * return value placed in the arg "zeta".
+ * rs_remainder -- the correction terms of the Riemann-Siegel formula,
+ *    (-1)^{N-1} tau^{-1/4} sum_{k=0}^4 C_k(p) tau^{-k/2}
+ * with a = sqrt(tau) and p = a - N. Only an absolute accuracy of
+ * 10^{-prec} is needed, as the term is small.
+ */
+static void rs_remainder (mpf_t corr, const mpf_t a, const mpf_t p,
+                          unsigned int nmax, int prec)
+{
+	int ndig = prec + 3;
+	mp_bitcnt_t bits = 3.322 * (ndig + 15) + 50;
+	mpf_t psi[RS_NDERIV];
+	int k, j;
+	for (k=0; k<RS_NDERIV; k++) mpf_init2 (psi[k], bits);
+	rs_psi_derivs (psi, RS_NDERIV, p, ndig);
+
+	mpf_t acc, term, ipisq;
+	mpf_init2 (acc, bits);
+	mpf_init2 (term, bits);
+	mpf_init2 (ipisq, bits);
+	fp_pi (ipisq, ndig);
+	mpf_mul (ipisq, ipisq, ipisq);
+	mpf_ui_div (ipisq, 1, ipisq);
+
+	mpf_set_ui (acc, 0);
+	for (k=0; k<sizeof(rs_gabcke)/sizeof(rs_gabcke[0]); k++)
+	{
+		mpf_set (term, psi[rs_gabcke[k].deriv]);
+		if (0 > rs_gabcke[k].num) mpf_neg (term, term);
+		mpf_mul_ui (term, term, labs (rs_gabcke[k].num));
+		mpf_div_ui (term, term, rs_gabcke[k].den);
+		for (j=0; j<rs_gabcke[k].pipow; j++) mpf_mul (term, term, ipisq);
+		for (j=0; j<rs_gabcke[k].k; j++) mpf_div (term, term, a);
+		mpf_add (acc, acc, term);
+	}
+
+	/* tau^{-1/4} = a^{-1/2} */
+	mpf_sqrt (term, a);
+	mpf_div (acc, acc, term);
+	if (0 == nmax%2) mpf_neg (acc, acc);
+	mpf_set (corr, acc);
+
+	for (k=0; k<RS_NDERIV; k++) mpf_clear (psi[k]);
+	mpf_clear (acc);
+	mpf_clear (term);
+	mpf_clear (ipisq);
+}
+
+/**
+ * riemann_siegel -- compute Z(t), and theta(t) modulo 2pi, for t > 0.
+ * Returns non-zero, without computing anything, if Gabcke's error
+ * bound does not guarantee prec digits.
+ */
+static int riemann_siegel (mpf_t zee, mpf_t theta, const mpf_t t, int prec)
+{
+	double td = mpf_get_d (t);
+	if (td < RS_MIN_T || rs_digits (td) < prec) return 1;
+
+	int wprec = rs_working_prec (td, prec);
+	mp_bitcnt_t bits = 3.322 * wprec + 50;
+
+	mpf_t tee, th, twopi, ph, lg, sq, acc, a, p, term;
+	mpf_init2 (tee, bits);
+	mpf_init2 (th, bits);
+	mpf_init2 (twopi, bits);
+	mpf_init2 (ph, bits);
+	mpf_init2 (lg, bits);
+	mpf_init2 (sq, bits);
+	mpf_init2 (acc, bits);
+	mpf_init2 (a, bits);
+	mpf_init2 (p, bits);
+	mpf_init2 (term, bits);
+
+	/* Make copy of argument now! */
+	mpf_set (tee, t);
+	fp_two_pi (twopi, wprec);
+
+	/* Only theta modulo 2pi is needed */
+	fp_riemann_siegel_theta (th, tee, wprec);
+	rs_mod_two_pi (th, twopi);
+	mpf_set (theta, th);
+
+	unsigned int nmax = rs_split (a, p, tee, twopi);
+
+	/* The main sum */
+	mpf_set_ui (acc, 0);
+	unsigned int n;
+	for (n=1; n<=nmax; n++)
+	{
+		fp_log_ui (lg, n, wprec);
+		mpf_mul (ph, lg, tee);
+		mpf_sub (ph, th, ph);
+		rs_mod_two_pi (ph, twopi);
+
+		fp_cosine (term, ph, wprec);
+		mpf_sqrt_ui (sq, n);
+		mpf_div (term, term, sq);
+		mpf_add (acc, acc, term);
+	}
+	mpf_mul_ui (acc, acc, 2);
+
+	rs_remainder (term, a, p, nmax, prec);
+	mpf_add (zee, acc, term);
+
+	mpf_clear (tee);
+	mpf_clear (th);
+	mpf_clear (twopi);
+	mpf_clear (ph);
+	mpf_clear (lg);
+	mpf_clear (sq);
+	mpf_clear (acc);
+	mpf_clear (a);
+	mpf_clear (p);
+	mpf_clear (term);
+	return 0;
+}
+
+int fp_riemann_siegel_z (mpf_t zee, const mpf_t t, int prec)
+{
+	mpf_t theta;
+	mpf_init2 (theta, 3.322 * prec + 100);
+	int rc = riemann_siegel (zee, theta, t, prec);
+	mpf_clear (theta);
+	return rc;
+}
+
+/**
+ * riemann_siegel_zeta -- zeta on the critical line, for large |t|.
+ * Returns non-zero, without computing anything, if s is not on the
+ * critical line, or if the Riemann-Siegel formula cannot provide
+ * prec digits.
+ */
+static int riemann_siegel_zeta (cpx_t zeta, const cpx_t s, int prec)
+{
+	if (0 != mpf_cmp_d (s[0].re, 0.5)) return 1;
+	if (fabs (mpf_get_d (s[0].im)) < RS_MIN_T) return 1;
+
+	int wprec = prec + 10;
+	mp_bitcnt_t bits = 3.322 * wprec + 50;
+	mpf_t tee, zee, theta, co, si;
+	mpf_init2 (tee, bits);
+	mpf_init2 (zee, bits);
+	mpf_init2 (theta, bits);
+	mpf_init2 (co, bits);
+	mpf_init2 (si, bits);
+
+	/* zeta(conj s) = conj zeta(s) */
+	mpf_abs (tee, s[0].im);
+	int rc = riemann_siegel (zee, theta, tee, prec);
+	if (0 == rc)
+	{
+		fp_cosine (co, theta, wprec);
+		fp_sine (si, theta, wprec);
+		mpf_mul (zeta[0].re, zee, co);
+		mpf_mul (zeta[0].im, zee, si);
+		if (0 < mpf_sgn (s[0].im)) mpf_neg (zeta[0].im, zeta[0].im);
+	}
+
+	mpf_clear (tee);
+	mpf_clear (zee);
+	mpf_clear (theta);
+	mpf_clear (co);
+	mpf_clear (si);
+	return rc;
+}
+
+/* ======================================================================= */
+/*
+ * Multi-evaluation on a grid of t values, in the style of
+ * Odlyzko-Schonhage.
+ *
+ * At t_j = t_c + j dt, the Riemann-Siegel main sum is
+ *    F(t_j) = sum_{n=1}^N n^{-1/2} exp(-i t_j log n)
+ *           = sum_n a_n exp(i j phi_n)
+ * with a_n = n^{-1/2} exp(-i t_c log n) and phi_n = -dt log n. Round
+ * each frequency to the nearest point of an L-point grid on the circle,
+ * phi_n = 2pi m_n/L + eps_n, and expand exp(i j eps_n) in a Taylor
+ * series. Then
+ *    F(t_j) = sum_r (ij)^r/r! sum_m exp(2pi i jm/L) b^{(r)}_m
+ *    b^{(r)}_m = sum_{n: m_n = m} a_n eps_n^r
+ * and each inner sum, for all j at once, is a single FFT of length L.
+ * With |j| <= L/4 and |eps_n| <= pi/L, the Taylor series converges
+ * like (pi/4)^r/r!. The main sums for a block of points thus cost
+ * O(R (N + L log L)) instead of O(N L), where R is the number of
+ * Taylor terms.
+ *
+ * The grid is cut into blocks on which N is constant; theta and the
+ * correction terms are still computed point by point.
+ */
+#define ZETA_GRID_BLOCK 4096
+
+/* Fewer points, or fewer terms in the main sum, than this, and
+ * the direct sums are cheaper than the FFT's. */
+#define ZETA_GRID_MIN 8
+#define ZETA_GRID_MIN_N 40
+
+static void rs_grid_block (cpx_t *zeta, const mpf_t tstart, const mpf_t dt,
+                           int npts, unsigned int nmax, int prec)
+{
+	int j, r;
+	unsigned int n;
+
+	/* Block center, and the largest t in the block */
+	int jc = npts/2;
+	double tmax = fmax (mpf_get_d (tstart), mpf_get_d (tstart) + npts * mpf_get_d (dt));
+	int wprec = rs_working_prec (tmax, prec);
+	mp_bitcnt_t bits = 3.322 * wprec + 50;
+
+	unsigned int len = 1;
+	while (len < 2*npts) len <<= 1;
+
+	/* Number of Taylor terms: x^r/r! * sum |a_n| < 10^{-wprec},
+	 * where |j eps_n| < x */
+	double x = M_PI * (npts - jc) / len;
+	double lgterm = log (2.0 * sqrt (nmax));
+	int nterms;
+	for (nterms=1; nterms<500; nterms++)
+	{
+		lgterm += log (x / nterms);
+		if (lgterm < -2.302585093 * wprec) break;
+	}
+
+	mpf_t tc, twopi, lg, ph, tmp;
+	mpf_init2 (tc, bits);
+	mpf_init2 (twopi, bits);
+	mpf_init2 (lg, bits);
+	mpf_init2 (ph, bits);
+	mpf_init2 (tmp, bits);
+	fp_two_pi (twopi, wprec);
+	mpf_mul_ui (tc, dt, jc);
+	mpf_add (tc, tc, tstart);
+
+	cpx_t *pw = (cpx_t *) malloc (nmax * sizeof (cpx_t));
+	mpf_t *eps = (mpf_t *) malloc (nmax * sizeof (mpf_t));
+	unsigned int *midx = (unsigned int *) malloc (nmax * sizeof (unsigned int));
+	cpx_t *b = (cpx_t *) malloc (len * sizeof (cpx_t));
+	cpx_t *fee = (cpx_t *) malloc (npts * sizeof (cpx_t));
+	cpx_t *cof = (cpx_t *) malloc (npts * sizeof (cpx_t));
+
+	/* pw = a_n, and the rounded frequencies */
+	for (n=1; n<=nmax; n++)
+	{
+		cpx_init2 (pw[n-1], bits);
+		mpf_init2 (eps[n-1], bits);
+
+		fp_log_ui (lg, n, wprec);
+		mpf_mul (ph, lg, tc);
+		mpf_neg (ph, ph);
+		rs_mod_two_pi (ph, twopi);
+		fp_cosine (pw[n-1][0].re, ph, wprec);
+		fp_sine (pw[n-1][0].im, ph, wprec);
+		mpf_sqrt_ui (tmp, n);
+		cpx_div_mpf (pw[n-1], pw[n-1], tmp);
+
+		mpf_mul (ph, lg, dt);
+		mpf_neg (ph, ph);
+		rs_mod_two_pi (ph, twopi);
+		mpf_mul_ui (tmp, ph, len);
+		mpf_div (tmp, tmp, twopi);
+		mpf_set_d (lg, 0.5);
+		mpf_add (tmp, tmp, lg);
+		mpf_floor (tmp, tmp);
+		unsigned int m = mpf_get_ui (tmp);
+		mpf_mul (tmp, tmp, twopi);
+		mpf_div_ui (tmp, tmp, len);
+		mpf_sub (eps[n-1], ph, tmp);
+		midx[n-1] = m % len;
+	}
+
+	for (j=0; j<len; j++) cpx_init2 (b[j], bits);
+	for (j=0; j<npts; j++)
+	{
+		cpx_init2 (fee[j], bits);
+		cpx_init2 (cof[j], bits);
+		cpx_set_ui (fee[j], 0, 0);
+		cpx_set_ui (cof[j], 1, 0);
+	}
+
+	for (r=0; r<nterms; r++)
+	{
+		for (j=0; j<len; j++) cpx_set_ui (b[j], 0, 0);
+		for (n=0; n<nmax; n++)
+		{
+			cpx_add (b[midx[n]], b[midx[n]], pw[n]);
+			cpx_times_mpf (pw[n], pw[n], eps[n]);
+		}
+		cpx_fft (b, len, 1, wprec);
+
+		/* fee += (ij)^r/r! b_j */
+		for (j=0; j<npts; j++)
+		{
+			int jj = j - jc;
+			cpx_addmul (fee[j], cof[j], b[(jj + len) % len]);
+
+			cpx_times_i (cof[j], cof[j]);
+			cpx_times_ui (cof[j], cof[j], abs (jj));
+			if (jj < 0) cpx_neg (cof[j], cof[j]);
+			cpx_div_ui (cof[j], cof[j], r+1);
+		}
+	}
+
+	/* Assemble Z and zeta, point by point */
+	mpf_t tj, th, co, si, zee, a, p;
+	mpf_init2 (tj, bits);
+	mpf_init2 (th, bits);
+	mpf_init2 (co, bits);
+	mpf_init2 (si, bits);
+	mpf_init2 (zee, bits);
+	mpf_init2 (a, bits);
+	mpf_init2 (p, bits);
+	for (j=0; j<npts; j++)
+	{
+		mpf_mul_ui (tj, dt, j);
+		mpf_add (tj, tj, tstart);
+
+		fp_riemann_siegel_theta (th, tj, wprec);
+		rs_mod_two_pi (th, twopi);
+		fp_cosine (co, th, wprec);
+		fp_sine (si, th, wprec);
+
+		/* Z = 2 Re (exp(i theta) F) + corrections */
+		mpf_mul (zee, co, fee[j][0].re);
+		mpf_mul (tmp, si, fee[j][0].im);
+		mpf_sub (zee, zee, tmp);
+		mpf_mul_ui (zee, zee, 2);
+
+		rs_split (a, p, tj, twopi);
+		rs_remainder (tmp, a, p, nmax, prec);
+		mpf_add (zee, zee, tmp);
+
+		mpf_mul (zeta[j][0].re, zee, co);
+		mpf_mul (zeta[j][0].im, zee, si);
+		mpf_neg (zeta[j][0].im, zeta[j][0].im);
+	}
+
+	for (n=0; n<nmax; n++)
+	{
+		cpx_clear (pw[n]);
+		mpf_clear (eps[n]);
+	}
+	for (j=0; j<len; j++) cpx_clear (b[j]);
+	for (j=0; j<npts; j++)
+	{
+		cpx_clear (fee[j]);
+		cpx_clear (cof[j]);
+	}
+	free (pw);
+	free (eps);
+	free (midx);
+	free (b);
+	free (fee);
+	free (cof);
+
+	mpf_clear (tc);
+	mpf_clear (twopi);
+	mpf_clear (lg);
+	mpf_clear (ph);
+	mpf_clear (tmp);
+	mpf_clear (tj);
+	mpf_clear (th);
+	mpf_clear (co);
+	mpf_clear (si);
+	mpf_clear (zee);
+	mpf_clear (a);
+	mpf_clear (p);
+}
+
+void cpx_zeta_grid (cpx_t *zeta, const mpf_t sigma, const mpf_t t0,
+                    const mpf_t dt, int npts, int prec)
+{
+	if (npts <= 0) return;
+
+	int on_line = (0 == mpf_cmp_d (sigma, 0.5));
+	double tbig = fmax (fabs (mpf_get_d (t0)),
+	                    fabs (mpf_get_d (t0) + npts * mpf_get_d (dt)));
+	int wprec = rs_working_prec (fmax (tbig, RS_MIN_T), prec);
+	mp_bitcnt_t bits = 3.322 * wprec + 50;
+
+	mpf_t tj, twopi, a, p;
+	mpf_init2 (tj, bits);
+	mpf_init2 (twopi, bits);
+	mpf_init2 (a, bits);
+	mpf_init2 (p, bits);
+	fp_two_pi (twopi, wprec);
+
+	cpx_t ess;
+	cpx_init2 (ess, bits);
+	mpf_set (ess[0].re, sigma);
+
+	int j = 0;
+	while (j < npts)
+	{
+		mpf_mul_ui (tj, dt, j);
+		mpf_add (tj, tj, t0);
+		double td = mpf_get_d (tj);
+
+		/* Find the run of points that share the same N */
+		int jend = j;
+		unsigned int nmax = 0;
+		if (on_line && RS_MIN_T <= td && prec <= rs_digits (td))
+		{
+			nmax = rs_split (a, p, tj, twopi);
+			for (jend=j+1; jend<npts && jend-j < ZETA_GRID_BLOCK; jend++)
+			{
+				mpf_mul_ui (tj, dt, jend);
+				mpf_add (tj, tj, t0);
+				td = mpf_get_d (tj);
+				if (td < RS_MIN_T || rs_digits (td) < prec) break;
+				if (rs_split (a, p, tj, twopi) != nmax) break;
+			}
+		}
+
+		if (ZETA_GRID_MIN <= jend - j && ZETA_GRID_MIN_N <= nmax)
+		{
+			mpf_mul_ui (tj, dt, j);
+			mpf_add (tj, tj, t0);
+			rs_grid_block (&zeta[j], tj, dt, jend-j, nmax, prec);
+			j = jend;
+			continue;
+		}
+
+		/* Not worth it; do them one at a time. */
+		if (jend == j) jend = j+1;
+		for (; j<jend; j++)
+		{
+			mpf_mul_ui (ess[0].im, dt, j);
+			mpf_add (ess[0].im, ess[0].im, t0);
+			cpx_borwein_zeta (zeta[j], ess, prec);
+		}
+	}
+
+	mpf_clear (tj);
+	mpf_clear (twopi);
+	mpf_clear (a);
+	mpf_clear (p);
+	cpx_clear (ess);
+}
+
+/* ======================================================================= */
+
+static inline int bor_zeta_terms_est (const cpx_t s, int prec)
+{
+	double nterms = 0.69 + 2.302585093 * prec;
+
+	// This is a real sleazy way of estimating the number
+	// of terms needed for complex values far from the real axis.
+	// Works OK for s = 1/2 + i tau, should be cleaned up to be better.
+	// What we want is an estimate for size of gamma
+	// nterms -=  s * log(s) -s;  -- Stirling approx for gamma ...
+	double sim = mpf_get_d (s[0].im);
+	sim = fabs(sim);
+	nterms += 0.5*M_PI*sim;
+
+	nterms *= 0.567296329;
+	return (int) (nterms+1.0);
+}
+
+void cpx_borwein_zeta (cpx_t zeta, const cpx_t s, int prec)
+{
+	/* High on the critical line, Riemann-Siegel is vastly faster. */
+	if (0 == riemann_siegel_zeta (zeta, s, prec)) return;
+
+	int n = bor_zeta_terms_est (s, prec);
+
+	/* Fixed-point scale, in bits */
+	unsigned long fbits = mpf_get_prec (zeta[0].re) + 64;
+
+	mpz_t one, pre, pim, sre, sim, hre, him, d;
+	mpz_init (one);
+	mpz_init (pre);
+	mpz_init (pim);
+	mpz_init (sre);
+	mpz_init (sim);
+	mpz_init (hre);
+	mpz_init (him);
+	mpz_init (d);
+
+	mpf_t fone, tmp;
+	mpf_init (fone);
+	mpf_init (tmp);
+	mpf_set_ui (fone, 1);
+
+	cpx_t po, ess;
+	cpx_init (po);
+	cpx_init (ess);
+
+	/* make copy of input now ! Use -s, so that the powers
+	 * come out as (k+1)^{-s}, and the divide becomes a multiply. */
+	cpx_neg (ess, s);
+
+	mpz_set_ui (one, 1);
+	mpz_mul_2exp (one, one, fbits);
+
+	mpz_set_ui (sre, 0);
+	mpz_set_ui (sim, 0);
+	mpz_set_ui (hre, 0);
+	mpz_set_ui (him, 0);
+	int i;
+	for (i=1; i<=n; i++)
+	{
+		// po = pow (i, -s), in fixed point
+		fp_pow_rc (po, i-1, fone, ess, prec);
+		mpf_mul_2exp (tmp, po[0].re, fbits);
+		mpz_set_f (pre, tmp);
+		mpf_mul_2exp (tmp, po[0].im, fbits);
+		mpz_set_f (pim, tmp);
+
+		if (i%2)
+		{
+			mpz_add (sre, sre, pre);
+			mpz_add (sim, sim, pim);
+		}
+		else
+		{
+			mpz_sub (sre, sre, pre);
+			mpz_sub (sim, sim, pim);
+		}
+
+		borwein_horner_step (hre, n, i);
+		mpz_add (hre, hre, sre);
+		borwein_horner_step (him, n, i);
+		mpz_add (him, him, sim);
+	}
+	i_borwein_d_n (d, n);
+	borwein_eta_fixed (zeta[0].re, hre, d, n, fbits);
+	borwein_eta_fixed (zeta[0].im, him, d, n, fbits);
+
+	/* po = 1 - 2^{1-s} */
+	cpx_neg (ess, ess);
+	mpf_sub_ui (ess[0].re, ess[0].re, 1);
+	fp_pow_rc (po, 1, fone, ess, prec);
+	cpx_recip (po, po);
+	cpx_neg (po, po);
+	mpf_add_ui (po[0].re, po[0].re, 1);
+
+	cpx_div (zeta, zeta, po);
+
+	mpz_clear (one);
+	mpz_clear (pre);
+	mpz_clear (pim);
+	mpz_clear (sre);
+	mpz_clear (sim);
+	mpz_clear (hre);
+	mpz_clear (him);
+	mpz_clear (d);
+
+	mpf_clear (fone);
+	mpf_clear (tmp);
+
+	cpx_clear (po);
+	cpx_clear (ess);
+}
+
+typedef struct
+{
+	cpx_cache cache;
+	cpx_t cache_s;
+	int precision;
+} borwein_zeta_state;
+
+static void * borwein_zeta_state_new (void)
+{
+	borwein_zeta_state *st = (borwein_zeta_state *) malloc (sizeof (borwein_zeta_state));
+	cpx_one_d_cache_init (&st->cache);
+	cpx_init (st->cache_s);
+	cpx_set_ui (st->cache_s, 1, 0);
+	st->precision = 0;
+	return st;
+}
+
+static void borwein_zeta_state_free (void *p)
+{
+	borwein_zeta_state *st = (borwein_zeta_state *) p;
+	cpx_one_d_cache_free (&st->cache);
+	cpx_clear (st->cache_s);
+	free (st);
+}
+
+/* Keyed on s, so one cache per thread. */
+DECLARE_THREAD_STATE (borwein_zeta_state_key, borwein_zeta_state_new,
+                      borwein_zeta_state_free);
+
+void cpx_borwein_zeta_cache (cpx_t zeta, const cpx_t s, unsigned int n, int prec)
+{
+	borwein_zeta_state *st = thread_state_get (&borwein_zeta_state_key);
+	if (st->precision < prec)
+	{
+		cpx_set_prec (st->cache_s, 3.22*prec+50);
+		st->precision = prec;
+	}
+
+	/* First, check if this is the same s value as before */
+	if (!cpx_eq (st->cache_s, s, prec*3.322))
+	{
+		cpx_one_d_cache_clear (&st->cache);
+		cpx_set (st->cache_s, s);
+	}
+
+	/* Check the local cache */
+	int have_prec = cpx_one_d_cache_check (&st->cache, n);
+	if (have_prec >= prec)
+	{
+		cpx_one_d_cache_fetch (&st->cache, zeta, n);
+		return;
+	}
+
+	cpx_t ess;
+	cpx_init (ess);
+	cpx_add_ui (ess, s, n, 0);
+	cpx_borwein_zeta (zeta, ess, prec);
+	cpx_one_d_cache_store (&st->cache, zeta, n, prec);
+	cpx_clear (ess);
+}
+
+/* ======================================================================= */
+/**
+ * fp_zeta
+ * Floating-point-valued Riemann zeta for positive integer arguments
+ * return value placed in the arg "zeta".
  *
  * Carries out the math to "prec" decimal digits. Uses a combined
  * algorithm:
@@ -993,44 +2060,59 @@ static void fp_zeta_file_cache_put(mpf_t zeta, unsigned int s, int prec)
 	mpf_clear (zm1);
 }
 
-void fp_zeta (mpf_t zeta, unsigned int s, int prec)
+DECLARE_FP_CACHE (fp_zeta_cache);
+
+/* If a high order is requested, but only a relatively low
+ * number of digits of precision, then a brute force summation
+ * is appropriate. Compare the cost estimate for the direct sum
+ * against the alternatives, in units of one multiply:
+ * -- Even s: the Bernoulli number, a power and a factorial; cheap,
+ *    but slowly growing with s.
+ * -- Odd s: the Borwein algorithm, with about 1.3 prec terms, each
+ *    costing a few linear-time bignum operations, so that each gets
+ *    cheaper, relative to a multiply, as the precision goes up.
+ * These were fit to timings at 30 to 3000 digits.
+ */
+static inline int zeta_use_brute (unsigned int s, int prec)
 {
-	DECLARE_FP_CACHE (cache);
-	if (2>s)
-	{
-		fprintf (stderr, "Domain error, asked for zeta(%d)\n", s);
-		mpf_set_ui (zeta, 0);
-		return;
-	}
+	unsigned int nterms;
+	int ntail;
+	double cost = zeta_brute_plan (s, prec, &nterms, &ntail);
 
-	/* First, check the local cache */
-	int have_prec = fp_one_d_cache_check (&cache, s);
+	if (0 == s%2) return cost < 10.0 + 0.3*s;
+
+	double nbor = 1.306 * prec + 1.0;
+	return cost < nbor * 2.5 / (1.0 + prec / 600.0);
+}
+
+/* Look for zeta(s) in the ram cache, and then on disk */
+static int fp_zeta_lookup (mpf_t zeta, unsigned int s, int prec)
+{
+	int have_prec = fp_one_d_cache_check (&fp_zeta_cache, s);
 	if (have_prec >= prec)
 	{
-		fp_one_d_cache_fetch (&cache, zeta, s);
-		return;
+		fp_one_d_cache_fetch (&fp_zeta_cache, zeta, s);
+		return 1;
 	}
 
-	/* Check the disk cache next */
 	if (fp_cache_get (ZETA_DB_NAME, zeta, s, prec))
 	{
 		mpf_add_ui (zeta, zeta, 1);
 		/* Save disk value to the ram cache. */
-		fp_one_d_cache_store (&cache, zeta, s, prec);
-		return;
+		fp_one_d_cache_store (&fp_zeta_cache, zeta, s, prec);
+		return 1;
 	}
+	return 0;
+}
 
-	/* If a high order is requested, but only a relatively low
-	 * number of digits of precision, then a brute force summation
-	 * is appropriate.
-	 */
-	double marge = ((double) prec) / ((double) s-1);
-	if (((1 == s%2) && (marge < 3.3 && s>20)) ||
-	    ((0 == s%2) && (marge < 1.8 && s>20)))
+/* Compute zeta(s), without touching any of the caches. Safe to call
+ * from several threads at once, provided that q_bernoulli() has
+ * already been filled out as far as fp_zeta_bernoulli_need() says. */
+static void fp_zeta_compute (mpf_t zeta, unsigned int s, int prec)
+{
+	if (zeta_use_brute (s, prec))
 	{
 		fp_zeta_brute (zeta, s, prec);
-		fp_one_d_cache_store (&cache, zeta, s, prec);
-		fp_zeta_file_cache_put (zeta, s, prec);
 		return;
 	}
 
@@ -1038,8 +2120,6 @@ void fp_zeta (mpf_t zeta, unsigned int s, int prec)
 	if (0 == s%2)
 	{
 		fp_zeta_even (zeta, s, prec);
-		fp_one_d_cache_store (&cache, zeta, s, prec);
-		fp_zeta_file_cache_put (zeta, s, prec);
 		return;
 	}
 
@@ -1052,12 +2132,451 @@ void fp_zeta (mpf_t zeta, unsigned int s, int prec)
 		// fp_zeta_brute (zeta, s, prec);
 		fp_borwein_zeta (zeta, s, prec);
 	}
+}
+
+/* Largest Bernoulli index that fp_zeta_compute() will ask for */
+static int fp_zeta_bernoulli_need (unsigned int s, int prec)
+{
+	if (zeta_use_brute (s, prec))
+	{
+		unsigned int nterms;
+		int ntail;
+		zeta_brute_plan (s, prec, &nterms, &ntail);
+		return 2*ntail;
+	}
+	if (0 == s%2) return s;
+	return 0;
+}
+
+void fp_zeta (mpf_t zeta, unsigned int s, int prec)
+{
+	if (2>s)
+	{
+		fprintf (stderr, "Domain error, asked for zeta(%d)\n", s);
+		mpf_set_ui (zeta, 0);
+		return;
+	}
+
+	if (fp_zeta_lookup (zeta, s, prec)) return;
+
+	fp_zeta_compute (zeta, s, prec);
 
 	/* Save computed value to the cache. */
-	fp_one_d_cache_store (&cache, zeta, s, prec);
+	fp_one_d_cache_store (&fp_zeta_cache, zeta, s, prec);
 	fp_zeta_file_cache_put (zeta, s, prec);
 }
 
+/* ======================================================================= */
+/*
+ * Batch evaluation of zeta at a run of integers. Each of the three
+ * algorithms used by fp_zeta shares most of its work across s:
+ *
+ * -- Borwein: the Tchebysheff coefficients, and the Horner rescaling
+ *    steps, do not depend on s. The fixed-point powers 1/i^s form a
+ *    ladder: each is the previous one, divided by the small integer i.
+ * -- Even s: the Bernoulli numbers come out of q_bernoulli in order,
+ *    and (2pi)^s and s! are built up incrementally.
+ * -- Brute force: the sums over k are done together, again climbing
+ *    a ladder of powers k^{-s}.
+ */
+
+/* What each s still needs */
+#define ZR_DONE 0
+#define ZR_BORWEIN 1
+#define ZR_EVEN 2
+#define ZR_BRUTE 3
+
+typedef struct
+{
+	mpf_t *zeta;
+	const char *todo;
+	unsigned int smin;
+	unsigned int slo;
+	unsigned int shi;
+	unsigned int blk;
+	int n;
+	unsigned long fbits;
+	mpz_t d;
+} zeta_range_job;
+
+/* One block of s values. Every block climbs its ladder from s=1,
+ * and so gets the same powers, no matter how the blocks are cut. */
+static void zeta_range_borwein_block (void *arg, int job)
+{
+	zeta_range_job *zr = (zeta_range_job *) arg;
+	const char *todo = zr->todo;
+	unsigned int smin = zr->smin;
+	int n = zr->n;
+
+	unsigned int s;
+	unsigned int slo = zr->slo + job * zr->blk;
+	unsigned int shi = slo + zr->blk - 1;
+	if (zr->shi < shi) shi = zr->shi;
+
+	int nb = shi - slo + 1;
+	mpz_t *sum = (mpz_t *) malloc (nb * sizeof (mpz_t));
+	mpz_t *h = (mpz_t *) malloc (nb * sizeof (mpz_t));
+	for (s=0; s<nb; s++)
+	{
+		mpz_init_set_ui (sum[s], 0);
+		mpz_init_set_ui (h[s], 0);
+	}
+
+	mpz_t one, po;
+	mpz_init (one);
+	mpz_init (po);
+	mpz_set_ui (one, 1);
+	mpz_mul_2exp (one, one, zr->fbits);
+
+	int i;
+	for (i=1; i<=n; i++)
+	{
+		/* po = 1/i^s in fixed point, climbing up from s=1 */
+		mpz_tdiv_q_ui (po, one, i);
+		for (s=2; s<slo; s++) mpz_tdiv_q_ui (po, po, i);
+
+		for (s=slo; s<=shi; s++)
+		{
+			mpz_tdiv_q_ui (po, po, i);
+			if (ZR_BORWEIN != todo[s-smin]) continue;
+
+			int j = s - slo;
+			if (i%2) mpz_add (sum[j], sum[j], po);
+			else mpz_sub (sum[j], sum[j], po);
+
+			borwein_horner_step (h[j], n, i);
+			mpz_add (h[j], h[j], sum[j]);
+		}
+	}
+
+	mpf_t term;
+	mpf_init2 (term, mpf_get_prec (zr->zeta[slo-smin]));
+	for (s=slo; s<=shi; s++)
+	{
+		if (ZR_BORWEIN != todo[s-smin]) continue;
+		borwein_eta_fixed (zr->zeta[s-smin], h[s-slo], zr->d, n, zr->fbits);
+
+		/* zeta = eta / (1-2^{1-s}) */
+		mpf_set_ui (term, 1);
+		mpf_div_2exp (term, term, s-1);
+		mpf_ui_sub (term, 1, term);
+		mpf_div (zr->zeta[s-smin], zr->zeta[s-smin], term);
+	}
+
+	for (s=0; s<nb; s++)
+	{
+		mpz_clear (sum[s]);
+		mpz_clear (h[s]);
+	}
+	free (sum);
+	free (h);
+	mpz_clear (one);
+	mpz_clear (po);
+	mpf_clear (term);
+}
+
+static void zeta_range_borwein (mpf_t *zeta, const char *todo,
+                                unsigned int smin, unsigned int smax, int prec)
+{
+	unsigned int s, slo = 0, shi = 0;
+	for (s=smin; s<=smax; s++)
+	{
+		if (ZR_BORWEIN != todo[s-smin]) continue;
+		if (0 == slo) slo = s;
+		shi = s;
+	}
+	if (0 == slo) return;
+
+	double nterms = 0.69 + 2.302585093 * prec;
+	nterms *= 0.567296329;
+
+	zeta_range_job zr;
+	zr.zeta = zeta;
+	zr.todo = todo;
+	zr.smin = smin;
+	zr.slo = slo;
+	zr.shi = shi;
+	zr.n = (int) (nterms+1.0);
+
+	/* Fixed-point scale, in bits. The ladder loses a bit or so
+	 * per rung, for which there are the 64 guard bits. */
+	zr.fbits = mpf_get_prec (zeta[slo-smin]) + 64;
+
+	mpz_init (zr.d);
+	i_borwein_d_n (zr.d, zr.n);
+
+	/* One block per thread; the climb up to the start of each
+	 * block is the price paid for splitting. */
+	int nblk = mp_get_nthreads ();
+	if (shi - slo + 1 < nblk) nblk = shi - slo + 1;
+	zr.blk = (shi - slo + nblk) / nblk;
+	nblk = (shi - slo + zr.blk) / zr.blk;
+
+	mp_parallel_for (nblk, zeta_range_borwein_block, &zr);
+
+	mpz_clear (zr.d);
+}
+
+/* zeta(2m) = (-1)^{m+1} B_{2m} (2pi)^{2m} / 2 (2m)! */
+static void zeta_range_even (mpf_t *zeta, const char *todo,
+                             unsigned int smin, unsigned int smax, int prec)
+{
+	unsigned int s;
+	mp_bitcnt_t bits = 3.322 * prec + 50;
+
+	mpq_t bern;
+	mpq_init (bern);
+	mpz_t fact;
+	mpz_init_set_ui (fact, 2);
+
+	mpf_t twopisq, pw, term;
+	mpf_init2 (twopisq, bits);
+	mpf_init2 (pw, bits);
+	mpf_init2 (term, bits);
+	fp_two_pi (twopisq, prec);
+	mpf_mul (twopisq, twopisq, twopisq);
+	mpf_set (pw, twopisq);
+
+	/* pw = (2pi)^s and fact = s! */
+	for (s=2; s<=smax; s+=2)
+	{
+		if (smin <= s && ZR_EVEN == todo[s-smin])
+		{
+			q_bernoulli (bern, s);
+			mpq_abs (bern, bern);
+			mpf_set_q (term, bern);
+			mpf_mul (term, term, pw);
+			mpf_set_z (zeta[s-smin], fact);
+			mpf_div (zeta[s-smin], term, zeta[s-smin]);
+			mpf_div_2exp (zeta[s-smin], zeta[s-smin], 1);
+		}
+		mpf_mul (pw, pw, twopisq);
+		mpz_mul_ui (fact, fact, (s+1)*(s+2));
+	}
+
+	mpq_clear (bern);
+	mpz_clear (fact);
+	mpf_clear (twopisq);
+	mpf_clear (pw);
+	mpf_clear (term);
+}
+
+/* Direct sums plus tails, as in fp_zeta_brute */
+static void zeta_range_brute (mpf_t *zeta, const char *todo,
+                              unsigned int smin, unsigned int smax, int prec)
+{
+	unsigned int s, slo = 0, shi = 0;
+	for (s=smin; s<=smax; s++)
+	{
+		if (ZR_BRUTE != todo[s-smin]) continue;
+		if (0 == slo) slo = s;
+		shi = s;
+	}
+	if (0 == slo) return;
+
+	int nb = shi - slo + 1;
+	unsigned int *nmax = (unsigned int *) malloc (nb * sizeof (unsigned int));
+	int *ntail = (int *) malloc (nb * sizeof (int));
+	for (s=slo; s<=shi; s++)
+	{
+		nmax[s-slo] = 0;
+		if (ZR_BRUTE != todo[s-smin]) continue;
+		zeta_brute_plan (s, prec, &nmax[s-slo], &ntail[s-slo]);
+		mpf_set_ui (zeta[s-smin], 1);
+	}
+
+	/* kend[j] = the largest nmax for s >= slo+j; past that, the
+	 * climb up the ladder of powers can stop. */
+	unsigned int *kend = (unsigned int *) malloc (nb * sizeof (unsigned int));
+	unsigned int kmax = 0;
+	int j;
+	for (j=nb-1; 0<=j; j--)
+	{
+		if (kmax < nmax[j]) kmax = nmax[j];
+		kend[j] = kmax;
+	}
+
+	mp_bitcnt_t bits = mpf_get_prec (zeta[slo-smin]);
+	mpf_t inv, pw;
+	mpf_init2 (inv, bits);
+	mpf_init2 (pw, bits);
+
+	unsigned int k;
+	for (k=2; k<kmax; k++)
+	{
+		mpf_set_ui (inv, 1);
+		mpf_div_ui (inv, inv, k);
+		mpf_pow_ui (pw, inv, slo);
+		for (s=slo; s<=shi; s++)
+		{
+			if (kend[s-slo] <= k) break;
+			if (s != slo) mpf_mul (pw, pw, inv);
+			if (k < nmax[s-slo])
+				mpf_add (zeta[s-smin], zeta[s-smin], pw);
+		}
+	}
+
+	for (s=slo; s<=shi; s++)
+	{
+		if (ZR_BRUTE != todo[s-smin]) continue;
+		zeta_brute_tail (pw, s, nmax[s-slo], ntail[s-slo], bits);
+		mpf_add (zeta[s-smin], zeta[s-smin], pw);
+	}
+
+	free (nmax);
+	free (ntail);
+	free (kend);
+	mpf_clear (inv);
+	mpf_clear (pw);
+}
+
+void fp_zeta_range (mpf_t *zeta, unsigned int smin, unsigned int smax, int prec)
+{
+	unsigned int s;
+	if (smax < smin) return;
+
+	char *todo = (char *) malloc (smax - smin + 1);
+	for (s=smin; s<=smax; s++)
+	{
+		todo[s-smin] = ZR_DONE;
+		if (2>s)
+		{
+			fprintf (stderr, "Domain error, asked for zeta(%d)\n", s);
+			mpf_set_ui (zeta[s-smin], 0);
+			continue;
+		}
+
+		if (fp_one_d_cache_check (&fp_zeta_cache, s) >= prec)
+		{
+			fp_one_d_cache_fetch (&fp_zeta_cache, zeta[s-smin], s);
+			continue;
+		}
+
+		if (zeta_use_brute (s, prec)) todo[s-smin] = ZR_BRUTE;
+		else if (0 == s%2) todo[s-smin] = ZR_EVEN;
+		else todo[s-smin] = ZR_BORWEIN;
+	}
+
+	zeta_range_borwein (zeta, todo, smin, smax, prec);
+	zeta_range_even (zeta, todo, smin, smax, prec);
+	zeta_range_brute (zeta, todo, smin, smax, prec);
+
+	for (s=smin; s<=smax; s++)
+	{
+		if (ZR_DONE == todo[s-smin]) continue;
+		fp_one_d_cache_store (&fp_zeta_cache, zeta[s-smin], s, prec);
+	}
+	free (todo);
+}
+
+/* ======================================================================= */
+/**
+ * fp_bernoulli() -- Bernoulli number B_n, as a float.
+ *
+ * For large n, B_{2k} = (-1)^{k+1} 2 (2k)! zeta(2k) / (2pi)^{2k}
+ * where zeta(2k) is a rapidly convergent direct sum; the sums for
+ * all k are done together, as in fp_zeta_range. For small n, where
+ * the sum converges slowly, the exact rationals are used.
+ */
+DECLARE_FP_CACHE (fp_bernoulli_cache);
+
+void fp_bernoulli (mpf_t bern, int n, int prec)
+{
+	static int bern_max = 0;
+	static int bern_prec = 0;
+
+	if ((0 > n) || (1 == n%2) || (2 > n))
+	{
+		mpq_t q;
+		mpq_init (q);
+		q_bernoulli (q, n);
+		mpf_set_q (bern, q);
+		mpq_clear (q);
+		return;
+	}
+
+	int hn = n/2;
+	if (fp_one_d_cache_check (&fp_bernoulli_cache, hn) >= prec)
+	{
+		fp_one_d_cache_fetch (&fp_bernoulli_cache, bern, hn);
+		return;
+	}
+
+	/* Callers usually walk up through n; fill generously.
+	 * The fill size is shared by all threads; it is kept under
+	 * the cache lock. */
+	unsigned int s, nfill = n;
+	pthread_spin_lock (&fp_bernoulli_cache.lock);
+	if (prec <= bern_prec && nfill < 2*bern_max) nfill = 2*bern_max;
+	pthread_spin_unlock (&fp_bernoulli_cache.lock);
+	fp_one_d_cache_check (&fp_bernoulli_cache, nfill/2);
+
+	/* Where the direct sum for zeta(s) converges quickly */
+	unsigned int sbrute = 2;
+	while (sbrute <= nfill && !zeta_use_brute (sbrute, prec)) sbrute += 2;
+
+	mp_bitcnt_t bits = 3.322 * prec + 50;
+	mpf_t twopisq, ratio, val;
+	mpf_init2 (twopisq, bits);
+	mpf_init2 (ratio, bits);
+	mpf_init2 (val, bits);
+
+	mpf_t *zees = NULL;
+	char *todo = NULL;
+	if (sbrute <= nfill)
+	{
+		int nz = nfill - sbrute + 1;
+		zees = (mpf_t *) malloc (nz * sizeof (mpf_t));
+		todo = (char *) malloc (nz);
+		for (s=sbrute; s<=nfill; s++)
+		{
+			mpf_init2 (zees[s-sbrute], bits);
+			todo[s-sbrute] = (0 == s%2) ? ZR_BRUTE : ZR_DONE;
+		}
+		zeta_range_brute (zees, todo, sbrute, nfill, prec);
+	}
+
+	/* ratio = 2 s! / (2pi)^s */
+	fp_two_pi (twopisq, prec);
+	mpf_mul (twopisq, twopisq, twopisq);
+	mpf_set_ui (ratio, 2);
+	mpq_t q;
+	mpq_init (q);
+	for (s=2; s<=nfill; s+=2)
+	{
+		mpf_mul_ui (ratio, ratio, (s-1)*s);
+		mpf_div (ratio, ratio, twopisq);
+		if (s < sbrute)
+		{
+			q_bernoulli (q, s);
+			mpf_set_q (val, q);
+		}
+		else
+		{
+			mpf_mul (val, ratio, zees[s-sbrute]);
+			if (0 == s%4) mpf_neg (val, val);
+		}
+		fp_one_d_cache_store (&fp_bernoulli_cache, val, s/2, prec);
+		if (s == n) mpf_set (bern, val);
+	}
+	mpq_clear (q);
+
+	if (zees)
+	{
+		for (s=sbrute; s<=nfill; s++) mpf_clear (zees[s-sbrute]);
+		free (zees);
+		free (todo);
+	}
+	mpf_clear (twopisq);
+	mpf_clear (ratio);
+	mpf_clear (val);
+
+	pthread_spin_lock (&fp_bernoulli_cache.lock);
+	bern_max = nfill;
+	bern_prec = prec;
+	pthread_spin_unlock (&fp_bernoulli_cache.lock);
+}
+
 /* ======================================================================= */
 /* Rough count of number of digits in a number. */
 
@@ -1080,20 +2599,65 @@ static inline unsigned int num_digits (mpz_t num, mpz_t tmpa, mpz_t tmpb)
 /*
  * Compute a_sub_n
  * the w argument is for the power bit --
+ *
+ * The terms will have alternating signs, and will mostly cancel
+ * one-another. Thus, we need to increase precision for those terms
+ * with the largest binomial coefficients. This is will increase
+ * precision for the killer terms, while keeping the others in
+ * bearable range, in terms to cpu time consumed.
+ *
+ * The terms are computed in parallel, starting with the costly ones
+ * in the middle, and each is written to its own slot. Cache lookups
+ * and stores are done up front, and at the end, by the calling
+ * thread. The slots are added up in order of k, so that the result
+ * does not depend on the number of threads.
  */
+typedef struct
+{
+	unsigned int n;
+	unsigned int prec;
+	int *order;
+	int *ndigits;
+	char *have;
+	mpz_t *ibin;
+	mpf_t *zeta;
+	mpf_t *term;
+} a_sub_n_job;
+
+/* term = binomial (n,k) (1/k - zeta (k+1)/(k+1)) */
+static void a_sub_n_term (void *arg, int job)
+{
+	a_sub_n_job *aj = (a_sub_n_job *) arg;
+	int k = aj->order[job];
+
+	if (0 == aj->have[k])
+		fp_zeta_compute (aj->zeta[k], k+1, aj->prec + aj->ndigits[k]);
+	// fp_hasse_zeta (zeta, k+1, prec+ndigits);
+
+	mpf_t zt, ok;
+	mpf_init (zt);
+	mpf_init (ok);
+
+	mpf_div_ui (zt, aj->zeta[k], k+1);
+	mpf_set_ui (ok, 1);
+	mpf_div_ui (ok, ok, k);
+	mpf_sub (ok, ok, zt);
+	mpf_set_z (zt, aj->ibin[k]);
+	mpf_mul (aj->term[k], ok, zt);
+
+	mpf_clear (zt);
+	mpf_clear (ok);
+}
+
 void a_sub_n (mpf_t a_n, mpf_t w, unsigned int n, unsigned int prec)
 {
 	int k;
-	mpf_t fbin, term, zt, ok, one, acc, zeta;
-	mpf_t gam, wneg, wn;
+	mpf_t term, zt, ok, one, gam, wneg, wn;
 
 	mpf_init (term);
-	mpf_init (acc);
-	mpf_init (zeta);
 	mpf_init (zt);
 	mpf_init (ok);
 	mpf_init (one);
-	mpf_init (fbin);
 	mpf_init (gam);
 	mpf_init (wneg);
 	mpf_init (wn);
@@ -1103,55 +2667,93 @@ void a_sub_n (mpf_t a_n, mpf_t w, unsigned int n, unsigned int prec)
 	mpz_init (tmpb);
 
 	mpf_set_ui (one, 1);
-
-	mpz_t ibin;
-	mpz_init (ibin);
 	mpf_set_ui (a_n, 0);
 
 	mpf_neg (wneg, w);
 	mpf_set (wn, wneg);
 
+	/* Slots are indexed by k; slot zero is unused. */
+	a_sub_n_job aj;
+	aj.n = n;
+	aj.prec = prec;
+	aj.order = (int *) malloc (n * sizeof (int));
+	aj.ndigits = (int *) malloc ((n+1) * sizeof (int));
+	aj.have = (char *) malloc ((n+1) * sizeof (char));
+	aj.ibin = (mpz_t *) malloc ((n+1) * sizeof (mpz_t));
+	aj.zeta = (mpf_t *) malloc ((n+1) * sizeof (mpf_t));
+	aj.term = (mpf_t *) malloc ((n+1) * sizeof (mpf_t));
+
 	int maxbump = 0;
+	int bneed = 0;
 	for (k=1; k<= n; k++)
 	{
-		/* Compute the binomial */
-		i_binomial (ibin, n, k);
-		mpf_set_z (fbin, ibin);
-
-		/* The terms will have alternating signs, and
-		 * will mostly cancel one-another. Thus, we need
-		 * to increase precision for those terms with the
-		 * largest binomial coefficients. This is will
-		 * increase precision for the killer terms,
-		 * while keeping the others in bearable range,
-		 * in terms to cpu time consumed.
-		 */
-		int ndigits = num_digits (ibin, tmpa,tmpb);
+		mpz_init (aj.ibin[k]);
+		mpf_init (aj.zeta[k]);
+		mpf_init (aj.term[k]);
+
+		i_binomial (aj.ibin[k], n, k);
+		int ndigits = num_digits (aj.ibin[k], tmpa,tmpb);
 		if (maxbump < ndigits) maxbump = ndigits;
+		aj.ndigits[k] = ndigits;
 
-		/* compute 1/k - zeta (k+1)/(k+1) */
-		fp_zeta (zeta, k+1, prec+ndigits);
-		// fp_hasse_zeta (zeta, k+1, prec+ndigits);
+		aj.have[k] = fp_zeta_lookup (aj.zeta[k], k+1, prec+ndigits);
+		if (aj.have[k]) continue;
 
-		mpf_div_ui (zt, zeta, k+1);
-		mpf_div_ui (ok, one, k);
-		mpf_sub (term, ok, zt);
+		int need = fp_zeta_bernoulli_need (k+1, prec+ndigits);
+		if (bneed < need) bneed = need;
+	}
+
+	/* The shared caches get filled here, and not by the threads */
+	if (bneed)
+	{
+		mpq_t bern;
+		mpq_init (bern);
+		q_bernoulli (bern, bneed);
+		mpq_clear (bern);
+		fp_pi (gam, prec+maxbump);
+	}
+
+	/* Middle-out: the biggest binomials come first. */
+	int j = 0;
+	for (k=0; j<n; k++)
+	{
+		int kk = (n+1)/2 + ((k%2) ? -(k+1)/2 : k/2);
+		if (kk < 1 || n < kk) continue;
+		aj.order[j++] = kk;
+	}
 
-		mpf_mul (zeta, term, fbin);
+	mp_parallel_for (n, a_sub_n_term, &aj);
+
+	for (k=1; k<= n; k++)
+	{
+		if (0 == aj.have[k])
+		{
+			int p = prec + aj.ndigits[k];
+			fp_one_d_cache_store (&fp_zeta_cache, aj.zeta[k], k+1, p);
+			fp_zeta_file_cache_put (aj.zeta[k], k+1, p);
+		}
 
 #define W_IS_EQUAL_TO_ONE 1
 #if W_IS_EQUAL_TO_ONE
-		if (k%2) mpf_neg (term, zeta);
-		else mpf_set (term, zeta);
+		if (k%2) mpf_sub (a_n, a_n, aj.term[k]);
+		else mpf_add (a_n, a_n, aj.term[k]);
 #else
-		mpf_mul (term, wn, zeta);
+		mpf_mul (term, wn, aj.term[k]);
 		mpf_mul (zt, wn, wneg);
 		mpf_set (wn, zt);
+		mpf_add (a_n, a_n, term);
 #endif
 
-		mpf_add (acc, a_n, term);
-		mpf_set (a_n, acc);
+		mpz_clear (aj.ibin[k]);
+		mpf_clear (aj.zeta[k]);
+		mpf_clear (aj.term[k]);
 	}
+	free (aj.order);
+	free (aj.ndigits);
+	free (aj.have);
+	free (aj.ibin);
+	free (aj.zeta);
+	free (aj.term);
 
 	/* add const terms */
 	mpf_add_ui (term, a_n, 1);
@@ -1169,17 +2771,13 @@ void a_sub_n (mpf_t a_n, mpf_t w, unsigned int n, unsigned int prec)
 	mpf_set (a_n, term);
 
 	mpf_clear (term);
-	mpf_clear (acc);
-	mpf_clear (zeta);
 	mpf_clear (zt);
 	mpf_clear (ok);
 	mpf_clear (one);
-	mpf_clear (fbin);
 	mpf_clear (gam);
 	mpf_clear (wneg);
 	mpf_clear (wn);
 
-	mpz_clear (ibin);
 	mpz_clear (tmpa);
 	mpz_clear (tmpb);
 
@@ -1203,6 +2801,8 @@ void a_bound_n (mpf_t b_n, unsigned int n)
 /* ======================================================================= */
 /*
  * Compute b_sub_n
+ * Most of the work is in the batch of zeta values; fp_zeta_range
+ * splits the Borwein part of that batch across threads.
  */
 void b_sub_n (mpf_t b_n, unsigned int n, unsigned int prec)
 {
@@ -1244,13 +2844,17 @@ void b_sub_n (mpf_t b_n, unsigned int n, unsigned int prec)
 	mpf_set_si (b_n, -1);
 	mpf_div_ui (b_n, b_n, 2);
 
+	/* All of the zeta values at once */
 	int k;
+	mpf_t *zees = (mpf_t *) malloc ((n-1) * sizeof (mpf_t));
+	for (k=2; k<=n; k++) mpf_init (zees[k-2]);
+	fp_zeta_range (zees, 2, n, prec);
+
 	for (k=2; k<=n; k++)
 	{
 		i_binomial (ibin, n, k);
 		mpf_set_z (bin, ibin);
-		fp_zeta (zeta, k, prec);
-		mpf_mul (zeta, zeta, bin);
+		mpf_mul (zeta, zees[k-2], bin);
 		if (k%2)
 		{
 			mpf_sub (b_n, b_n, zeta);
@@ -1270,6 +2874,8 @@ void b_sub_n (mpf_t b_n, unsigned int n, unsigned int prec)
 	mpf_mul_ui (zeta, zeta, n);
 	mpf_add (b_n, b_n, zeta);
 
+	for (k=2; k<=n; k++) mpf_clear (zees[k-2]);
+	free (zees);
 	mpf_clear (bin);
 	mpf_clear (zeta);
 	mpz_clear (ibin);
@@ -1516,44 +3122,316 @@ void b_sub_s_d (mpf_t re_b, mpf_t im_b, double fre_s, double fim_s,
 }
 
 /* ==================================================================== */
-/* Return the Steiltjes constants */
+/*
+ * Stieltjes constants, from the Euler-Maclaurin formula applied to
+ * f(x) = (log x)^n / x, viz.
+ *
+ *    gamma_n = sum_{k=1}^{M-1} f(k) - (log M)^{n+1}/(n+1) + f(M)/2
+ *              - sum_{j=1}^J B_{2j}/(2j)! f^{(2j-1)}(M)
+ *
+ * All n are done at once. The direct sums share the logarithms, and
+ * the derivatives come from the generating function
+ *
+ *    sum_n f^{(r)}(x) (-t)^n/n! = (-1)^r (1+t)_r x^{-1-r} e^{-t log x}
+ *
+ * so that the correction terms, for all n, are the coefficients of
+ * a single power series in t.
+ */
 
-#if THIS_WORKS_BUT_HAS_PRECISION_PROBLEMS
-void stieltjes_gamma (mpf_t gam, int n)
+#define STIELTJES_DB_NAME "db-stieltjes.db"
+#define STIELTJES_CHUNKS 64
+
+DECLARE_FP_CACHE (stieltjes_cache);
+
+/**
+ * stieltjes_plan() -- pick the number of direct terms M, and of
+ * Euler-Maclaurin terms J, for gamma_0 .. gamma_nmax to prec places.
+ * Returns the working precision, in decimal digits; the direct sums
+ * cancel against the integral to about (log M)^nmax.
+ */
+static int stieltjes_plan (int nmax, int prec, int *em, int *jay)
 {
-	int k;
+	double best = HUGE_VAL;
+	double lneps = -(prec+3) * M_LN10;
+
+	*em = 0;
+	*jay = 0;
+	int m;
+	for (m=4; m<100000000; m += (m<64) ? 4 : m/8)
+	{
+		/* Bigger m can only cost more */
+		if (best < m*(nmax+2.0)) break;
+
+		/* The j'th term, for gamma_nmax, is B_{2j}/(2j)! M^{-2j} nmax!
+		 * times the t^nmax coefficient of (1+t)_{2j-1} M^{-t}; bound
+		 * the latter by its maximum on the circle |t| = rho. */
+		double lm = log (m);
+		double ltpm = log (2.0*M_PI*m);
+		int j;
+		double err = 0.0;
+		for (j=1; j < 2.0*m; j++)
+		{
+			double rho = 1.0;
+			int i;
+			for (i=0; i<4 && 0<nmax; i++)
+				rho = nmax / (lm + log ((2.0*j+rho) / (1.0+rho)));
+
+			err = M_LN2 - 2.0*j*ltpm + lgamma (nmax+1.0) +
+			      lgamma (2.0*j+rho) - lgamma (1.0+rho) +
+			      rho*lm - nmax*log (rho);
+			if (err < lneps) break;
+			if (M_PI*m < j) break;
+		}
+		if (lneps < err) continue;
 
-	mpz_t isb;
-	mpz_init (isb);
+		double cost = m*(nmax+2.0) + 2.0*j*(nmax+2.0);
+		if (cost < best)
+		{
+			best = cost;
+			*em = m;
+			*jay = j;
+		}
+	}
 
-	mpf_t term, sb;
-	mpf_init (term);
-	mpf_init (sb);
+	return prec + 10 + (int) ((nmax+1) * log10 (log (*em) + 1.0));
+}
 
-	mpf_set_ui (gam, 0);
-	// XXXX precision violation !!
-	for (k=n; k<n+260; k++)
+typedef struct
+{
+	int nmax;
+	int em;
+	int chunk;
+	mpf_t *logk;
+	mpf_t **part;
+} stieltjes_job;
+
+/* part[n] = sum over one chunk of k of (log k)^n / k */
+static void stieltjes_chunk (void *arg, int job)
+{
+	stieltjes_job *sj = (stieltjes_job *) arg;
+	mpf_t *part = sj->part[job];
+	mp_bitcnt_t bits = mpf_get_prec (part[0]);
+
+	int n, k = 2 + job * sj->chunk;
+	int kend = k + sj->chunk;
+	if (sj->em < kend) kend = sj->em;
+
+	mpf_t pw;
+	mpf_init2 (pw, bits);
+	for (n=0; n<=sj->nmax; n++) mpf_set_ui (part[n], 0);
+	for (; k<kend; k++)
+	{
+		mpf_set_ui (pw, 1);
+		mpf_div_ui (pw, pw, k);
+		for (n=0; n<=sj->nmax; n++)
+		{
+			mpf_add (part[n], part[n], pw);
+			mpf_mul (pw, pw, sj->logk[k]);
+		}
+	}
+	mpf_clear (pw);
+}
+
+static void stieltjes_compute (mpf_t *gam, int nmax, int prec)
+{
+	int em, jay, n, j, k;
+	int wprec = stieltjes_plan (nmax, prec, &em, &jay);
+	mp_bitcnt_t bits = 3.322 * wprec + 50;
+
+	/* log k for k up to M; only the primes need a real logarithm */
+	mpf_t *logk = (mpf_t *) malloc ((em+1) * sizeof (mpf_t));
+	for (k=1; k<=em; k++)
+	{
+		mpf_init2 (logk[k], bits);
+		int p = 2;
+		while (p*p <= k && k%p) p++;
+		if (k < p*p) fp_log_ui (logk[k], k, wprec);
+		else mpf_add (logk[k], logk[p], logk[k/p]);
+	}
+	mpf_set_ui (logk[1], 0);
+
+	/* The direct sums, k = 2 .. M-1, in fixed chunks */
+	stieltjes_job sj;
+	sj.nmax = nmax;
+	sj.em = em;
+	sj.chunk = (em - 2 + STIELTJES_CHUNKS - 1) / STIELTJES_CHUNKS;
+	if (0 == sj.chunk) sj.chunk = 1;
+	sj.logk = logk;
+	int nchunks = (em - 2 + sj.chunk - 1) / sj.chunk;
+	sj.part = (mpf_t **) malloc (nchunks * sizeof (mpf_t *));
+	for (j=0; j<nchunks; j++)
+	{
+		sj.part[j] = (mpf_t *) malloc ((nmax+1) * sizeof (mpf_t));
+		for (n=0; n<=nmax; n++) mpf_init2 (sj.part[j][n], bits);
+	}
+	mp_parallel_for (nchunks, stieltjes_chunk, &sj);
+
+	/* Q(t) = sum_j B_{2j}/(2j)! M^{-2j} (1+t)_{2j-1} */
+	mpf_t *poch = (mpf_t *) malloc ((nmax+1) * sizeof (mpf_t));
+	mpf_t *que = (mpf_t *) malloc ((nmax+1) * sizeof (mpf_t));
+	for (n=0; n<=nmax; n++)
 	{
-		b_sub_n (term, k, 460);
-		i_stirbin_sum (isb, k,n);
-		mpf_set_z (sb, isb);
-		mpf_mul (term, term, sb);
+		mpf_init2 (poch[n], bits);
+		mpf_init2 (que[n], bits);
+		mpf_set_ui (que[n], 0);
+		mpf_set_ui (poch[n], 0);
+	}
+	mpf_set_ui (poch[0], 1);
+	if (0 < nmax) mpf_set_ui (poch[1], 1);
+
+	mpf_t fact, cj, term, lm, acc;
+	mpf_init2 (fact, bits);
+	mpf_init2 (acc, bits);
+	mpf_init2 (cj, bits);
+	mpf_init2 (term, bits);
+	mpf_init2 (lm, bits);
+
+	/* fact = 1/((2j)! M^{2j}) */
+	mpf_set_ui (fact, 1);
+	for (j=1; j<=jay; j++)
+	{
+		if (1 < j)
+		{
+			/* poch *= (2j-2+t)(2j-1+t) */
+			int a;
+			for (a=2*j-2; a<2*j; a++)
+			{
+				for (n=nmax; 0<n; n--)
+				{
+					mpf_mul_ui (poch[n], poch[n], a);
+					mpf_add (poch[n], poch[n], poch[n-1]);
+				}
+				mpf_mul_ui (poch[0], poch[0], a);
+			}
+		}
+		mpf_div_ui (fact, fact, (2*j-1)*(2*j));
+		mpf_div_ui (fact, fact, em);
+		mpf_div_ui (fact, fact, em);
 
-		i_factorial (isb, k);
-		mpf_set_z (sb, isb);
-		mpf_div (term, term, sb);
-		mpf_add (gam, gam, term);
+		fp_bernoulli (cj, 2*j, wprec);
+		mpf_mul (cj, cj, fact);
+		for (n=0; n<=nmax; n++)
+		{
+			mpf_mul (term, cj, poch[n]);
+			mpf_add (que[n], que[n], term);
+		}
 	}
-	i_factorial (isb, n);
-	mpf_set_z (sb, isb);
-	mpf_mul (gam, gam, sb);
-	if (n%2) mpf_neg (gam, gam);
 
+	/* poch[m] = (-log M)^m / m!, and then the direct-sum terms */
+	mpf_set (lm, logk[em]);
+	mpf_set_ui (poch[0], 1);
+	for (n=1; n<=nmax; n++)
+	{
+		mpf_mul (poch[n], poch[n-1], lm);
+		mpf_div_ui (poch[n], poch[n], n);
+		mpf_neg (poch[n], poch[n]);
+	}
+
+	/* fact = n!, cj = (log M)^n / M */
+	mpf_set_ui (fact, 1);
+	mpf_set_ui (cj, 1);
+	mpf_div_ui (cj, cj, em);
+	for (n=0; n<=nmax; n++)
+	{
+		/* n! [t^n] e^{-t log M} Q(t), with sign (-1)^n */
+		mpf_set_ui (acc, 0);
+		for (k=0; k<=n; k++)
+		{
+			mpf_mul (term, poch[k], que[n-k]);
+			mpf_add (acc, acc, term);
+		}
+		if (n) mpf_mul_ui (fact, fact, n);
+		mpf_mul (acc, acc, fact);
+		if (n%2) mpf_neg (acc, acc);
+
+		/* + f(M)/2 */
+		mpf_div_2exp (term, cj, 1);
+		mpf_add (acc, acc, term);
+
+		/* - (log M)^{n+1}/(n+1) */
+		mpf_mul (cj, cj, lm);
+		mpf_mul_ui (term, cj, em);
+		mpf_div_ui (term, term, n+1);
+		mpf_sub (acc, acc, term);
+
+		/* + sum_{k<M} f(k), in chunk order */
+		for (j=0; j<nchunks; j++)
+			mpf_add (acc, acc, sj.part[j][n]);
+
+		/* The k=1 term */
+		if (0 == n) mpf_add_ui (acc, acc, 1);
+		mpf_set (gam[n], acc);
+	}
+	for (j=0; j<nchunks; j++)
+	{
+		for (n=0; n<=nmax; n++) mpf_clear (sj.part[j][n]);
+		free (sj.part[j]);
+	}
+	free (sj.part);
+	for (k=1; k<=em; k++) mpf_clear (logk[k]);
+	free (logk);
+	for (n=0; n<=nmax; n++)
+	{
+		mpf_clear (poch[n]);
+		mpf_clear (que[n]);
+	}
+	free (poch);
+	free (que);
+	mpf_clear (fact);
+	mpf_clear (cj);
 	mpf_clear (term);
-	mpf_clear (sb);
-	mpz_clear (isb);
+	mpf_clear (lm);
+	mpf_clear (acc);
+}
+
+void stieltjes_gamma_range (mpf_t *gam, int nmax, int prec)
+{
+	int n;
+	if (0 > nmax) return;
+
+	/* Look in the caches first; checking the top one makes room */
+	fp_one_d_cache_check (&stieltjes_cache, nmax);
+	for (n=0; n<=nmax; n++)
+	{
+		if (fp_one_d_cache_check (&stieltjes_cache, n) >= prec)
+		{
+			fp_one_d_cache_fetch (&stieltjes_cache, gam[n], n);
+			continue;
+		}
+		if (fp_cache_get (STIELTJES_DB_NAME, gam[n], n, prec))
+		{
+			fp_one_d_cache_store (&stieltjes_cache, gam[n], n, prec);
+			continue;
+		}
+		break;
+	}
+	if (nmax < n) return;
+
+	stieltjes_compute (gam, nmax, prec);
+	for (n=0; n<=nmax; n++)
+	{
+		fp_one_d_cache_store (&stieltjes_cache, gam[n], n, prec);
+		fp_cache_put (STIELTJES_DB_NAME, gam[n], n, prec);
+	}
+}
+
+void stieltjes_gamma (mpf_t gam, int n, int prec)
+{
+	if (0 > n) return;
+	if (fp_one_d_cache_check (&stieltjes_cache, n) >= prec)
+	{
+		fp_one_d_cache_fetch (&stieltjes_cache, gam, n);
+		return;
+	}
+
+	int k;
+	mpf_t *gees = (mpf_t *) malloc ((n+1) * sizeof (mpf_t));
+	for (k=0; k<=n; k++) mpf_init2 (gees[k], mpf_get_prec (gam));
+	stieltjes_gamma_range (gees, n, prec);
+	mpf_set (gam, gees[n]);
+	for (k=0; k<=n; k++) mpf_clear (gees[k]);
+	free (gees);
 }
-#endif
 
 /* =============================== END OF FILE =========================== */
 
@@ -34,6 +34,13 @@ extern "C" {
 /** Bernoulli number B_n given as a fixed-point number. */
 void q_bernoulli (mpq_t bern, int n);
 
+/**
+ * fp_bernoulli -- Bernoulli number B_n, to prec decimal places.
+ * Much faster than q_bernoulli for large n, as it avoids the huge
+ * exact numerators and denominators. Results are cached.
+ */
+void fp_bernoulli (mpf_t bern, int n, int prec);
+
 /** Compute and return the "exact" result for the zeta function for 
  * any value of even n. Computed to `prec` decimal places.
  * Zeta at the even values of n can be given exactly as a product of
@@ -50,6 +57,16 @@ void fp_zeta_even (mpf_t zeta, unsigned int n, int prec);
  */
 void fp_zeta (mpf_t zeta, unsigned int s, int prec);
 
+/**
+ * fp_zeta_range -- zeta(s) for every integer smin <= s <= smax.
+ *
+ * The result for s is placed in zeta[s-smin]. Same values as repeated
+ * calls to fp_zeta, but the work is shared across s, and so is much
+ * faster for long runs. The results are placed in the same in-memory
+ * cache that fp_zeta uses; values already in that cache are reused.
+ */
+void fp_zeta_range (mpf_t *zeta, unsigned int smin, unsigned int smax, int prec);
+
 /** Same, using Helmut Hasse convergent algo. */
 void fp_hasse_zeta (mpf_t zeta, unsigned int s, int prec);
 
@@ -62,9 +79,46 @@ void fp_borwein_zeta (mpf_t zeta, unsigned int s, int prec);
  * Compute and return a value for the Riemann zeta function, for
  * a complex value of 's'. Uses the  P. Borwein algorithm for 
  * rapid computation.
+ *
+ * High up on the critical line, the Riemann-Siegel formula is used
+ * instead, whenever it can provide the requested precision.
  */
 void cpx_borwein_zeta (cpx_t zeta, const cpx_t ess, int prec);
 
+/**
+ * fp_riemann_siegel_theta -- Riemann-Siegel theta function.
+ *
+ * Computed from its asymptotic expansion, for large t, and from
+ * log Gamma(1/4+it/2) for small t.
+ */
+void fp_riemann_siegel_theta (mpf_t theta, const mpf_t t, int prec);
+
+/**
+ * fp_riemann_siegel_z -- Hardy Z function, Z(t) = exp(i theta(t)) zeta(1/2+it)
+ *
+ * Uses the Riemann-Siegel formula, with Gabcke's corrections through
+ * the C_4 term. The formula is asymptotic, and so the attainable
+ * precision is limited: about 7 digits at t=1000, 10 at t=10^4 and
+ * 13 at t=10^5. Returns zero on success. Returns non-zero, and leaves
+ * zee untouched, if t < 200 or if prec digits cannot be guaranteed.
+ *
+ * cpx_borwein_zeta uses this automatically, whenever it can.
+ */
+int fp_riemann_siegel_z (mpf_t zee, const mpf_t t, int prec);
+
+/**
+ * cpx_zeta_grid -- zeta(sigma + it) on an evenly spaced grid of t.
+ *
+ * Sets zeta[j] = zeta(sigma + i(t0 + j dt)) for 0 <= j < npts.
+ * On the critical line, wherever the Riemann-Siegel formula can
+ * deliver prec digits, the main sums for whole blocks of points are
+ * obtained together, with FFT's, in the manner of Odlyzko-Schonhage.
+ * The cost per point then grows only slowly with t. All other points
+ * are handed to cpx_borwein_zeta, one at a time.
+ */
+void cpx_zeta_grid (cpx_t *zeta, const mpf_t sigma, const mpf_t t0,
+                    const mpf_t dt, int npts, int prec);
+
 /**
  * cpx_borwein_zeta_cache -- Caching Riemann zeta for complex argument
  * 
@@ -79,15 +133,37 @@ void cpx_borwein_zeta (cpx_t zeta, const cpx_t ess, int prec);
  */
 void cpx_borwein_zeta_cache (cpx_t zeta, const cpx_t ess, unsigned int n, int prec);
 
-/** Brute-force summation. */
+/**
+ * fp_zeta_brute -- direct summation, with an Euler-Maclaurin tail.
+ * The direct sum is spread over mp_get_nthreads() threads; the
+ * result does not depend on the number of threads.
+ */
 void fp_zeta_brute (mpf_t zeta, unsigned int s, int prec);
 
-/* Stieltjes constants */
-// void stieltjes_gamma (mpf_t gam, int n);
+/**
+ * stieltjes_gamma -- the Stieltjes constant gamma_n, defined by
+ *    zeta(s) = 1/(s-1) + sum_n (-1)^n gamma_n (s-1)^n / n!
+ * so that gamma_0 is the Euler-Mascheroni constant.
+ *
+ * stieltjes_gamma_range -- gamma_0 through gamma_nmax, all at once.
+ * This costs hardly more than the single gamma_nmax; it is how the
+ * single value is computed, anyway.
+ *
+ * The values are accurate to prec decimal places, or to prec
+ * significant digits, whichever is looser. The big ones have many
+ * digits before the decimal point; make sure that the default
+ * precision has room for them. Results are cached, in RAM and on
+ * disk.
+ */
+void stieltjes_gamma (mpf_t gam, int n, int prec);
+void stieltjes_gamma_range (mpf_t *gam, int nmax, int prec);
 
 /**
  * Compute a_sub_n
  * the w argument is for the power bit -- 
+ *
+ * Both of these spread their terms across threads (see mp-thread.h);
+ * the results do not depend on the number of threads.
  */
 void a_sub_n (mpf_t a_n, mpf_t w, unsigned int n, unsigned int prec);
 void b_sub_n (mpf_t b_n, unsigned int n, unsigned int prec);
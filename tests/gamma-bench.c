@@ -0,0 +1,92 @@
+/*
+ * gamma-bench.c
+ *
+ * Timing of the complex gamma function, for |Im z| from 1 to 10^4,
+ * at several precisions. Away from the real axis, cpx_gamma uses
+ * Stirling's series, whose cost should not grow with |Im z|. For
+ * comparison, the last column is the time close to z=2, where the
+ * A&S series is used.
+ *
+ * Copyright (C) 2026 Linas Vepstas
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301  USA
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <gmp.h>
+#include "mp-complex.h"
+#include "mp-gamma.h"
+
+static double now (void)
+{
+	struct timespec ts;
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + 1.0e-9 * ts.tv_nsec;
+}
+
+/* msecs per call of cpx_gamma at x+iy, after a first, cold, call */
+static double timeit (cpx_t gam, cpx_t z, double x, double y, int prec)
+{
+	int n = 0;
+	cpx_set_d (z, x, y);
+	cpx_gamma (gam, z, prec);
+
+	double start = now ();
+	do
+	{
+		cpx_gamma (gam, z, prec);
+		n++;
+	} while (now() - start < 0.1);
+	return 1.0e3 * (now() - start) / n;
+}
+
+/* ==================================================================== */
+
+int main (int argc, char * argv[])
+{
+	int precs[] = {50, 100, 200, 400};
+	double tees[] = {1.0, 10.0, 100.0, 1.0e3, 1.0e4};
+	int ip, it;
+
+	printf ("#prec");
+	for (it=0; it<5; it++) printf ("\tt=%g", tees[it]);
+	printf ("\tz=2+0.2i\n");
+
+	for (ip=0; ip<4; ip++)
+	{
+		int prec = precs[ip];
+		mpf_set_default_prec (3.322 * prec + 50);
+
+		cpx_t z, gam;
+		cpx_init (z);
+		cpx_init (gam);
+
+		printf ("%d", prec);
+		for (it=0; it<5; it++)
+			printf ("\t%.3g", timeit (gam, z, 0.5, tees[it], prec));
+		printf ("\t%.3g\n", timeit (gam, z, 2.0, 0.2, prec));
+		fflush (stdout);
+
+		cpx_clear (z);
+		cpx_clear (gam);
+	}
+
+	return 0;
+}
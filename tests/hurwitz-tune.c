@@ -0,0 +1,156 @@
+/*
+ * hurwitz-tune.c
+ *
+ * Autotuning for cpx_hurwitz_auto(). Times each of the Hurwitz zeta
+ * methods, cold (first call at a new s) and warm (further calls at
+ * the same s), at several precisions, and divides by the term counts
+ * from cpx_hurwitz_terms() to get the cost per term. The result is
+ * written out as a new mp-hurwitz-tune.h:
+ *
+ *    ./hurwitz-tune > ../src/mp-hurwitz-tune.h
+ *
+ * Copyright (C) 2026 Linas Vepstas
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301  USA
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <gmp.h>
+#include "mp-complex.h"
+#include "mp-polylog.h"
+
+static double now (void)
+{
+	struct timespec ts;
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + 1.0e-9 * ts.tv_nsec;
+}
+
+static const char *names[HURWITZ_NMETHODS] = {"periodic", "taylor", "euler"};
+
+static void call (int m, cpx_t out, cpx_t s, cpx_t q, int prec)
+{
+	if (HURWITZ_PERIODIC == m) cpx_hurwitz_zeta (out, s, q[0].re, prec);
+	else if (HURWITZ_TAYLOR == m) cpx_hurwitz_taylor (out, s, q, prec);
+	else cpx_hurwitz_euler (out, s, q, prec);
+}
+
+/* ==================================================================== */
+
+int main (int argc, char * argv[])
+{
+	int precs[] = {15, 30, 60, 120};
+	double tees[] = {1.0, 10.0, 30.0};
+	int nprec = 4, ntee = 3;
+	int ip, it, m, j;
+	int fresh = 0;
+	double table[4][7];
+
+	for (ip=0; ip<nprec; ip++)
+	{
+		int prec = precs[ip];
+		mpf_set_default_prec (3.322 * prec + 50);
+
+		cpx_t s, q, out;
+		cpx_init (s);
+		cpx_init (q);
+		cpx_init (out);
+
+		table[ip][0] = prec;
+		for (m=0; m<HURWITZ_NMETHODS; m++)
+		{
+			double ctime = 0.0, cterms = 0.0;
+			double stime = 0.0, sterms = 0.0;
+			double setup, percall;
+
+			/* A cold call and then warm calls, on a fresh s for each t */
+			double cold[3], coldcall[3], coldsetup[3];
+			for (it=0; it<ntee; it++)
+			{
+				/* The cold call takes the largest q, so that the
+				 * warm calls need no more of the per-s caches. */
+				cpx_set_d (s, 0.6 + 1.0e-7 * (++fresh), tees[it]);
+				cpx_set_d (q, 0.40, 0.0);
+				if (!cpx_hurwitz_terms (m, s, q, prec, &setup, &percall))
+				{
+					cold[it] = -1.0;
+					continue;
+				}
+				double start = now ();
+				call (m, out, s, q, prec);
+				cold[it] = now() - start;
+				coldcall[it] = percall;
+				coldsetup[it] = setup;
+
+				start = now ();
+				j = 0;
+				do
+				{
+					cpx_set_d (q, 0.30 + 0.01 * (j%10), 0.0);
+					cpx_hurwitz_terms (m, s, q, prec, &setup, &percall);
+					call (m, out, s, q, prec);
+					cterms += percall;
+					j++;
+				} while (j < 3 || now() - start < 0.05);
+				ctime += now() - start;
+			}
+			double ucall = (0.0 < cterms) ? 1.0e6 * ctime / cterms : 0.0;
+
+			/* Whatever the cold call spent beyond a warm call */
+			for (it=0; it<ntee; it++)
+			{
+				if (cold[it] < 0.0 || 0.0 >= coldsetup[it]) continue;
+				double extra = 1.0e6 * cold[it] - ucall * coldcall[it];
+				if (0.0 < extra) stime += extra;
+				sterms += coldsetup[it];
+			}
+			double usetup = (0.0 < sterms) ? stime / sterms : 0.0;
+
+			table[ip][2*m+1] = usetup;
+			table[ip][2*m+2] = ucall;
+			fprintf (stderr, "prec=%d %s: setup %g usec/term, call %g usec/term\n",
+			         prec, names[m], usetup, ucall);
+		}
+
+		cpx_clear (s);
+		cpx_clear (q);
+		cpx_clear (out);
+	}
+
+	printf ("/*\n"
+	        " * mp-hurwitz-tune.h\n"
+	        " *\n"
+	        " * Tuning table for cpx_hurwitz_auto(). Written by tests/hurwitz-tune;\n"
+	        " * rerun that, and replace this file, to tune for another machine.\n"
+	        " */\n"
+	        "#define HURWITZ_TUNE_ROWS %d\n\n"
+	        "/* prec, then microseconds per term for the setup and per-call cost\n"
+	        " * of the periodic zeta, Taylor and Euler-Maclaurin methods. */\n"
+	        "static const double hurwitz_tune[HURWITZ_TUNE_ROWS][7] = {\n", nprec);
+	for (ip=0; ip<nprec; ip++)
+	{
+		printf ("\t{%d", precs[ip]);
+		for (j=1; j<7; j++) printf (", %.4g", table[ip][j]);
+		printf ("},\n");
+	}
+	printf ("};\n");
+
+	return 0;
+}
@@ -0,0 +1,78 @@
+/*
+ * stieltjes-bench.c
+ *
+ * Timing of the Stieltjes constants gamma_0 .. gamma_N, computed in
+ * one batch, for a few N at the given precision. The results land in
+ * the disk cache "db-stieltjes.db"; remove it to time them afresh.
+ *
+ * Usage: stieltjes-bench [nmax [prec]]
+ *
+ * Copyright (C) 2026 Linas Vepstas
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301  USA
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <gmp.h>
+#include "mp-zeta.h"
+
+static double now (void)
+{
+	struct timespec ts;
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + 1.0e-9 * ts.tv_nsec;
+}
+
+/* ==================================================================== */
+
+int main (int argc, char * argv[])
+{
+	int nmax = 1000;
+	int prec = 300;
+	int n;
+
+	if (1 < argc) nmax = atoi (argv[1]);
+	if (2 < argc) prec = atoi (argv[2]);
+
+	/* The big ones have about n log log n / log 10 digits before
+	 * the decimal point. */
+	mpf_set_default_prec (3.322 * (prec + nmax) + 100);
+
+	mpf_t *gam = (mpf_t *) malloc ((nmax+1) * sizeof (mpf_t));
+	for (n=0; n<=nmax; n++) mpf_init (gam[n]);
+
+	int top;
+	for (top = 10; top <= nmax; top *= 10)
+	{
+		double start = now ();
+		stieltjes_gamma_range (gam, top, prec);
+		double tot = now() - start;
+
+		printf ("gamma_0..gamma_%d prec=%d: %g secs, %g msecs/constant\n",
+		        top, prec, tot, 1.0e3 * tot / (top+1));
+		gmp_printf ("\tgamma_%d = %.30Fe\n", top, gam[top]);
+		fflush (stdout);
+	}
+
+	for (n=0; n<=nmax; n++) mpf_clear (gam[n]);
+	free (gam);
+
+	return 0;
+}
@@ -43,8 +43,10 @@ double tgamma (double);  // libc is missing the correct prototype
 #include "mp-hyper.h"
 #include "mp-misc.h"
 #include "mp-polylog.h"
+#include "mp-thread.h"
 #include "mp-trig.h"
 #include "mp-zeta.h"
+#include "mp-zerofind.h"
 
 /* ==================================================================== */
 
@@ -1582,6 +1584,1543 @@ int test_hurwitz_zeta (int nterms, int prec)
 	return nfaults;
 }
 
+/* ==================================================================== */
+/**
+ * test_fp_zeta_range() -- the batch zeta values should agree with
+ * the one-at-a-time algorithms, including the brute-force sum, for s
+ * both below and above the point where the brute-force sum takes over.
+ */
+int test_fp_zeta_range (int nterms, int prec)
+{
+	int nfaults = 0;
+	unsigned int s;
+
+	/* Go far enough out that the brute-force sum is used */
+	unsigned int smax = nterms + prec/3 + 10;
+
+	mpf_t epsi, zeta;
+	mpf_init (epsi);
+	mpf_init (zeta);
+	fp_epsilon (epsi, prec-2);
+
+	mpf_t *zees = (mpf_t *) malloc ((smax-1) * sizeof (mpf_t));
+	for (s=2; s<=smax; s++) mpf_init (zees[s-2]);
+	fp_zeta_range (zees, 2, smax, prec);
+
+	for (s=2; s<=smax; s++)
+	{
+		if (0 == s%2) fp_zeta_even (zeta, s, prec);
+		else fp_borwein_zeta (zeta, s, prec);
+		mpf_sub (zeta, zeta, zees[s-2]);
+		nfaults = check_for_zero (nfaults, zeta, epsi, "zeta range", s);
+
+		fp_zeta_brute (zeta, s, prec);
+		mpf_sub (zeta, zeta, zees[s-2]);
+		nfaults = check_for_zero (nfaults, zeta, epsi, "zeta brute", s);
+	}
+
+	for (s=2; s<=smax; s++) mpf_clear (zees[s-2]);
+	free (zees);
+	mpf_clear (epsi);
+	mpf_clear (zeta);
+
+	if (0 == nfaults)
+	{
+		fprintf(stderr, "Zeta range test passed!\n");
+	}
+	return nfaults;
+}
+
+/* ==================================================================== */
+/**
+ * test_stieltjes() -- gamma_0 is the Euler-Mascheroni constant, and
+ * the Laurent series about s=1, summed at s = 1+1/64, should give
+ * zeta there. Single values should agree with the batch. The Laurent
+ * series only sees the first dozen or so; a few large n are checked
+ * against known values.
+ */
+int test_stieltjes (int nterms, int prec)
+{
+	int nfaults = 0;
+	int n;
+	int nmax = prec/2 + 5;
+
+	mpf_t epsi, val, term, g;
+	mpf_init (epsi);
+	mpf_init (val);
+	mpf_init (term);
+	mpf_init (g);
+	fp_epsilon (epsi, prec-5);
+
+	mpf_t *gam = (mpf_t *) malloc ((nmax+1) * sizeof (mpf_t));
+	for (n=0; n<=nmax; n++) mpf_init (gam[n]);
+	stieltjes_gamma_range (gam, nmax, prec);
+
+	fp_euler_mascheroni (val, prec);
+	mpf_sub (val, val, gam[0]);
+	nfaults = check_for_zero (nfaults, val, epsi, "Stieltjes gamma_0", 0.0);
+
+	/* sum_n (-1)^n gamma_n eps^n / n! + 1/eps */
+	mpf_set_ui (val, 64);
+	mpf_set_ui (term, 1);
+	for (n=0; n<=nmax; n++)
+	{
+		mpf_mul (g, gam[n], term);
+		mpf_add (val, val, g);
+		mpf_div_ui (term, term, 64*(n+1));
+		mpf_neg (term, term);
+	}
+
+	cpx_t ess, zeta;
+	cpx_init (ess);
+	cpx_init (zeta);
+	cpx_set_ui (ess, 1, 0);
+	mpf_set_ui (term, 1);
+	mpf_div_ui (term, term, 64);
+	mpf_add (ess[0].re, ess[0].re, term);
+	cpx_borwein_zeta (zeta, ess, prec);
+	mpf_sub (val, val, zeta[0].re);
+	nfaults = check_for_zero (nfaults, val, epsi, "Stieltjes Laurent series", 1.0/64);
+
+	/* The cached values hold prec significant digits; ask for more,
+	 * so that they are computed anew, and not just read back. */
+	for (n=0; n<=nmax; n+=7)
+	{
+		stieltjes_gamma (val, n, prec+3);
+		mpf_sub (val, val, gam[n]);
+		mpf_abs (g, gam[n]);
+		if (0 < mpf_cmp_ui (g, 1)) mpf_div (val, val, g);
+		nfaults = check_for_zero (nfaults, val, epsi, "Stieltjes single", n);
+	}
+
+	int large[] = {30, 60, 100, 150, 200};
+	char * known[] = {
+		"0.0035577288555731609479135377489084026108",
+		"98543.254590146042110932114289417115317",
+		"-425340157170802696.23144385197278358247",
+		"802885373150684299325664642598989201.48",
+		"-6.9746497194788228686243330694268145845e55" };
+	int kprec = (prec < 36) ? prec : 36;
+	fp_epsilon (epsi, kprec-3);
+	for (n=0; n<5; n++)
+	{
+		stieltjes_gamma (val, large[n], kprec);
+		mpf_set_str (g, known[n], 10);
+		mpf_sub (val, val, g);
+		mpf_div (val, val, g);
+		nfaults = check_for_zero (nfaults, val, epsi, "Stieltjes large n", large[n]);
+	}
+
+	for (n=0; n<=nmax; n++) mpf_clear (gam[n]);
+	free (gam);
+	cpx_clear (ess);
+	cpx_clear (zeta);
+	mpf_clear (epsi);
+	mpf_clear (val);
+	mpf_clear (term);
+	mpf_clear (g);
+
+	if (0 == nfaults)
+	{
+		fprintf(stderr, "Stieltjes constants test passed!\n");
+	}
+	return nfaults;
+}
+
+/* ==================================================================== */
+/**
+ * test_riemann_siegel() -- zeta high up on the critical line, where
+ * cpx_borwein_zeta switches over to the Riemann-Siegel formula.
+ * Checks known zeros, and one value, at the precision that the
+ * Riemann-Siegel error bound allows.
+ */
+int test_riemann_siegel (int nterms, int prec)
+{
+	int nfaults = 0;
+	int i;
+
+	char * zero[] = {
+		"1419.4224809459956864659890380799168",
+		"1420.4165263237511360343752509329152",
+		"9877.7826540055011427740990706901236",
+		"74920.827498994186793849200946918347" };
+	int zprec[] = {8, 8, 10, 12};
+
+	mpf_t epsi;
+	mpf_init (epsi);
+
+	cpx_t zeta, ess;
+	cpx_init (zeta);
+	cpx_init (ess);
+
+	for (i=0; i<4; i++)
+	{
+		fp_epsilon (epsi, zprec[i]-1);
+		mpf_set_d (ess[0].re, 0.5);
+		mpf_set_str (ess[0].im, zero[i], 10);
+		cpx_borwein_zeta (zeta, ess, zprec[i]);
+		nfaults = cpx_check_for_zero (nfaults, zeta, epsi,
+		     "Riemann-Siegel at zeros", i, 0.5, mpf_get_d (ess[0].im));
+	}
+
+	/* zeta(1/2 + 10000 i) */
+	fp_epsilon (epsi, 9);
+	cpx_set_d (ess, 0.5, -10000.0);
+	cpx_borwein_zeta (zeta, ess, 10);
+	mpf_set_str (ess[0].re, "-0.33937380263883445756747107794598938", 10);
+	mpf_set_str (ess[0].im, "0.037091505973206031474344206813012023", 10);
+	cpx_sub (zeta, zeta, ess);
+	nfaults = cpx_check_for_zero (nfaults, zeta, epsi,
+		     "Riemann-Siegel value", 0, 0.5, -10000.0);
+
+	mpf_clear (epsi);
+	cpx_clear (zeta);
+	cpx_clear (ess);
+
+	if (0 == nfaults)
+	{
+		fprintf(stderr, "Riemann-Siegel test passed!\n");
+	}
+	return nfaults;
+}
+
+/* ==================================================================== */
+/**
+ * test_zeta_grid() -- compare the FFT-based multi-evaluation of zeta
+ * along the critical line to the one-at-a-time values.
+ */
+int test_zeta_grid (int nterms, int prec)
+{
+	int nfaults = 0;
+	int gprec = 11;
+	int npts = 4*nterms;
+	int j;
+
+	mpf_t epsi, sigma, t0, dt;
+	mpf_init (epsi);
+	mpf_init (sigma);
+	mpf_init (t0);
+	mpf_init (dt);
+	fp_epsilon (epsi, gprec);
+
+	cpx_t ess, zeta;
+	cpx_init (ess);
+	cpx_init (zeta);
+
+	cpx_t *grid = (cpx_t *) malloc (npts * sizeof (cpx_t));
+	for (j=0; j<npts; j++) cpx_init (grid[j]);
+
+	mpf_set_d (sigma, 0.5);
+	mpf_set_d (t0, 20000.0);
+	mpf_set_d (dt, 0.037);
+	cpx_zeta_grid (grid, sigma, t0, dt, npts, gprec);
+
+	for (j=0; j<npts; j++)
+	{
+		mpf_set (ess[0].re, sigma);
+		mpf_mul_ui (ess[0].im, dt, j);
+		mpf_add (ess[0].im, ess[0].im, t0);
+		cpx_borwein_zeta (zeta, ess, gprec);
+		cpx_sub (zeta, zeta, grid[j]);
+		nfaults = cpx_check_for_zero (nfaults, zeta, epsi, "zeta grid",
+		                  j, 0.5, mpf_get_d (ess[0].im));
+	}
+
+	for (j=0; j<npts; j++) cpx_clear (grid[j]);
+	free (grid);
+	mpf_clear (epsi);
+	mpf_clear (sigma);
+	mpf_clear (t0);
+	mpf_clear (dt);
+	cpx_clear (ess);
+	cpx_clear (zeta);
+
+	if (0 == nfaults)
+	{
+		fprintf(stderr, "Zeta grid test passed!\n");
+	}
+	return nfaults;
+}
+
+/* ==================================================================== */
+/**
+ * test_lowprec() -- compare the double and double-double fast paths
+ * of polylog, periodic zeta and gamma against the GMP results.
+ */
+int test_lowprec (int nterms, int prec)
+{
+	int nfaults = 0;
+	int lowprec[] = {12, 25};
+	int ip;
+
+	mpf_t epsi, q;
+	mpf_init (epsi);
+	mpf_init (q);
+
+	cpx_t s, z, lo, hi;
+	cpx_init (s);
+	cpx_init (z);
+	cpx_init (lo);
+	cpx_init (hi);
+
+	for (ip=0; ip<2; ip++)
+	{
+		int lp = lowprec[ip];
+		fp_epsilon (epsi, lp-2);
+
+		double sre, sim, t;
+		for (sre = -1.3; sre < 4.0; sre += 5.3/nterms)
+		{
+			for (sim = -0.3; sim < 30.0; sim += 30.3/nterms)
+			{
+				cpx_set_d (s, sre, sim);
+
+				/* polylog inside the unit circle */
+				for (t=0.1; t<6.28; t += 0.77)
+				{
+					cpx_set_d (z, 0.8*cos(t), 0.8*sin(t));
+					cpx_polylog (lo, s, z, lp);
+					cpx_polylog (hi, s, z, prec);
+					cpx_sub (lo, lo, hi);
+					cpx_div (lo, lo, hi);
+					nfaults = cpx_check_for_zero (nfaults, lo, epsi, "lowprec polylog", lp, sre, sim);
+				}
+
+				for (t=0.03; t<1.0; t += 0.171)
+				{
+					mpf_set_d (q, t);
+					cpx_periodic_zeta (lo, s, q, lp);
+					cpx_periodic_zeta (hi, s, q, prec);
+					cpx_sub (lo, lo, hi);
+					cpx_div (lo, lo, hi);
+					nfaults = cpx_check_for_zero (nfaults, lo, epsi, "lowprec periodic zeta", lp, sre, sim);
+				}
+
+				cpx_set_d (z, 3.0*sre, sim);
+				cpx_gamma (lo, z, lp);
+				cpx_gamma (hi, z, prec);
+				cpx_sub (lo, lo, hi);
+				cpx_div (lo, lo, hi);
+				nfaults = cpx_check_for_zero (nfaults, lo, epsi, "lowprec gamma", lp, sre, sim);
+			}
+		}
+	}
+	if (nfaults) fprintf(stderr, "---\n");
+
+	mpf_clear (epsi);
+	mpf_clear (q);
+	cpx_clear (s);
+	cpx_clear (z);
+	cpx_clear (lo);
+	cpx_clear (hi);
+
+	if (0 == nfaults)
+	{
+		fprintf(stderr, "Low precision test passed!\n");
+	}
+	return nfaults;
+}
+
+/* ==================================================================== */
+/**
+ * test_polylog_grid() -- compare the double-precision grid kernels
+ * against cpx_polylog() and cpx_periodic_zeta().
+ */
+int test_polylog_grid (int nterms, int prec)
+{
+	int nfaults = 0;
+	int gprec = 8;
+	int npts = nterms*nterms;
+	int i;
+
+	double *zee = (double *) malloc (2*npts * sizeof (double));
+	double *que = (double *) malloc (npts * sizeof (double));
+	double *out = (double *) malloc (2*npts * sizeof (double));
+	double *pzo = (double *) malloc (2*npts * sizeof (double));
+
+	for (i=0; i<npts; i++)
+	{
+		double r = 0.95 * (i/nterms + 1) / (nterms + 1);
+		double t = 6.2831853 * (i % nterms) / nterms;
+		zee[2*i] = r * cos (t);
+		zee[2*i+1] = r * sin (t);
+		que[i] = (i + 0.5) / npts;
+	}
+
+	mpf_t epsi, q;
+	mpf_init (epsi);
+	mpf_init (q);
+	fp_epsilon (epsi, gprec-1);
+
+	cpx_t s, z, val;
+	cpx_init (s);
+	cpx_init (z);
+	cpx_init (val);
+
+	double sre, sim;
+	for (sre = -0.7; sre < 3.0; sre += 1.2)
+	{
+		for (sim = 0.3; sim < 15.0; sim += 4.6)
+		{
+			cpx_set_d (s, sre, sim);
+			polylog_grid_d (out, sre, sim, zee, npts, gprec);
+			periodic_zeta_grid_d (pzo, sre, sim, que, npts, gprec);
+
+			for (i=0; i<npts; i+=7)
+			{
+				cpx_set_d (z, zee[2*i], zee[2*i+1]);
+				cpx_polylog (val, s, z, prec);
+				cpx_set_d (z, out[2*i], out[2*i+1]);
+				cpx_sub (z, z, val);
+				cpx_div (z, z, val);
+				nfaults = cpx_check_for_zero (nfaults, z, epsi, "polylog grid", i, sre, sim);
+
+				mpf_set_d (q, que[i]);
+				cpx_periodic_zeta (val, s, q, prec);
+				cpx_set_d (z, pzo[2*i], pzo[2*i+1]);
+				cpx_sub (z, z, val);
+				cpx_div (z, z, val);
+				nfaults = cpx_check_for_zero (nfaults, z, epsi, "periodic zeta grid", i, sre, sim);
+			}
+		}
+	}
+	if (nfaults) fprintf(stderr, "---\n");
+
+	free (zee);
+	free (que);
+	free (out);
+	free (pzo);
+	mpf_clear (epsi);
+	mpf_clear (q);
+	cpx_clear (s);
+	cpx_clear (z);
+	cpx_clear (val);
+
+	if (0 == nfaults)
+	{
+		fprintf(stderr, "Polylog grid test passed!\n");
+	}
+	return nfaults;
+}
+
+/* ==================================================================== */
+/**
+ * check_threads() -- evaluate njobs values, first serially, then on
+ * four threads at once, with neighbouring jobs on different threads;
+ * the two must agree. The eval callback takes the job's s and z.
+ */
+typedef void (*threads_eval_fn) (cpx_t, const cpx_t, const cpx_t, int);
+
+typedef struct
+{
+	threads_eval_fn eval;
+	cpx_t *ess;
+	cpx_t *zee;
+	cpx_t *val;
+	int prec;
+} threads_ctx;
+
+static void threads_job (void *arg, int job)
+{
+	threads_ctx *ctx = (threads_ctx *) arg;
+	ctx->eval (ctx->val[job], ctx->ess[job], ctx->zee[job], ctx->prec);
+}
+
+static int check_threads (threads_eval_fn eval, cpx_t *ess, cpx_t *zee,
+                          int njobs, int prec, char *what)
+{
+	int nfaults = 0;
+	int j;
+
+	threads_ctx ctx;
+	ctx.eval = eval;
+	ctx.ess = ess;
+	ctx.zee = zee;
+	ctx.val = (cpx_t *) malloc (njobs * sizeof (cpx_t));
+	ctx.prec = prec;
+
+	cpx_t *serial = (cpx_t *) malloc (njobs * sizeof (cpx_t));
+	for (j=0; j<njobs; j++)
+	{
+		cpx_init (ctx.val[j]);
+		cpx_init (serial[j]);
+		eval (serial[j], ess[j], zee[j], prec);
+	}
+
+	int nthr = mp_get_nthreads ();
+	mp_set_nthreads (4);
+	mp_parallel_for (njobs, threads_job, &ctx);
+	mp_set_nthreads (nthr);
+
+	/* Which values are cache hits depends on the order of the calls,
+	 * and so the last few digits may differ. */
+	mpf_t epsi;
+	mpf_init (epsi);
+	fp_epsilon (epsi, prec-4);
+
+	cpx_t diff;
+	cpx_init (diff);
+	for (j=0; j<njobs; j++)
+	{
+		cpx_sub (diff, ctx.val[j], serial[j]);
+		cpx_div (diff, diff, serial[j]);
+		nfaults = cpx_check_for_zero (nfaults, diff, epsi, what, j,
+		                  cpx_get_re (zee[j]), cpx_get_im (zee[j]));
+	}
+	if (nfaults) fprintf(stderr, "---\n");
+
+	for (j=0; j<njobs; j++)
+	{
+		cpx_clear (ctx.val[j]);
+		cpx_clear (serial[j]);
+	}
+	free (ctx.val);
+	free (serial);
+	cpx_clear (diff);
+	mpf_clear (epsi);
+	return nfaults;
+}
+
+/* ==================================================================== */
+/**
+ * test_polylog_threads() -- polylog from many threads at once.
+ *
+ * The polylog keeps state keyed on the last s (powers, gamma, zeta
+ * values). Threads that interleave different values of s must not
+ * see each other's state; the results must agree with a serial run.
+ */
+static void threads_polylog (cpx_t val, const cpx_t ess, const cpx_t zee, int prec)
+{
+	cpx_polylog (val, ess, zee, prec);
+}
+
+int test_polylog_threads (int nterms, int prec)
+{
+	int nfaults = 0;
+	int njobs = 24;
+	int j;
+
+	cpx_t *ess = (cpx_t *) malloc (njobs * sizeof (cpx_t));
+	cpx_t *zee = (cpx_t *) malloc (njobs * sizeof (cpx_t));
+	double mags[] = {0.4, 0.9, 1.3, 2.5};
+	for (j=0; j<njobs; j++)
+	{
+		cpx_init (ess[j]);
+		cpx_init (zee[j]);
+
+		/* Neighbouring jobs use different s, so that threads
+		 * interleave them. */
+		cpx_set_d (ess[j], 0.3 + 0.4*(j%3), 1.1 + 2.3*(j%4));
+		double r = mags[(j/3)%4];
+		double t = 0.5 + 0.9*j;
+		cpx_set_d (zee[j], r*cos(t), r*sin(t));
+	}
+
+	nfaults = check_threads (threads_polylog, ess, zee, njobs, prec,
+	                         "threaded polylog");
+
+	for (j=0; j<njobs; j++)
+	{
+		cpx_clear (ess[j]);
+		cpx_clear (zee[j]);
+	}
+	free (ess);
+	free (zee);
+
+	if (0 == nfaults)
+	{
+		fprintf(stderr, "Threaded polylog test passed!\n");
+	}
+	return nfaults;
+}
+
+/* ==================================================================== */
+/**
+ * test_cpx_polylog_grid() -- the polylog grid must agree with
+ * cpx_polylog() taken one point at a time. The grid corners are
+ * chosen so that all of the points are exact binary fractions.
+ */
+int test_cpx_polylog_grid (int nterms, int prec)
+{
+	int nfaults = 0;
+	int nx = 5, ny = 4;
+	int i, j;
+
+	cpx_t ess, zll, zur, zee, val, diff;
+	cpx_init (ess);
+	cpx_init (zll);
+	cpx_init (zur);
+	cpx_init (zee);
+	cpx_init (val);
+	cpx_init (diff);
+
+	cpx_set_d (ess, 0.5, 3.7);
+	cpx_set_d (zll, -1.5, -1.25);
+	cpx_set_d (zur, 2.5, 1.75);
+
+	cpx_t *grid = (cpx_t *) malloc (nx*ny * sizeof (cpx_t));
+	for (i=0; i<nx*ny; i++) cpx_init (grid[i]);
+
+	int nfail = cpx_polylog_grid (grid, ess, zll, zur, nx, ny, prec, 4);
+	if (nfail)
+	{
+		nfaults ++;
+		fprintf(stderr, "Error: polylog grid failed at %d points\n", nfail);
+	}
+
+	mpf_t epsi;
+	mpf_init (epsi);
+	fp_epsilon (epsi, prec-4);
+
+	for (j=0; j<ny; j++)
+	{
+		for (i=0; i<nx; i++)
+		{
+			cpx_set_d (zee, -1.5 + i, -1.25 + j);
+			cpx_polylog (val, ess, zee, prec);
+			cpx_sub (diff, grid[j*nx+i], val);
+			cpx_div (diff, diff, val);
+			nfaults = cpx_check_for_zero (nfaults, diff, epsi, "polylog grid", i,
+			                  cpx_get_re (zee), cpx_get_im (zee));
+		}
+	}
+	if (nfaults) fprintf(stderr, "---\n");
+
+	for (i=0; i<nx*ny; i++) cpx_clear (grid[i]);
+	free (grid);
+	cpx_clear (ess);
+	cpx_clear (zll);
+	cpx_clear (zur);
+	cpx_clear (zee);
+	cpx_clear (val);
+	cpx_clear (diff);
+	mpf_clear (epsi);
+
+	if (0 == nfaults)
+	{
+		fprintf(stderr, "Polylog grid test passed!\n");
+	}
+	return nfaults;
+}
+
+/* ==================================================================== */
+/**
+ * test_polylog_memo() -- a sweep of the periodic zeta over q=k/N
+ * must come out the same with the memo table on, and must actually
+ * find the subproblems that repeat.
+ */
+int test_polylog_memo (int nterms, int prec)
+{
+	int nfaults = 0;
+	int npts = 16;
+	int k;
+
+	cpx_t ess, val, diff;
+	cpx_init (ess);
+	cpx_init (val);
+	cpx_init (diff);
+	cpx_set_d (ess, 0.5, 14.0);
+
+	mpf_t que, epsi;
+	mpf_init (que);
+	mpf_init (epsi);
+	fp_epsilon (epsi, prec-4);
+
+	cpx_t *plain = (cpx_t *) malloc (npts * sizeof (cpx_t));
+	for (k=1; k<npts; k++)
+	{
+		cpx_init (plain[k]);
+		mpf_set_ui (que, k);
+		mpf_div_ui (que, que, npts);
+		cpx_periodic_zeta (plain[k], ess, que, prec);
+	}
+
+	cpx_polylog_memo (1);
+	cpx_polylog_memo_stats (NULL, NULL, 1);
+	for (k=1; k<npts; k++)
+	{
+		mpf_set_ui (que, k);
+		mpf_div_ui (que, que, npts);
+		cpx_periodic_zeta (val, ess, que, prec);
+
+		cpx_sub (diff, val, plain[k]);
+		cpx_div (diff, diff, plain[k]);
+		nfaults = cpx_check_for_zero (nfaults, diff, epsi, "memoized periodic zeta", k,
+		                  mpf_get_d (que), 0.0);
+	}
+
+	unsigned long lookups, hits;
+	cpx_polylog_memo_stats (&lookups, &hits, 1);
+	cpx_polylog_memo (0);
+	if (0 == hits)
+	{
+		nfaults ++;
+		fprintf(stderr, "Error: polylog memo had no hits in %lu lookups\n", lookups);
+	}
+	if (nfaults) fprintf(stderr, "---\n");
+
+	for (k=1; k<npts; k++) cpx_clear (plain[k]);
+	free (plain);
+	cpx_clear (ess);
+	cpx_clear (val);
+	cpx_clear (diff);
+	mpf_clear (que);
+	mpf_clear (epsi);
+
+	if (0 == nfaults)
+	{
+		fprintf(stderr, "Polylog memo test passed!\n");
+	}
+	return nfaults;
+}
+
+/* ==================================================================== */
+/**
+ * test_periodic_zeta_batch() -- F(s,p/N) for all p at once, by way of
+ * the DFT, must agree with the polylog at z = exp(2pi i p/N), and with
+ * zeta(s) at p=0. Both the FFT (N a power of two) and the plain DFT
+ * are tried.
+ */
+int test_periodic_zeta_batch (int nterms, int prec)
+{
+	int nfaults = 0;
+	unsigned int lens[] = {6, 8};
+	int i;
+	unsigned int p;
+
+	cpx_t ess, zee, val, diff;
+	cpx_init (ess);
+	cpx_init (zee);
+	cpx_init (val);
+	cpx_init (diff);
+	cpx_set_d (ess, 0.5, 14.0);
+
+	mpf_t ang, epsi;
+	mpf_init (ang);
+	mpf_init (epsi);
+	fp_epsilon (epsi, prec-4);
+
+	for (i=0; i<2; i++)
+	{
+		unsigned int N = lens[i];
+		cpx_t *batch = (cpx_t *) malloc (N * sizeof (cpx_t));
+		for (p=0; p<N; p++) cpx_init (batch[p]);
+
+		cpx_periodic_zeta_batch (batch, ess, N, prec);
+		for (p=0; p<N; p++)
+		{
+			if (0 == p)
+			{
+				cpx_borwein_zeta (val, ess, prec);
+			}
+			else
+			{
+				fp_two_pi (ang, prec);
+				mpf_mul_ui (ang, ang, p);
+				mpf_div_ui (ang, ang, N);
+				fp_cosine (zee[0].re, ang, prec);
+				fp_sine (zee[0].im, ang, prec);
+				cpx_polylog (val, ess, zee, prec);
+			}
+			cpx_sub (diff, batch[p], val);
+			cpx_div (diff, diff, val);
+			nfaults = cpx_check_for_zero (nfaults, diff, epsi, "periodic zeta batch", p,
+			                  N, 0.0);
+		}
+
+		for (p=0; p<N; p++) cpx_clear (batch[p]);
+		free (batch);
+	}
+	if (nfaults) fprintf(stderr, "---\n");
+
+	cpx_clear (ess);
+	cpx_clear (zee);
+	cpx_clear (val);
+	cpx_clear (diff);
+	mpf_clear (ang);
+	mpf_clear (epsi);
+
+	if (0 == nfaults)
+	{
+		fprintf(stderr, "Periodic zeta batch test passed!\n");
+	}
+	return nfaults;
+}
+
+/* ==================================================================== */
+/**
+ * test_hurwitz_threads() -- Hurwitz zeta for several interleaved s,
+ * from many threads at once. The scale factors for each s are shared
+ * between the threads; the results must agree with a serial run.
+ */
+static void threads_hurwitz (cpx_t val, const cpx_t ess, const cpx_t que, int prec)
+{
+	cpx_hurwitz_zeta (val, ess, que[0].re, prec);
+}
+
+int test_hurwitz_threads (int nterms, int prec)
+{
+	int nfaults = 0;
+	int njobs = 18;
+	int j;
+
+	cpx_t *ess = (cpx_t *) malloc (njobs * sizeof (cpx_t));
+	cpx_t *que = (cpx_t *) malloc (njobs * sizeof (cpx_t));
+	for (j=0; j<njobs; j++)
+	{
+		cpx_init (ess[j]);
+		cpx_init (que[j]);
+
+		cpx_set_d (ess[j], 0.5 + 0.1*(j%3), 3.0 + 2.0*(j%3));
+		cpx_set_d (que[j], 0.1 + 0.05*j, 0.0);
+	}
+
+	nfaults = check_threads (threads_hurwitz, ess, que, njobs, prec,
+	                         "threaded hurwitz");
+
+	for (j=0; j<njobs; j++)
+	{
+		cpx_clear (ess[j]);
+		cpx_clear (que[j]);
+	}
+	free (ess);
+	free (que);
+
+	if (0 == nfaults)
+	{
+		fprintf(stderr, "Threaded Hurwitz test passed!\n");
+	}
+	return nfaults;
+}
+
+/* ==================================================================== */
+/**
+ * test_hurwitz_taylor_batch() -- the batched Taylor series must agree
+ * with one-at-a-time cpx_hurwitz_taylor, with cpx_hurwitz_zeta for
+ * real q, and with Euler-Maclaurin for complex q with Re q > 0; and it
+ * must flag a q outside of the domain of convergence. The q that are
+ * shifted down by one or more, into the strip, are 1.7+0.1i, 2.2-0.3i
+ * and 2.7.
+ */
+int test_hurwitz_taylor_batch (int nterms, int prec)
+{
+	int nfaults = 0;
+	int m = 7;
+	int j;
+	double qre[] = {0.3, -0.2, 1.7, 2.7, 0.1, 2.2, 0.5};
+	double qim[] = {0.0, 0.4, 0.1, 0.0, 0.7, -0.3, 0.9};
+
+	cpx_t ess, one, diff;
+	cpx_init (ess);
+	cpx_init (one);
+	cpx_init (diff);
+	cpx_set_d (ess, 0.6, 3.0);
+
+	cpx_t *que = (cpx_t *) malloc (m * sizeof (cpx_t));
+	cpx_t *out = (cpx_t *) malloc (m * sizeof (cpx_t));
+	for (j=0; j<m; j++)
+	{
+		cpx_init (que[j]);
+		cpx_init (out[j]);
+		cpx_set_d (que[j], qre[j], qim[j]);
+	}
+
+	int nbad = cpx_hurwitz_taylor_batch (out, ess, (const cpx_t *) que, m, prec);
+	if (1 != nbad)
+	{
+		nfaults ++;
+		fprintf(stderr, "Error: hurwitz taylor batch: expected 1 bad q, got %d\n", nbad);
+	}
+
+	mpf_t epsi, q;
+	mpf_init (epsi);
+	mpf_init (q);
+	fp_epsilon (epsi, prec-4);
+
+	for (j=0; j<m-1; j++)
+	{
+		cpx_hurwitz_taylor (one, ess, que[j], prec);
+		cpx_sub (diff, out[j], one);
+		cpx_div (diff, diff, one);
+		nfaults = cpx_check_for_zero (nfaults, diff, epsi, "hurwitz taylor batch", j,
+		                  qre[j], qim[j]);
+
+		/* Real q can be checked against the periodic-zeta route,
+		 * and complex q against Euler-Maclaurin */
+		if (0.0 == qim[j])
+		{
+			mpf_set_d (q, qre[j]);
+			cpx_hurwitz_zeta (one, ess, q, prec);
+		}
+		else if (0.0 < qre[j])
+		{
+			cpx_hurwitz_euler (one, ess, que[j], prec);
+		}
+		else continue;
+		cpx_sub (diff, out[j], one);
+		cpx_div (diff, diff, one);
+		nfaults = cpx_check_for_zero (nfaults, diff, epsi, "hurwitz taylor shift", j,
+		                  qre[j], qim[j]);
+	}
+	if (nfaults) fprintf(stderr, "---\n");
+
+	for (j=0; j<m; j++)
+	{
+		cpx_clear (que[j]);
+		cpx_clear (out[j]);
+	}
+	free (que);
+	free (out);
+	cpx_clear (ess);
+	cpx_clear (one);
+	cpx_clear (diff);
+	mpf_clear (epsi);
+	mpf_clear (q);
+
+	if (0 == nfaults)
+	{
+		fprintf(stderr, "Batched Hurwitz Taylor test passed!\n");
+	}
+	return nfaults;
+}
+
+/* ==================================================================== */
+/**
+ * test_hurwitz_auto() -- whichever method cpx_hurwitz_auto picks, it
+ * must agree with cpx_hurwitz_zeta for real q, and with the Taylor
+ * series for complex q. At s=1+11i the periodic zeta route does not
+ * converge, and must not be picked.
+ */
+int test_hurwitz_auto (int nterms, int prec)
+{
+	int nfaults = 0;
+	int i, j;
+	double sre[] = {0.6, -0.3, 1.0};
+	double sim[] = {2.0, 15.0, 11.0};
+	double qre[] = {0.3, 1.7, 0.95, 3.2, 0.2, 1.1};
+	double qim[] = {0.0, 0.0, 0.0, 0.0, 0.3, -0.2};
+
+	cpx_t ess, que, val, ref, diff;
+	cpx_init (ess);
+	cpx_init (que);
+	cpx_init (val);
+	cpx_init (ref);
+	cpx_init (diff);
+
+	mpf_t epsi;
+	mpf_init (epsi);
+	fp_epsilon (epsi, prec-4);
+
+	for (i=0; i<3; i++)
+	{
+		cpx_set_d (ess, sre[i], sim[i]);
+		for (j=0; j<6; j++)
+		{
+			cpx_set_d (que, qre[j], qim[j]);
+			int m = cpx_hurwitz_method (ess, que, prec);
+			if ((HURWITZ_PERIODIC == m) && (0.0 != qim[j] || 2 == i))
+			{
+				nfaults ++;
+				fprintf(stderr, "Error: hurwitz auto picked periodic at s=%g+i%g q=%g+i%g\n",
+				        sre[i], sim[i], qre[j], qim[j]);
+			}
+
+			if (cpx_hurwitz_auto (val, ess, que, prec))
+			{
+				nfaults ++;
+				fprintf(stderr, "Error: hurwitz auto failed at s=%g+i%g q=%g+i%g\n",
+				        sre[i], sim[i], qre[j], qim[j]);
+				continue;
+			}
+			if (0.0 == qim[j] && 2 != i)
+				cpx_hurwitz_zeta (ref, ess, que[0].re, prec);
+			else
+				cpx_hurwitz_taylor (ref, ess, que, prec);
+
+			cpx_sub (diff, val, ref);
+			cpx_div (diff, diff, ref);
+			nfaults = cpx_check_for_zero (nfaults, diff, epsi, "hurwitz auto", j,
+			                  sre[i], qre[j]);
+		}
+	}
+	if (nfaults) fprintf(stderr, "---\n");
+
+	cpx_clear (ess);
+	cpx_clear (que);
+	cpx_clear (val);
+	cpx_clear (ref);
+	cpx_clear (diff);
+	mpf_clear (epsi);
+
+	if (0 == nfaults)
+	{
+		fprintf(stderr, "Hurwitz auto test passed!\n");
+	}
+	return nfaults;
+}
+
+/* ==================================================================== */
+/**
+ * test_hurwitz_euler() -- Euler-Maclaurin, both variants, against
+ * cpx_hurwitz_zeta; and high up, at q=1, against the Riemann zeta,
+ * where a fixed cutoff M would leave the asymptotic tail divergent.
+ */
+int test_hurwitz_euler (int nterms, int prec)
+{
+	int nfaults = 0;
+	int i;
+	double sre[] = {0.6, 0.6, -1.3, 0.5};
+	double sim[] = {2.0, 2.0, 7.0, 150.0};
+	double qre[] = {0.3, 1.7, 0.45, 1.0};
+
+	cpx_t ess, que, val, vfp, ref, diff;
+	cpx_init (ess);
+	cpx_init (que);
+	cpx_init (val);
+	cpx_init (vfp);
+	cpx_init (ref);
+	cpx_init (diff);
+
+	mpf_t epsi;
+	mpf_init (epsi);
+	fp_epsilon (epsi, prec-4);
+
+	for (i=0; i<4; i++)
+	{
+		cpx_set_d (ess, sre[i], sim[i]);
+		cpx_set_d (que, qre[i], 0.0);
+		cpx_hurwitz_euler (val, ess, que, prec);
+		cpx_hurwitz_euler_fp (vfp, ess, que[0].re, prec);
+		if (3 == i)
+			cpx_borwein_zeta (ref, ess, prec);
+		else
+			cpx_hurwitz_zeta (ref, ess, que[0].re, prec);
+
+		cpx_sub (diff, val, ref);
+		cpx_div (diff, diff, ref);
+		nfaults = cpx_check_for_zero (nfaults, diff, epsi, "hurwitz euler", i,
+		                  sim[i], qre[i]);
+
+		cpx_sub (diff, vfp, ref);
+		cpx_div (diff, diff, ref);
+		nfaults = cpx_check_for_zero (nfaults, diff, epsi, "hurwitz euler fp", i,
+		                  sim[i], qre[i]);
+	}
+	if (nfaults) fprintf(stderr, "---\n");
+
+	cpx_clear (ess);
+	cpx_clear (que);
+	cpx_clear (val);
+	cpx_clear (vfp);
+	cpx_clear (ref);
+	cpx_clear (diff);
+	mpf_clear (epsi);
+
+	if (0 == nfaults)
+	{
+		fprintf(stderr, "Hurwitz Euler-Maclaurin test passed!\n");
+	}
+	return nfaults;
+}
+
+/* ==================================================================== */
+/**
+ * test_polylog_near_one -- close to z=1, the polylog is summed as a
+ * series in log z. Compare to the inversion formula,
+ *
+ * (1-e^{2pi is}) Li_s(z) = e^{i pi s/2} (2pi)^s / Gamma(s)
+ *                [zeta(1-s, rho) - e^{pi is} zeta(1-s, 1-rho)]
+ *
+ * with rho = log z / 2pi i, and the Hurwitz zetas done by
+ * Euler-Maclaurin. This holds for Im z >= 0.
+ */
+int test_polylog_near_one (int nterms, int prec)
+{
+	int nfaults = 0;
+	int i, j;
+	double sre[] = {0.5, 2.5, -1.3};
+	double sim[] = {3.0, 0.5, 0.7};
+	double zre[] = {0.999, 0.99, 1.01, 1.3};
+	double zim[] = {0.001, 0.01, 0.01, 0.4};
+
+	cpx_t ess, zee, val, ref, rho, omr, oms, a, b, diff;
+	cpx_init (ess);
+	cpx_init (zee);
+	cpx_init (val);
+	cpx_init (ref);
+	cpx_init (rho);
+	cpx_init (omr);
+	cpx_init (oms);
+	cpx_init (a);
+	cpx_init (b);
+	cpx_init (diff);
+
+	mpf_t twopi, epsi;
+	mpf_init (twopi);
+	mpf_init (epsi);
+	fp_two_pi (twopi, prec);
+	fp_epsilon (epsi, prec-4);
+
+	for (i=0; i<3; i++)
+	{
+		cpx_set_d (ess, sre[i], sim[i]);
+		cpx_set_ui (oms, 1, 0);
+		cpx_sub (oms, oms, ess);
+		for (j=0; j<4; j++)
+		{
+			cpx_set_d (zee, zre[j], zim[j]);
+			cpx_polylog (val, ess, zee, prec);
+
+			/* rho = -i log z / 2pi */
+			cpx_log (rho, zee, prec);
+			cpx_div_mpf (rho, rho, twopi);
+			cpx_times_i (rho, rho);
+			cpx_neg (rho, rho);
+			cpx_set_ui (omr, 1, 0);
+			cpx_sub (omr, omr, rho);
+
+			/* ref = zeta(1-s,rho) - e^{pi is} zeta(1-s,1-rho) */
+			cpx_hurwitz_euler (ref, oms, rho, prec);
+			cpx_hurwitz_euler (a, oms, omr, prec);
+			cpx_times_mpf (b, ess, twopi);
+			cpx_div_ui (b, b, 2);
+			cpx_times_i (b, b);
+			cpx_exp (b, b, prec);
+			cpx_mul (a, a, b);
+			cpx_sub (ref, ref, a);
+
+			/* times e^{i pi s/2} (2pi)^s / Gamma(s) (1-e^{2pi is}) */
+			cpx_times_mpf (b, ess, twopi);
+			cpx_div_ui (b, b, 4);
+			cpx_times_i (b, b);
+			cpx_exp (b, b, prec);
+			cpx_mul (ref, ref, b);
+			cpx_mpf_pow (b, twopi, ess, prec);
+			cpx_mul (ref, ref, b);
+			cpx_gamma (b, ess, prec);
+			cpx_div (ref, ref, b);
+			cpx_times_mpf (b, ess, twopi);
+			cpx_times_i (b, b);
+			cpx_exp (b, b, prec);
+			cpx_set_ui (a, 1, 0);
+			cpx_sub (a, a, b);
+			cpx_div (ref, ref, a);
+
+			cpx_sub (diff, val, ref);
+			cpx_div (diff, diff, ref);
+			nfaults = cpx_check_for_zero (nfaults, diff, epsi, "polylog near one",
+			                  i, zre[j], zim[j]);
+		}
+	}
+	if (nfaults) fprintf(stderr, "---\n");
+
+	cpx_clear (ess);
+	cpx_clear (zee);
+	cpx_clear (val);
+	cpx_clear (ref);
+	cpx_clear (rho);
+	cpx_clear (omr);
+	cpx_clear (oms);
+	cpx_clear (a);
+	cpx_clear (b);
+	cpx_clear (diff);
+	mpf_clear (twopi);
+	mpf_clear (epsi);
+
+	if (0 == nfaults)
+	{
+		fprintf(stderr, "Polylog near z=1 test passed!\n");
+	}
+	return nfaults;
+}
+
+/* ==================================================================== */
+/**
+ * test_polylog_nint_batch -- Li_{-n}(z) for many n at once, by the
+ * recurrence in n, against one n at a time, by the Eulerian
+ * polynomials; and the exact rational values against both.
+ */
+int test_polylog_nint_batch (int nterms, int prec)
+{
+	int nfaults = 0;
+	int i, n;
+	int maxn = 30;
+	long num[] = {-5, 3, 9, 13};
+	unsigned long den[] = {2, 7, 10, 4};
+
+	mpf_t epsi;
+	mpf_init (epsi);
+	fp_epsilon (epsi, prec-4);
+
+	mpq_t qz, qv;
+	mpq_init (qz);
+	mpq_init (qv);
+
+	cpx_t zee, val, diff;
+	cpx_init (zee);
+	cpx_init (val);
+	cpx_init (diff);
+	cpx_t *batch = (cpx_t *) malloc ((maxn+1) * sizeof (cpx_t));
+	for (n=0; n<=maxn; n++) cpx_init (batch[n]);
+
+	for (i=0; i<4; i++)
+	{
+		mpq_set_si (qz, num[i], den[i]);
+		mpf_set_q (zee[0].re, qz);
+		mpf_set_d (zee[0].im, 0.1*i);
+		cpx_polylog_nint_batch (batch, maxn, zee);
+		for (n=0; n<=maxn; n++)
+		{
+			cpx_polylog_nint (val, n, zee);
+			cpx_sub (diff, val, batch[n]);
+			cpx_div (diff, diff, val);
+			nfaults = cpx_check_for_zero (nfaults, diff, epsi, "polylog nint batch",
+			                  n, cpx_get_re (zee), cpx_get_im (zee));
+		}
+
+		/* The exact values, on the real axis */
+		mpf_set_ui (zee[0].im, 0);
+		for (n=0; n<=maxn; n+=7)
+		{
+			q_polylog_nint (qv, n, qz);
+			cpx_polylog_nint (val, n, zee);
+			mpf_set_q (diff[0].re, qv);
+			mpf_set_ui (diff[0].im, 0);
+			cpx_sub (diff, val, diff);
+			cpx_div (diff, diff, val);
+			nfaults = cpx_check_for_zero (nfaults, diff, epsi, "polylog nint exact",
+			                  n, cpx_get_re (zee), 0.0);
+		}
+	}
+
+	/* The pole */
+	mpq_set_ui (qz, 1, 1);
+	if (0 == q_polylog_nint (qv, 3, qz))
+	{
+		fprintf (stderr, "Error: q_polylog_nint did not report the pole at z=1\n");
+		nfaults ++;
+	}
+	if (nfaults) fprintf(stderr, "---\n");
+
+	for (n=0; n<=maxn; n++) cpx_clear (batch[n]);
+	free (batch);
+	cpx_clear (zee);
+	cpx_clear (val);
+	cpx_clear (diff);
+	mpq_clear (qz);
+	mpq_clear (qv);
+	mpf_clear (epsi);
+
+	if (0 == nfaults)
+	{
+		fprintf(stderr, "Negative integer polylog batch test passed!\n");
+	}
+	return nfaults;
+}
+
+/* ==================================================================== */
+/**
+ * test_gamma_large_im -- Gamma far from the real axis, where the
+ * Stirling series is used, against |Gamma(1/2+it)|^2 = pi/cosh(pi t)
+ * and Gamma(1+it) = it Gamma(it).
+ */
+int test_gamma_large_im (int nterms, int prec)
+{
+	int nfaults = 0;
+	int i;
+	double tee[] = {3.3, 17.0, 101.0, 1234.5, 10001.0};
+
+	mpf_t epsi, pi, ch;
+	mpf_init (epsi);
+	mpf_init (pi);
+	mpf_init (ch);
+	fp_epsilon (epsi, prec-4);
+	fp_pi (pi, prec);
+
+	cpx_t zee, gam, ref, diff;
+	cpx_init (zee);
+	cpx_init (gam);
+	cpx_init (ref);
+	cpx_init (diff);
+
+	for (i=0; i<5; i++)
+	{
+		/* |Gamma(1/2+it)|^2 cosh(pi t) / pi = 1 */
+		cpx_set_d (zee, 0.5, tee[i]);
+		cpx_gamma (gam, zee, prec);
+		cpx_mod_sq (diff[0].re, gam);
+		mpf_set_d (ch, tee[i]);
+		mpf_mul (ch, ch, pi);
+		fp_exp (ch, ch, prec);
+		mpf_ui_div (diff[0].im, 1, ch);
+		mpf_add (ch, ch, diff[0].im);
+		mpf_div_ui (ch, ch, 2);
+		mpf_mul (diff[0].re, diff[0].re, ch);
+		mpf_div (diff[0].re, diff[0].re, pi);
+		mpf_sub_ui (diff[0].re, diff[0].re, 1);
+		mpf_set_ui (diff[0].im, 0);
+		nfaults = cpx_check_for_zero (nfaults, diff, epsi, "gamma half line",
+		                  i, 0.5, tee[i]);
+
+		/* Gamma(1+it) = it Gamma(it) */
+		cpx_set_d (zee, 0.0, tee[i]);
+		cpx_gamma (gam, zee, prec);
+		cpx_mul (gam, gam, zee);
+		cpx_add_ui (zee, zee, 1, 0);
+		cpx_gamma (ref, zee, prec);
+		cpx_sub (diff, gam, ref);
+		cpx_div (diff, diff, ref);
+		nfaults = cpx_check_for_zero (nfaults, diff, epsi, "gamma recurrence",
+		                  i, 1.0, tee[i]);
+	}
+	if (nfaults) fprintf(stderr, "---\n");
+
+	cpx_clear (zee);
+	cpx_clear (gam);
+	cpx_clear (ref);
+	cpx_clear (diff);
+	mpf_clear (epsi);
+	mpf_clear (pi);
+	mpf_clear (ch);
+
+	if (0 == nfaults)
+	{
+		fprintf(stderr, "Gamma at large imaginary part test passed!\n");
+	}
+	return nfaults;
+}
+
+/* ==================================================================== */
+/**
+ * test_lngamma -- log Gamma against log(z) = lnGamma(z+1) - lnGamma(z),
+ * which holds only on the principal branch, and against Gamma itself.
+ */
+int test_lngamma (int nterms, int prec)
+{
+	int nfaults = 0;
+	int i;
+	double pts[][2] = {{-2.5, 0.1}, {-2.5, -0.1}, {-7.3, 0.2}, {0.9, 0.0},
+	                   {-40.5, 30.0}, {3.7, -12.0}, {-300.3, -2.0},
+	                   {0.5, 1000.0}, {-3.2, 10000.0}};
+
+	mpf_t epsi, lg, gam;
+	mpf_init (epsi);
+	mpf_init (lg);
+	mpf_init (gam);
+	fp_epsilon (epsi, prec-4);
+
+	cpx_t zee, lng, ref, diff;
+	cpx_init (zee);
+	cpx_init (lng);
+	cpx_init (ref);
+	cpx_init (diff);
+
+	for (i=0; i<9; i++)
+	{
+		double x = pts[i][0];
+		double y = pts[i][1];
+		cpx_set_d (zee, x, y);
+		cpx_lngamma (lng, zee, prec);
+		cpx_log (diff, zee, prec);
+		cpx_add (diff, diff, lng);
+		cpx_add_ui (zee, zee, 1, 0);
+		cpx_lngamma (ref, zee, prec);
+		cpx_sub (diff, diff, ref);
+		nfaults = cpx_check_for_zero (nfaults, diff, epsi, "lngamma recurrence",
+		                  i, x, y);
+
+		/* Gamma itself, where it is of modest size */
+		if (1000.0 < fabs (x) + fabs (y)) continue;
+		cpx_set_d (zee, x, y);
+		cpx_exp (lng, lng, prec);
+		cpx_gamma (ref, zee, prec);
+		cpx_sub (diff, lng, ref);
+		cpx_div (diff, diff, ref);
+		nfaults = cpx_check_for_zero (nfaults, diff, epsi, "exp lngamma",
+		                  i, x, y);
+	}
+
+	/* log |Gamma(-2.5)| */
+	mpf_set_d (lg, -2.5);
+	fp_gamma (gam, lg, prec);
+	mpf_abs (gam, gam);
+	fp_log (gam, gam, prec);
+	fp_lngamma (lg, lg, prec);
+	mpf_sub (diff[0].re, lg, gam);
+	mpf_set_ui (diff[0].im, 0);
+	nfaults = cpx_check_for_zero (nfaults, diff, epsi, "real lngamma",
+	                  0, -2.5, 0.0);
+	if (nfaults) fprintf(stderr, "---\n");
+
+	cpx_clear (zee);
+	cpx_clear (lng);
+	cpx_clear (ref);
+	cpx_clear (diff);
+	mpf_clear (epsi);
+	mpf_clear (lg);
+	mpf_clear (gam);
+
+	if (0 == nfaults)
+	{
+		fprintf(stderr, "Complex lngamma test passed!\n");
+	}
+	return nfaults;
+}
+
+/* ==================================================================== */
+/* Riemann zeta, and its derivative, for the Newton zero finder */
+static void dual_zeta (cpx_t f, cpx_t fp, cpx_t z, int nprec)
+{
+	cpx_t one;
+	cpx_init (one);
+	cpx_set_ui (one, 1, 0);
+	cpx_hurwitz_zeta_d (f, fp, NULL, z, one, nprec);
+	cpx_clear (one);
+}
+
+/**
+ * test_dual_derivatives -- the derivatives from cpx_polylog_d and
+ * cpx_hurwitz_zeta_d, against the recurrences in z and q, and
+ * against central differences in s; then find the first Riemann
+ * zero with the Newton zero finder.
+ */
+int test_dual_derivatives (int nterms, int prec)
+{
+	int nfaults = 0;
+	int i, j;
+	double sre[] = {2.5, 0.7};
+	double sim[] = {0.3, -3.0};
+	double zre[] = {0.4, -1.2};
+	double zim[] = {0.3, 0.6};
+	double qre[] = {0.3, 1.7};
+	double qim[] = {0.0, 0.4};
+
+	mpf_t epsi, deps, h;
+	mpf_init (epsi);
+	mpf_init (deps);
+	mpf_init (h);
+	fp_epsilon (epsi, prec-4);
+	fp_epsilon (deps, prec/2-2);
+	fp_epsilon (h, prec/3);
+
+	cpx_t ess, sp, sm, zee, val, ds, dz, ref, a, b, diff;
+	cpx_init (ess);
+	cpx_init (sp);
+	cpx_init (sm);
+	cpx_init (zee);
+	cpx_init (val);
+	cpx_init (ds);
+	cpx_init (dz);
+	cpx_init (ref);
+	cpx_init (a);
+	cpx_init (b);
+	cpx_init (diff);
+
+	for (i=0; i<2; i++)
+	{
+		cpx_set_d (ess, sre[i], sim[i]);
+		cpx_set (sp, ess);
+		mpf_add (sp[0].re, sp[0].re, h);
+		cpx_set (sm, ess);
+		mpf_sub (sm[0].re, sm[0].re, h);
+
+		for (j=0; j<2; j++)
+		{
+			/* d/dz Li_s(z) = Li_{s-1}(z) / z */
+			cpx_set_d (zee, zre[j], zim[j]);
+			cpx_polylog_d (val, ds, dz, ess, zee, prec);
+			cpx_polylog (ref, ess, zee, prec);
+			cpx_sub (diff, val, ref);
+			cpx_div (diff, diff, ref);
+			nfaults = cpx_check_for_zero (nfaults, diff, epsi, "dual polylog",
+			                  i, zre[j], zim[j]);
+
+			cpx_sub_ui (a, ess, 1, 0);
+			cpx_polylog (ref, a, zee, prec);
+			cpx_div (ref, ref, zee);
+			cpx_sub (diff, dz, ref);
+			cpx_div (diff, diff, ref);
+			nfaults = cpx_check_for_zero (nfaults, diff, epsi, "dual polylog dz",
+			                  i, zre[j], zim[j]);
+
+			cpx_polylog (a, sp, zee, prec);
+			cpx_polylog (b, sm, zee, prec);
+			cpx_sub (ref, a, b);
+			cpx_div_mpf (ref, ref, h);
+			cpx_div_ui (ref, ref, 2);
+			cpx_sub (diff, ds, ref);
+			cpx_div (diff, diff, ref);
+			nfaults = cpx_check_for_zero (nfaults, diff, deps, "dual polylog ds",
+			                  i, zre[j], zim[j]);
+
+			/* d/dq zeta(s,q) = -s zeta(s+1,q) */
+			cpx_set_d (zee, qre[j], qim[j]);
+			cpx_hurwitz_zeta_d (val, ds, dz, ess, zee, prec);
+			cpx_hurwitz_euler (ref, ess, zee, prec);
+			cpx_sub (diff, val, ref);
+			cpx_div (diff, diff, ref);
+			nfaults = cpx_check_for_zero (nfaults, diff, epsi, "dual hurwitz",
+			                  i, qre[j], qim[j]);
+
+			cpx_add_ui (a, ess, 1, 0);
+			cpx_hurwitz_euler (ref, a, zee, prec);
+			cpx_mul (ref, ref, ess);
+			cpx_neg (ref, ref);
+			cpx_sub (diff, dz, ref);
+			cpx_div (diff, diff, ref);
+			nfaults = cpx_check_for_zero (nfaults, diff, epsi, "dual hurwitz dq",
+			                  i, qre[j], qim[j]);
+
+			cpx_hurwitz_euler (a, sp, zee, prec);
+			cpx_hurwitz_euler (b, sm, zee, prec);
+			cpx_sub (ref, a, b);
+			cpx_div_mpf (ref, ref, h);
+			cpx_div_ui (ref, ref, 2);
+			cpx_sub (diff, ds, ref);
+			cpx_div (diff, diff, ref);
+			nfaults = cpx_check_for_zero (nfaults, diff, deps, "dual hurwitz ds",
+			                  i, qre[j], qim[j]);
+		}
+	}
+
+	/* The first Riemann zero */
+	cpx_set_d (zee, 0.5, 14.0);
+	if (cpx_find_zero_newton (val, dual_zeta, zee, prec-4, prec))
+	{
+		fprintf (stderr, "Error: Newton zero finder did not converge\n");
+		nfaults ++;
+	}
+	cpx_set_ui (ref, 0, 0);
+	mpf_set_str (ref[0].re, "0.5", 10);
+	mpf_set_str (ref[0].im, "14.13472514173469379045725198356247027078425711569924"
+	             "3175685567460149963429809256764949", 10);
+	cpx_sub (diff, val, ref);
+	nfaults = cpx_check_for_zero (nfaults, diff, epsi, "newton zeta zero",
+	                  0, 0.5, 14.0);
+	if (nfaults) fprintf(stderr, "---\n");
+
+	cpx_clear (ess);
+	cpx_clear (sp);
+	cpx_clear (sm);
+	cpx_clear (zee);
+	cpx_clear (val);
+	cpx_clear (ds);
+	cpx_clear (dz);
+	cpx_clear (ref);
+	cpx_clear (a);
+	cpx_clear (b);
+	cpx_clear (diff);
+	mpf_clear (epsi);
+	mpf_clear (deps);
+	mpf_clear (h);
+
+	if (0 == nfaults)
+	{
+		fprintf(stderr, "Dual number derivative test passed!\n");
+	}
+	return nfaults;
+}
+
 /* ==================================================================== */
 
 int main (int argc, char * argv[])
@@ -1826,7 +3365,7 @@ int main (int argc, char * argv[])
 	mpf_init (stie);
 	int i;
 	for (i=0; i<40; i++ ) {
-		stieltjes_gamma (stie, i);
+		stieltjes_gamma (stie, i, prec);
 		printf ("gamma[%d] = ", i);
 		mpf_out_str (stdout, 10, 60, stie);
 		printf (";\n");
@@ -1973,6 +3512,25 @@ int main (int argc, char * argv[])
 	nfaults += test_polylog_euler (nterms, prec);
 	nfaults += test_polylog_series (nterms, prec);
  	nfaults += test_periodic_zeta (nterms, prec);
+	nfaults += test_fp_zeta_range (nterms, prec);
+	nfaults += test_stieltjes (nterms, prec);
+	nfaults += test_riemann_siegel (nterms, prec);
+	nfaults += test_zeta_grid (nterms, prec);
+	nfaults += test_lowprec (nterms, prec);
+	nfaults += test_polylog_grid (nterms, prec);
+	nfaults += test_polylog_threads (nterms, prec);
+	nfaults += test_cpx_polylog_grid (nterms, prec);
+	nfaults += test_polylog_memo (nterms, prec);
+	nfaults += test_periodic_zeta_batch (nterms, prec);
+	nfaults += test_hurwitz_threads (nterms, prec);
+	nfaults += test_hurwitz_taylor_batch (nterms, prec);
+	nfaults += test_hurwitz_auto (nterms, prec);
+	nfaults += test_hurwitz_euler (nterms, prec);
+	nfaults += test_polylog_near_one (nterms, prec);
+	nfaults += test_polylog_nint_batch (nterms, prec);
+	nfaults += test_dual_derivatives (nterms, prec);
+	nfaults += test_gamma_large_im (nterms, prec);
+	nfaults += test_lngamma (nterms, prec);
 
 	if (0 == nfaults)
 	{
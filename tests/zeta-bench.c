@@ -0,0 +1,143 @@
+/*
+ * zeta-bench.c
+ *
+ * Timing of the Riemann zeta function high up on the critical line,
+ * where cpx_borwein_zeta uses the Riemann-Siegel formula, and where
+ * cpx_zeta_grid evaluates many points at once. For
+ * comparison, the Borwein algorithm is timed as well, for t up to
+ * the (optional) command-line argument; it needs O(t) terms and O(t)
+ * digits of precision, and so becomes hopelessly slow beyond a few
+ * thousand.
+ *
+ * Copyright (C) 2026 Linas Vepstas
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301  USA
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <gmp.h>
+#include "mp-complex.h"
+#include "mp-misc.h"
+#include "mp-zeta.h"
+
+static double now (void)
+{
+	struct timespec ts;
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + 1.0e-9 * ts.tv_nsec;
+}
+
+/* ==================================================================== */
+
+int main (int argc, char * argv[])
+{
+	double tees[] = {1.0e3, 1.0e4, 1.0e5};
+	int precs[] = {7, 10, 13};
+	double tmax = 1.0e3;
+	int i;
+
+	if (1 < argc) tmax = atof (argv[1]);
+
+	cpx_t ess, zeta;
+	for (i=0; i<3; i++)
+	{
+		double t = tees[i];
+		int prec = precs[i];
+
+		/* Borwein loses about pi t / 2 log 10 digits to cancellation */
+		int bprec = prec + (int) (0.6822 * t) + 10;
+		mpf_set_default_prec (3.322 * bprec + 50);
+		cpx_init (ess);
+		cpx_init (zeta);
+		cpx_set_d (ess, 0.5, t);
+
+		int n = 0;
+		double start = now ();
+		do
+		{
+			cpx_borwein_zeta (zeta, ess, prec);
+			n++;
+		} while (now() - start < 1.0);
+		double rs = (now() - start) / n;
+
+		printf ("t=%g prec=%d zeta=", t, prec);
+		cpx_prt ("", zeta);
+		printf ("\n\tRiemann-Siegel: %g msecs\n", 1.0e3 * rs);
+
+		if (t <= tmax)
+		{
+			/* Asking for more digits than Riemann-Siegel can
+			 * deliver forces the Borwein algorithm. */
+			start = now ();
+			cpx_borwein_zeta (zeta, ess, bprec);
+			double bor = now() - start;
+			printf ("\tBorwein: %g msecs, ratio=%g\n", 1.0e3 * bor, bor / rs);
+		}
+		fflush (stdout);
+
+		cpx_clear (ess);
+		cpx_clear (zeta);
+	}
+
+	/* Many points at once, on a grid */
+	double gtees[] = {1.0e5, 1.0e6, 1.0e7};
+	int gprecs[] = {13, 16, 18};
+	int npts = 1000;
+	for (i=0; i<3; i++)
+	{
+		int j;
+		mpf_set_default_prec (3.322 * gprecs[i] + 100);
+
+		mpf_t sigma, t0, dt;
+		mpf_init (sigma);
+		mpf_init (t0);
+		mpf_init (dt);
+		mpf_set_d (sigma, 0.5);
+		mpf_set_d (t0, gtees[i]);
+		mpf_set_d (dt, 0.01);
+
+		cpx_t *grid = (cpx_t *) malloc (npts * sizeof (cpx_t));
+		for (j=0; j<npts; j++) cpx_init (grid[j]);
+
+		double start = now ();
+		cpx_zeta_grid (grid, sigma, t0, dt, npts, gprecs[i]);
+		double gr = (now() - start) / npts;
+
+		cpx_init (ess);
+		cpx_set_d (ess, 0.5, gtees[i]);
+		start = now ();
+		for (j=0; j<10; j++) cpx_borwein_zeta (grid[j], ess, gprecs[i]);
+		double one = (now() - start) / 10;
+
+		printf ("grid of %d at t=%g prec=%d: %g msecs/point, "
+		        "one at a time: %g msecs, ratio=%g\n",
+		        npts, gtees[i], gprecs[i], 1.0e3 * gr, 1.0e3 * one, one / gr);
+		fflush (stdout);
+
+		for (j=0; j<npts; j++) cpx_clear (grid[j]);
+		free (grid);
+		cpx_clear (ess);
+		mpf_clear (sigma);
+		mpf_clear (t0);
+		mpf_clear (dt);
+	}
+
+	return 0;
+}